@@ -0,0 +1,26 @@
+#include "timereport.h"
+#include <cstdlib>
+#include <new>
+
+// operator new do executavel, que alimenta as alocacoes do --time-report.
+// Fica fora da libcompilador.a: substituir o operador global e decisao de
+// quem monta o programa, nao da biblioteca.
+
+void* operator new(std::size_t size) {
+    recordAllocation(size);
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,47 @@
+#include "asmwriter.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// Media generosa de bytes por instrucao em AT&T, para reservar o buffer
+// de uma vez.
+static const size_t BYTES_PER_INSTR = 24;
+
+bool writeAsm(const std::vector<MFunction>& program, const std::string& path) {
+    std::string text;
+    return writeAsm(program, path, text);
+}
+
+bool writeAsm(const std::vector<MFunction>& program, const std::string& path, std::string& text) {
+    printProgram(program, text);
+    return writeFile(path, text.data(), text.size());
+}
+
+void printProgram(const std::vector<MFunction>& program, std::string& text) {
+    size_t instructions = 0;
+    for (const auto& fn : program) {
+        instructions += fn.code.size();
+    }
+
+    text.clear();
+    text.reserve(instructions * BYTES_PER_INSTR);
+    AsmPrinter printer(text);
+    for (const auto& fn : program) {
+        printer.print(fn.code);
+    }
+}
+
+bool writeFile(const std::string& path, const char* data, size_t size) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written <= 0) {
+            ::close(fd);
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return ::close(fd) == 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "machine.h"
+#include <string>
+#include <vector>
+
+// Grava o programa em assembly no arquivo path. O texto inteiro e montado
+// num unico buffer e sai em poucas chamadas de write; devolve false se o
+// arquivo nao puder ser criado ou escrito.
+bool writeAsm(const std::vector<MFunction>& program, const std::string& path);
+
+// O mesmo, montando o texto em buffer: quem grava muitos arquivos reusa a
+// memoria ja reservada em vez de pedir outra a cada programa.
+bool writeAsm(const std::vector<MFunction>& program, const std::string& path, std::string& buffer);
+
+// Monta em text (substituindo o conteudo) o assembly do programa inteiro.
+void printProgram(const std::vector<MFunction>& program, std::string& text);
+
+// Grava data no arquivo path com open/write, repetindo escritas parciais.
+bool writeFile(const std::string& path, const char* data, size_t size);
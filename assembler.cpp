@@ -0,0 +1,755 @@
+#include "assembler.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+enum class FixupKind { REL, ABS32S, ABS64 };
+
+// Campo de uma instrucao que depende do endereco de um simbolo. Em REL o
+// addend ja desconta a distancia entre o campo e o fim da instrucao.
+struct Fixup {
+    size_t offset;
+    int width;
+    FixupKind kind;
+    std::string symbol;
+    int64_t addend;
+};
+
+struct Encoding {
+    std::vector<uint8_t> bytes;
+    std::vector<Fixup> fixups;
+};
+
+bool fitsInt8(long long v) {
+    return v >= -128 && v <= 127;
+}
+
+bool fitsInt32(long long v) {
+    return v >= -2147483648LL && v <= 2147483647LL;
+}
+
+int regCode(Reg r) {
+    return static_cast<int>(r);
+}
+
+bool isJump(const MInstr& instr) {
+    return (instr.op == MOp::JMP || instr.op == MOp::JCC) && instr.operands.size() == 1 &&
+           instr.operands[0].kind == MOperand::Kind::SYMBOL;
+}
+
+class Encoder {
+public:
+    Encoder(const MInstr& in, bool longJump) : in(in), longJump(longJump) {}
+
+    Encoding run() {
+        encode();
+        for (auto& fixup : out.fixups) {
+            if (fixup.kind == FixupKind::REL) {
+                fixup.addend -= static_cast<int64_t>(out.bytes.size() - fixup.offset);
+            }
+        }
+        return std::move(out);
+    }
+
+private:
+    const MInstr& in;
+    bool longJump;
+    Encoding out;
+
+    [[noreturn]] void invalid() const {
+        std::ostringstream text;
+        printAsm({in}, text);
+        std::string line = text.str();
+        line = line.substr(line.find_first_not_of(' '));
+        throw std::runtime_error("Erro de montagem: operandos invalidos em '" +
+                                 line.substr(0, line.find('\n')) + "'");
+    }
+
+    void byte(int b) {
+        out.bytes.push_back(static_cast<uint8_t>(b));
+    }
+
+    void value(long long v, int width) {
+        for (int i = 0; i < width; i++) {
+            byte(static_cast<int>((static_cast<unsigned long long>(v) >> (8 * i)) & 0xff));
+        }
+    }
+
+    void fixup(FixupKind kind, int width, const std::string& symbol, int64_t addend) {
+        out.fixups.push_back(Fixup{out.bytes.size(), width, kind, symbol, addend});
+        value(0, width);
+    }
+
+    // Imediato de ate 32 bits, estendido com sinal pela instrucao.
+    void immediate(const MOperand& op, int width) {
+        if (!op.symbol.empty()) {
+            if (width != 4) invalid();
+            fixup(FixupKind::ABS32S, 4, op.symbol, op.imm);
+            return;
+        }
+        if (width == 1 ? !fitsInt8(op.imm) && (op.imm < 0 || op.imm > 255) : !fitsInt32(op.imm)) invalid();
+        value(op.imm, width);
+    }
+
+    static bool needsRex8(const MOperand& op) {
+        return op.isReg() && op.size == 1 && op.reg >= Reg::RSP && op.reg <= Reg::RDI;
+    }
+
+    void rex(bool wide, int regField, const MOperand* rm, bool force = false) {
+        int bits = wide ? 8 : 0;
+        if (regField & 8) bits |= 4;
+        if (rm && rm->isReg() && (regCode(rm->reg) & 8)) bits |= 1;
+        if (rm && rm->isMem() && rm->hasBase && (regCode(rm->base) & 8)) bits |= 1;
+        if (rm && rm->isMem() && rm->hasIndex && (regCode(rm->index) & 8)) bits |= 2;
+        if (bits || force || (rm && needsRex8(*rm))) byte(0x40 | bits);
+    }
+
+    static int scaleBits(int scale) {
+        return scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+    }
+
+    void displacement32(const MOperand& m) {
+        if (!m.symbol.empty()) {
+            fixup(FixupKind::ABS32S, 4, m.symbol, m.imm);
+        } else {
+            if (!fitsInt32(m.imm)) invalid();
+            value(m.imm, 4);
+        }
+    }
+
+    void modrm(int regField, const MOperand& rm) {
+        int reg = (regField & 7) << 3;
+        if (rm.isReg()) {
+            byte(0xc0 | reg | (regCode(rm.reg) & 7));
+            return;
+        }
+        if (!rm.isMem()) invalid();
+
+        if (!rm.hasBase) {
+            int index = rm.hasIndex ? regCode(rm.index) & 7 : 4;
+            byte(0x04 | reg);
+            byte(scaleBits(rm.scale) << 6 | index << 3 | 5);
+            displacement32(rm);
+            return;
+        }
+
+        int base = regCode(rm.base) & 7;
+        int mod;
+        if (!rm.symbol.empty() || !fitsInt8(rm.imm)) {
+            mod = 2;
+        } else if (rm.imm == 0 && base != 5) {
+            mod = 0;
+        } else {
+            mod = 1;
+        }
+        bool sib = rm.hasIndex || base == 4;
+        byte(mod << 6 | reg | (sib ? 4 : base));
+        if (sib) {
+            int index = rm.hasIndex ? regCode(rm.index) & 7 : 4;
+            byte(scaleBits(rm.scale) << 6 | index << 3 | base);
+        }
+        if (mod == 1) {
+            value(rm.imm, 1);
+        } else if (mod == 2) {
+            displacement32(rm);
+        }
+    }
+
+    // Forma geral: [REX] opcode ModRM [SIB] [disp]. regField e um
+    // registrador ou a extensao /digito do opcode.
+    void op(std::initializer_list<int> opcode, int size, int regField, const MOperand& rm,
+            bool byteRegister = false) {
+        bool force = byteRegister && size == 1 && regField >= 4 && regField < 8;
+        rex(size == 8, regField, &rm, force);
+        for (int b : opcode) byte(b);
+        modrm(regField, rm);
+    }
+
+    // SSE2: o prefixo obrigatorio (66 ou F3) vem antes do REX, e o opcode
+    // depois de 0F. wide pede REX.W (movq com registrador geral).
+    void sse(int prefix, int opcode, int regField, const MOperand& rm, bool wide = false) {
+        byte(prefix);
+        rex(wide, regField, &rm);
+        byte(0x0f);
+        byte(opcode);
+        modrm(regField, rm);
+    }
+
+    int xmm(size_t i) const {
+        if (!operand(i).isXmm()) invalid();
+        return regCode(operand(i).reg);
+    }
+
+    // op xmm/m128, xmm
+    void packed(int opcode) {
+        expectOperands(2);
+        if (operand(0).isReg() && !operand(0).isXmm()) invalid();
+        sse(0x66, opcode, xmm(1), operand(0));
+    }
+
+    // Registrador codificado no proprio opcode (push, pop, mov imediato).
+    void opReg(int opcode, int size, Reg reg, bool force = false) {
+        int bits = (size == 8 ? 8 : 0) | (regCode(reg) & 8 ? 1 : 0);
+        if (bits || force) byte(0x40 | bits);
+        byte(opcode + (regCode(reg) & 7));
+    }
+
+    const MOperand& operand(size_t i) const {
+        if (i >= in.operands.size()) invalid();
+        return in.operands[i];
+    }
+
+    void expectOperands(size_t count) const {
+        if (in.operands.size() != count) invalid();
+    }
+
+    void mov(int size) {
+        expectOperands(2);
+        const MOperand& src = operand(0);
+        const MOperand& dst = operand(1);
+        if (src.isReg() && (dst.isReg() || dst.isMem())) {
+            op({size == 1 ? 0x88 : 0x89}, size, regCode(src.reg), dst, true);
+        } else if (src.isMem() && dst.isReg()) {
+            op({size == 1 ? 0x8a : 0x8b}, size, regCode(dst.reg), src, true);
+        } else if (src.isImm() && dst.isReg()) {
+            if (size == 8 && src.symbol.empty() && !fitsInt32(src.imm)) {
+                opReg(0xb8, 8, dst.reg);
+                value(src.imm, 8);
+            } else if (size == 8) {
+                op({0xc7}, 8, 0, dst);
+                immediate(src, 4);
+            } else {
+                opReg(size == 1 ? 0xb0 : 0xb8, size, dst.reg, needsRex8(dst));
+                immediate(src, size == 1 ? 1 : 4);
+            }
+        } else if (src.isImm() && dst.isMem()) {
+            op({size == 1 ? 0xc6 : 0xc7}, size, 0, dst);
+            immediate(src, size == 1 ? 1 : 4);
+        } else {
+            invalid();
+        }
+    }
+
+    void arithmetic(int digit, int size) {
+        expectOperands(2);
+        const MOperand& src = operand(0);
+        const MOperand& dst = operand(1);
+        if (src.isImm()) {
+            if (dst.kind != MOperand::Kind::REG && !dst.isMem()) invalid();
+            bool accumulator = dst.is(Reg::RAX);
+            if (accumulator && (size == 1 || !src.symbol.empty() || !fitsInt8(src.imm))) {
+                // forma curta com al/eax/rax, como o GNU as escolhe
+                if (size == 8) byte(0x48);
+                byte(digit * 8 + (size == 1 ? 4 : 5));
+                immediate(src, size == 1 ? 1 : 4);
+            } else if (size == 1) {
+                op({0x80}, 1, digit, dst);
+                immediate(src, 1);
+            } else if (src.symbol.empty() && fitsInt8(src.imm)) {
+                op({0x83}, size, digit, dst);
+                value(src.imm, 1);
+            } else {
+                op({0x81}, size, digit, dst);
+                immediate(src, 4);
+            }
+        } else if (src.isReg() && (dst.isReg() || dst.isMem())) {
+            op({digit * 8 + (size == 1 ? 0 : 1)}, size, regCode(src.reg), dst, true);
+        } else if (src.isMem() && dst.isReg()) {
+            op({digit * 8 + (size == 1 ? 2 : 3)}, size, regCode(dst.reg), src, true);
+        } else {
+            invalid();
+        }
+    }
+
+    void test(int size) {
+        expectOperands(2);
+        const MOperand& src = operand(0);
+        const MOperand& dst = operand(1);
+        if (src.isImm()) {
+            op({size == 1 ? 0xf6 : 0xf7}, size, 0, dst);
+            immediate(src, size == 1 ? 1 : 4);
+        } else if (src.isReg()) {
+            op({size == 1 ? 0x84 : 0x85}, size, regCode(src.reg), dst, true);
+        } else if (dst.isReg()) {
+            op({size == 1 ? 0x84 : 0x85}, size, regCode(dst.reg), src, true);
+        } else {
+            invalid();
+        }
+    }
+
+    void unary(int byteOpcode, int opcode, int digit, int size) {
+        expectOperands(1);
+        op({size == 1 ? byteOpcode : opcode}, size, digit, operand(0));
+    }
+
+    void shift(int digit, int size) {
+        const MOperand& dst = in.operands.empty() ? operand(0) : in.operands.back();
+        if (in.operands.size() == 1) {
+            op({size == 1 ? 0xd0 : 0xd1}, size, digit, dst);
+            return;
+        }
+        expectOperands(2);
+        const MOperand& count = operand(0);
+        if (count.isImm() && count.symbol.empty()) {
+            if (count.imm == 1) {
+                op({size == 1 ? 0xd0 : 0xd1}, size, digit, dst);
+            } else {
+                op({size == 1 ? 0xc0 : 0xc1}, size, digit, dst);
+                value(count.imm, 1);
+            }
+        } else if (count.isReg() && count.reg == Reg::RCX) {
+            op({size == 1 ? 0xd2 : 0xd3}, size, digit, dst);
+        } else {
+            invalid();
+        }
+    }
+
+    void imul(int size) {
+        if (in.operands.size() == 2 && operand(0).isImm()) {
+            const MOperand& dst = operand(1);
+            if (!dst.isReg()) invalid();
+            multiplyImmediate(size, dst, dst, operand(0));
+        } else if (in.operands.size() == 2) {
+            const MOperand& dst = operand(1);
+            if (!dst.isReg()) invalid();
+            op({0x0f, 0xaf}, size, regCode(dst.reg), operand(0));
+        } else {
+            expectOperands(3);
+            if (!operand(0).isImm() || !operand(2).isReg()) invalid();
+            multiplyImmediate(size, operand(1), operand(2), operand(0));
+        }
+    }
+
+    void multiplyImmediate(int size, const MOperand& src, const MOperand& dst, const MOperand& factor) {
+        if (factor.symbol.empty() && fitsInt8(factor.imm)) {
+            op({0x6b}, size, regCode(dst.reg), src);
+            value(factor.imm, 1);
+        } else {
+            op({0x69}, size, regCode(dst.reg), src);
+            immediate(factor, 4);
+        }
+    }
+
+    void branch(int shortOpcode, std::initializer_list<int> longOpcode, int indirectDigit) {
+        expectOperands(1);
+        const MOperand& target = operand(0);
+        if (target.kind != MOperand::Kind::SYMBOL) {
+            if (indirectDigit < 0) invalid();
+            op({0xff}, 4, indirectDigit, target);
+            return;
+        }
+        if (longJump || shortOpcode < 0) {
+            for (int b : longOpcode) byte(b);
+            fixup(FixupKind::REL, 4, target.symbol, 0);
+        } else {
+            byte(shortOpcode);
+            fixup(FixupKind::REL, 1, target.symbol, 0);
+        }
+    }
+
+    void encode() {
+        int size = in.operandSize();
+        int cc = static_cast<int>(in.cond);
+        switch (in.op) {
+            case MOp::LABEL:
+            case MOp::SECTION:
+            case MOp::GLOBL:
+            case MOp::LCOMM:
+            case MOp::INCLUDE:
+            case MOp::ALIGN:
+                break;
+            case MOp::BYTE:
+                for (const auto& v : in.operands) immediate(v, 1);
+                break;
+            case MOp::QUAD:
+                for (const auto& v : in.operands) {
+                    if (v.symbol.empty()) {
+                        value(v.imm, 8);
+                    } else {
+                        fixup(FixupKind::ABS64, 8, v.symbol, v.imm);
+                    }
+                }
+                break;
+            case MOp::ASCII:
+                out.bytes.insert(out.bytes.end(), in.name.begin(), in.name.end());
+                break;
+            case MOp::ZERO:
+                out.bytes.resize(out.bytes.size() + static_cast<size_t>(operand(0).imm), 0);
+                break;
+            case MOp::MOV: mov(size); break;
+            case MOp::MOVZB:
+                expectOperands(2);
+                if (!operand(1).isReg()) invalid();
+                op({0x0f, 0xb6}, size, regCode(operand(1).reg), operand(0));
+                break;
+            case MOp::LEA:
+                expectOperands(2);
+                if (!operand(0).isMem() || !operand(1).isReg()) invalid();
+                op({0x8d}, size, regCode(operand(1).reg), operand(0));
+                break;
+            case MOp::ADD: arithmetic(0, size); break;
+            case MOp::OR: arithmetic(1, size); break;
+            case MOp::AND: arithmetic(4, size); break;
+            case MOp::SUB: arithmetic(5, size); break;
+            case MOp::XOR: arithmetic(6, size); break;
+            case MOp::CMP: arithmetic(7, size); break;
+            case MOp::TEST: test(size); break;
+            case MOp::IMUL: imul(size); break;
+            case MOp::MUL: unary(0xf6, 0xf7, 4, size); break;
+            case MOp::IDIV: unary(0xf6, 0xf7, 7, size); break;
+            case MOp::DIV: unary(0xf6, 0xf7, 6, size); break;
+            case MOp::NEG: unary(0xf6, 0xf7, 3, size); break;
+            case MOp::INC: unary(0xfe, 0xff, 0, size); break;
+            case MOp::DEC: unary(0xfe, 0xff, 1, size); break;
+            case MOp::SHL: shift(4, size); break;
+            case MOp::SHR: shift(5, size); break;
+            case MOp::SAR: shift(7, size); break;
+            case MOp::BSR:
+                expectOperands(2);
+                if (!operand(1).isReg() || size == 1) invalid();
+                op({0x0f, 0xbd}, size, regCode(operand(1).reg), operand(0));
+                break;
+            case MOp::BT:
+                expectOperands(2);
+                if (!operand(0).isReg() || size == 1) invalid();
+                op({0x0f, 0xa3}, size, regCode(operand(0).reg), operand(1));
+                break;
+            case MOp::CQO:
+                byte(0x48);
+                byte(0x99);
+                break;
+            case MOp::PUSH: {
+                expectOperands(1);
+                const MOperand& src = operand(0);
+                if (src.isReg()) {
+                    opReg(0x50, 4, src.reg);
+                } else if (src.isImm() && src.symbol.empty() && fitsInt8(src.imm)) {
+                    byte(0x6a);
+                    value(src.imm, 1);
+                } else if (src.isImm()) {
+                    byte(0x68);
+                    immediate(src, 4);
+                } else {
+                    op({0xff}, 4, 6, src);
+                }
+                break;
+            }
+            case MOp::POP:
+                expectOperands(1);
+                if (operand(0).isReg()) {
+                    opReg(0x58, 4, operand(0).reg);
+                } else {
+                    op({0x8f}, 4, 0, operand(0));
+                }
+                break;
+            case MOp::CALL: branch(-1, {0xe8}, 2); break;
+            case MOp::JMP: branch(0xeb, {0xe9}, 4); break;
+            case MOp::JCC: branch(0x70 + cc, {0x0f, 0x80 + cc}, -1); break;
+            case MOp::SETCC:
+                expectOperands(1);
+                op({0x0f, 0x90 + cc}, 1, 0, operand(0));
+                break;
+            case MOp::RET: byte(0xc3); break;
+            case MOp::LEAVE: byte(0xc9); break;
+            case MOp::SYSCALL:
+                byte(0x0f);
+                byte(0x05);
+                break;
+            case MOp::RDTSC:
+                byte(0x0f);
+                byte(0x31);
+                break;
+            case MOp::REP_STOSQ:
+                byte(0xf3);
+                byte(0x48);
+                byte(0xab);
+                break;
+            case MOp::XCHG: {
+                expectOperands(2);
+                const MOperand& reg = operand(0).isReg() ? operand(0) : operand(1);
+                const MOperand& other = operand(0).isReg() ? operand(1) : operand(0);
+                if (!reg.isReg() || reg.isXmm()) invalid();
+                op({size == 1 ? 0x86 : 0x87}, size, regCode(reg.reg), other, true);
+                break;
+            }
+            case MOp::PAUSE:
+                byte(0xf3);
+                byte(0x90);
+                break;
+            case MOp::LOCK_ADD:
+                if (!operand(1).isMem()) invalid();
+                byte(0xf0);
+                arithmetic(0, size);
+                break;
+            case MOp::MOVDQU:
+            case MOp::MOVDQA: {
+                expectOperands(2);
+                int prefix = in.op == MOp::MOVDQU ? 0xf3 : 0x66;
+                if (operand(1).isXmm() && !(operand(0).isReg() && !operand(0).isXmm())) {
+                    sse(prefix, 0x6f, xmm(1), operand(0));
+                } else if (operand(1).isMem()) {
+                    sse(prefix, 0x7f, xmm(0), operand(1));
+                } else {
+                    invalid();
+                }
+                break;
+            }
+            case MOp::MOVQ:
+                expectOperands(2);
+                if (operand(1).isXmm() && operand(0).isReg() && !operand(0).isXmm()) {
+                    sse(0x66, 0x6e, xmm(1), operand(0), true);
+                } else if (operand(0).isXmm() && operand(1).isReg() && !operand(1).isXmm()) {
+                    sse(0x66, 0x7e, xmm(0), operand(1), true);
+                } else {
+                    invalid();
+                }
+                break;
+            case MOp::PUNPCKLQDQ: packed(0x6c); break;
+            case MOp::PADDQ: packed(0xd4); break;
+            case MOp::PSUBQ: packed(0xfb); break;
+            case MOp::PCMPEQD: packed(0x76); break;
+            case MOp::PAND: packed(0xdb); break;
+            case MOp::PXOR: packed(0xef); break;
+            case MOp::PSHUFD:
+                expectOperands(3);
+                if (!operand(0).isImm() || !operand(1).isXmm()) invalid();
+                sse(0x66, 0x70, xmm(2), operand(1));
+                value(operand(0).imm, 1);
+                break;
+            case MOp::PSRLQ:
+                expectOperands(2);
+                if (!operand(0).isImm() || !operand(1).isXmm()) invalid();
+                sse(0x66, 0x73, 2, operand(1));
+                value(operand(0).imm, 1);
+                break;
+        }
+    }
+};
+
+Encoding encode(const MInstr& instr, bool longJump) {
+    return Encoder(instr, longJump).run();
+}
+
+}
+
+const ObjectSymbol* ObjectCode::find(const std::string& name) const {
+    for (const auto& symbol : symbols) {
+        if (symbol.name == name) return &symbol;
+    }
+    return nullptr;
+}
+
+Assembler::Assembler(std::vector<std::string> includeDirs) : includeDirs(std::move(includeDirs)) {}
+
+int Assembler::sectionIndex(const std::string& name) {
+    for (size_t i = 0; i < object.sections.size(); i++) {
+        if (object.sections[i].name == name) return static_cast<int>(i);
+    }
+    if (name != ".text" && name != ".data" && name != ".bss" && name != ".rodata" &&
+        name != ".note.GNU-stack") {
+        throw std::runtime_error("Erro de montagem: secao nao suportada '" + name + "'");
+    }
+    ObjectSection section;
+    section.name = name;
+    section.align = name == ".text" ? 16 : name == ".note.GNU-stack" ? 1 : 8;
+    object.sections.push_back(section);
+    items.emplace_back();
+    return static_cast<int>(object.sections.size()) - 1;
+}
+
+void Assembler::preload(const std::string& file, std::shared_ptr<const std::vector<MInstr>> code) {
+    preloaded[file] = std::move(code);
+}
+
+const std::vector<MInstr>& Assembler::include(const std::string& file) {
+    auto ready = preloaded.find(file);
+    if (ready != preloaded.end()) return *ready->second;
+    for (const auto& dir : includeDirs) {
+        std::string path = file[0] == '/' || dir.empty() ? file : dir + "/" + file;
+        std::ifstream in(path);
+        if (!in.is_open()) continue;
+        std::stringstream text;
+        text << in.rdbuf();
+        includedCode.push_back(parseAsm(text.str()));
+        return includedCode.back();
+    }
+    throw std::runtime_error("Erro de montagem: nao foi possivel abrir '" + file + "'");
+}
+
+void Assembler::collect(const std::vector<MInstr>& code, int& section) {
+    for (const auto& instr : code) {
+        switch (instr.op) {
+            case MOp::SECTION:
+                section = sectionIndex(instr.name);
+                break;
+            case MOp::INCLUDE:
+                collect(include(instr.name), section);
+                break;
+            case MOp::GLOBL:
+                globals.insert(instr.name);
+                break;
+            case MOp::LCOMM:
+                commons.push_back(&instr);
+                break;
+            case MOp::LABEL:
+                if (labels.count(instr.name)) {
+                    throw std::runtime_error("Erro de montagem: simbolo '" + instr.name + "' redefinido");
+                }
+                labels[instr.name] = Label{section, items[section].size()};
+                items[section].push_back(Item{&instr});
+                break;
+            default:
+                items[section].push_back(Item{&instr});
+                break;
+        }
+    }
+}
+
+bool Assembler::isLocalTarget(const std::string& symbol, int section) const {
+    auto label = labels.find(symbol);
+    return label != labels.end() && label->second.section == section &&
+           label->second.item != Label::COMMON;
+}
+
+static uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+    return alignment > 1 ? (offset + alignment - 1) / alignment * alignment : offset;
+}
+
+// Calcula o deslocamento de cada item. Todo desvio local comeca curto; os
+// que nao alcancam o alvo passam para rel32 e a disposicao e refeita ate
+// nao haver mudanca (os tamanhos so crescem, entao o laco termina).
+void Assembler::layout(int section) {
+    auto& list = items[section];
+    for (auto& item : list) {
+        item.longJump = isJump(*item.instr) && !isLocalTarget(item.instr->operands[0].symbol, section);
+        item.size = encode(*item.instr, item.longJump).bytes.size();
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        uint64_t offset = 0;
+        for (auto& item : list) {
+            if (item.instr->op == MOp::ALIGN) {
+                item.size = alignUp(offset, item.instr->operands[0].imm) - offset;
+            }
+            item.offset = offset;
+            offset += item.size;
+        }
+        for (auto& item : list) {
+            if (!isJump(*item.instr) || item.longJump) continue;
+            uint64_t target = list[labels.at(item.instr->operands[0].symbol).item].offset;
+            long long distance = static_cast<long long>(target) - static_cast<long long>(item.offset + item.size);
+            if (!fitsInt8(distance)) {
+                item.longJump = true;
+                item.size = encode(*item.instr, true).bytes.size();
+                changed = true;
+            }
+        }
+    }
+}
+
+void Assembler::emit(int section) {
+    ObjectSection& out = object.sections[section];
+    bool nobits = out.name == ".bss";
+    std::vector<uint8_t> bytes;
+
+    for (const auto& item : items[section]) {
+        if (item.instr->op == MOp::ALIGN) {
+            if (item.instr->operands[0].imm > static_cast<long long>(out.align)) {
+                out.align = item.instr->operands[0].imm;
+            }
+            bytes.resize(bytes.size() + item.size, out.name == ".text" ? 0x90 : 0);
+            continue;
+        }
+
+        Encoding enc = encode(*item.instr, item.longJump);
+        for (const auto& fix : enc.fixups) {
+            uint64_t place = item.offset + fix.offset;
+            if (fix.kind == FixupKind::REL && isLocalTarget(fix.symbol, section)) {
+                uint64_t target = items[section][labels.at(fix.symbol).item].offset;
+                long long distance = static_cast<long long>(target) + fix.addend - static_cast<long long>(place);
+                for (int i = 0; i < fix.width; i++) {
+                    enc.bytes[fix.offset + i] = static_cast<uint8_t>((static_cast<unsigned long long>(distance) >> (8 * i)) & 0xff);
+                }
+                continue;
+            }
+
+            uint32_t type = R_X86_64_32S;
+            if (fix.kind == FixupKind::ABS64) {
+                type = R_X86_64_64;
+            } else if (fix.kind == FixupKind::REL) {
+                type = labels.count(fix.symbol) ? R_X86_64_PC32 : R_X86_64_PLT32;
+            }
+            out.relocations.push_back(Relocation{place, fix.symbol, type, fix.addend});
+            referenced.insert(fix.symbol);
+        }
+        bytes.insert(bytes.end(), enc.bytes.begin(), enc.bytes.end());
+    }
+
+    out.size = bytes.size();
+    if (nobits) {
+        for (uint8_t b : bytes) {
+            if (b) throw std::runtime_error("Erro de montagem: dados nao nulos em .bss");
+        }
+    } else {
+        out.data = std::move(bytes);
+    }
+}
+
+ObjectCode Assembler::assemble(const std::vector<MInstr>& code) {
+    object = ObjectCode();
+    items.clear();
+    labels.clear();
+    globals.clear();
+    commons.clear();
+    referenced.clear();
+    includedCode.clear();
+
+    int section = sectionIndex(".text");
+    collect(code, section);
+
+    for (size_t s = 0; s < items.size(); s++) {
+        layout(static_cast<int>(s));
+        emit(static_cast<int>(s));
+    }
+
+    // .lcomm reserva espaco no fim da .bss, alinhado pelo tamanho pedido
+    // (no maximo 8 bytes, como o GNU as).
+    if (!commons.empty()) {
+        int bss = sectionIndex(".bss");
+        ObjectSection& out = object.sections[bss];
+        for (const MInstr* common : commons) {
+            uint64_t size = static_cast<uint64_t>(common->operands[0].imm);
+            uint64_t alignment = size >= 8 ? 8 : size >= 4 ? 4 : size >= 2 ? 2 : 1;
+            if (alignment > out.align) out.align = alignment;
+            if (labels.count(common->name)) {
+                throw std::runtime_error("Erro de montagem: simbolo '" + common->name + "' redefinido");
+            }
+            out.size = alignUp(out.size, alignment);
+            labels[common->name] = Label{bss, Label::COMMON, out.size};
+            out.size += size;
+        }
+    }
+
+    for (const auto& entry : labels) {
+        const Label& label = entry.second;
+        ObjectSymbol symbol;
+        symbol.name = entry.first;
+        symbol.section = label.section;
+        symbol.value = label.item == Label::COMMON ? label.value : items[label.section][label.item].offset;
+        symbol.global = globals.count(entry.first) > 0;
+        object.symbols.push_back(symbol);
+    }
+    for (const auto& name : referenced) {
+        if (labels.count(name)) continue;
+        ObjectSymbol symbol;
+        symbol.name = name;
+        symbol.global = true;
+        object.symbols.push_back(symbol);
+    }
+
+    return std::move(object);
+}
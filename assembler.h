@@ -0,0 +1,95 @@
+#pragma once
+#include "machine.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Tipos de relocacao do x86-64 usados pelo montador.
+enum RelocationType : uint32_t {
+    R_X86_64_64 = 1,
+    R_X86_64_PC32 = 2,
+    R_X86_64_PLT32 = 4,
+    R_X86_64_32S = 11
+};
+
+struct Relocation {
+    uint64_t offset;
+    std::string symbol;
+    uint32_t type;
+    int64_t addend;
+};
+
+struct ObjectSection {
+    std::string name;
+    std::vector<uint8_t> data;  // vazio em secoes NOBITS (.bss)
+    uint64_t size = 0;
+    uint64_t align = 1;
+    std::vector<Relocation> relocations;
+};
+
+struct ObjectSymbol {
+    std::string name;
+    int section = -1;  // indice em ObjectCode::sections; -1 = indefinido
+    uint64_t value = 0;
+    bool global = false;
+};
+
+// Resultado da montagem: secoes ja codificadas, simbolos e as relocacoes
+// que so o ligador (ou o carregador do JIT) consegue resolver.
+struct ObjectCode {
+    std::vector<ObjectSection> sections;
+    std::vector<ObjectSymbol> symbols;
+
+    const ObjectSymbol* find(const std::string& name) const;
+};
+
+// Montador x86-64 para o subconjunto de instrucoes produzido pelo emissor
+// e usado pelo runtime.s. Desvios para rotulos da mesma secao comecam na
+// forma curta (rel8) e so crescem para rel32 quando nao alcancam o alvo.
+class Assembler {
+public:
+    explicit Assembler(std::vector<std::string> includeDirs = {"."});
+    ObjectCode assemble(const std::vector<MInstr>& code);
+
+    // Instrucoes ja lidas de um arquivo de .include, usadas no lugar dele:
+    // quem monta muitos programas interpreta o runtime.s uma vez so.
+    void preload(const std::string& file, std::shared_ptr<const std::vector<MInstr>> code);
+
+private:
+    struct Item {
+        const MInstr* instr;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        bool longJump = false;
+    };
+
+    // Rotulos apontam para um item da secao; os de .lcomm (COMMON) guardam
+    // o deslocamento diretamente.
+    struct Label {
+        static const size_t COMMON = ~size_t(0);
+        int section;
+        size_t item;
+        uint64_t value = 0;
+    };
+
+    std::vector<std::string> includeDirs;
+    std::deque<std::vector<MInstr>> includedCode;
+    std::map<std::string, std::shared_ptr<const std::vector<MInstr>>> preloaded;
+    std::vector<std::vector<Item>> items;
+    std::map<std::string, Label> labels;
+    std::set<std::string> globals;
+    std::set<std::string> referenced;
+    std::vector<const MInstr*> commons;
+    ObjectCode object;
+
+    int sectionIndex(const std::string& name);
+    void collect(const std::vector<MInstr>& code, int& section);
+    const std::vector<MInstr>& include(const std::string& file);
+    void layout(int section);
+    void emit(int section);
+    bool isLocalTarget(const std::string& symbol, int section) const;
+};
@@ -99,6 +99,30 @@ void FunctionDeclaration::accept(Visitor& visitor) const {
     visitor.visit(*this);
 }
 
+void ExternDeclaration::accept(Visitor& visitor) const {
+    visitor.visit(*this);
+}
+
 void FunctionCall::accept(Visitor& visitor) const {
     visitor.visit(*this);
 }
+
+void ArrayDeclaration::accept(Visitor& visitor) const {
+    visitor.visit(*this);
+}
+
+void ArrayAccess::accept(Visitor& visitor) const {
+    visitor.visit(*this);
+}
+
+void ArrayAssignment::accept(Visitor& visitor) const {
+    visitor.visit(*this);
+}
+
+void ParallelForStatement::accept(Visitor& visitor) const {
+    visitor.visit(*this);
+}
+
+void MatchStatement::accept(Visitor& visitor) const {
+    visitor.visit(*this);
+}
@@ -6,6 +6,7 @@
 #include <vector>
 
 class Visitor;
+class WhileStatement;
 
 enum class Operador { SOMA, SUB, MULT, DIV };
 
@@ -17,6 +18,25 @@ std::string operadorToString(Operador op);
 std::string comparisonOperatorToString(ComparisonOperator op);
 std::string logicalOperatorToString(LogicalOperator op);
 
+// Onde mora cada nome, decidido uma vez por bindNames (binder.h) antes da
+// geracao de codigo. Parametros e locais tem um slot no quadro da funcao
+// (os parametros nos primeiros); globais, o indice na ordem das
+// declaracoes.
+enum class StorageClass { GLOBAL, PARAMETER, LOCAL };
+
+struct Binding {
+    StorageClass storage = StorageClass::GLOBAL;
+    int slot = -1;
+};
+
+// Quando um acesso a vetor dispensa a checagem de limites, decidido por
+// markBoundsChecks (bounds.h): sempre (indice constante dentro do vetor)
+// ou so dentro da versao de loop que ja sabe o indice nao negativo.
+struct BoundsCheck {
+    bool proven = false;
+    const WhileStatement* loop = nullptr;
+};
+
 class Exp {
 public:
     virtual ~Exp() = default;
@@ -48,6 +68,7 @@ public:
 class BlockStatement : public Statement {
 public:
     std::vector<std::unique_ptr<Statement>> statements;
+    mutable bool declaresArrays = false;  // tem let de vetor local (bindNames)
     
     void addStatement(std::unique_ptr<Statement> stmt) {
         statements.push_back(std::move(stmt));
@@ -59,6 +80,7 @@ public:
 class MainFunction : public Statement {
 public:
     std::unique_ptr<BlockStatement> body;
+    mutable int frameSlots = 0;  // locais, contadas por bindNames
     
     explicit MainFunction(std::unique_ptr<BlockStatement> b) 
         : body(std::move(b)) {}
@@ -80,6 +102,7 @@ class VarDeclaration : public Statement {
 public:
     std::string identifier;
     std::unique_ptr<Exp> initializer;
+    mutable Binding binding;
     
     VarDeclaration(std::string name, std::unique_ptr<Exp> init = nullptr)
         : identifier(std::move(name)), initializer(std::move(init)) {}
@@ -87,6 +110,26 @@ public:
     void accept(Visitor& visitor) const override;
 };
 
+// Maior vetor aceito, global ou local: 2^27 elementos (1 GiB).
+const long long MAX_ARRAY_LENGTH = 1LL << 27;
+
+// Vetor de inteiros, zerado na declaracao. Global, fica no .bss e o
+// tamanho precisa ser constante; local, e reservado na pilha quando o let
+// executa e vale ate o fim do bloco.
+class ArrayDeclaration : public Statement {
+public:
+    std::string identifier;
+    std::unique_ptr<Exp> size;
+    // local: slot do endereco; o seguinte guarda o tamanho
+    mutable Binding binding;
+    mutable long long length = -1;  // tamanho constante, ou -1 (bindNames)
+
+    ArrayDeclaration(std::string name, std::unique_ptr<Exp> size)
+        : identifier(std::move(name)), size(std::move(size)) {}
+
+    void accept(Visitor& visitor) const override;
+};
+
 class Const : public Exp {
 public:
     int valor;
@@ -108,6 +151,7 @@ public:
 class Variable : public Exp {
 public:
     std::string name;
+    mutable Binding binding;
 
     explicit Variable(std::string n) : name(std::move(n)) {}
     
@@ -166,6 +210,7 @@ class AssignmentExpression : public Exp {
 public:
     std::string variable;
     std::unique_ptr<Exp> value;
+    mutable Binding binding;
 
     AssignmentExpression(std::string var, std::unique_ptr<Exp> val)
         : variable(std::move(var)), value(std::move(val)) {}
@@ -173,6 +218,33 @@ public:
     void accept(Visitor& visitor) const override;
 };
 
+class ArrayAccess : public Exp {
+public:
+    std::string name;
+    std::unique_ptr<Exp> index;
+    mutable const ArrayDeclaration* array = nullptr;  // preenchido por bindNames
+    mutable BoundsCheck bounds;
+
+    ArrayAccess(std::string n, std::unique_ptr<Exp> idx)
+        : name(std::move(n)), index(std::move(idx)) {}
+
+    void accept(Visitor& visitor) const override;
+};
+
+class ArrayAssignment : public Exp {
+public:
+    std::string name;
+    std::unique_ptr<Exp> index;
+    std::unique_ptr<Exp> value;
+    mutable const ArrayDeclaration* array = nullptr;
+    mutable BoundsCheck bounds;
+
+    ArrayAssignment(std::string n, std::unique_ptr<Exp> idx, std::unique_ptr<Exp> val)
+        : name(std::move(n)), index(std::move(idx)), value(std::move(val)) {}
+
+    void accept(Visitor& visitor) const override;
+};
+
 class IfStatement : public Statement {
 public:
     std::unique_ptr<Exp> condition;
@@ -190,12 +262,68 @@ public:
     std::unique_ptr<Exp> condition;
     std::unique_ptr<Statement> body;
 
+    // Variavel da condicao que indexa vetores sem checagem na versao
+    // rapida do laco, e se essa versao depende de testar na entrada que ela
+    // nao e negativa (markBoundsChecks, bounds.h).
+    mutable const Variable* boundsIndex = nullptr;
+    mutable bool entryTest = false;
+
     WhileStatement(std::unique_ptr<Exp> cond, std::unique_ptr<Statement> bodyStmt)
         : condition(std::move(cond)), body(std::move(bodyStmt)) {}
 
     void accept(Visitor& visitor) const override;
 };
 
+// parfor (i = inicio; i < fim) reduce (a, b) corpo: as iteracoes podem
+// rodar ao mesmo tempo, em threads diferentes. i e uma local nova, so do
+// corpo, que nao pode mudar; as variaveis de fora sao so lidas, menos as do
+// reduce, locais que cada thread soma numa copia propria comecando em 0.
+// Vetores podem ser escritos.
+class ParallelForStatement : public Statement {
+public:
+    std::string index;
+    std::unique_ptr<Exp> start;
+    std::unique_ptr<Exp> end;
+    std::vector<std::string> reductions;
+    std::unique_ptr<Statement> body;
+
+    // Preenchidos por bindNames: o slot de i, os slots de fora lidos no
+    // corpo (o tamanho de um vetor local conta como slot) e os do reduce.
+    mutable Binding binding;
+    mutable std::vector<int> captured;
+    mutable std::vector<int> reductionSlots;
+
+    ParallelForStatement(std::string index, std::unique_ptr<Exp> start, std::unique_ptr<Exp> end,
+                         std::vector<std::string> reductions, std::unique_ptr<Statement> body)
+        : index(std::move(index)), start(std::move(start)), end(std::move(end)),
+          reductions(std::move(reductions)), body(std::move(body)) {}
+
+    void accept(Visitor& visitor) const override;
+};
+
+// Braco de um match: os valores que o escolhem e o bloco que executa.
+struct MatchArm {
+    std::vector<int> values;
+    std::unique_ptr<BlockStatement> body;
+};
+
+// match (x) { 1 => { ... } 2, 3 => { ... } _ => { ... } }: avalia x uma
+// vez e executa o bloco do braco que tem esse valor, ou o do _ (opcional)
+// se nenhum tiver; um braco nao continua no seguinte. Os valores sao
+// constantes inteiras, sem repeticao entre os bracos (bindNames).
+class MatchStatement : public Statement {
+public:
+    std::unique_ptr<Exp> subject;
+    std::vector<MatchArm> arms;
+    std::unique_ptr<BlockStatement> otherwise;  // braco _, ou nulo
+
+    MatchStatement(std::unique_ptr<Exp> subject, std::vector<MatchArm> arms,
+                   std::unique_ptr<BlockStatement> otherwise = nullptr)
+        : subject(std::move(subject)), arms(std::move(arms)), otherwise(std::move(otherwise)) {}
+
+    void accept(Visitor& visitor) const override;
+};
+
 class ReturnStatement : public Statement {
 public:
     std::unique_ptr<Exp> expression;
@@ -218,6 +346,8 @@ public:
     std::string name;
     std::vector<Parameter> parameters;
     std::unique_ptr<BlockStatement> body;
+    mutable int frameSlots = 0;  // parametros e locais, contados por bindNames
+    mutable bool declaresArrays = false;
     
     FunctionDeclaration(std::string n, std::vector<Parameter> params, std::unique_ptr<BlockStatement> b)
         : name(std::move(n)), parameters(std::move(params)), body(std::move(b)) {}
@@ -225,6 +355,19 @@ public:
     void accept(Visitor& visitor) const override;
 };
 
+// Funcao implementada fora do programa (libc ou objeto C proprio), sempre
+// chamada pela convencao System V.
+class ExternDeclaration : public Statement {
+public:
+    std::string name;
+    std::vector<Parameter> parameters;
+    
+    ExternDeclaration(std::string n, std::vector<Parameter> params)
+        : name(std::move(n)), parameters(std::move(params)) {}
+    
+    void accept(Visitor& visitor) const override;
+};
+
 class FunctionCall : public Exp {
 public:
     std::string name;
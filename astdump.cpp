@@ -0,0 +1,983 @@
+#include "astdump.h"
+#include "visitor.h"
+#include <cstdint>
+#include <unordered_map>
+
+namespace {
+
+// Buffer de saida: os visitors so acrescentam texto, e out recebe blocos
+// de CHUNK bytes.
+class Writer {
+public:
+    static const size_t CHUNK = 1 << 16;
+
+    explicit Writer(std::ostream& out) : out(out) { buffer.reserve(CHUNK + 256); }
+
+    void put(char c) {
+        buffer += c;
+        if (buffer.size() >= CHUNK) drain();
+    }
+
+    void text(std::string_view s) {
+        buffer.append(s.data(), s.size());
+        if (buffer.size() >= CHUNK) drain();
+    }
+
+    void number(long long value) { text(std::to_string(value)); }
+
+    void indent(int depth) { buffer.append(static_cast<size_t>(depth) * 2, ' '); }
+
+    void drain() {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+private:
+    std::ostream& out;
+    std::string buffer;
+};
+
+// O formato da antiga PrintVisitor, linha por linha; a profundidade sobe e
+// desce num unico visitor.
+class TextDumper : public Visitor {
+public:
+    explicit TextDumper(Writer& out) : out(out) {}
+
+    void visit(const Program& node) override {
+        line("Program");
+        int declNum = 1;
+        for (const auto& decl : node.globalDeclarations) {
+            child("|- Global Declaration ", declNum++, ":");
+            nested(*decl, 2);
+        }
+        if (node.mainFunction) {
+            child("|- Main Function:");
+            nested(*node.mainFunction, 2);
+        }
+    }
+
+    void visit(const BlockStatement& node) override {
+        line("BlockStatement");
+        int stmtNum = 1;
+        for (const auto& stmt : node.statements) {
+            child("|- Statement ", stmtNum++, ":");
+            nested(*stmt, 2);
+        }
+    }
+
+    void visit(const MainFunction& node) override {
+        line("MainFunction()");
+        nested(*node.body, 1);
+    }
+
+    void visit(const ExpressionStatement& node) override {
+        line("ExpressionStatement");
+        nested(*node.expression, 1);
+    }
+
+    void visit(const VarDeclaration& node) override {
+        named("VarDeclaration(\"", node.identifier, "\")");
+        if (node.initializer) {
+            child("|- Initializer:");
+            nested(*node.initializer, 2);
+        }
+    }
+
+    void visit(const ArrayDeclaration& node) override {
+        named("ArrayDeclaration(\"", node.identifier, "\")");
+        child("|- Size:");
+        nested(*node.size, 2);
+    }
+
+    void visit(const IfStatement& node) override {
+        line("IfStatement");
+        line("|- Condition:");
+        nested(*node.condition, 1);
+        line("|- Then:");
+        nested(*node.thenBranch, 1);
+        if (node.elseBranch) {
+            line("|- Else:");
+            nested(*node.elseBranch, 1);
+        }
+    }
+
+    void visit(const WhileStatement& node) override {
+        line("WhileStatement");
+        line("|- Condition:");
+        nested(*node.condition, 1);
+        line("|- Body:");
+        nested(*node.body, 1);
+    }
+
+    void visit(const ParallelForStatement& node) override {
+        named("ParallelForStatement(\"", node.index, "\")");
+        child("|- Start:");
+        nested(*node.start, 2);
+        child("|- End:");
+        nested(*node.end, 2);
+        for (const auto& name : node.reductions) named("  |- Reduce: ", name, "");
+        child("|- Body:");
+        nested(*node.body, 2);
+    }
+
+    void visit(const MatchStatement& node) override {
+        line("MatchStatement");
+        line("|- Subject:");
+        nested(*node.subject, 1);
+        for (const auto& arm : node.arms) {
+            out.indent(depth);
+            out.text("|- Case ");
+            for (size_t j = 0; j < arm.values.size(); j++) {
+                if (j) out.text(", ");
+                out.number(arm.values[j]);
+            }
+            out.text(":\n");
+            nested(*arm.body, 1);
+        }
+        if (node.otherwise) {
+            line("|- Default:");
+            nested(*node.otherwise, 1);
+        }
+    }
+
+    void visit(const ReturnStatement& node) override {
+        line("|- Return:");
+        nested(*node.expression, 1);
+    }
+
+    void visit(const FunctionDeclaration& node) override {
+        named("FunctionDeclaration(\"", node.name, "\")");
+        parameters(node.parameters);
+        child("|- Body:");
+        nested(*node.body, 2);
+    }
+
+    void visit(const ExternDeclaration& node) override {
+        named("ExternDeclaration(\"", node.name, "\")");
+        parameters(node.parameters);
+    }
+
+    void visit(const Const& node) override {
+        out.indent(depth);
+        out.text("Const(");
+        out.number(node.valor);
+        out.text(")\n");
+    }
+
+    void visit(const BooleanLiteral& node) override {
+        line(node.value ? "Boolean(true)" : "Boolean(false)");
+    }
+
+    void visit(const Variable& node) override {
+        named("Variable(\"", node.name, "\")");
+    }
+
+    void visit(const OpBin& node) override {
+        named("OpBin(", operadorToString(node.op), ")");
+        child("|- Operando Esquerdo:");
+        nested(*node.opEsq, 2);
+        child("|- Operando Direito:");
+        nested(*node.opDir, 2);
+    }
+
+    void visit(const ComparisonExpression& node) override {
+        named("Comparison(", comparisonOperatorToString(node.op), ")");
+        operands(*node.left, *node.right);
+    }
+
+    void visit(const LogicalExpression& node) override {
+        named("Logical(", logicalOperatorToString(node.op), ")");
+        operands(*node.left, *node.right);
+    }
+
+    void visit(const UnaryExpression& node) override {
+        line(node.isNot ? "Unary(!)" : "Unary()");
+        line("|- Operand:");
+        nested(*node.operand, 1);
+    }
+
+    void visit(const AssignmentExpression& node) override {
+        line("Assignment(=)");
+        named("|- Variable: ", node.variable, "");
+        line("|- Value:");
+        nested(*node.value, 1);
+    }
+
+    void visit(const ArrayAccess& node) override {
+        named("ArrayAccess(\"", node.name, "\")");
+        line("|- Index:");
+        nested(*node.index, 1);
+    }
+
+    void visit(const ArrayAssignment& node) override {
+        line("ArrayAssignment(=)");
+        named("|- Array: ", node.name, "");
+        line("|- Index:");
+        nested(*node.index, 1);
+        line("|- Value:");
+        nested(*node.value, 1);
+    }
+
+    void visit(const FunctionCall& node) override {
+        named("FunctionCall(\"", node.name, "\")");
+        child("|- Arguments:");
+        for (size_t j = 0; j < node.arguments.size(); j++) {
+            out.indent(depth + 2);
+            out.text("|- Argument ");
+            out.number(static_cast<long long>(j + 1));
+            out.text(":\n");
+            nested(*node.arguments[j], 3);
+        }
+    }
+
+private:
+    Writer& out;
+    int depth = 0;
+
+    void line(std::string_view text) {
+        out.indent(depth);
+        out.text(text);
+        out.put('\n');
+    }
+
+    void named(std::string_view before, std::string_view name, std::string_view after) {
+        out.indent(depth);
+        out.text(before);
+        out.text(name);
+        out.text(after);
+        out.put('\n');
+    }
+
+    void child(std::string_view text) {
+        out.indent(depth + 1);
+        out.text(text);
+        out.put('\n');
+    }
+
+    void child(std::string_view before, int number, std::string_view after) {
+        out.indent(depth + 1);
+        out.text(before);
+        out.number(number);
+        out.text(after);
+        out.put('\n');
+    }
+
+    template <typename Node>
+    void nested(const Node& node, int extra) {
+        depth += extra;
+        node.accept(*this);
+        depth -= extra;
+    }
+
+    void operands(const Exp& left, const Exp& right) {
+        line("|- Left:");
+        nested(left, 1);
+        line("|- Right:");
+        nested(right, 1);
+    }
+
+    void parameters(const std::vector<Parameter>& params) {
+        child("|- Parameters:");
+        for (size_t j = 0; j < params.size(); j++) {
+            out.indent(depth + 2);
+            out.text("|- Parameter ");
+            out.number(static_cast<long long>(j + 1));
+            out.text(": ");
+            out.text(params[j].name);
+            out.put('\n');
+        }
+    }
+};
+
+// JSON numa linha: cada no e um objeto com "kind" (o nome da classe) e os
+// campos dele; filhos ausentes sao null.
+class JsonDumper : public Visitor {
+public:
+    explicit JsonDumper(Writer& out) : out(out) {}
+
+    void visit(const Program& node) override {
+        out.text("{\"kind\":\"Program\",\"declarations\":");
+        list(node.globalDeclarations);
+        out.text(",\"main\":");
+        optional(node.mainFunction.get());
+        out.put('}');
+    }
+
+    void visit(const BlockStatement& node) override {
+        out.text("{\"kind\":\"BlockStatement\",\"statements\":");
+        list(node.statements);
+        out.put('}');
+    }
+
+    void visit(const MainFunction& node) override {
+        out.text("{\"kind\":\"MainFunction\",\"body\":");
+        node.body->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const ExpressionStatement& node) override {
+        out.text("{\"kind\":\"ExpressionStatement\",\"expression\":");
+        node.expression->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const VarDeclaration& node) override {
+        out.text("{\"kind\":\"VarDeclaration\",\"name\":");
+        string(node.identifier);
+        out.text(",\"initializer\":");
+        optional(node.initializer.get());
+        out.put('}');
+    }
+
+    void visit(const ArrayDeclaration& node) override {
+        out.text("{\"kind\":\"ArrayDeclaration\",\"name\":");
+        string(node.identifier);
+        out.text(",\"size\":");
+        node.size->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const IfStatement& node) override {
+        out.text("{\"kind\":\"IfStatement\",\"condition\":");
+        node.condition->accept(*this);
+        out.text(",\"then\":");
+        node.thenBranch->accept(*this);
+        out.text(",\"else\":");
+        optional(node.elseBranch.get());
+        out.put('}');
+    }
+
+    void visit(const WhileStatement& node) override {
+        out.text("{\"kind\":\"WhileStatement\",\"condition\":");
+        node.condition->accept(*this);
+        out.text(",\"body\":");
+        node.body->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const ParallelForStatement& node) override {
+        out.text("{\"kind\":\"ParallelForStatement\",\"index\":");
+        string(node.index);
+        out.text(",\"start\":");
+        node.start->accept(*this);
+        out.text(",\"end\":");
+        node.end->accept(*this);
+        out.text(",\"reductions\":[");
+        for (size_t i = 0; i < node.reductions.size(); i++) {
+            if (i) out.put(',');
+            string(node.reductions[i]);
+        }
+        out.text("],\"body\":");
+        node.body->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const MatchStatement& node) override {
+        out.text("{\"kind\":\"MatchStatement\",\"subject\":");
+        node.subject->accept(*this);
+        out.text(",\"arms\":[");
+        for (size_t i = 0; i < node.arms.size(); i++) {
+            if (i) out.put(',');
+            out.text("{\"values\":[");
+            for (size_t j = 0; j < node.arms[i].values.size(); j++) {
+                if (j) out.put(',');
+                out.number(node.arms[i].values[j]);
+            }
+            out.text("],\"body\":");
+            node.arms[i].body->accept(*this);
+            out.put('}');
+        }
+        out.text("],\"default\":");
+        optional(node.otherwise.get());
+        out.put('}');
+    }
+
+    void visit(const ReturnStatement& node) override {
+        out.text("{\"kind\":\"ReturnStatement\",\"expression\":");
+        node.expression->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const FunctionDeclaration& node) override {
+        out.text("{\"kind\":\"FunctionDeclaration\",\"name\":");
+        string(node.name);
+        out.text(",\"parameters\":");
+        parameters(node.parameters);
+        out.text(",\"body\":");
+        node.body->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const ExternDeclaration& node) override {
+        out.text("{\"kind\":\"ExternDeclaration\",\"name\":");
+        string(node.name);
+        out.text(",\"parameters\":");
+        parameters(node.parameters);
+        out.put('}');
+    }
+
+    void visit(const Const& node) override {
+        out.text("{\"kind\":\"Const\",\"value\":");
+        out.number(node.valor);
+        out.put('}');
+    }
+
+    void visit(const BooleanLiteral& node) override {
+        out.text(node.value ? "{\"kind\":\"BooleanLiteral\",\"value\":true}"
+                            : "{\"kind\":\"BooleanLiteral\",\"value\":false}");
+    }
+
+    void visit(const Variable& node) override {
+        out.text("{\"kind\":\"Variable\",\"name\":");
+        string(node.name);
+        out.put('}');
+    }
+
+    void visit(const OpBin& node) override {
+        binary("OpBin", operadorToString(node.op), *node.opEsq, *node.opDir);
+    }
+
+    void visit(const ComparisonExpression& node) override {
+        binary("ComparisonExpression", comparisonOperatorToString(node.op), *node.left, *node.right);
+    }
+
+    void visit(const LogicalExpression& node) override {
+        binary("LogicalExpression", logicalOperatorToString(node.op), *node.left, *node.right);
+    }
+
+    void visit(const UnaryExpression& node) override {
+        out.text(node.isNot ? "{\"kind\":\"UnaryExpression\",\"not\":true,\"operand\":"
+                            : "{\"kind\":\"UnaryExpression\",\"not\":false,\"operand\":");
+        node.operand->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const AssignmentExpression& node) override {
+        out.text("{\"kind\":\"AssignmentExpression\",\"name\":");
+        string(node.variable);
+        out.text(",\"value\":");
+        node.value->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const ArrayAccess& node) override {
+        out.text("{\"kind\":\"ArrayAccess\",\"name\":");
+        string(node.name);
+        out.text(",\"index\":");
+        node.index->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const ArrayAssignment& node) override {
+        out.text("{\"kind\":\"ArrayAssignment\",\"name\":");
+        string(node.name);
+        out.text(",\"index\":");
+        node.index->accept(*this);
+        out.text(",\"value\":");
+        node.value->accept(*this);
+        out.put('}');
+    }
+
+    void visit(const FunctionCall& node) override {
+        out.text("{\"kind\":\"FunctionCall\",\"name\":");
+        string(node.name);
+        out.text(",\"arguments\":");
+        list(node.arguments);
+        out.put('}');
+    }
+
+private:
+    Writer& out;
+
+    void string(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        out.put('"');
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out.put('\\');
+                out.put(c);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out.text("\\u00");
+                out.put(hex[(c >> 4) & 0xf]);
+                out.put(hex[c & 0xf]);
+            } else {
+                out.put(c);
+            }
+        }
+        out.put('"');
+    }
+
+    template <typename Node>
+    void list(const std::vector<std::unique_ptr<Node>>& nodes) {
+        out.put('[');
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (i) out.put(',');
+            nodes[i]->accept(*this);
+        }
+        out.put(']');
+    }
+
+    template <typename Node>
+    void optional(const Node* node) {
+        if (node) {
+            node->accept(*this);
+        } else {
+            out.text("null");
+        }
+    }
+
+    void parameters(const std::vector<Parameter>& params) {
+        out.put('[');
+        for (size_t i = 0; i < params.size(); i++) {
+            if (i) out.put(',');
+            string(params[i].name);
+        }
+        out.put(']');
+    }
+
+    void binary(std::string_view kind, std::string_view op, const Exp& left, const Exp& right) {
+        out.text("{\"kind\":\"");
+        out.text(kind);
+        out.text("\",\"op\":");
+        string(op);
+        out.text(",\"left\":");
+        left.accept(*this);
+        out.text(",\"right\":");
+        right.accept(*this);
+        out.put('}');
+    }
+};
+
+// Tipos de no do formato binario. Operadores vao no proprio tipo.
+enum Tag : uint8_t {
+    TAG_BLOCK = 1, TAG_MAIN, TAG_EXPRESSION, TAG_VAR, TAG_VAR_INIT, TAG_IF, TAG_IF_ELSE, TAG_WHILE,
+    TAG_RETURN, TAG_FUNCTION, TAG_EXTERN, TAG_ARRAY, TAG_PARFOR, TAG_MATCH,
+    TAG_CONST = 16, TAG_TRUE, TAG_FALSE, TAG_VARIABLE,
+    TAG_OPBIN = 20,       // + Operador (4)
+    TAG_COMPARISON = 24,  // + ComparisonOperator (6)
+    TAG_LOGICAL = 30,     // + LogicalOperator (2)
+    TAG_UNARY = 32, TAG_NOT, TAG_ASSIGN, TAG_CALL, TAG_INDEX, TAG_INDEX_ASSIGN
+};
+
+class BinaryDumper : public Visitor {
+public:
+    explicit BinaryDumper(Writer& out) : out(out) {}
+
+    void visit(const Program& node) override {
+        out.text(std::string_view(AST_MAGIC, AST_MAGIC_SIZE));
+        number(node.globalDeclarations.size());
+        for (const auto& decl : node.globalDeclarations) decl->accept(*this);
+        out.put(node.mainFunction ? 1 : 0);
+        if (node.mainFunction) node.mainFunction->accept(*this);
+    }
+
+    void visit(const BlockStatement& node) override {
+        out.put(TAG_BLOCK);
+        number(node.statements.size());
+        for (const auto& stmt : node.statements) stmt->accept(*this);
+    }
+
+    void visit(const MainFunction& node) override {
+        out.put(TAG_MAIN);
+        node.body->accept(*this);
+    }
+
+    void visit(const ExpressionStatement& node) override {
+        out.put(TAG_EXPRESSION);
+        node.expression->accept(*this);
+    }
+
+    void visit(const VarDeclaration& node) override {
+        out.put(node.initializer ? TAG_VAR_INIT : TAG_VAR);
+        name(node.identifier);
+        if (node.initializer) node.initializer->accept(*this);
+    }
+
+    void visit(const ArrayDeclaration& node) override {
+        out.put(TAG_ARRAY);
+        name(node.identifier);
+        node.size->accept(*this);
+    }
+
+    void visit(const IfStatement& node) override {
+        out.put(node.elseBranch ? TAG_IF_ELSE : TAG_IF);
+        node.condition->accept(*this);
+        node.thenBranch->accept(*this);
+        if (node.elseBranch) node.elseBranch->accept(*this);
+    }
+
+    void visit(const WhileStatement& node) override {
+        out.put(TAG_WHILE);
+        node.condition->accept(*this);
+        node.body->accept(*this);
+    }
+
+    void visit(const ParallelForStatement& node) override {
+        out.put(TAG_PARFOR);
+        name(node.index);
+        node.start->accept(*this);
+        node.end->accept(*this);
+        number(node.reductions.size());
+        for (const auto& reduction : node.reductions) name(reduction);
+        node.body->accept(*this);
+    }
+
+    void visit(const MatchStatement& node) override {
+        out.put(TAG_MATCH);
+        node.subject->accept(*this);
+        number(node.arms.size());
+        for (const auto& arm : node.arms) {
+            number(arm.values.size());
+            for (int value : arm.values) signedNumber(value);
+            arm.body->accept(*this);
+        }
+        out.put(node.otherwise ? 1 : 0);
+        if (node.otherwise) node.otherwise->accept(*this);
+    }
+
+    void visit(const ReturnStatement& node) override {
+        out.put(TAG_RETURN);
+        node.expression->accept(*this);
+    }
+
+    void visit(const FunctionDeclaration& node) override {
+        out.put(TAG_FUNCTION);
+        name(node.name);
+        parameters(node.parameters);
+        node.body->accept(*this);
+    }
+
+    void visit(const ExternDeclaration& node) override {
+        out.put(TAG_EXTERN);
+        name(node.name);
+        parameters(node.parameters);
+    }
+
+    void visit(const Const& node) override {
+        out.put(TAG_CONST);
+        signedNumber(node.valor);
+    }
+
+    void visit(const BooleanLiteral& node) override {
+        out.put(node.value ? TAG_TRUE : TAG_FALSE);
+    }
+
+    void visit(const Variable& node) override {
+        out.put(TAG_VARIABLE);
+        name(node.name);
+    }
+
+    void visit(const OpBin& node) override {
+        out.put(static_cast<char>(TAG_OPBIN + static_cast<int>(node.op)));
+        node.opEsq->accept(*this);
+        node.opDir->accept(*this);
+    }
+
+    void visit(const ComparisonExpression& node) override {
+        out.put(static_cast<char>(TAG_COMPARISON + static_cast<int>(node.op)));
+        node.left->accept(*this);
+        node.right->accept(*this);
+    }
+
+    void visit(const LogicalExpression& node) override {
+        out.put(static_cast<char>(TAG_LOGICAL + static_cast<int>(node.op)));
+        node.left->accept(*this);
+        node.right->accept(*this);
+    }
+
+    void visit(const UnaryExpression& node) override {
+        out.put(node.isNot ? TAG_NOT : TAG_UNARY);
+        node.operand->accept(*this);
+    }
+
+    void visit(const AssignmentExpression& node) override {
+        out.put(TAG_ASSIGN);
+        name(node.variable);
+        node.value->accept(*this);
+    }
+
+    void visit(const ArrayAccess& node) override {
+        out.put(TAG_INDEX);
+        name(node.name);
+        node.index->accept(*this);
+    }
+
+    void visit(const ArrayAssignment& node) override {
+        out.put(TAG_INDEX_ASSIGN);
+        name(node.name);
+        node.index->accept(*this);
+        node.value->accept(*this);
+    }
+
+    void visit(const FunctionCall& node) override {
+        out.put(TAG_CALL);
+        name(node.name);
+        number(node.arguments.size());
+        for (const auto& arg : node.arguments) arg->accept(*this);
+    }
+
+private:
+    Writer& out;
+    std::unordered_map<std::string, uint64_t> names;
+
+    void number(uint64_t value) {
+        while (value >= 0x80) {
+            out.put(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.put(static_cast<char>(value));
+    }
+
+    // zigzag: valores pequenos, positivos ou negativos, ocupam poucos bytes
+    void signedNumber(int64_t value) {
+        number((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void name(const std::string& text) {
+        auto inserted = names.emplace(text, names.size());
+        number(inserted.first->second);
+        if (inserted.second) {
+            number(text.size());
+            out.text(text);
+        }
+    }
+
+    void parameters(const std::vector<Parameter>& params) {
+        number(params.size());
+        for (const auto& param : params) name(param.name);
+    }
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view bytes) : bytes(bytes), pos(AST_MAGIC_SIZE) {}
+
+    std::unique_ptr<Program> program() {
+        auto result = std::make_unique<Program>();
+        for (uint64_t n = count(); n > 0; n--) result->addGlobalDeclaration(statement());
+        if (byte()) result->setMainFunction(statement());
+        if (pos != bytes.size()) fail();
+        return result;
+    }
+
+private:
+    std::string_view bytes;
+    size_t pos;
+    std::vector<std::string> names;
+
+    [[noreturn]] static void fail() {
+        throw std::runtime_error("Erro: arvore binaria invalida ou truncada.");
+    }
+
+    uint8_t byte() {
+        if (pos >= bytes.size()) fail();
+        return static_cast<uint8_t>(bytes[pos++]);
+    }
+
+    uint64_t number() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        fail();
+    }
+
+    // Quantidade de filhos; cada um ocupa ao menos um byte, o que limita
+    // o valor lido ao que resta do arquivo.
+    uint64_t count() {
+        uint64_t n = number();
+        if (n > bytes.size() - pos) fail();
+        return n;
+    }
+
+    int signedNumber() {
+        uint64_t zigzag = number();
+        int64_t value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        if (value < INT32_MIN || value > INT32_MAX) fail();
+        return static_cast<int>(value);
+    }
+
+    std::string name() {
+        uint64_t index = number();
+        if (index < names.size()) return names[index];
+        if (index != names.size()) fail();
+        uint64_t size = count();
+        names.emplace_back(bytes.substr(pos, size));
+        pos += size;
+        return names.back();
+    }
+
+    std::vector<Parameter> parameters() {
+        std::vector<Parameter> params;
+        for (uint64_t n = count(); n > 0; n--) params.emplace_back(name());
+        return params;
+    }
+
+    std::unique_ptr<BlockStatement> block() {
+        if (byte() != TAG_BLOCK) fail();
+        auto result = std::make_unique<BlockStatement>();
+        for (uint64_t n = count(); n > 0; n--) result->addStatement(statement());
+        return result;
+    }
+
+    std::unique_ptr<Statement> statement() {
+        uint8_t tag = byte();
+        switch (tag) {
+            case TAG_BLOCK:
+                pos--;
+                return block();
+            case TAG_MAIN:
+                return std::make_unique<MainFunction>(block());
+            case TAG_EXPRESSION:
+                return std::make_unique<ExpressionStatement>(expression());
+            case TAG_VAR:
+                return std::make_unique<VarDeclaration>(name());
+            case TAG_VAR_INIT: {
+                std::string identifier = name();
+                return std::make_unique<VarDeclaration>(std::move(identifier), expression());
+            }
+            case TAG_IF:
+            case TAG_IF_ELSE: {
+                std::unique_ptr<Exp> cond = expression();
+                std::unique_ptr<Statement> thenBranch = statement();
+                std::unique_ptr<Statement> elseBranch = tag == TAG_IF_ELSE ? statement() : nullptr;
+                return std::make_unique<IfStatement>(std::move(cond), std::move(thenBranch), std::move(elseBranch));
+            }
+            case TAG_WHILE: {
+                std::unique_ptr<Exp> cond = expression();
+                return std::make_unique<WhileStatement>(std::move(cond), statement());
+            }
+            case TAG_PARFOR: {
+                std::string index = name();
+                auto start = expression();
+                auto end = expression();
+                std::vector<std::string> reductions;
+                for (uint64_t n = count(); n > 0; n--) reductions.push_back(name());
+                return std::make_unique<ParallelForStatement>(std::move(index), std::move(start), std::move(end),
+                                                              std::move(reductions), statement());
+            }
+            case TAG_MATCH: {
+                std::unique_ptr<Exp> subject = expression();
+                std::vector<MatchArm> arms;
+                for (uint64_t n = count(); n > 0; n--) {
+                    MatchArm arm;
+                    for (uint64_t k = count(); k > 0; k--) arm.values.push_back(signedNumber());
+                    arm.body = block();
+                    arms.push_back(std::move(arm));
+                }
+                std::unique_ptr<BlockStatement> otherwise = byte() ? block() : nullptr;
+                return std::make_unique<MatchStatement>(std::move(subject), std::move(arms), std::move(otherwise));
+            }
+            case TAG_RETURN:
+                return std::make_unique<ReturnStatement>(expression());
+            case TAG_FUNCTION: {
+                std::string fnName = name();
+                std::vector<Parameter> params = parameters();
+                return std::make_unique<FunctionDeclaration>(std::move(fnName), std::move(params), block());
+            }
+            case TAG_EXTERN: {
+                std::string fnName = name();
+                return std::make_unique<ExternDeclaration>(std::move(fnName), parameters());
+            }
+            case TAG_ARRAY: {
+                std::string identifier = name();
+                return std::make_unique<ArrayDeclaration>(std::move(identifier), expression());
+            }
+        }
+        fail();
+    }
+
+    std::unique_ptr<Exp> expression() {
+        uint8_t tag = byte();
+        if (tag >= TAG_OPBIN && tag < TAG_OPBIN + 4) {
+            std::unique_ptr<Exp> left = expression();
+            return std::make_unique<OpBin>(std::move(left), static_cast<Operador>(tag - TAG_OPBIN), expression());
+        }
+        if (tag >= TAG_COMPARISON && tag < TAG_COMPARISON + 6) {
+            std::unique_ptr<Exp> left = expression();
+            return std::make_unique<ComparisonExpression>(
+                std::move(left), static_cast<ComparisonOperator>(tag - TAG_COMPARISON), expression());
+        }
+        if (tag >= TAG_LOGICAL && tag < TAG_LOGICAL + 2) {
+            std::unique_ptr<Exp> left = expression();
+            return std::make_unique<LogicalExpression>(std::move(left), static_cast<LogicalOperator>(tag - TAG_LOGICAL),
+                                                       expression());
+        }
+        switch (tag) {
+            case TAG_CONST:
+                return std::make_unique<Const>(signedNumber());
+            case TAG_TRUE:
+            case TAG_FALSE:
+                return std::make_unique<BooleanLiteral>(tag == TAG_TRUE);
+            case TAG_VARIABLE:
+                return std::make_unique<Variable>(name());
+            case TAG_UNARY:
+            case TAG_NOT:
+                return std::make_unique<UnaryExpression>(expression(), tag == TAG_NOT);
+            case TAG_ASSIGN: {
+                std::string variable = name();
+                return std::make_unique<AssignmentExpression>(std::move(variable), expression());
+            }
+            case TAG_CALL: {
+                std::string fnName = name();
+                std::vector<std::unique_ptr<Exp>> args;
+                for (uint64_t n = count(); n > 0; n--) args.push_back(expression());
+                return std::make_unique<FunctionCall>(std::move(fnName), std::move(args));
+            }
+            case TAG_INDEX: {
+                std::string array = name();
+                return std::make_unique<ArrayAccess>(std::move(array), expression());
+            }
+            case TAG_INDEX_ASSIGN: {
+                std::string array = name();
+                std::unique_ptr<Exp> index = expression();
+                return std::make_unique<ArrayAssignment>(std::move(array), std::move(index), expression());
+            }
+        }
+        fail();
+    }
+};
+
+}
+
+bool parseAstFormat(const std::string& name, AstFormat& format) {
+    if (name == "text") {
+        format = AstFormat::TEXT;
+    } else if (name == "json") {
+        format = AstFormat::JSON;
+    } else if (name == "bin") {
+        format = AstFormat::BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void dumpAst(const Program& program, AstFormat format, std::ostream& out) {
+    Writer writer(out);
+    if (format == AstFormat::TEXT) {
+        TextDumper dumper(writer);
+        program.accept(dumper);
+    } else if (format == AstFormat::JSON) {
+        JsonDumper dumper(writer);
+        program.accept(dumper);
+        writer.put('\n');
+    } else {
+        BinaryDumper dumper(writer);
+        program.accept(dumper);
+    }
+    writer.drain();
+}
+
+bool isBinaryAst(std::string_view bytes) {
+    return bytes.size() >= AST_MAGIC_SIZE && bytes.compare(0, AST_MAGIC_SIZE, AST_MAGIC) == 0;
+}
+
+std::unique_ptr<Program> loadAst(std::string_view bytes) {
+    if (!isBinaryAst(bytes)) {
+        throw std::runtime_error("Erro: o arquivo nao e uma arvore binaria do compilador.");
+    }
+    return Reader(bytes).program();
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ast.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Formatos de --dump-ast: o texto indentado de sempre, JSON numa linha so
+// e um binario compacto que loadAst le de volta.
+enum class AstFormat { TEXT, JSON, BINARY };
+
+// "text", "json" ou "bin"; devolve false para outro nome.
+bool parseAstFormat(const std::string& name, AstFormat& format);
+
+// Escreve a arvore em out. O texto e montado num buffer unico e entregue a
+// out em blocos de 64 KiB, por um visitor so para a arvore inteira.
+void dumpAst(const Program& program, AstFormat format, std::ostream& out);
+
+// Binario: AST_MAGIC e a arvore em pre-ordem, um byte de tipo por no.
+// Inteiros sao LEB128 sem sinal (constantes em zigzag); cada nome vira o
+// indice dele numa tabela montada durante a leitura, e o nome novo vem
+// logo apos o proprio indice, com o tamanho e os bytes.
+const char* const AST_MAGIC = "CIAST1\n";
+const size_t AST_MAGIC_SIZE = 7;
+
+bool isBinaryAst(std::string_view bytes);
+
+// Le uma arvore gravada com AstFormat::BINARY; lanca runtime_error se os
+// bytes estiverem truncados ou nao forem uma arvore.
+std::unique_ptr<Program> loadAst(std::string_view bytes);
@@ -0,0 +1,122 @@
+#include "batch.h"
+#include "asmwriter.h"
+#include "compiler.h"
+#include "parallel.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+// Memoria de cada thread, reaproveitada de uma entrada para a seguinte:
+// o texto do fonte e a saida gerada.
+struct WorkerArena {
+    std::string source;
+    std::string output;
+};
+
+struct Outcome {
+    std::string error;
+    size_t bytes = 0;
+    CacheStats cache;
+};
+
+void readSource(const std::string& path, std::string& source) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Nao foi possivel abrir o arquivo " + path);
+    }
+    source.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(&source[0], static_cast<std::streamsize>(source.size()));
+}
+
+void compileOne(const std::string& input, const CompilerOptions& options, WorkerArena& arena, Outcome& outcome) {
+    readSource(input, arena.source);
+    outcome.bytes = arena.source.size();
+
+    arena.output.clear();
+    MemorySink sink(arena.output);
+    CompileResult result = compile(arena.source, options, sink);
+    outcome.cache = result.cache;
+    if (!result.ok) {
+        throw std::runtime_error(result.error);
+    }
+
+    std::string path = outputPath(input, options.emitObject);
+    if (!writeFile(path, arena.output.data(), arena.output.size())) {
+        throw std::runtime_error("Erro: Nao foi possivel criar arquivo " + path);
+    }
+}
+
+}
+
+std::vector<std::string> readManifest(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Nao foi possivel abrir a lista " + path);
+    }
+    std::vector<std::string> inputs;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        inputs.push_back(line.substr(first, last - first + 1));
+    }
+    return inputs;
+}
+
+std::string outputPath(const std::string& input, bool object) {
+    std::string base = input;
+    if (base.size() > 3 && base.compare(base.size() - 3, 3, ".ci") == 0) {
+        base.resize(base.size() - 3);
+    }
+    return base + (object ? ".o" : ".s");
+}
+
+int compileBatch(const std::vector<std::string>& inputs, const CompilerOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+
+    // As entradas ja ocupam todas as threads; cada uma gera suas funcoes
+    // em sequencia.
+    CompilerOptions single = options;
+    single.jobs = 1;
+
+    std::vector<Outcome> outcomes(inputs.size());
+    std::vector<WorkerArena> arenas(static_cast<size_t>(workerCount(options.jobs)));
+    stealingFor(inputs.size(), options.jobs, [&](size_t i, int worker) {
+        try {
+            compileOne(inputs[i], single, arenas[worker], outcomes[i]);
+        } catch (const std::exception& e) {
+            // qualquer falha fica so com a entrada dela; o lote continua
+            outcomes[i].error = e.what();
+        }
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int failed = 0;
+    size_t bytes = 0;
+    CacheStats cache;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        bytes += outcomes[i].bytes;
+        cache += outcomes[i].cache;
+        if (!outcomes[i].error.empty()) {
+            failed++;
+            std::cerr << inputs[i] << ": " << outcomes[i].error << std::endl;
+        }
+    }
+
+    double rate = seconds > 0 ? 1.0 / seconds : 0;
+    std::cout << std::fixed << std::setprecision(1) << "Lote: " << inputs.size() << " arquivos em "
+              << seconds * 1000 << " ms (" << inputs.size() * rate << " arquivos/s, "
+              << bytes * rate / (1024 * 1024) << " MiB/s de fonte), " << inputs.size() - failed
+              << " compilados, " << failed << " com erro" << std::endl;
+    if (!options.cacheDir.empty()) {
+        std::cout << "Cache: " << cache.hits << " funcoes reaproveitadas, " << cache.misses << " geradas"
+                  << std::endl;
+    }
+    return failed;
+}
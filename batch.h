@@ -0,0 +1,16 @@
+#pragma once
+#include "options.h"
+#include <string>
+#include <vector>
+
+// Entradas listadas num arquivo (@lista na linha de comando): um caminho
+// por linha; linhas vazias ou comecadas por # sao ignoradas.
+std::vector<std::string> readManifest(const std::string& path);
+
+// Arquivo gerado para uma entrada: o nome dela com .s (ou .o) no lugar de .ci.
+std::string outputPath(const std::string& input, bool object);
+
+// Compila varias entradas no mesmo processo, em paralelo, cada uma para o
+// seu outputPath. Os erros saem em stderr na ordem das entradas, seguidos
+// de um resumo com a vazao; devolve a quantidade de entradas com erro.
+int compileBatch(const std::vector<std::string>& inputs, const CompilerOptions& options);
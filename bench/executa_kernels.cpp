@@ -0,0 +1,310 @@
+// Mede o codigo gerado: compila cada kernel de bench/kernels em -O0 e -O1,
+// monta com o runtime.s (as + ld), executa varias vezes e confere a saida
+// com o .esperado ao lado do kernel.
+//
+//   bench/executa_kernels [--execucoes=5] [--base=anterior.jsonl]
+//                         [--limite=10] [kernel...] > atual.jsonl
+//
+// A tabela sai em stderr e cada kernel e nivel vira um objeto JSON por
+// linha em stdout, com o melhor tempo e, quando o kernel permite
+// perf_event_open, ciclos e instrucoes em espaco de usuario. Com --base, um
+// resultado anterior no mesmo formato, um kernel que ficar mais de
+// --limite por cento mais lento (em ciclos, ou em tempo sem contadores) e
+// marcado como regressao; bench/kernels/limites.txt pode dar um limite
+// proprio a cada kernel ("nome porcentagem" por linha). Sai com 1 se
+// alguma saida diferir ou houver regressao.
+#include "asmwriter.h"
+#include "compiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <map>
+#include <sstream>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+const int FORMAT_VERSION = 1;
+
+struct Run {
+    double ms = 0;
+    bool counted = false;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    bool exited = false;
+};
+
+struct Result {
+    std::string kernel;
+    std::string level;
+    int runs = 0;
+    double bestMs = 0;
+    double totalMs = 0;
+    bool counted = false;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    bool outputOk = false;
+    double change = 0;  // variacao sobre a base, em por cento
+    bool regression = false;
+};
+
+std::string readText(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+std::string quoted(const std::string& path) {
+    std::string out = "'";
+    for (char c : path) {
+        if (c == '\'') {
+            out += "'\\''";
+        } else {
+            out += c;
+        }
+    }
+    return out + "'";
+}
+
+// Contador do processo pid, ligado so quando ele faz exec e restrito ao
+// espaco de usuario: mede o programa, nao o fork nem o carregamento.
+int openCounter(pid_t pid, uint64_t config) {
+    perf_event_attr attr = {};
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+// Executa program com stdout em output. O filho espera no pipe ate os
+// contadores estarem abertos.
+Run execute(const std::string& program, const std::string& output) {
+    int gate[2];
+    if (pipe(gate) != 0) throw std::runtime_error("Erro: pipe falhou");
+    pid_t child = fork();
+    if (child < 0) throw std::runtime_error("Erro: fork falhou");
+    if (child == 0) {
+        close(gate[1]);
+        char go;
+        if (read(gate[0], &go, 1) != 1) _exit(127);
+        int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || dup2(fd, 1) < 0) _exit(127);
+        execl(program.c_str(), program.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(gate[0]);
+
+    Run run;
+    int cycles = openCounter(child, PERF_COUNT_HW_CPU_CYCLES);
+    int instructions = openCounter(child, PERF_COUNT_HW_INSTRUCTIONS);
+    auto start = std::chrono::steady_clock::now();
+    if (write(gate[1], "x", 1) != 1) throw std::runtime_error("Erro: pipe falhou");
+    close(gate[1]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    run.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    run.exited = WIFEXITED(status) && WEXITSTATUS(status) != 127;
+
+    if (cycles >= 0 && instructions >= 0) {
+        run.counted = read(cycles, &run.cycles, sizeof run.cycles) == sizeof run.cycles &&
+                      read(instructions, &run.instructions, sizeof run.instructions) == sizeof run.instructions;
+    }
+    if (cycles >= 0) close(cycles);
+    if (instructions >= 0) close(instructions);
+    return run;
+}
+
+// Valor de "chave": num objeto de uma linha; vazio se nao houver.
+std::string field(const std::string& line, const std::string& key) {
+    size_t at = line.find("\"" + key + "\": ");
+    if (at == std::string::npos) return "";
+    at += key.size() + 4;
+    if (line[at] == '"') {
+        size_t end = line.find('"', at + 1);
+        return line.substr(at + 1, end - at - 1);
+    }
+    size_t end = line.find_first_of(",}", at);
+    return line.substr(at, end - at);
+}
+
+std::vector<std::string> listKernels(const std::string& dir) {
+    std::vector<std::string> names;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, ".ci") == 0) {
+                names.push_back(name.substr(0, name.size() - 3));
+            }
+        }
+        closedir(d);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::map<std::string, double> readLimits(const std::string& path) {
+    std::map<std::string, double> limits;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        double percent;
+        if (fields >> name && name[0] != '#' && fields >> percent) limits[name] = percent;
+    }
+    return limits;
+}
+
+void print(const Result& r) {
+    std::printf("{\"formato\": %d, \"kernel\": \"%s\", \"nivel\": \"%s\", \"execucoes\": %d, \"ms\": %.3f, "
+                "\"ms_media\": %.3f, ",
+                FORMAT_VERSION, r.kernel.c_str(), r.level.c_str(), r.runs, r.bestMs, r.totalMs / r.runs);
+    if (r.counted) {
+        std::printf("\"ciclos\": %llu, \"instrucoes\": %llu, ", static_cast<unsigned long long>(r.cycles),
+                    static_cast<unsigned long long>(r.instructions));
+    } else {
+        std::printf("\"ciclos\": null, \"instrucoes\": null, ");
+    }
+    std::printf("\"saida\": \"%s\", \"regressao\": %s}\n", r.outputOk ? "ok" : "diferente",
+                r.regression ? "true" : "false");
+    std::fflush(stdout);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string self = argv[0];
+    std::string benchDir = self.find('/') == std::string::npos ? "." : self.substr(0, self.rfind('/'));
+    std::string kernelDir = benchDir + "/kernels";
+    std::string runtime = benchDir + "/../runtime.s";
+
+    int runs = 5;
+    double limit = 10;
+    std::string basePath;
+    std::vector<std::string> kernels;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--execucoes=", 0) == 0) {
+            runs = std::max(1, std::atoi(arg.c_str() + 12));
+        } else if (arg.rfind("--limite=", 0) == 0) {
+            limit = std::atof(arg.c_str() + 9);
+        } else if (arg.rfind("--base=", 0) == 0) {
+            basePath = arg.substr(7);
+        } else if (!arg.empty() && arg[0] != '-') {
+            kernels.push_back(arg);
+        } else {
+            std::cerr << "Uso: " << argv[0] << " [--execucoes=N] [--base=anterior.jsonl] [--limite=pct] [kernel...]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (kernels.empty()) kernels = listKernels(kernelDir);
+
+    std::map<std::string, std::string> base;
+    if (!basePath.empty()) {
+        std::ifstream in(basePath);
+        if (!in.is_open()) {
+            std::cerr << "Erro: Nao foi possivel abrir a base " << basePath << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) base[field(line, "kernel") + " " + field(line, "nivel")] = line;
+    }
+    std::map<std::string, double> limits = readLimits(kernelDir + "/limites.txt");
+
+    char tmpl[] = "/tmp/kernels.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::cerr << "Erro: nao foi possivel criar o diretorio temporario" << std::endl;
+        return 1;
+    }
+    std::string work = tmpl;
+    if (std::system(("cp " + quoted(runtime) + " " + quoted(work + "/runtime.s")).c_str()) != 0) {
+        std::cerr << "Erro: runtime.s nao encontrado em " << runtime << std::endl;
+        return 1;
+    }
+
+    std::fprintf(stderr, "%-12s %-5s %10s %14s %14s %-9s %s\n", "kernel", "nivel", "melhor ms", "ciclos",
+                 "instrucoes", "saida", "situacao");
+    bool failed = false;
+    for (const auto& kernel : kernels) {
+        std::string source = readText(kernelDir + "/" + kernel + ".ci");
+        std::string expected = readText(kernelDir + "/" + kernel + ".esperado");
+        for (int level = 0; level <= 1; level++) {
+            Result r;
+            r.kernel = kernel;
+            r.level = "-O" + std::to_string(level);
+
+            CompilerOptions options;
+            options.optimizationLevel = level;
+            CompileResult compiled = compile(source, options);
+            std::string asmPath = work + "/" + kernel + ".s";
+            std::string program = work + "/" + kernel;
+            if (!compiled.ok || !writeFile(asmPath, compiled.output.data(), compiled.output.size()) ||
+                std::system(("cd " + quoted(work) + " && as -64 " + quoted(kernel + ".s") + " -o k.o && ld k.o -o " +
+                             quoted(kernel)).c_str()) != 0) {
+                std::cerr << kernel << " " << r.level << ": " << (compiled.ok ? "falha ao montar" : compiled.error)
+                          << std::endl;
+                failed = true;
+                continue;
+            }
+
+            std::string output = work + "/saida.txt";
+            for (int i = 0; i < runs; i++) {
+                Run run = execute(program, output);
+                if (i == 0) r.outputOk = run.exited && readText(output) == expected;
+                r.bestMs = i == 0 ? run.ms : std::min(r.bestMs, run.ms);
+                r.totalMs += run.ms;
+                r.counted = run.counted && (i == 0 || r.counted);
+                if (run.counted && (i == 0 || run.cycles < r.cycles)) {
+                    r.cycles = run.cycles;
+                    r.instructions = run.instructions;
+                }
+                r.runs++;
+            }
+
+            std::string situation = "-";
+            auto previous = base.find(kernel + " " + r.level);
+            if (previous != base.end()) {
+                std::string baseCycles = field(previous->second, "ciclos");
+                double before, after;
+                if (r.counted && !baseCycles.empty() && baseCycles != "null") {
+                    before = std::atof(baseCycles.c_str());
+                    after = static_cast<double>(r.cycles);
+                } else {
+                    before = std::atof(field(previous->second, "ms").c_str());
+                    after = r.bestMs;
+                }
+                auto own = limits.find(kernel);
+                double allowed = own != limits.end() ? own->second : limit;
+                r.change = before > 0 ? (after / before - 1) * 100 : 0;
+                r.regression = r.change > allowed;
+                char text[64];
+                std::snprintf(text, sizeof text, "%s %+.1f%%", r.regression ? "REGRESSAO" : "ok", r.change);
+                situation = text;
+            }
+
+            std::string cycles = r.counted ? std::to_string(r.cycles) : "-";
+            std::string instructions = r.counted ? std::to_string(r.instructions) : "-";
+            std::fprintf(stderr, "%-12s %-5s %10.1f %14s %14s %-9s %s\n", kernel.c_str(), r.level.c_str(), r.bestMs,
+                         cycles.c_str(), instructions.c_str(), r.outputOk ? "ok" : "DIFERENTE", situation.c_str());
+            print(r);
+            failed = failed || !r.outputOk || r.regression;
+        }
+    }
+
+    std::system(("rm -rf " + quoted(work)).c_str());
+    return failed ? 1 : 0;
+}
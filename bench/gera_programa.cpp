@@ -0,0 +1,34 @@
+// Gera um programa .ci sintetico em stdout (ver gerador.h):
+//
+//   bench/gera_programa [--tamanho=1M] [--forma=misto] [--semente=1] > p.ci
+//
+// Formas: misto, funcoes, profundo, blocos, globais, chamadas.
+#include "gerador.h"
+#include <cstdio>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg.rfind("--tamanho=", 0) == 0) {
+            options.bytes = parseSize(arg.substr(10));
+            ok = options.bytes > 0;
+        } else if (arg.rfind("--forma=", 0) == 0) {
+            ok = parseShape(arg.substr(8), options.shape);
+        } else if (arg.rfind("--semente=", 0) == 0) {
+            ok = parseSeed(arg.substr(10), options.seed);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "Uso: %s [--tamanho=N[K|M|G]] [--forma=misto|funcoes|profundo|blocos|globais|chamadas]"
+                                 " [--semente=N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::string program = generateProgram(options);
+    return std::fwrite(program.data(), 1, program.size(), stdout) == program.size() ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+#include "gerador.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Profundidade maxima de chamadas encadeadas: cada funcao chama no maximo
+// duas outras, todas de nivel menor, entao uma chamada custa no maximo
+// 2^MAX_LEVEL execucoes de corpo.
+const int MAX_LEVEL = 6;
+
+struct Function {
+    std::string name;
+    int arity;
+    int level;
+};
+
+// Parametros de uma funcao gerada.
+struct Recipe {
+    int params;
+    int statements;
+    int depth;       // aninhamento das expressoes
+    int calls;       // chamadas no corpo
+    bool control;    // usa if e while
+};
+
+class Generator {
+public:
+    explicit Generator(const GeneratorOptions& options) : options(options), state(options.seed * 2 + 1) {}
+
+    std::string run() {
+        out.reserve(options.bytes + 4096);
+        size_t globalBytes = options.shape == Shape::GLOBALS ? options.bytes / 4 : options.bytes / 64;
+        while (out.size() < globalBytes || globals.empty()) {
+            std::string name = "g" + std::to_string(globals.size());
+            out += "let " + name + " = " + std::to_string(below(1000)) + ";\n";
+            globals.push_back(name);
+        }
+        out += '\n';
+
+        while (out.size() < options.bytes) {
+            // perto do fim, funcoes menores, para nao passar muito do tamanho
+            Recipe next = recipe(options.shape);
+            int room = static_cast<int>(std::min<size_t>(options.bytes - out.size(), 1 << 20) / 48);
+            next.statements = std::max(1, std::min(next.statements, room));
+            function(next);
+        }
+        mainFunction();
+        return std::move(out);
+    }
+
+private:
+    const GeneratorOptions& options;
+    uint64_t state;
+    std::string out;
+    std::vector<std::string> globals;
+    std::vector<Function> functions;
+    std::vector<std::string> locals;
+    int level = 0;
+    int callsLeft = 0;
+
+    // xorshift64*: a mesma sequencia em qualquer plataforma.
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dULL;
+    }
+
+    int below(int limit) {
+        return static_cast<int>(next() % static_cast<uint64_t>(limit));
+    }
+
+    Recipe recipe(Shape shape) {
+        switch (shape) {
+            case Shape::MIXED:
+                return recipe(static_cast<Shape>(1 + below(5)));
+            case Shape::FUNCTIONS:
+                return Recipe{1 + below(3), 1 + below(3), 2, 1, false};
+            case Shape::DEEP:
+                return Recipe{2, 2, 24 + below(16), 1, false};
+            case Shape::BLOCKS:
+                return Recipe{2, 40 + below(80), 2, 2, true};
+            case Shape::GLOBALS:
+                return Recipe{1, 4 + below(8), 2, 1, true};
+            case Shape::CALLS:
+                return Recipe{8 + below(9), 3, 2, 2, false};
+        }
+        return Recipe{1, 1, 1, 0, false};
+    }
+
+    void indent(int depth) {
+        out.append(static_cast<size_t>(depth) * 4, ' ');
+    }
+
+    std::string variable() {
+        int pick = below(static_cast<int>(locals.size() + (globals.empty() ? 0 : 2)));
+        if (pick < static_cast<int>(locals.size())) return locals[pick];
+        return globals[below(static_cast<int>(globals.size()))];
+    }
+
+    // Funcao anterior de nivel baixo, ou nenhuma (-1).
+    int callee() {
+        for (int attempt = 0; attempt < 4 && !functions.empty(); attempt++) {
+            int index = below(static_cast<int>(functions.size()));
+            if (functions[index].level < MAX_LEVEL) return index;
+        }
+        return -1;
+    }
+
+    void expression(int depth) {
+        if (depth <= 0) {
+            if (below(3) == 0) {
+                out += std::to_string(below(1000));
+            } else {
+                out += variable();
+            }
+            return;
+        }
+        int kind = below(10);
+        if (kind == 0 && callsLeft > 0) {
+            int index = callee();
+            if (index >= 0) {
+                callsLeft--;
+                const Function& fn = functions[index];
+                level = std::max(level, fn.level + 1);
+                out += fn.name + "(";
+                for (int i = 0; i < fn.arity; i++) {
+                    if (i) out += ", ";
+                    expression(depth > 2 ? 1 : 0);
+                }
+                out += ")";
+                return;
+            }
+        }
+        static const char* const OPERATORS[] = {" + ", " - ", " * ", " + ", " < ", " == ", " && ", " || "};
+        if (kind == 1) {
+            out += "!(";
+            expression(depth - 1);
+            out += ")";
+        } else if (kind == 2) {
+            // divisor constante e nunca zero
+            out += "(";
+            expression(depth - 1);
+            out += " / " + std::to_string(1 + below(9)) + ")";
+        } else {
+            // so o lado esquerdo desce ate o fim: o tamanho cresce em linha
+            // com a profundidade
+            out += "(";
+            expression(depth - 1);
+            out += OPERATORS[below(8)];
+            expression(below(std::min(depth, 3)));
+            out += ")";
+        }
+    }
+
+    // Comandos sem let: atribuicoes, impressoes, if e lacos contados.
+    void statement(const Recipe& recipe, int depth) {
+        int kind = below(recipe.control ? 8 : 5);
+        indent(depth);
+        if (kind <= 2) {
+            out += variable() + " = ";
+            expression(recipe.depth);
+            out += ";\n";
+        } else if (kind <= 4) {
+            expression(recipe.depth);
+            out += ";\n";
+        } else if (kind <= 6 && depth < 3) {
+            out += "if (";
+            expression(2);
+            out += ") {\n";
+            statement(recipe, depth + 1);
+            indent(depth);
+            out += "} else {\n";
+            statement(recipe, depth + 1);
+            indent(depth);
+            out += "}\n";
+        } else if (depth < 3) {
+            std::string counter = locals[0];
+            out += counter + " = 0;\n";
+            indent(depth);
+            out += "while (" + counter + " < " + std::to_string(1 + below(8)) + ") {\n";
+            indent(depth + 1);
+            out += counter + " = " + counter + " + 1;\n";
+            // sem chamadas dentro do laco, para o custo de executar ficar
+            // limitado
+            indent(depth + 1);
+            int calls = callsLeft;
+            callsLeft = 0;
+            out += locals[1 + below(static_cast<int>(locals.size()) - 1)] + " = ";
+            expression(1);
+            out += ";\n";
+            callsLeft = calls;
+            indent(depth);
+            out += "}\n";
+        } else {
+            out += variable() + " = ";
+            expression(1);
+            out += ";\n";
+        }
+    }
+
+    void function(const Recipe& recipe) {
+        Function fn{"f" + std::to_string(functions.size()), recipe.params, 0};
+        locals.clear();
+        level = 0;
+        callsLeft = recipe.calls;
+
+        out += "fun " + fn.name + "(";
+        for (int i = 0; i < recipe.params; i++) {
+            if (i) out += ", ";
+            locals.push_back("p" + std::to_string(i));
+            out += locals.back();
+        }
+        out += ") {\n";
+
+        // O contador dos lacos e sempre o primeiro local declarado.
+        int lets = 1 + recipe.statements / 8;
+        for (int i = 0; i < lets; i++) {
+            std::string name = "v" + std::to_string(i);
+            out += "    let " + name + " = ";
+            if (i == 0) {
+                out += "0";
+            } else {
+                expression(recipe.depth);
+            }
+            out += ";\n";
+            locals.insert(locals.begin() + i, name);
+        }
+        for (int i = 0; i < recipe.statements; i++) {
+            statement(recipe, 1);
+        }
+        out += "    return ";
+        expression(recipe.depth);
+        out += ";\n}\n\n";
+
+        fn.level = level;
+        functions.push_back(fn);
+    }
+
+    // main chama algumas funcoes e devolve a soma, reduzida a um byte.
+    void mainFunction() {
+        locals.assign(1, "r");
+        out += "main() {\n    let r = 0;\n";
+        int count = std::min<int>(8, static_cast<int>(functions.size()));
+        for (int i = 0; i < count; i++) {
+            const Function& fn = functions[functions.size() - 1 - i * (functions.size() / count)];
+            if (fn.level >= MAX_LEVEL) continue;
+            out += "    r = r + " + fn.name + "(";
+            for (int a = 0; a < fn.arity; a++) {
+                if (a) out += ", ";
+                out += std::to_string(below(100));
+            }
+            out += ");\n";
+        }
+        out += "    return r - (r / 256) * 256;\n}\n";
+    }
+};
+
+}
+
+const char* shapeName(Shape shape) {
+    switch (shape) {
+        case Shape::MIXED: return "misto";
+        case Shape::FUNCTIONS: return "funcoes";
+        case Shape::DEEP: return "profundo";
+        case Shape::BLOCKS: return "blocos";
+        case Shape::GLOBALS: return "globais";
+        case Shape::CALLS: return "chamadas";
+    }
+    return "?";
+}
+
+bool parseShape(const std::string& name, Shape& shape) {
+    const Shape all[] = {Shape::MIXED, Shape::FUNCTIONS, Shape::DEEP, Shape::BLOCKS, Shape::GLOBALS, Shape::CALLS};
+    for (Shape s : all) {
+        if (name == shapeName(s)) {
+            shape = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t parseSize(const std::string& text) {
+    size_t value = 0;
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (parsed.ec != std::errc()) return 0;
+    std::string suffix(parsed.ptr, text.data() + text.size());
+    int shift = 0;
+    if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        return 0;
+    }
+    // grande demais para size_t tambem e invalido
+    return value > (SIZE_MAX >> shift) ? 0 : value << shift;
+}
+
+bool parseSeed(const std::string& text, uint64_t& seed) {
+    const char* end = text.data() + text.size();
+    auto parsed = std::from_chars(text.data(), end, seed);
+    return parsed.ec == std::errc() && parsed.ptr == end;
+}
+
+std::string generateProgram(const GeneratorOptions& options) {
+    return Generator(options).run();
+}
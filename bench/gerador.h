@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Formato dos programas sinteticos; cada um carrega num aspecto do
+// compilador.
+enum class Shape {
+    MIXED,      // mistura das demais, sorteada por funcao
+    FUNCTIONS,  // muitas funcoes pequenas
+    DEEP,       // expressoes com aninhamento profundo
+    BLOCKS,     // corpos longos, em linha reta, com if e while
+    GLOBALS,    // muitas globais, lidas e escritas pelas funcoes
+    CALLS,      // chamadas largas, com muitos argumentos
+};
+
+struct GeneratorOptions {
+    size_t bytes = 1024;   // tamanho aproximado do fonte (passa um pouco)
+    Shape shape = Shape::MIXED;
+    uint64_t seed = 1;
+};
+
+// Nome do formato na linha de comando e nos resultados ("misto",
+// "funcoes", ...); parseShape devolve false para um nome desconhecido.
+const char* shapeName(Shape shape);
+bool parseShape(const std::string& name, Shape& shape);
+
+// Tamanho com sufixo K, M ou G (potencias de 1024); 0 se invalido.
+size_t parseSize(const std::string& text);
+
+// Semente decimal; false se nao for um numero que caiba em 64 bits.
+bool parseSeed(const std::string& text, uint64_t& seed);
+
+// Programa .ci valido, sempre o mesmo para as mesmas opcoes: so usa um
+// gerador pseudoaleatorio proprio, sem depender da plataforma. Funcoes
+// so chamam funcoes anteriores, os lacos terminam e nao ha divisao por
+// zero, entao o programa tambem pode ser executado.
+std::string generateProgram(const GeneratorOptions& options);
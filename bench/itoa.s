@@ -0,0 +1,31 @@
+# Microbenchmark de imprime_num, sem o compilador: converte N numeros
+# pseudoaleatorios (xorshift64) com sinal e de 1 a 19 digitos. A saida vai
+# pelo buffer do runtime e serve para comparar duas versoes.
+  .equ N, 20000000
+
+  .text
+  .globl _start
+_start:
+  mov $N, %rbx
+  mov $88172645463325252, %r12
+
+laco:
+  mov %r12, %rax
+  shl $13, %rax
+  xor %rax, %r12
+  mov %r12, %rax
+  shr $7, %rax
+  xor %rax, %r12
+  mov %r12, %rax
+  shl $17, %rax
+  xor %rax, %r12
+  mov %r12, %rax
+  mov %rbx, %rcx
+  and $63, %rcx
+  sar %cl, %rax           # desloca de 0 a 63 bits: varia a quantidade de digitos
+  call imprime_num
+  dec %rbx
+  jnz laco
+  call sair
+
+  .include "runtime.s"
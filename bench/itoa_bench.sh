@@ -0,0 +1,35 @@
+#!/bin/bash
+# Mede imprime_num isolada (bench/itoa.s): numeros convertidos por segundo.
+# Com um runtime.s alternativo como argumento, mede os dois e confere se a
+# saida e a mesma. Uso, a partir da raiz do repositorio:
+#   bench/itoa_bench.sh [outro_runtime.s]
+# Ex.: git show HEAD~1:runtime.s > /tmp/antigo.s && bench/itoa_bench.sh /tmp/antigo.s
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+COUNT=$(awk '/\.equ N,/ { print $3 }' "$ROOT/bench/itoa.s")
+
+# Monta o harness com o runtime dado e mede a execucao.
+measure() {
+    local runtime=$1 name=$2 start end ms
+    mkdir -p "$WORK/$name"
+    cp "$runtime" "$WORK/$name/runtime.s"
+    cp "$ROOT/bench/itoa.s" "$WORK/$name/"
+    (cd "$WORK/$name" && as -64 itoa.s -o itoa.o && ld itoa.o -o itoa)
+    start=$(date +%s%N)
+    "$WORK/$name/itoa" > "$WORK/$name/saida.txt"
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    printf "%-10s %8d ms %10.1f M numeros/s  %s\n" "$name" "$ms" \
+        "$(awk -v n="$COUNT" -v ms="$ms" 'BEGIN { print (ms > 0 ? n / ms / 1000 : 0) }')" \
+        "$(md5sum < "$WORK/$name/saida.txt" | cut -c1-12)"
+}
+
+measure "$ROOT/runtime.s" atual
+if [ $# -gt 0 ]; then
+    measure "$1" outro
+    cmp -s "$WORK/atual/saida.txt" "$WORK/outro/saida.txt" && echo "saidas identicas" || echo "SAIDAS DIFERENTES"
+fi
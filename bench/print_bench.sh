@@ -0,0 +1,33 @@
+#!/bin/bash
+# Imprime dez milhoes de numeros (bench/print10m.ci) e mede o tempo do
+# executavel. Com um runtime.s alternativo como argumento, mede os dois e
+# confere se a saida e a mesma. Uso, a partir da raiz do repositorio:
+#   bench/print_bench.sh [outro_runtime.s]
+# Ex.: git show HEAD~1:runtime.s > /tmp/antigo.s && bench/print_bench.sh /tmp/antigo.s
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+g++ -std=c++17 -O2 -o "$WORK/compiler" "$ROOT"/*.cpp -ldl
+(cd "$WORK" && ./compiler "$ROOT/bench/print10m.ci" > /dev/null)
+
+# Monta program.s com o runtime dado e mede a execucao.
+measure() {
+    local runtime=$1 name=$2 start end
+    mkdir -p "$WORK/$name"
+    cp "$runtime" "$WORK/$name/runtime.s"
+    cp "$WORK/program.s" "$WORK/$name/"
+    (cd "$WORK/$name" && as -64 program.s -o program.o && ld program.o -o program)
+    start=$(date +%s%N)
+    "$WORK/$name/program" > "$WORK/$name/saida.txt"
+    end=$(date +%s%N)
+    printf "%-10s %8d ms  %s\n" "$name" $(( (end - start) / 1000000 )) "$(md5sum < "$WORK/$name/saida.txt" | cut -c1-12)"
+}
+
+measure "$ROOT/runtime.s" atual
+if [ $# -gt 0 ]; then
+    measure "$1" outro
+    cmp -s "$WORK/atual/saida.txt" "$WORK/outro/saida.txt" && echo "saidas identicas" || echo "SAIDAS DIFERENTES"
+fi
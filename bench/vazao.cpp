@@ -0,0 +1,194 @@
+// Vazao do lexico, do sintatico e da geracao de codigo em programas
+// sinteticos (gerador.h) de --min a --max bytes, multiplicando por 16:
+//
+//   bench/vazao [--min=1K] [--max=1G] [--formas=misto,blocos] [--tempo=0.5]
+//               [--semente=1] [opcoes do compilador: -O0, -jN, --abi=...]
+//
+// Cada fase e repetida ate somar --tempo segundos (ao menos uma vez) e o
+// resultado sai em stdout, um objeto JSON por linha e fase, sempre com as
+// mesmas chaves na mesma ordem; bench/vazao.sh grava e compara execucoes.
+// Tamanhos que nao cabem na memoria disponivel sao pulados, com aviso em
+// stderr.
+#include "gerador.h"
+#include "lexer.h"
+#include "parser.h"
+#include "profile.h"
+#include "visitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Versao do formato das linhas; muda quando uma chave muda de sentido.
+const int FORMAT_VERSION = 1;
+
+// Memoria de pico por byte de fonte (tokens, arvore e codigo gerado):
+// cerca de 100 num programa misto de 16 MiB, mais uma folga.
+const size_t BYTES_PER_SOURCE_BYTE = 120;
+
+struct Timing {
+    int repetitions = 0;
+    double best = 0;
+    double total = 0;
+};
+
+// Repete step ate somar minSeconds; step devolve a duracao da parte medida
+// (o que ela constroi e destruido fora da medida).
+template <typename Step>
+Timing repeat(double minSeconds, Step step) {
+    Timing timing;
+    while (timing.repetitions == 0 || timing.total < minSeconds) {
+        double seconds = step();
+        timing.best = timing.repetitions == 0 ? seconds : std::min(timing.best, seconds);
+        timing.total += seconds;
+        timing.repetitions++;
+    }
+    return timing;
+}
+
+double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t availableMemory() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    size_t kib;
+    std::string unit;
+    while (meminfo >> key >> kib >> unit) {
+        if (key == "MemAvailable:") return kib * 1024;
+    }
+    return static_cast<size_t>(-1);
+}
+
+struct Sample {
+    const char* shape;
+    size_t bytes;
+    size_t lines;
+    size_t tokens;
+    size_t nodes;
+};
+
+void print(const Sample& sample, const char* phase, const Timing& timing) {
+    double best = timing.best > 0 ? timing.best : 1e-9;
+    std::printf("{\"formato\": %d, \"forma\": \"%s\", \"bytes\": %zu, \"linhas\": %zu, \"tokens\": %zu, "
+                "\"nos\": %zu, \"fase\": \"%s\", \"repeticoes\": %d, \"segundos\": %.6f, "
+                "\"segundos_media\": %.6f, \"mib_s\": %.2f, \"linhas_s\": %.0f, \"nos_s\": %.0f}\n",
+                FORMAT_VERSION, sample.shape, sample.bytes, sample.lines, sample.tokens, sample.nodes, phase,
+                timing.repetitions, timing.best, timing.total / timing.repetitions,
+                sample.bytes / best / (1024 * 1024), sample.lines / best, sample.nodes / best);
+    std::fflush(stdout);
+}
+
+void measure(const GeneratorOptions& generator, const CompilerOptions& options, double minSeconds) {
+    std::string source = generateProgram(generator);
+    Sample sample{shapeName(generator.shape), source.size(),
+                  static_cast<size_t>(std::count(source.begin(), source.end(), '\n')), 0, 0};
+
+    std::vector<Token> tokens;
+    Timing lexing = repeat(minSeconds, [&] {
+        tokens = std::vector<Token>();
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(source);
+        tokens = lexer.tokenize();
+        return since(start);
+    });
+    sample.tokens = tokens.size();
+
+    std::unique_ptr<Program> program;
+    Timing parsing = repeat(minSeconds, [&] {
+        program.reset();
+        auto start = std::chrono::steady_clock::now();
+        Parser parser(tokens);
+        program = parser.parse();
+        return since(start);
+    });
+    sample.nodes = static_cast<size_t>(treeSize(*program));
+    tokens = std::vector<Token>();
+
+    Timing generating = repeat(minSeconds, [&] {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<CodeGenerationVisitor> visitor(new CodeGenerationVisitor(options));
+        program->accept(*visitor);
+        double seconds = since(start);
+        visitor.reset();
+        return seconds;
+    });
+
+    print(sample, "lexico", lexing);
+    print(sample, "sintatico", parsing);
+    print(sample, "geracao", generating);
+}
+
+bool parseShapes(const std::string& list, std::vector<Shape>& shapes) {
+    std::stringstream stream(list);
+    std::string name;
+    shapes.clear();
+    while (std::getline(stream, name, ',')) {
+        Shape shape;
+        if (!parseShape(name, shape)) return false;
+        shapes.push_back(shape);
+    }
+    return !shapes.empty();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t minBytes = 1 << 10;
+    size_t maxBytes = size_t(1) << 30;
+    double minSeconds = 0.5;
+    uint64_t seed = 1;
+    std::vector<Shape> shapes = {Shape::MIXED};
+    CompilerOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (parseOption(arg, options)) {
+            ok = !options.jit && !options.interpret && !options.emitObject && options.profileGenerate.empty() &&
+                 options.profileUse.empty() && options.cacheDir.empty() && options.timeReport.empty();
+        } else if (arg.rfind("--min=", 0) == 0) {
+            ok = (minBytes = parseSize(arg.substr(6))) > 0;
+        } else if (arg.rfind("--max=", 0) == 0) {
+            ok = (maxBytes = parseSize(arg.substr(6))) > 0;
+        } else if (arg.rfind("--formas=", 0) == 0) {
+            ok = parseShapes(arg.substr(9), shapes);
+        } else if (arg.rfind("--tempo=", 0) == 0) {
+            minSeconds = std::atof(arg.c_str() + 8);
+        } else if (arg.rfind("--semente=", 0) == 0) {
+            ok = parseSeed(arg.substr(10), seed);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Uso: " << argv[0] << " [--min=1K] [--max=1G] [--formas=misto,funcoes,profundo,blocos,"
+                      << "globais,chamadas] [--tempo=s] [--semente=N] [-O0|-O1] [-jN] [--abi=stack|sysv]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    for (Shape shape : shapes) {
+        for (size_t bytes = minBytes; bytes <= maxBytes; bytes *= 16) {
+            if (bytes * BYTES_PER_SOURCE_BYTE > availableMemory()) {
+                std::cerr << "Pulando " << shapeName(shape) << " com " << bytes
+                          << " bytes: memoria disponivel insuficiente" << std::endl;
+                continue;
+            }
+            std::cerr << "Medindo " << shapeName(shape) << " com " << bytes << " bytes" << std::endl;
+            try {
+                measure(GeneratorOptions{bytes, shape, seed}, options, minSeconds);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Erro no programa gerado: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#!/bin/bash
+# Mede a vazao do compilador (bench/vazao) e grava o resultado em
+# vazao-<commit>.jsonl no diretorio atual; as opcoes vao direto para o
+# bench/vazao. Com --compara, mostra a razao entre duas execucoes, fase
+# por fase (acima de 1: a segunda e mais rapida). Uso, a partir da raiz:
+#   bench/vazao.sh [--max=64M] [--formas=misto,blocos] [-j1] ...
+#   bench/vazao.sh --compara vazao-antes.jsonl vazao-depois.jsonl
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+if [ "${1:-}" = "--compara" ]; then
+    [ $# -eq 3 ] || { echo "Uso: $0 --compara antes.jsonl depois.jsonl" >&2; exit 1; }
+    awk '
+        function field(line, name,    m) {
+            if (match(line, "\"" name "\": \"?[^,\"}]*")) {
+                m = substr(line, RSTART, RLENGTH)
+                sub(/^"[^"]*": "?/, "", m)
+                return m
+            }
+            return ""
+        }
+        {
+            key = field($0, "forma") " " field($0, "bytes") " " field($0, "fase")
+            if (FNR == NR) { before[key] = field($0, "mib_s"); next }
+            if (key in before) order[++n] = key
+            after[key] = field($0, "mib_s")
+        }
+        END {
+            printf "%-10s %12s %-10s %10s %10s %7s\n", "forma", "bytes", "fase", "antes", "depois", "razao"
+            for (i = 1; i <= n; i++) {
+                split(order[i], k, " ")
+                b = before[order[i]]; a = after[order[i]]
+                printf "%-10s %12s %-10s %10.2f %10.2f %7.2f\n", k[1], k[2], k[3], b, a, (b > 0 ? a / b : 0)
+            }
+            print "(MiB/s de fonte)"
+        }' "$2" "$3"
+    exit 0
+fi
+
+make -s -C "$ROOT" bench
+OUT="vazao-$(git -C "$ROOT" rev-parse --short HEAD 2>/dev/null || echo local).jsonl"
+"$ROOT/bench/vazao" "$@" > "$OUT"
+echo "Resultados em $OUT"
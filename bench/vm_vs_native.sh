@@ -0,0 +1,36 @@
+#!/bin/bash
+# Compara o tempo do interpretador de bytecode (--run) com o do executavel
+# nativo (as + ld) em cada programa. Uso, a partir da raiz do repositorio:
+#   bench/vm_vs_native.sh [programas.ci...]
+# Sem argumentos, usa tests/*.ci e bench/loop.ci.
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+g++ -std=c++17 -O2 -o "$WORK/compiler" "$ROOT"/*.cpp -ldl
+cp "$ROOT/runtime.s" "$WORK/"
+
+if [ $# -eq 0 ]; then
+    set -- "$ROOT"/tests/*.ci "$ROOT/bench/loop.ci"
+fi
+
+# Tempo de parede em milissegundos do comando dado.
+elapsed() {
+    local start end
+    start=$(date +%s%N)
+    "$@" > /dev/null
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 ))
+}
+
+printf "%-24s %10s %10s %8s\n" programa nativo_ms vm_ms razao
+for program in "$@"; do
+    name=$(basename "$program" .ci)
+    (cd "$WORK" && ./compiler "$program" > /dev/null && as -64 program.s -o program.o && ld program.o -o "$name")
+    native=$(cd "$WORK" && elapsed "./$name")
+    vm=$(cd "$WORK" && elapsed ./compiler --run "$program")
+    ratio=$(awk -v n="$native" -v v="$vm" 'BEGIN { printf "%.1fx", (n > 0 ? v / n : 0) }')
+    printf "%-24s %10s %10s %8s\n" "$name" "$native" "$vm" "$ratio"
+done
@@ -0,0 +1,353 @@
+#include "binder.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+class Binder {
+public:
+    explicit Binder(const Program& program) {
+        for (const auto& decl : program.globalDeclarations) {
+            if (auto var = dynamic_cast<const VarDeclaration*>(decl.get())) {
+                globals.emplace(var->identifier, static_cast<int>(globals.size()));
+            } else if (auto array = dynamic_cast<const ArrayDeclaration*>(decl.get())) {
+                int index = static_cast<int>(globals.size());
+                if (globals.emplace(array->identifier, index).second) globalArrays[index] = array;
+            }
+        }
+    }
+
+    // Inicializadores das globais, avaliados no _start fora de qualquer
+    // funcao: so enxergam globais.
+    void bindGlobal(const VarDeclaration& decl) {
+        if (decl.initializer) bind(*decl.initializer);
+        decl.binding = Binding{StorageClass::GLOBAL, globals.at(decl.identifier)};
+    }
+
+    // Vetor global: tamanho constante, reservado no .bss.
+    void bindGlobal(const ArrayDeclaration& decl) {
+        decl.length = constantLength(decl);
+        if (decl.length < 0) {
+            throw std::runtime_error("Erro semantico: vetor global '" + decl.identifier +
+                                     "' precisa de tamanho constante.");
+        }
+        decl.binding = Binding{StorageClass::GLOBAL, globals.at(decl.identifier)};
+    }
+
+    void bindFunction(const FunctionDeclaration& fn) {
+        scope.clear();
+        localArrays.clear();
+        slots = 0;
+        allocates = false;
+        for (const auto& param : fn.parameters) {
+            scope[param.name] = Binding{StorageClass::PARAMETER, slots++};
+        }
+        bind(*fn.body);
+        fn.frameSlots = slots;
+        fn.declaresArrays = allocates;
+    }
+
+    void bindMain(const MainFunction& main) {
+        scope.clear();
+        localArrays.clear();
+        slots = 0;
+        bind(*main.body);
+        main.frameSlots = slots;
+    }
+
+private:
+    std::unordered_map<std::string, int> globals;
+    std::unordered_map<std::string, Binding> scope;
+    // Nome declarado em cada let dos blocos abertos e o que ele escondia
+    // (slot -1 se nada), desfeito ao fechar o bloco.
+    std::vector<std::pair<std::string, Binding>> shadowed;
+    int slots = 0;
+    // Declaracao de cada vetor, pelo indice da global ou pelo slot local.
+    std::unordered_map<int, const ArrayDeclaration*> globalArrays;
+    std::unordered_map<int, const ArrayDeclaration*> localArrays;
+    std::vector<const BlockStatement*> blocks;
+    bool allocates = false;
+    // parfor cujo corpo esta sendo ligado; os slots abaixo de
+    // parallelFirst sao de fora dele.
+    const ParallelForStatement* parallel = nullptr;
+    int parallelFirst = 0;
+
+    // Um literal entre 1 e MAX_ARRAY_LENGTH; -1 se o tamanho nao for
+    // constante.
+    static long long constantLength(const ArrayDeclaration& decl) {
+        auto size = dynamic_cast<const Const*>(decl.size.get());
+        if (!size) return -1;
+        if (size->valor < 1 || size->valor > MAX_ARRAY_LENGTH) {
+            throw std::runtime_error("Erro semantico: vetor '" + decl.identifier + "' com tamanho invalido (de 1 a " +
+                                     std::to_string(MAX_ARRAY_LENGTH) + " elementos).");
+        }
+        return size->valor;
+    }
+
+    const ArrayDeclaration* arrayOf(Binding binding) const {
+        const auto& arrays = binding.storage == StorageClass::GLOBAL ? globalArrays : localArrays;
+        auto it = arrays.find(binding.slot);
+        return it != arrays.end() ? it->second : nullptr;
+    }
+
+    // Nome usado como escalar.
+    Binding resolveScalar(const std::string& name) const {
+        Binding binding = resolve(name);
+        if (arrayOf(binding)) {
+            throw std::runtime_error("Erro semantico: '" + name + "' e um vetor e precisa de indice.");
+        }
+        return binding;
+    }
+
+    const ArrayDeclaration* resolveArray(const std::string& name) const {
+        const ArrayDeclaration* array = arrayOf(resolve(name));
+        if (!array) throw std::runtime_error("Erro semantico: '" + name + "' nao e um vetor.");
+        return array;
+    }
+
+    // Slot de fora lido no corpo do parfor: vai para o contexto que o
+    // corpo recebe, menos os do reduce, que cada thread tem os seus.
+    void capture(Binding binding) {
+        if (!parallel || binding.storage == StorageClass::GLOBAL || binding.slot >= parallelFirst) return;
+        const auto& reductions = parallel->reductionSlots;
+        if (std::find(reductions.begin(), reductions.end(), binding.slot) != reductions.end()) return;
+        auto& captured = parallel->captured;
+        if (std::find(captured.begin(), captured.end(), binding.slot) == captured.end()) {
+            captured.push_back(binding.slot);
+        }
+    }
+
+    void captureArray(const ArrayDeclaration& array) {
+        if (array.binding.storage == StorageClass::GLOBAL) return;
+        capture(array.binding);
+        if (array.length < 0) capture(Binding{StorageClass::LOCAL, array.binding.slot + 1});
+    }
+
+    bool isReduction(Binding binding) const {
+        if (!parallel || binding.storage == StorageClass::GLOBAL) return false;
+        const auto& reductions = parallel->reductionSlots;
+        return std::find(reductions.begin(), reductions.end(), binding.slot) != reductions.end();
+    }
+
+    // Cada thread soma a partir de 0 na sua copia e as copias sao somadas
+    // no fim, entao uma variavel do reduce so pode aparecer no corpo como
+    // o comando s = s + e ou s = s - e (ou s + a - b ...), sem s nos
+    // termos; lida em qualquer outro lugar ela teria o parcial de uma
+    // thread.
+    [[noreturn]] static void badReduction(const std::string& name) {
+        throw std::runtime_error("Erro semantico: '" + name + "' do reduce so pode aparecer no corpo de parfor como " +
+                                 name + " = " + name + " + e ou " + name + " = " + name + " - e.");
+    }
+
+    // Liga o comando s = s +/- e; false se exp nao muda uma variavel do
+    // reduce.
+    bool bindReduction(const Exp& exp) {
+        auto assign = dynamic_cast<const AssignmentExpression*>(&exp);
+        if (!parallel || !assign) return false;
+        Binding binding = resolveScalar(assign->variable);
+        if (!isReduction(binding)) return false;
+        // s + a - b chega como (s + a) - b: s e a ponta esquerda de uma
+        // cadeia de + e -
+        std::vector<const Exp*> terms;
+        const Exp* left = assign->value.get();
+        while (auto sum = dynamic_cast<const OpBin*>(left)) {
+            if (sum->op != Operador::SOMA && sum->op != Operador::SUB) break;
+            terms.push_back(sum->opDir.get());
+            left = sum->opEsq.get();
+        }
+        auto self = dynamic_cast<const Variable*>(left);
+        if (terms.empty() || !self || self->name != assign->variable) badReduction(assign->variable);
+        self->binding = binding;
+        for (auto term = terms.rbegin(); term != terms.rend(); ++term) bind(**term);
+        assign->binding = binding;
+        return true;
+    }
+
+    // No corpo do parfor so as locais dele e as do reduce mudam.
+    void checkWrite(const std::string& name, Binding binding) const {
+        if (!parallel) return;
+        const auto& reductions = parallel->reductionSlots;
+        if (binding.storage == StorageClass::GLOBAL) {
+            throw std::runtime_error("Erro semantico: o corpo de parfor nao pode mudar a global '" + name + "'.");
+        }
+        if (binding.slot == parallel->binding.slot) {
+            throw std::runtime_error("Erro semantico: o indice '" + name + "' de parfor nao pode mudar.");
+        }
+        if (binding.slot < parallelFirst &&
+            std::find(reductions.begin(), reductions.end(), binding.slot) == reductions.end()) {
+            throw std::runtime_error("Erro semantico: '" + name +
+                                     "' e de fora do parfor e so pode mudar se estiver no reduce.");
+        }
+    }
+
+    // i e uma local nova, so do corpo; inicio e fim ficam fora dele.
+    void bindParallel(const ParallelForStatement& node) {
+        if (parallel) throw std::runtime_error("Erro semantico: parfor dentro de parfor.");
+        bind(*node.start);
+        bind(*node.end);
+        node.captured.clear();
+        node.reductionSlots.clear();
+        for (const auto& name : node.reductions) {
+            Binding binding = resolveScalar(name);
+            if (binding.storage == StorageClass::GLOBAL) {
+                throw std::runtime_error("Erro semantico: '" + name + "' no reduce de parfor precisa ser local.");
+            }
+            if (std::find(node.reductionSlots.begin(), node.reductionSlots.end(), binding.slot) !=
+                node.reductionSlots.end()) {
+                throw std::runtime_error("Erro semantico: '" + name + "' repetida no reduce de parfor.");
+            }
+            node.reductionSlots.push_back(binding.slot);
+        }
+
+        size_t mark = shadowed.size();
+        parallelFirst = slots;
+        node.binding = Binding{StorageClass::LOCAL, slots++};
+        declare(node.index, node.binding);
+        parallel = &node;
+        bindBlock(*node.body);
+        parallel = nullptr;
+        close(mark);
+    }
+
+    void declare(const std::string& name, Binding binding) {
+        auto it = scope.find(name);
+        shadowed.emplace_back(name, it != scope.end() ? it->second : Binding());
+        scope[name] = binding;
+    }
+
+    void bindBlock(const Statement& stmt) {
+        size_t mark = shadowed.size();
+        bind(stmt);
+        close(mark);
+    }
+
+    void close(size_t mark) {
+        while (shadowed.size() > mark) {
+            auto& entry = shadowed.back();
+            if (entry.second.slot < 0) {
+                scope.erase(entry.first);
+            } else {
+                scope[entry.first] = entry.second;
+            }
+            shadowed.pop_back();
+        }
+    }
+
+    Binding resolve(const std::string& name) const {
+        auto local = scope.find(name);
+        if (local != scope.end()) return local->second;
+        auto global = globals.find(name);
+        if (global == globals.end()) {
+            throw std::runtime_error("Erro semantico: variavel '" + name + "' nao declarada.");
+        }
+        return Binding{StorageClass::GLOBAL, global->second};
+    }
+
+    void bind(const Statement& stmt) {
+        if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+            size_t mark = shadowed.size();
+            block->declaresArrays = false;
+            blocks.push_back(block);
+            for (const auto& s : block->statements) bind(*s);
+            blocks.pop_back();
+            close(mark);
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+            bind(*ifStmt->condition);
+            bindBlock(*ifStmt->thenBranch);
+            if (ifStmt->elseBranch) bindBlock(*ifStmt->elseBranch);
+        } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+            bind(*loop->condition);
+            bindBlock(*loop->body);
+        } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+            if (!bindReduction(*exprStmt->expression)) bind(*exprStmt->expression);
+        } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+            if (var->initializer) bind(*var->initializer);
+            var->binding = Binding{StorageClass::LOCAL, slots++};
+            declare(var->identifier, var->binding);
+        } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+            // o tamanho e avaliado na declaracao e fica no slot seguinte
+            bind(*array->size);
+            array->length = constantLength(*array);
+            array->binding = Binding{StorageClass::LOCAL, slots};
+            slots += 2;
+            localArrays[array->binding.slot] = array;
+            declare(array->identifier, array->binding);
+            if (!blocks.empty()) blocks.back()->declaresArrays = true;
+            allocates = true;
+        } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+            bind(*match->subject);
+            std::unordered_set<int> seen;
+            for (const auto& arm : match->arms) {
+                for (int value : arm.values) {
+                    if (!seen.insert(value).second) {
+                        throw std::runtime_error("Erro semantico: valor " + std::to_string(value) +
+                                                 " repetido no match.");
+                    }
+                }
+                bindBlock(*arm.body);
+            }
+            if (match->otherwise) bindBlock(*match->otherwise);
+        } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+            bindParallel(*parfor);
+        } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+            if (parallel) throw std::runtime_error("Erro semantico: return dentro de parfor.");
+            bind(*ret->expression);
+        }
+    }
+
+    void bind(const Exp& exp) {
+        if (auto var = dynamic_cast<const Variable*>(&exp)) {
+            var->binding = resolveScalar(var->name);
+            if (isReduction(var->binding)) badReduction(var->name);
+            capture(var->binding);
+        } else if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+            bind(*bin->opEsq);
+            bind(*bin->opDir);
+        } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+            bind(*cmp->left);
+            bind(*cmp->right);
+        } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+            bind(*logical->left);
+            bind(*logical->right);
+        } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+            bind(*unary->operand);
+        } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+            bind(*assign->value);
+            assign->binding = resolveScalar(assign->variable);
+            if (isReduction(assign->binding)) badReduction(assign->variable);
+            checkWrite(assign->variable, assign->binding);
+        } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+            bind(*element->index);
+            element->array = resolveArray(element->name);
+            captureArray(*element->array);
+        } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+            bind(*store->index);
+            bind(*store->value);
+            store->array = resolveArray(store->name);
+            captureArray(*store->array);
+        } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+            for (const auto& arg : call->arguments) bind(*arg);
+        }
+    }
+};
+
+}
+
+void bindNames(const Program& program) {
+    Binder binder(program);
+    for (const auto& decl : program.globalDeclarations) {
+        if (auto var = dynamic_cast<const VarDeclaration*>(decl.get())) {
+            binder.bindGlobal(*var);
+        } else if (auto array = dynamic_cast<const ArrayDeclaration*>(decl.get())) {
+            binder.bindGlobal(*array);
+        } else if (auto fn = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
+            binder.bindFunction(*fn);
+        }
+    }
+    if (auto main = dynamic_cast<const MainFunction*>(program.mainFunction.get())) {
+        binder.bindMain(*main);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "ast.h"
+
+// Resolve cada Variable, AssignmentExpression e VarDeclaration para global,
+// parametro ou local (ast.h) e conta os slots de cada funcao, numa passada
+// so pela arvore; a geracao de codigo usa o resultado sem procurar nomes.
+// Uma local vale do let ate o fim do bloco que a declara (os ramos de um if
+// e o corpo de um while contam como bloco, com ou sem chaves) e so depois
+// do proprio inicializador; um let interno esconde o nome de fora ate o fim
+// do bloco. Cada let tem o seu slot. O que nao for parametro nem local
+// precisa ser uma global declarada. Vetores (ArrayDeclaration) seguem as
+// mesmas regras; cada acesso recebe a declaracao do vetor, e um vetor local
+// ocupa dois slots, o do endereco e o do tamanho. O indice de um parfor e
+// uma local do corpo; os slots de fora lidos no corpo e os do reduce ficam
+// anotados no ParallelForStatement. Lanca runtime_error para um nome sem
+// declaracao, um vetor usado como escalar (ou o contrario), um tamanho
+// constante fora de 1..MAX_ARRAY_LENGTH e, no corpo de um parfor, return,
+// outro parfor ou escrita numa variavel de fora que nao esteja no reduce.
+// Pode ser repetida sobre a mesma arvore.
+void bindNames(const Program& program);
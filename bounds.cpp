@@ -0,0 +1,318 @@
+#include "bounds.h"
+#include <climits>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// Visita e e cada subexpressao, em pre-ordem.
+template <typename F>
+void walk(const Exp& exp, F&& f) {
+    f(exp);
+    if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+        walk(*bin->opEsq, f);
+        walk(*bin->opDir, f);
+    } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+        walk(*cmp->left, f);
+        walk(*cmp->right, f);
+    } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+        walk(*logical->left, f);
+        walk(*logical->right, f);
+    } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+        walk(*unary->operand, f);
+    } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+        walk(*assign->value, f);
+    } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+        walk(*element->index, f);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+        walk(*store->index, f);
+        walk(*store->value, f);
+    } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+        for (const auto& arg : call->arguments) walk(*arg, f);
+    }
+}
+
+// Todas as expressoes de stmt; loops diz quantos while envolvem cada uma
+// dentro de stmt.
+template <typename F>
+void walk(const Statement& stmt, F&& f, int loops = 0) {
+    auto exp = [&](const Exp& e) { walk(e, [&](const Exp& sub) { f(sub, loops); }); };
+    if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+        for (const auto& s : block->statements) walk(*s, f, loops);
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        exp(*ifStmt->condition);
+        walk(*ifStmt->thenBranch, f, loops);
+        if (ifStmt->elseBranch) walk(*ifStmt->elseBranch, f, loops);
+    } else if (auto whileStmt = dynamic_cast<const WhileStatement*>(&stmt)) {
+        walk(*whileStmt->condition, [&](const Exp& sub) { f(sub, loops + 1); });
+        walk(*whileStmt->body, f, loops + 1);
+    } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+        exp(*match->subject);
+        for (const auto& arm : match->arms) walk(*arm.body, f, loops);
+        if (match->otherwise) walk(*match->otherwise, f, loops);
+    } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+        exp(*parfor->start);
+        exp(*parfor->end);
+        walk(*parfor->body, f, loops + 1);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        exp(*exprStmt->expression);
+    } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+        if (var->initializer) exp(*var->initializer);
+    } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+        exp(*array->size);
+    } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+        exp(*ret->expression);
+    }
+}
+
+// Slot de um parametro ou local; -1 para o resto.
+int localSlot(const Exp& exp) {
+    auto var = dynamic_cast<const Variable*>(&exp);
+    return var && var->binding.storage != StorageClass::GLOBAL ? var->binding.slot : -1;
+}
+
+const AssignmentExpression* assignmentTo(const Exp& exp, int slot) {
+    auto assign = dynamic_cast<const AssignmentExpression*>(&exp);
+    bool local = assign && assign->binding.storage != StorageClass::GLOBAL;
+    return local && assign->binding.slot == slot ? assign : nullptr;
+}
+
+bool isConstant(const Exp& exp, long long min, long long max) {
+    auto c = dynamic_cast<const Const*>(&exp);
+    return c && c->valor >= min && c->valor <= max;
+}
+
+// i = i + c ou i = c + i, com 0 <= c < 2^31.
+bool isStep(const AssignmentExpression& assign, int slot) {
+    auto sum = dynamic_cast<const OpBin*>(assign.value.get());
+    if (!sum || sum->op != Operador::SOMA) return false;
+    return (localSlot(*sum->opEsq) == slot && isConstant(*sum->opDir, 0, INT_MAX)) ||
+           (localSlot(*sum->opDir) == slot && isConstant(*sum->opEsq, 0, INT_MAX));
+}
+
+template <typename T>
+bool writes(const T& node, int slot) {
+    bool found = false;
+    walk(node, [&](const Exp& exp, auto...) { found = found || assignmentTo(exp, slot); });
+    return found;
+}
+
+// Fato "indice < limite" de um laco envolvente, valido ate o indice mudar.
+// loop e nulo no indice de um parfor, que comeca >= 0 e nunca muda.
+struct Fact {
+    const WhileStatement* loop;
+    int index;
+    long long limit;  // -1 quando o limite e a local limitSlot
+    int limitSlot;
+    bool valid;
+    bool used;
+};
+
+class BoundsAnalysis {
+public:
+    void function(const Statement& body) {
+        assigned.clear();
+        walk(body, [&](const Exp& exp, int) {
+            auto assign = dynamic_cast<const AssignmentExpression*>(&exp);
+            if (assign && assign->binding.storage != StorageClass::GLOBAL) assigned.insert(assign->binding.slot);
+        });
+        statement(body, nullptr);
+    }
+
+    void expression(const Exp& exp) {
+        for (auto& fact : facts) {
+            if (fact.valid && writes(exp, fact.index)) fact.valid = false;
+        }
+        walk(exp, [&](const Exp& sub) {
+            if (auto element = dynamic_cast<const ArrayAccess*>(&sub)) {
+                element->bounds = decide(*element->array, *element->index);
+            } else if (auto store = dynamic_cast<const ArrayAssignment*>(&sub)) {
+                store->bounds = decide(*store->array, *store->index);
+            }
+        });
+    }
+
+private:
+    std::unordered_set<int> assigned;  // slots que recebem atribuicao na funcao
+    std::vector<Fact> facts;           // do laco mais externo para o mais interno
+
+    void statement(const Statement& stmt, const BlockStatement* block) {
+        if (auto inner = dynamic_cast<const BlockStatement*>(&stmt)) {
+            for (const auto& s : inner->statements) statement(*s, inner);
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+            expression(*ifStmt->condition);
+            std::vector<Fact> before = facts;
+            statement(*ifStmt->thenBranch, block);
+            std::vector<Fact> afterThen = facts;
+            for (size_t i = 0; i < facts.size(); i++) facts[i].valid = before[i].valid;
+            if (ifStmt->elseBranch) statement(*ifStmt->elseBranch, block);
+            for (size_t i = 0; i < facts.size(); i++) {
+                facts[i].valid = facts[i].valid && afterThen[i].valid;
+                facts[i].used = facts[i].used || afterThen[i].used;
+            }
+        } else if (auto whileStmt = dynamic_cast<const WhileStatement*>(&stmt)) {
+            loop(*whileStmt, block);
+        } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+            branches(*match, block);
+        } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+            parallel(*parfor);
+        } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+            expression(*exprStmt->expression);
+        } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+            if (var->initializer) expression(*var->initializer);
+        } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+            expression(*array->size);
+        } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+            expression(*ret->expression);
+        }
+    }
+
+    // Como no if: cada braco parte dos fatos de antes e so continua valido
+    // o que vale ao fim de todos, inclusive sem braco nenhum.
+    void branches(const MatchStatement& node, const BlockStatement* block) {
+        expression(*node.subject);
+        std::vector<Fact> before = facts;
+        std::vector<bool> valid(facts.size(), true);
+        auto arm = [&](const BlockStatement& body) {
+            for (size_t i = 0; i < facts.size(); i++) facts[i].valid = before[i].valid;
+            statement(body, block);
+            for (size_t i = 0; i < facts.size(); i++) valid[i] = valid[i] && facts[i].valid;
+        };
+        for (const auto& a : node.arms) arm(*a.body);
+        if (node.otherwise) arm(*node.otherwise);
+        for (size_t i = 0; i < facts.size(); i++) {
+            facts[i].valid = valid[i] && (node.otherwise || before[i].valid);
+        }
+    }
+
+    void loop(const WhileStatement& node, const BlockStatement* block) {
+        node.boundsIndex = nullptr;
+        node.entryTest = false;
+        expression(*node.condition);
+
+        Fact fact{&node, -1, -1, -1, true, false};
+        const Variable* index = condition(node, fact);
+        if (index) facts.push_back(fact);
+        statement(*node.body, block);
+        if (!index) return;
+
+        if (facts.back().used) {
+            node.boundsIndex = index;
+            node.entryTest = !nonNegativeBefore(node, block, fact.index);
+        }
+        facts.pop_back();
+        // o laco pode ter mudado o indice de um laco de fora; os fatos de
+        // fora ja foram invalidados ao passar pelas atribuicoes
+    }
+
+    void parallel(const ParallelForStatement& node) {
+        expression(*node.start);
+        expression(*node.end);
+        Fact fact{nullptr, node.binding.slot, -1, -1, isConstant(*node.start, 0, LLONG_MAX), false};
+        if (isConstant(*node.end, LLONG_MIN, MAX_ARRAY_LENGTH)) {
+            fact.limit = static_cast<const Const&>(*node.end).valor;
+        } else if (localSlot(*node.end) >= 0 && !assigned.count(localSlot(*node.end))) {
+            fact.limitSlot = localSlot(*node.end);
+        } else {
+            fact.valid = false;
+        }
+        facts.push_back(fact);
+        statement(*node.body, nullptr);
+        facts.pop_back();
+    }
+
+    // i < n, n > i ou i <= c, com i so avancando dentro do laco.
+    const Variable* condition(const WhileStatement& node, Fact& fact) const {
+        auto cmp = dynamic_cast<const ComparisonExpression*>(node.condition.get());
+        if (!cmp) return nullptr;
+        const Exp* index = cmp->left.get();
+        const Exp* limit = cmp->right.get();
+        ComparisonOperator op = cmp->op;
+        if (op == ComparisonOperator::GREATER || op == ComparisonOperator::GREATER_EQUAL) {
+            std::swap(index, limit);
+            op = op == ComparisonOperator::GREATER ? ComparisonOperator::LESS : ComparisonOperator::LESS_EQUAL;
+        }
+        if (op != ComparisonOperator::LESS && op != ComparisonOperator::LESS_EQUAL) return nullptr;
+
+        fact.index = localSlot(*index);
+        if (fact.index < 0) return nullptr;
+        if (auto c = dynamic_cast<const Const*>(limit)) {
+            if (c->valor > MAX_ARRAY_LENGTH) return nullptr;
+            fact.limit = op == ComparisonOperator::LESS ? c->valor : c->valor + 1;
+        } else if (op == ComparisonOperator::LESS && localSlot(*limit) >= 0 &&
+                   !assigned.count(localSlot(*limit))) {
+            fact.limitSlot = localSlot(*limit);
+        } else {
+            return nullptr;
+        }
+
+        bool advances = true;
+        walk(*node.body, [&](const Exp& exp, int loops) {
+            const AssignmentExpression* assign = assignmentTo(exp, fact.index);
+            if (assign && (loops > 0 || !isStep(*assign, fact.index))) advances = false;
+        });
+        return advances ? static_cast<const Variable*>(index) : nullptr;
+    }
+
+    BoundsCheck decide(const ArrayDeclaration& array, const Exp& index) {
+        BoundsCheck check;
+        if (array.length > 0 && isConstant(index, 0, array.length - 1)) {
+            check.proven = true;
+            return check;
+        }
+        int slot = localSlot(index);
+        if (slot < 0) return check;
+        for (auto& fact : facts) {
+            if (fact.valid && fact.index == slot && fits(fact, array)) {
+                fact.used = true;
+                check.loop = fact.loop;
+                check.proven = !fact.loop;
+                break;
+            }
+        }
+        return check;
+    }
+
+    bool fits(const Fact& fact, const ArrayDeclaration& array) const {
+        if (fact.limitSlot < 0) return array.length > 0 && fact.limit <= array.length;
+        return array.length < 0 && localSlot(*array.size) == fact.limitSlot;
+    }
+
+    // O ultimo comando antes do laco que pode mudar i e let i = c ou
+    // i = c, com c >= 0 (ou let i sem valor).
+    static bool nonNegativeBefore(const WhileStatement& node, const BlockStatement* block, int slot) {
+        if (!block) return false;
+        size_t at = 0;
+        while (at < block->statements.size() && block->statements[at].get() != &node) at++;
+        while (at-- > 0) {
+            const Statement& stmt = *block->statements[at];
+            if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+                if (var->binding.storage != StorageClass::GLOBAL && var->binding.slot == slot) {
+                    return !var->initializer || isConstant(*var->initializer, 0, LLONG_MAX);
+                }
+            }
+            if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+                const AssignmentExpression* assign = assignmentTo(*exprStmt->expression, slot);
+                if (assign) return isConstant(*assign->value, 0, LLONG_MAX);
+            }
+            if (writes(stmt, slot)) return false;
+        }
+        return false;
+    }
+};
+
+}
+
+void markBoundsChecks(const Program& program) {
+    BoundsAnalysis analysis;
+    for (const auto& decl : program.globalDeclarations) {
+        if (auto var = dynamic_cast<const VarDeclaration*>(decl.get())) {
+            if (var->initializer) analysis.expression(*var->initializer);
+        } else if (auto fn = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
+            analysis.function(*fn->body);
+        }
+    }
+    if (auto main = dynamic_cast<const MainFunction*>(program.mainFunction.get())) {
+        analysis.function(*main->body);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "ast.h"
+
+// Marca os acessos a vetor que dispensam a checagem de limites (BoundsCheck
+// em ast.h); roda depois de bindNames e refaz todas as marcas.
+//
+// Um indice constante dentro de um vetor de tamanho constante nunca e
+// checado. Num laco while (i < n) ou while (i <= c), com i parametro ou
+// local, n uma constante ou uma local que nunca recebe atribuicao, a[i]
+// dispensa a checagem enquanto i nao mudar depois do teste, quando o vetor
+// tem tamanho constante de ao menos n (ou c + 1) ou foi declarado com
+// tamanho n. Para isso i so pode mudar dentro do laco por i = i + c, com c
+// constante entre 0 e 2^31 - 1, fora de lacos internos: nao negativo na
+// entrada, i nao decresce nem transborda. Se o let ou a atribuicao que
+// vem antes do laco no mesmo bloco nao garantir i >= 0, o laco fica com
+// entryTest e a geracao de codigo faz duas versoes dele, escolhidas por
+// esse teste na entrada. O indice de um parfor com inicio constante nao
+// negativo segue as mesmas regras de limite, mas como nunca muda o acesso
+// fica sem checagem em qualquer versao.
+void markBoundsChecks(const Program& program);
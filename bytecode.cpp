@@ -0,0 +1,338 @@
+#include "bytecode.h"
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+struct Source {
+    bool isImm;
+    int32_t reg;
+    int64_t imm;
+};
+
+ComparisonOperator mirrored(ComparisonOperator op) {
+    switch (op) {
+        case ComparisonOperator::LESS: return ComparisonOperator::GREATER;
+        case ComparisonOperator::GREATER: return ComparisonOperator::LESS;
+        case ComparisonOperator::LESS_EQUAL: return ComparisonOperator::GREATER_EQUAL;
+        case ComparisonOperator::GREATER_EQUAL: return ComparisonOperator::LESS_EQUAL;
+        default: return op;
+    }
+}
+
+// Indice da condicao na sequencia EQ, NE, LT, GT, LE, GE de BYTECODE_OPS.
+int conditionIndex(ComparisonOperator op) {
+    switch (op) {
+        case ComparisonOperator::EQUAL: return 0;
+        case ComparisonOperator::NOT_EQUAL: return 1;
+        case ComparisonOperator::LESS: return 2;
+        case ComparisonOperator::GREATER: return 3;
+        case ComparisonOperator::LESS_EQUAL: return 4;
+        case ComparisonOperator::GREATER_EQUAL: return 5;
+    }
+    return 0;
+}
+
+BcOp conditional(BcOp first, ComparisonOperator op, bool immediate) {
+    return static_cast<BcOp>(static_cast<int>(first) + 2 * conditionIndex(op) + (immediate ? 1 : 0));
+}
+
+class FunctionCompiler {
+public:
+    FunctionCompiler(const IRFunction& fn, BcProgram& program, const std::map<std::string, int>& functionIndex,
+                     const std::map<std::string, int>& globalIndex, std::map<std::string, int>& externIndex)
+        : fn(fn), program(program), functionIndex(functionIndex), globalIndex(globalIndex),
+          externIndex(externIndex) {}
+
+    BcFunction compile() {
+        out.name = fn.name;
+        out.registerCount = fn.vregCount + 2;
+        out.params.assign(fn.params.begin(), fn.params.end());
+
+        for (const auto& instr : fn.code) {
+            translate(instr);
+        }
+        for (const auto& jump : jumps) {
+            auto target = labels.find(jump.second);
+            if (target == labels.end()) {
+                throw std::runtime_error("Erro interno: rotulo '" + jump.second + "' inexistente no bytecode.");
+            }
+            out.code[jump.first].a = target->second;
+        }
+        return std::move(out);
+    }
+
+private:
+    const IRFunction& fn;
+    BcProgram& program;
+    const std::map<std::string, int>& functionIndex;
+    const std::map<std::string, int>& globalIndex;
+    std::map<std::string, int>& externIndex;
+    BcFunction out;
+    std::map<std::string, int32_t> labels;
+    std::vector<std::pair<size_t, std::string>> jumps;
+    int nextTemp = 0;
+
+    void emit(BcOp op, int32_t a = 0, int32_t b = 0, int32_t c = 0, int64_t imm = 0) {
+        BcInstr instr;
+        instr.op = op;
+        instr.a = a;
+        instr.b = b;
+        instr.c = c;
+        instr.imm = imm;
+        out.code.push_back(instr);
+    }
+
+    void emitJump(BcOp op, const std::string& label, int32_t b = 0, int32_t c = 0, int64_t imm = 0) {
+        jumps.emplace_back(out.code.size(), label);
+        emit(op, 0, b, c, imm);
+    }
+
+    int32_t global(const std::string& name) const {
+        auto it = globalIndex.find(name);
+        if (it == globalIndex.end()) {
+            throw std::runtime_error("Erro semantico: variavel '" + name + "' nao declarada.");
+        }
+        return it->second;
+    }
+
+    // Os dois temporarios se alternam: nenhuma instrucao le mais de duas
+    // globais.
+    int32_t temp() {
+        nextTemp ^= 1;
+        return fn.vregCount + nextTemp;
+    }
+
+    Source source(const Operand& op) {
+        switch (op.kind) {
+            case Operand::Kind::VREG:
+                return Source{false, op.vreg, 0};
+            case Operand::Kind::IMM:
+                return Source{true, 0, op.imm};
+            case Operand::Kind::GLOBAL: {
+                int32_t t = temp();
+                emit(BcOp::LOADG, t, global(op.name));
+                return Source{false, t, 0};
+            }
+            case Operand::Kind::NONE:
+                break;
+        }
+        throw std::runtime_error("Erro interno: operando invalido no bytecode.");
+    }
+
+    Source inRegister(Source s) {
+        if (!s.isImm) return s;
+        int32_t t = temp();
+        emit(BcOp::MOV_RI, t, 0, 0, s.imm);
+        return Source{false, t, 0};
+    }
+
+    // Destino do resultado; globais recebem o valor de um temporario
+    // depois da operacao (ver store).
+    int32_t destination(const Operand& dst) {
+        return dst.isVReg() ? dst.vreg : fn.vregCount;
+    }
+
+    void store(const Operand& dst, int32_t reg) {
+        if (dst.isGlobal()) emit(BcOp::STOREG, reg, global(dst.name));
+    }
+
+    void arithmetic(const IRInstr& instr) {
+        Source a = source(instr.a);
+        Source b = source(instr.b);
+        if (a.isImm && b.isImm) a = inRegister(a);
+        int32_t dst = destination(instr.dst);
+        BcOp rr, ri, ir;
+        switch (instr.op) {
+            case IROp::ADD: rr = BcOp::ADD_RR; ri = BcOp::ADD_RI; ir = BcOp::ADD_RI; break;
+            case IROp::SUB: rr = BcOp::SUB_RR; ri = BcOp::SUB_RI; ir = BcOp::SUB_IR; break;
+            case IROp::MUL: rr = BcOp::MUL_RR; ri = BcOp::MUL_RI; ir = BcOp::MUL_RI; break;
+            default: rr = BcOp::DIV_RR; ri = BcOp::DIV_RI; ir = BcOp::DIV_IR; break;
+        }
+        if (!a.isImm && !b.isImm) {
+            emit(rr, dst, a.reg, b.reg);
+        } else if (b.isImm) {
+            emit(ri, dst, a.reg, 0, b.imm);
+        } else {
+            emit(ir, dst, b.reg, 0, a.imm);
+        }
+        store(instr.dst, dst);
+    }
+
+    // Compara a e b; com a imediato os operandos trocam de lado e a
+    // condicao e espelhada.
+    bool compareOperands(const IRInstr& instr, Source& a, Source& b, ComparisonOperator& cond) {
+        a = source(instr.a);
+        b = source(instr.b);
+        cond = instr.cond;
+        if (a.isImm && b.isImm) a = inRegister(a);
+        if (a.isImm) {
+            std::swap(a, b);
+            cond = mirrored(cond);
+        }
+        return b.isImm;
+    }
+
+    void translate(const IRInstr& instr) {
+        switch (instr.op) {
+            case IROp::MOV: {
+                if (instr.dst.isGlobal()) {
+                    Source s = source(instr.a);
+                    if (s.isImm) {
+                        emit(BcOp::STOREG_I, 0, global(instr.dst.name), 0, s.imm);
+                    } else {
+                        emit(BcOp::STOREG, s.reg, global(instr.dst.name));
+                    }
+                } else if (instr.a.isGlobal()) {
+                    emit(BcOp::LOADG, instr.dst.vreg, global(instr.a.name));
+                } else if (instr.a.isImm()) {
+                    emit(BcOp::MOV_RI, instr.dst.vreg, 0, 0, instr.a.imm);
+                } else if (instr.a.vreg != instr.dst.vreg) {
+                    emit(BcOp::MOV_RR, instr.dst.vreg, instr.a.vreg);
+                }
+                break;
+            }
+            case IROp::ADD:
+            case IROp::SUB:
+            case IROp::MUL:
+            case IROp::DIV:
+                arithmetic(instr);
+                break;
+            case IROp::CMP: {
+                Source a, b;
+                ComparisonOperator cond;
+                bool immediate = compareOperands(instr, a, b, cond);
+                int32_t dst = destination(instr.dst);
+                emit(conditional(BcOp::EQ_RR, cond, immediate), dst, a.reg, b.reg, b.imm);
+                store(instr.dst, dst);
+                break;
+            }
+            case IROp::NOT: {
+                int32_t dst = destination(instr.dst);
+                if (instr.a.isImm()) {
+                    emit(BcOp::MOV_RI, dst, 0, 0, instr.a.imm == 0);
+                } else {
+                    emit(BcOp::NOT_R, dst, source(instr.a).reg);
+                }
+                store(instr.dst, dst);
+                break;
+            }
+            case IROp::LABEL:
+                labels[instr.label] = static_cast<int32_t>(out.code.size());
+                break;
+            case IROp::JMP:
+                emitJump(BcOp::JMP, instr.label);
+                break;
+            case IROp::JZ:
+            case IROp::JNZ: {
+                if (instr.a.isImm()) {
+                    if ((instr.a.imm == 0) == (instr.op == IROp::JZ)) emitJump(BcOp::JMP, instr.label);
+                    break;
+                }
+                emitJump(instr.op == IROp::JZ ? BcOp::JZ : BcOp::JNZ, instr.label, source(instr.a).reg);
+                break;
+            }
+            case IROp::JCC: {
+                Source a, b;
+                ComparisonOperator cond;
+                bool immediate = compareOperands(instr, a, b, cond);
+                emitJump(conditional(BcOp::JEQ_RR, cond, immediate), instr.label, a.reg, b.reg, b.imm);
+                break;
+            }
+            case IROp::CALL:
+                call(instr);
+                break;
+            case IROp::PRINT:
+            case IROp::RET:
+            case IROp::EXIT: {
+                Source s = source(instr.a);
+                BcOp reg = instr.op == IROp::PRINT ? BcOp::PRINT_R : instr.op == IROp::RET ? BcOp::RET_R : BcOp::EXIT_R;
+                BcOp imm = instr.op == IROp::PRINT ? BcOp::PRINT_I : instr.op == IROp::RET ? BcOp::RET_I : BcOp::EXIT_I;
+                emit(s.isImm ? imm : reg, s.reg, 0, 0, s.imm);
+                break;
+            }
+            case IROp::FLUSH:
+                emit(BcOp::FLUSH);
+                break;
+            case IROp::COUNT:
+                throw std::runtime_error("Erro: --profile-generate nao e suportado com --run.");
+            case IROp::ALLOCA:
+            case IROp::LOAD:
+            case IROp::STORE:
+            case IROp::CHECK:
+            case IROp::STACKSAVE:
+            case IROp::STACKRESTORE:
+            case IROp::VLOAD:
+            case IROp::VSTORE:
+            case IROp::VADD:
+            case IROp::VSUB:
+            case IROp::VCMP:
+            case IROp::VSPLAT:
+            case IROp::VZERO:
+            case IROp::VSUM:
+                throw std::runtime_error("Erro: vetores nao sao suportados com --run.");
+            case IROp::ADDRESS:
+            case IROp::ATOMICADD:
+                throw std::runtime_error("Erro: parfor nao e suportado com --run.");
+            case IROp::SWITCH:
+            case IROp::BITTEST:
+                throw std::runtime_error("Erro interno: tabela de match no bytecode.");
+        }
+    }
+
+    void call(const IRInstr& instr) {
+        int32_t first = static_cast<int32_t>(program.args.size());
+        for (const auto& arg : instr.args) {
+            BcArg bc;
+            if (arg.isVReg()) {
+                bc = BcArg{BcArg::Kind::REG, arg.vreg};
+            } else if (arg.isImm()) {
+                bc = BcArg{BcArg::Kind::IMM, arg.imm};
+            } else {
+                bc = BcArg{BcArg::Kind::GLOBAL, global(arg.name)};
+            }
+            program.args.push_back(bc);
+        }
+
+        int32_t dst = destination(instr.dst);
+        int64_t count = static_cast<int64_t>(instr.args.size());
+        auto callee = functionIndex.find(instr.label);
+        if (callee != functionIndex.end()) {
+            emit(BcOp::CALL, dst, callee->second, first, count);
+        } else {
+            auto ext = externIndex.find(instr.label);
+            if (ext == externIndex.end()) {
+                ext = externIndex.emplace(instr.label, static_cast<int>(program.externs.size())).first;
+                program.externs.push_back(instr.label);
+            }
+            if (count > 6) {
+                throw std::runtime_error("Erro: --run aceita no maximo 6 argumentos em funcoes externas.");
+            }
+            emit(BcOp::CALL_EXTERN, dst, ext->second, first, count);
+        }
+        store(instr.dst, dst);
+    }
+};
+
+}
+
+BcProgram compileBytecode(const std::vector<IRFunction>& functions, const std::vector<std::string>& globals) {
+    BcProgram program;
+    program.globals = globals;
+
+    std::map<std::string, int> functionIndex;
+    for (size_t i = 0; i < functions.size(); i++) {
+        functionIndex[functions[i].name] = static_cast<int>(i);
+        if (functions[i].isEntry) program.entry = static_cast<int>(i);
+    }
+    std::map<std::string, int> globalIndex;
+    for (size_t i = 0; i < globals.size(); i++) {
+        globalIndex[globals[i]] = static_cast<int>(i);
+    }
+
+    std::map<std::string, int> externIndex;
+    for (const auto& fn : functions) {
+        program.functions.push_back(FunctionCompiler(fn, program, functionIndex, globalIndex, externIndex).compile());
+    }
+    return program;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "ir.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bytecode de registradores do interpretador (--run). Cada funcao tem um
+// quadro de registradores de 64 bits: os vregs do IR mais dois temporarios
+// para globais. O sufixo indica a forma dos operandos (R registrador,
+// I imediato); as formas com imediato e as comparacoes fundidas com o
+// desvio (J*_RR, J*_RI) sao as superinstrucoes para os padroes mais comuns
+// de OpBin e ComparisonExpression.
+#define BYTECODE_OPS(X)                                                            \
+    X(MOV_RR) X(MOV_RI) X(LOADG) X(STOREG) X(STOREG_I)                             \
+    X(ADD_RR) X(ADD_RI) X(SUB_RR) X(SUB_RI) X(SUB_IR)                              \
+    X(MUL_RR) X(MUL_RI) X(DIV_RR) X(DIV_RI) X(DIV_IR)                              \
+    X(EQ_RR) X(EQ_RI) X(NE_RR) X(NE_RI) X(LT_RR) X(LT_RI)                          \
+    X(GT_RR) X(GT_RI) X(LE_RR) X(LE_RI) X(GE_RR) X(GE_RI) X(NOT_R)                 \
+    X(JMP) X(JZ) X(JNZ)                                                            \
+    X(JEQ_RR) X(JEQ_RI) X(JNE_RR) X(JNE_RI) X(JLT_RR) X(JLT_RI)                    \
+    X(JGT_RR) X(JGT_RI) X(JLE_RR) X(JLE_RI) X(JGE_RR) X(JGE_RI)                    \
+    X(CALL) X(CALL_EXTERN) X(RET_R) X(RET_I) X(PRINT_R) X(PRINT_I) X(FLUSH) X(EXIT_R) X(EXIT_I)
+
+#define BYTECODE_ENUM(name) name,
+enum class BcOp : uint8_t { BYTECODE_OPS(BYTECODE_ENUM) };
+#undef BYTECODE_ENUM
+
+// Operacoes: a e o registrador destino (ou o alvo, nos desvios), b e c os
+// registradores de origem e imm o imediato. LOADG/STOREG usam b como indice
+// da global. CALL usa b para a funcao, c para o primeiro argumento em
+// BcProgram::args e imm para a quantidade.
+struct BcInstr {
+    BcOp op;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t c = 0;
+    int64_t imm = 0;
+};
+
+struct BcArg {
+    enum class Kind : uint8_t { REG, IMM, GLOBAL };
+    Kind kind;
+    int64_t value;
+};
+
+struct BcFunction {
+    std::string name;
+    int registerCount = 0;
+    std::vector<int32_t> params;
+    std::vector<BcInstr> code;
+};
+
+struct BcProgram {
+    std::vector<BcFunction> functions;
+    std::vector<BcArg> args;
+    std::vector<std::string> globals;
+    std::vector<std::string> externs;
+    int entry = -1;
+};
+
+BcProgram compileBytecode(const std::vector<IRFunction>& functions, const std::vector<std::string>& globals);
@@ -0,0 +1,240 @@
+#include "cache.h"
+#include <atomic>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Muda quando o formato das entradas ou a geracao de codigo mudam de um
+// jeito que invalide o que ja esta no cache.
+static const char* const CACHE_VERSION = "cache2";
+
+namespace {
+
+// Texto canonico da arvore: so tipos, nomes, operadores e constantes.
+class Normalizer {
+public:
+    Normalizer(const std::map<std::string, size_t>& externs,
+               const std::map<std::string, const FunctionDeclaration*>& functions)
+        : externs(externs), functions(functions) {}
+
+    std::string out;
+
+    void statement(const Statement& stmt) {
+        if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+            out += "{";
+            for (const auto& s : block->statements) statement(*s);
+            out += "}";
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+            out += "(if ";
+            expression(*ifStmt->condition);
+            statement(*ifStmt->thenBranch);
+            if (ifStmt->elseBranch) statement(*ifStmt->elseBranch);
+            out += ")";
+        } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+            out += "(while ";
+            expression(*loop->condition);
+            statement(*loop->body);
+            out += ")";
+        } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+            out += "(match ";
+            expression(*match->subject);
+            for (const auto& arm : match->arms) {
+                out += "(case";
+                for (int value : arm.values) out += " " + std::to_string(value);
+                out += " ";
+                statement(*arm.body);
+                out += ")";
+            }
+            if (match->otherwise) {
+                out += "(case _ ";
+                statement(*match->otherwise);
+                out += ")";
+            }
+            out += ")";
+        } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+            out += "(parfor " + parfor->index;
+            for (const auto& name : parfor->reductions) out += " " + name;
+            out += " ";
+            expression(*parfor->start);
+            expression(*parfor->end);
+            statement(*parfor->body);
+            out += ")";
+        } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+            out += "(expr ";
+            expression(*exprStmt->expression);
+            out += ")";
+        } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+            out += "(let " + var->identifier;
+            if (var->initializer) {
+                out += " ";
+                expression(*var->initializer);
+            }
+            out += ")";
+        } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+            out += "(array " + array->identifier + " ";
+            expression(*array->size);
+            out += ")";
+        } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+            out += "(return ";
+            expression(*ret->expression);
+            out += ")";
+        } else {
+            out += "(?)";
+        }
+    }
+
+    void expression(const Exp& exp) {
+        if (auto c = dynamic_cast<const Const*>(&exp)) {
+            out += std::to_string(c->valor);
+        } else if (auto b = dynamic_cast<const BooleanLiteral*>(&exp)) {
+            out += b->value ? "#t" : "#f";
+        } else if (auto v = dynamic_cast<const Variable*>(&exp)) {
+            out += "$" + v->name;
+        } else if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+            binary(operadorToString(bin->op), *bin->opEsq, *bin->opDir);
+        } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+            binary(comparisonOperatorToString(cmp->op), *cmp->left, *cmp->right);
+        } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+            binary(logicalOperatorToString(logical->op), *logical->left, *logical->right);
+        } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+            out += unary->isNot ? "(! " : "(+ ";
+            expression(*unary->operand);
+            out += ")";
+        } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+            out += "(= " + assign->variable + " ";
+            expression(*assign->value);
+            out += ")";
+        } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+            out += "(index " + array(element->name, element->array) + " ";
+            expression(*element->index);
+            out += ")";
+        } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+            out += "(index= " + array(store->name, store->array) + " ";
+            expression(*store->index);
+            out += " ";
+            expression(*store->value);
+            out += ")";
+        } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+            out += "(call " + call->name + " " + resolve(call->name);
+            for (const auto& arg : call->arguments) {
+                out += " ";
+                expression(*arg);
+            }
+            out += ")";
+        } else {
+            out += "?";
+        }
+    }
+
+private:
+    const std::map<std::string, size_t>& externs;
+    const std::map<std::string, const FunctionDeclaration*>& functions;
+
+    void binary(const std::string& op, const Exp& left, const Exp& right) {
+        out += "(" + op + " ";
+        expression(left);
+        out += " ";
+        expression(right);
+        out += ")";
+    }
+
+    // Um vetor global entra com o tamanho, que a checagem de limites e a
+    // vetorizacao usam; o de um vetor local ja esta na propria arvore.
+    static std::string array(const std::string& name, const ArrayDeclaration* decl) {
+        if (decl && decl->binding.storage == StorageClass::GLOBAL) {
+            return "$" + name + "[" + std::to_string(decl->length) + "]";
+        }
+        return "$" + name;
+    }
+
+    // Mesma ordem de resolucao de CodeGenerationVisitor::visit(FunctionCall):
+    // flush embutido, extern (System V, com aridade conferida) ou funcao.
+    std::string resolve(const std::string& name) const {
+        auto ext = externs.find(name);
+        if (ext != externs.end()) return "extern/" + std::to_string(ext->second);
+        if (name == "flush" && !functions.count(name)) return "flush";
+        return "fun";
+    }
+};
+
+uint64_t fnv1a(const std::string& text, uint64_t hash) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void appendHex(std::string& out, uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    for (int shift = 60; shift >= 0; shift -= 4) out += digits[(value >> shift) & 15];
+}
+
+}
+
+FunctionCache::FunctionCache(std::string dir) : dir(std::move(dir)) {
+    ::mkdir(this->dir.c_str(), 0755);
+}
+
+std::string FunctionCache::key(const FunctionDeclaration& fn, const CompilerOptions& options,
+                               const std::map<std::string, size_t>& externs,
+                               const std::map<std::string, const FunctionDeclaration*>& functions,
+                               int probe) const {
+    Normalizer normalizer(externs, functions);
+    std::string& text = normalizer.out;
+    text = std::string(CACHE_VERSION) + " O" + std::to_string(options.optimizationLevel) +
+           (options.abi == CallingConvention::SYSV ? " sysv" : " stack") +
+           (probe >= 0 ? " instr" + std::to_string(probe) : "") + " fun " + fn.name + "(";
+    for (const auto& param : fn.parameters) text += param.name + ",";
+    text += ")";
+    normalizer.statement(*fn.body);
+
+    // Dois FNV-1a de 64 bits com bases diferentes: 128 bits de chave.
+    std::string key;
+    appendHex(key, fnv1a(text, 0xcbf29ce484222325ULL));
+    appendHex(key, fnv1a(text, 0x84222325cbf29ce4ULL));
+    return key;
+}
+
+std::string FunctionCache::path(const std::string& key) const {
+    return dir + "/" + key.substr(0, 2) + "/" + key.substr(2) + ".s";
+}
+
+bool FunctionCache::load(const std::string& key, std::string& text) const {
+    int fd = ::open(path(key).c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    text.clear();
+    char chunk[65536];
+    ssize_t got;
+    while ((got = ::read(fd, chunk, sizeof chunk)) > 0) {
+        text.append(chunk, static_cast<size_t>(got));
+    }
+    ::close(fd);
+    return got == 0;
+}
+
+void FunctionCache::store(const std::string& key, const std::string& text) const {
+    static std::atomic<unsigned> sequence(0);
+    ::mkdir((dir + "/" + key.substr(0, 2)).c_str(), 0755);
+    std::string target = path(key);
+    std::string temp = target + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(sequence++);
+
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+    const char* data = text.data();
+    size_t size = text.size();
+    bool ok = true;
+    while (size > 0 && ok) {
+        ssize_t written = ::write(fd, data, size);
+        ok = written > 0;
+        if (ok) {
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(temp.c_str(), target.c_str()) != 0) {
+        ::unlink(temp.c_str());
+    }
+}
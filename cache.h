@@ -0,0 +1,45 @@
+#pragma once
+#include "ast.h"
+#include "options.h"
+#include <cstddef>
+#include <map>
+#include <string>
+
+// Acertos e falhas do cache de funcoes numa compilacao.
+struct CacheStats {
+    int hits = 0;
+    int misses = 0;
+
+    CacheStats& operator+=(const CacheStats& other) {
+        hits += other.hits;
+        misses += other.misses;
+        return *this;
+    }
+};
+
+// Cache em disco (--cache=dir) do assembly de cada funcao, enderecado pelo
+// conteudo: a chave resume a arvore da funcao sem posicoes, as opcoes que
+// mudam o codigo e como cada nome chamado foi resolvido (funcao do
+// programa, extern e aridade, ou o flush embutido). Cada entrada fica em
+// dir/xx/resto-da-chave.s.
+class FunctionCache {
+public:
+    explicit FunctionCache(std::string dir);
+
+    // externs: nome -> quantidade de parametros; functions: nomes das
+    // funcoes declaradas no programa; probe: registro da funcao na tabela
+    // do --instrument, ou -1.
+    std::string key(const FunctionDeclaration& fn, const CompilerOptions& options,
+                    const std::map<std::string, size_t>& externs,
+                    const std::map<std::string, const FunctionDeclaration*>& functions, int probe = -1) const;
+
+    bool load(const std::string& key, std::string& text) const;
+    // Grava num arquivo temporario e renomeia, para que outra compilacao
+    // lendo o mesmo diretorio nunca veja uma entrada pela metade.
+    void store(const std::string& key, const std::string& text) const;
+
+private:
+    std::string dir;
+
+    std::string path(const std::string& key) const;
+};
@@ -0,0 +1,110 @@
+// Cliente do servidor de compilacao (compilador --server): aceita as mesmas
+// opcoes e o mesmo arquivo que o compilador e grava program.s ou program.o
+// no diretorio atual, sem abrir um processo de compilacao a cada chamada.
+// O socket vem de COMPILADOR_SOCKET (padrao: compilador.sock).
+//
+//   g++ -std=c++17 -O2 -o cliente client/cliente.cpp
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+static bool readFile(const char* path, std::string& text) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    char chunk[65536];
+    ssize_t got;
+    while ((got = ::read(fd, chunk, sizeof chunk)) > 0) text.append(chunk, static_cast<size_t>(got));
+    ::close(fd);
+    return got == 0;
+}
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* input = nullptr;
+    std::vector<std::string> options;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            options.push_back(argv[i]);
+        } else if (!input) {
+            input = argv[i];
+        } else {
+            input = nullptr;
+            break;
+        }
+    }
+    if (!input) {
+        std::fprintf(stderr, "Uso: %s [opcoes do compilador] <arquivo.ci>\n", argv[0]);
+        return 1;
+    }
+
+    std::string source;
+    if (!readFile(input, source)) {
+        std::fprintf(stderr, "Erro: Nao foi possivel abrir o arquivo %s\n", input);
+        return 1;
+    }
+    std::string request = "CI1\n" + std::to_string(options.size()) + "\n";
+    for (const auto& option : options) request += option + "\n";
+    request += std::to_string(source.size()) + "\n";
+    request += source;
+
+    const char* socketPath = std::getenv("COMPILADOR_SOCKET");
+    if (!socketPath) socketPath = "compilador.sock";
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath, sizeof address.sun_path - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0) {
+        std::fprintf(stderr, "Erro: servidor indisponivel em %s\n", socketPath);
+        return 1;
+    }
+    if (!writeAll(fd, request.data(), request.size())) {
+        std::fprintf(stderr, "Erro: falha ao enviar o pedido\n");
+        return 1;
+    }
+    ::shutdown(fd, SHUT_WR);
+
+    std::string response;
+    char chunk[65536];
+    ssize_t got;
+    while ((got = ::read(fd, chunk, sizeof chunk)) > 0) response.append(chunk, static_cast<size_t>(got));
+    ::close(fd);
+
+    size_t newline = response.find('\n');
+    if (got < 0 || newline == std::string::npos || newline < 3 || response[1] != ' ' ||
+        std::strtoull(response.c_str() + 2, nullptr, 10) != response.size() - newline - 1) {
+        std::fprintf(stderr, "Erro: resposta invalida do servidor\n");
+        return 1;
+    }
+    const char* payload = response.data() + newline + 1;
+    size_t size = response.size() - newline - 1;
+
+    if (response[0] == 'e') {
+        std::fprintf(stderr, "%.*s\n", static_cast<int>(size), payload);
+        return 1;
+    }
+    const char* output = response[0] == 'o' ? "program.o" : "program.s";
+    int out = ::open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0 || !writeAll(out, payload, size) || ::close(out) != 0) {
+        std::fprintf(stderr, "Erro: Nao foi possivel criar arquivo %s\n", output);
+        return 1;
+    }
+    std::printf("%s gerado em: %s\n", response[0] == 'o' ? "Objeto" : "Codigo assembly", output);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "compiler.h"
+#include "asmwriter.h"
+#include "elf.h"
+#include "lexer.h"
+#include "parser.h"
+#include "visitor.h"
+#include <sstream>
+#include <stdexcept>
+
+void OutputSink::object(const ObjectCode& object) {
+    std::ostringstream out;
+    writeElfObject(object, out);
+    std::string bytes = out.str();
+    write(bytes);
+}
+
+void FileSink::write(std::string_view bytes) {
+    if (!writeFile(path, bytes.data(), bytes.size())) error = true;
+}
+
+void ObjectSink::write(std::string_view) {
+    throw std::runtime_error("Erro: ObjectSink so recebe objetos; use --emit-obj.");
+}
+
+void emitProgram(const CodeGenerationVisitor& program, const CompilerOptions& options, OutputSink& sink) {
+    if (options.emitObject) {
+        Assembler assembler(options.includeDirs);
+        if (options.runtime) assembler.preload("runtime.s", options.runtime);
+        sink.object(assembler.assemble(program.machineCode()));
+        return;
+    }
+    std::string text;
+    printProgram(program.machineFunctions(), text);
+    sink.write(text);
+}
+
+CompileResult compile(std::string_view source, const CompilerOptions& options, OutputSink& sink) {
+    CompileResult result;
+    try {
+        if (options.jit || options.interpret) {
+            throw std::runtime_error("Erro: compile() gera apenas assembly ou objeto.");
+        }
+        Lexer lexer{std::string(source)};
+        std::vector<Token> tokens = lexer.tokenize();
+        Parser parser(tokens);
+        std::unique_ptr<Program> program = parser.parse();
+
+        CodeGenerationVisitor codeGenVisitor(options);
+        program->accept(codeGenVisitor);
+        emitProgram(codeGenVisitor, options, sink);
+
+        result.decisions = codeGenVisitor.profileDecisions();
+        result.cache = codeGenVisitor.cacheStatistics();
+        result.ok = true;
+    } catch (const std::exception& e) {
+        // std::bad_alloc e afins tambem voltam como diagnostico
+        result.error = e.what();
+    }
+    return result;
+}
+
+CompileResult compile(std::string_view source, const CompilerOptions& options) {
+    MemorySink sink;
+    CompileResult result = compile(source, options, sink);
+    result.output = sink.release();
+    return result;
+}
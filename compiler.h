@@ -0,0 +1,84 @@
+#pragma once
+#include "assembler.h"
+#include "cache.h"
+#include "options.h"
+#include "profile.h"
+#include <string>
+#include <string_view>
+
+class CodeGenerationVisitor;
+
+// Destino da saida de uma compilacao: o texto do assembly ou, com
+// --emit-obj, o objeto montado.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // Bytes da saida: o assembly AT&T ou o objeto ELF64 ja serializado.
+    virtual void write(std::string_view bytes) = 0;
+
+    // Objeto montado, antes de virar ELF. O padrao serializa e chama write.
+    virtual void object(const ObjectCode& object);
+};
+
+// Guarda a saida num buffer em memoria: o proprio ou, para reaproveitar a
+// memoria de uma compilacao na outra, um buffer de quem chama.
+class MemorySink : public OutputSink {
+public:
+    MemorySink() : data(&own) {}
+    explicit MemorySink(std::string& buffer) : data(&buffer) {}
+    MemorySink(const MemorySink&) = delete;
+    MemorySink& operator=(const MemorySink&) = delete;
+
+    void write(std::string_view bytes) override { data->append(bytes.data(), bytes.size()); }
+    const std::string& bytes() const { return *data; }
+    std::string release() { return std::move(*data); }
+
+private:
+    std::string own;
+    std::string* data;
+};
+
+// Grava a saida no arquivo path; failed() informa se a escrita falhou.
+class FileSink : public OutputSink {
+public:
+    explicit FileSink(std::string path) : path(std::move(path)) {}
+    void write(std::string_view bytes) override;
+    bool failed() const { return error; }
+
+private:
+    std::string path;
+    bool error = false;
+};
+
+// Fica com o ObjectCode (secoes, simbolos e relocacoes) para quem vai
+// ligar ou carregar o codigo no proprio processo; assembly em texto e
+// recusado.
+class ObjectSink : public OutputSink {
+public:
+    void write(std::string_view bytes) override;
+    void object(const ObjectCode& object) override { code = object; }
+    const ObjectCode& result() const { return code; }
+
+private:
+    ObjectCode code;
+};
+
+struct CompileResult {
+    bool ok = false;
+    std::string error;       // mensagem de diagnostico quando !ok
+    std::string output;      // so em compile sem sink: a saida inteira
+    ProfileDecisions decisions;
+    CacheStats cache;
+};
+
+// Compila um programa inteiro em memoria, sem arquivos temporarios nem
+// estado global: chamadas em threads diferentes sao independentes. Gera o
+// assembly ou, com options.emitObject, o objeto; --jit e --run nao passam
+// por aqui. Erros de compilacao voltam em CompileResult::error.
+CompileResult compile(std::string_view source, const CompilerOptions& options, OutputSink& sink);
+CompileResult compile(std::string_view source, const CompilerOptions& options);
+
+// Ultima etapa de compile, para quem ja tem o programa gerado: imprime o
+// assembly ou monta o objeto e entrega a sink.
+void emitProgram(const CodeGenerationVisitor& program, const CompilerOptions& options, OutputSink& sink);
@@ -0,0 +1,244 @@
+#include "elf.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t SHT_PROGBITS = 1;
+const uint32_t SHT_SYMTAB = 2;
+const uint32_t SHT_STRTAB = 3;
+const uint32_t SHT_RELA = 4;
+const uint32_t SHT_NOBITS = 8;
+
+const uint64_t SHF_WRITE = 0x1;
+const uint64_t SHF_ALLOC = 0x2;
+const uint64_t SHF_EXECINSTR = 0x4;
+const uint64_t SHF_INFO_LINK = 0x40;
+
+const uint8_t STB_LOCAL = 0;
+const uint8_t STB_GLOBAL = 1;
+const uint8_t STT_NOTYPE = 0;
+const uint8_t STT_SECTION = 3;
+
+class Buffer {
+public:
+    std::vector<uint8_t> bytes;
+
+    void u8(uint8_t v) { bytes.push_back(v); }
+    void u16(uint16_t v) { put(v, 2); }
+    void u32(uint32_t v) { put(v, 4); }
+    void u64(uint64_t v) { put(v, 8); }
+
+    void append(const std::vector<uint8_t>& data) {
+        bytes.insert(bytes.end(), data.begin(), data.end());
+    }
+
+    void align(uint64_t alignment) {
+        while (alignment > 1 && bytes.size() % alignment) bytes.push_back(0);
+    }
+
+private:
+    void put(uint64_t v, int width) {
+        for (int i = 0; i < width; i++) bytes.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+};
+
+class StringTable {
+public:
+    StringTable() { data.push_back(0); }
+
+    uint32_t add(const std::string& text) {
+        if (text.empty()) return 0;
+        uint32_t offset = static_cast<uint32_t>(data.size());
+        data.insert(data.end(), text.begin(), text.end());
+        data.push_back(0);
+        return offset;
+    }
+
+    std::vector<uint8_t> data;
+};
+
+struct SectionHeader {
+    uint32_t name = 0;
+    uint32_t type = 0;
+    uint64_t flags = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t link = 0;
+    uint32_t info = 0;
+    uint64_t align = 1;
+    uint64_t entsize = 0;
+    std::vector<uint8_t> data;
+};
+
+void sectionAttributes(const std::string& name, SectionHeader& header) {
+    if (name == ".text") {
+        header.type = SHT_PROGBITS;
+        header.flags = SHF_ALLOC | SHF_EXECINSTR;
+    } else if (name == ".data") {
+        header.type = SHT_PROGBITS;
+        header.flags = SHF_ALLOC | SHF_WRITE;
+    } else if (name == ".bss") {
+        header.type = SHT_NOBITS;
+        header.flags = SHF_ALLOC | SHF_WRITE;
+    } else if (name == ".rodata") {
+        header.type = SHT_PROGBITS;
+        header.flags = SHF_ALLOC;
+    } else {
+        header.type = SHT_PROGBITS;
+    }
+}
+
+}
+
+// Disposicao: cabecalho ELF, conteudo das secoes e, no fim, a tabela de
+// cabecalhos de secao. Os simbolos locais vem antes dos globais, como o
+// formato exige (sh_info da .symtab aponta o primeiro global).
+void writeElfObject(const ObjectCode& object, std::ostream& out) {
+    StringTable shstrtab;
+    StringTable strtab;
+    std::vector<SectionHeader> headers(1);
+
+    for (const auto& section : object.sections) {
+        SectionHeader header;
+        header.name = shstrtab.add(section.name);
+        sectionAttributes(section.name, header);
+        header.size = section.size;
+        header.align = section.align;
+        header.data = section.data;
+        headers.push_back(header);
+    }
+    auto elfIndex = [](int section) { return static_cast<uint16_t>(section + 1); };
+
+    std::vector<const ObjectSymbol*> ordered;
+    for (const auto& symbol : object.symbols) {
+        if (!symbol.global) ordered.push_back(&symbol);
+    }
+    size_t sectionSymbols = object.sections.size();
+    size_t firstGlobal = 1 + sectionSymbols + ordered.size();
+    for (const auto& symbol : object.symbols) {
+        if (symbol.global) ordered.push_back(&symbol);
+    }
+
+    Buffer symtab;
+    std::map<std::string, uint32_t> symbolIndex;
+    symtab.bytes.resize(24, 0);
+    for (size_t s = 0; s < sectionSymbols; s++) {
+        symtab.u32(0);
+        symtab.u8(STB_LOCAL << 4 | STT_SECTION);
+        symtab.u8(0);
+        symtab.u16(elfIndex(static_cast<int>(s)));
+        symtab.u64(0);
+        symtab.u64(0);
+    }
+    for (size_t i = 0; i < ordered.size(); i++) {
+        const ObjectSymbol& symbol = *ordered[i];
+        symbolIndex[symbol.name] = static_cast<uint32_t>(1 + sectionSymbols + i);
+        symtab.u32(strtab.add(symbol.name));
+        symtab.u8((symbol.global ? STB_GLOBAL : STB_LOCAL) << 4 | STT_NOTYPE);
+        symtab.u8(0);
+        symtab.u16(symbol.section < 0 ? 0 : elfIndex(symbol.section));
+        symtab.u64(symbol.value);
+        symtab.u64(0);
+    }
+
+    size_t symtabIndex = headers.size();
+    for (const auto& section : object.sections) {
+        if (!section.relocations.empty()) symtabIndex++;
+    }
+
+    for (size_t s = 0; s < object.sections.size(); s++) {
+        const auto& relocations = object.sections[s].relocations;
+        if (relocations.empty()) continue;
+        Buffer rela;
+        for (const auto& reloc : relocations) {
+            auto symbol = symbolIndex.find(reloc.symbol);
+            if (symbol == symbolIndex.end()) {
+                throw std::runtime_error("Erro ao gerar objeto: simbolo '" + reloc.symbol + "' ausente");
+            }
+            rela.u64(reloc.offset);
+            rela.u64(static_cast<uint64_t>(symbol->second) << 32 | reloc.type);
+            rela.u64(static_cast<uint64_t>(reloc.addend));
+        }
+        SectionHeader header;
+        header.name = shstrtab.add(".rela" + object.sections[s].name);
+        header.type = SHT_RELA;
+        header.flags = SHF_INFO_LINK;
+        header.size = rela.bytes.size();
+        header.link = static_cast<uint32_t>(symtabIndex);
+        header.info = elfIndex(static_cast<int>(s));
+        header.align = 8;
+        header.entsize = 24;
+        header.data = std::move(rela.bytes);
+        headers.push_back(header);
+    }
+
+    SectionHeader symtabHeader;
+    symtabHeader.name = shstrtab.add(".symtab");
+    symtabHeader.type = SHT_SYMTAB;
+    symtabHeader.size = symtab.bytes.size();
+    symtabHeader.link = static_cast<uint32_t>(symtabIndex + 1);
+    symtabHeader.info = static_cast<uint32_t>(firstGlobal);
+    symtabHeader.align = 8;
+    symtabHeader.entsize = 24;
+    symtabHeader.data = std::move(symtab.bytes);
+    headers.push_back(symtabHeader);
+
+    SectionHeader strtabHeader;
+    strtabHeader.name = shstrtab.add(".strtab");
+    strtabHeader.type = SHT_STRTAB;
+    strtabHeader.size = strtab.data.size();
+    strtabHeader.data = strtab.data;
+    headers.push_back(strtabHeader);
+
+    SectionHeader shstrtabHeader;
+    shstrtabHeader.name = shstrtab.add(".shstrtab");
+    shstrtabHeader.type = SHT_STRTAB;
+    shstrtabHeader.size = shstrtab.data.size();
+    shstrtabHeader.data = shstrtab.data;
+    headers.push_back(shstrtabHeader);
+
+    Buffer file;
+    file.bytes.resize(64, 0);
+    for (size_t i = 1; i < headers.size(); i++) {
+        auto& header = headers[i];
+        file.align(header.align);
+        header.offset = file.bytes.size();
+        if (header.type != SHT_NOBITS) file.append(header.data);
+    }
+    file.align(8);
+    uint64_t sectionHeaders = file.bytes.size();
+    for (const auto& header : headers) {
+        file.u32(header.name);
+        file.u32(header.type);
+        file.u64(header.flags);
+        file.u64(0);
+        file.u64(header.offset);
+        file.u64(header.size);
+        file.u32(header.link);
+        file.u32(header.info);
+        file.u64(header.align);
+        file.u64(header.entsize);
+    }
+
+    Buffer elf;
+    const uint8_t ident[16] = { 0x7f, 'E', 'L', 'F', 2, 1, 1, 0 };
+    elf.bytes.assign(ident, ident + 16);
+    elf.u16(1);    // ET_REL
+    elf.u16(62);   // EM_X86_64
+    elf.u32(1);    // EV_CURRENT
+    elf.u64(0);    // e_entry
+    elf.u64(0);    // e_phoff
+    elf.u64(sectionHeaders);
+    elf.u32(0);    // e_flags
+    elf.u16(64);   // e_ehsize
+    elf.u16(0);    // e_phentsize
+    elf.u16(0);    // e_phnum
+    elf.u16(64);   // e_shentsize
+    elf.u16(static_cast<uint16_t>(headers.size()));
+    elf.u16(static_cast<uint16_t>(headers.size() - 1));
+    std::copy(elf.bytes.begin(), elf.bytes.end(), file.bytes.begin());
+
+    out.write(reinterpret_cast<const char*>(file.bytes.data()), static_cast<std::streamsize>(file.bytes.size()));
+}
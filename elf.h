@@ -0,0 +1,7 @@
+#pragma once
+#include "assembler.h"
+#include <ostream>
+
+// Serializa o resultado do montador como objeto relocavel ELF64 (ET_REL)
+// para x86-64, pronto para o ld.
+void writeElfObject(const ObjectCode& object, std::ostream& out);
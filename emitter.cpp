@@ -0,0 +1,745 @@
+#include "emitter.h"
+#include "profile.h"
+#include <cstdint>
+#include <stdexcept>
+
+static bool fitsInt32(long long v) {
+    return v >= -2147483648LL && v <= 2147483647LL;
+}
+
+static Cond condition(ComparisonOperator op) {
+    switch (op) {
+        case ComparisonOperator::EQUAL: return Cond::E;
+        case ComparisonOperator::NOT_EQUAL: return Cond::NE;
+        case ComparisonOperator::LESS: return Cond::L;
+        case ComparisonOperator::GREATER: return Cond::G;
+        case ComparisonOperator::LESS_EQUAL: return Cond::LE;
+        case ComparisonOperator::GREATER_EQUAL: return Cond::GE;
+    }
+    return Cond::E;
+}
+
+X86Emitter::X86Emitter(const IRFunction& fn, const Allocation& alloc, std::vector<MInstr>& out)
+    : fn(fn), alloc(alloc), out(out) {
+    if (!fn.isEntry) {
+        for (int r = 0; r < NUM_REGS; r++) {
+            if ((alloc.usedRegs & calleeSavedMask()) & regBit(static_cast<Reg>(r))) {
+                savedRegs.push_back(static_cast<Reg>(r));
+            }
+        }
+    }
+    // com --instrument, mais dois slots: o rdtsc da entrada e os ciclos
+    // dos chamadores acumulados ate ela
+    frameSize = 8 * (alloc.slotCount + static_cast<int>(savedRegs.size()) + (fn.probe >= 0 ? 2 : 0));
+    frameSize = (frameSize + 15) & ~15;
+}
+
+static const Reg argumentRegs[] = { Reg::RDI, Reg::RSI, Reg::RDX, Reg::RCX, Reg::R8, Reg::R9 };
+
+int X86Emitter::slotOffset(int slot) const {
+    return -8 * (slot + 1);
+}
+
+int X86Emitter::paramOffset(size_t index) const {
+    return 16 + 8 * static_cast<int>(index - fn.registerParams());
+}
+
+X86Emitter::Value X86Emitter::regValue(Reg r) const {
+    return MOperand::r(r);
+}
+
+X86Emitter::Value X86Emitter::value(const Operand& op) const {
+    switch (op.kind) {
+        case Operand::Kind::IMM:
+            return MOperand::immediate(op.imm);
+        case Operand::Kind::GLOBAL:
+            return MOperand::global(op.name);
+        case Operand::Kind::VREG: {
+            if (alloc.inRegister(op.vreg)) {
+                return regValue(static_cast<Reg>(alloc.reg[op.vreg]));
+            }
+            int offset;
+            if (alloc.slot[op.vreg] >= 0) {
+                offset = slotOffset(alloc.slot[op.vreg]);
+            } else {
+                size_t index = 0;
+                while (index < fn.params.size() && fn.params[index] != op.vreg) index++;
+                offset = paramOffset(index);
+            }
+            return MOperand::mem(Reg::RBP, offset);
+        }
+        case Operand::Kind::NONE:
+            break;
+    }
+    throw std::runtime_error("Operando invalido na geracao de codigo.");
+}
+
+void X86Emitter::instr(MOp op, std::vector<MOperand> operands, int size) {
+    MInstr instr(op, std::move(operands));
+    instr.size = size;
+    out.push_back(std::move(instr));
+}
+
+void X86Emitter::move(const Value& src, const Value& dst) {
+    if (src == dst) return;
+
+    if ((src.isMem() || (src.isImm() && !fitsInt32(src.imm))) && dst.isMem()) {
+        instr(MOp::MOV, {src, regValue(SCRATCH)});
+        instr(MOp::MOV, {regValue(SCRATCH), dst});
+    } else if (src.isImm() && dst.isMem()) {
+        instr(MOp::MOV, {src, dst}, 8);
+    } else {
+        instr(MOp::MOV, {src, dst});
+    }
+}
+
+void X86Emitter::emit() {
+    out.push_back(MInstr::labelled(MOp::LABEL, fn.name));
+    emitPrologue();
+    for (const auto& instr : fn.code) {
+        emitInstr(instr);
+    }
+    emitTables();
+}
+
+void X86Emitter::emitPrologue() {
+    if (!fn.isEntry) {
+        instr(MOp::PUSH, {regValue(Reg::RBP)});
+    }
+    instr(MOp::MOV, {regValue(Reg::RSP), regValue(Reg::RBP)});
+    if (frameSize > 0) {
+        instr(MOp::SUB, {MOperand::immediate(frameSize), regValue(Reg::RSP)});
+    }
+
+    for (size_t i = 0; i < savedRegs.size(); i++) {
+        int offset = slotOffset(alloc.slotCount + static_cast<int>(i));
+        instr(MOp::MOV, {regValue(savedRegs[i]), MOperand::mem(Reg::RBP, offset)});
+    }
+    emitProbeEntry();
+
+    std::vector<std::pair<Value, Value>> incoming;
+    for (size_t i = 0; i < fn.params.size(); i++) {
+        int p = fn.params[i];
+        if (i < fn.registerParams()) {
+            if (alloc.inRegister(p) || alloc.slot[p] >= 0) {
+                incoming.emplace_back(regValue(argumentRegs[i]), value(Operand::reg(p)));
+            }
+        } else if (alloc.inRegister(p)) {
+            incoming.emplace_back(MOperand::mem(Reg::RBP, paramOffset(i)), value(Operand::reg(p)));
+        }
+    }
+    emitParallelMoves(incoming);
+}
+
+// Executa um conjunto de copias como se fossem simultaneas. Copias para a
+// memoria vao primeiro; entre registradores, uma copia so e feita quando
+// seu destino nao e mais lido por outra, e ciclos sao quebrados com r11.
+void X86Emitter::emitParallelMoves(std::vector<std::pair<Value, Value>> moves) {
+    std::vector<std::pair<Value, Value>> pending;
+    for (auto& m : moves) {
+        if (m.first == m.second) continue;
+        if (m.second.isReg()) {
+            pending.push_back(m);
+        } else {
+            move(m.first, m.second);
+        }
+    }
+
+    while (!pending.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < pending.size(); i++) {
+            Reg target = pending[i].second.reg;
+            bool blocked = false;
+            for (size_t j = 0; j < pending.size(); j++) {
+                if (j != i && pending[j].first.is(target)) blocked = true;
+            }
+            if (!blocked) {
+                move(pending[i].first, pending[i].second);
+                pending.erase(pending.begin() + i);
+                progress = true;
+                break;
+            }
+        }
+        if (progress) continue;
+
+        Value saved = pending[0].second;
+        move(saved, regValue(SCRATCH));
+        for (auto& m : pending) {
+            if (m.first.is(saved.reg)) m.first = regValue(SCRATCH);
+        }
+    }
+}
+
+MOperand X86Emitter::probeCounter(int field) const {
+    MOperand counter = MOperand::global(INSTRUMENT_COUNTERS);
+    counter.imm = INSTRUMENT_RECORD * fn.probe + 8 * field;
+    return counter;
+}
+
+// rax = contador de tempo (rdtsc junta as duas metades); destroi rdx.
+void X86Emitter::emitTimestamp() {
+    instr(MOp::RDTSC);
+    instr(MOp::SHL, {MOperand::immediate(32), regValue(Reg::RDX)});
+    instr(MOp::OR, {regValue(Reg::RDX), regValue(Reg::RAX)});
+}
+
+// Conta a entrada, guarda o tempo e zera a soma dos ciclos das chamadas
+// feitas daqui em diante. Vem antes de copiar os parametros, entao rdx
+// (terceiro argumento em System V) passa por r11.
+void X86Emitter::emitProbeEntry() {
+    if (fn.probe < 0) return;
+    int base = alloc.slotCount + static_cast<int>(savedRegs.size());
+    if (fn.isEntry) {
+        instr(MOp::MOV, {MOperand::address(INSTRUMENT_TABLE), regValue(Reg::RAX)});
+        instr(MOp::MOV, {regValue(Reg::RAX), MOperand::global("tabela_instrumentacao")});
+    }
+    instr(MOp::INC, {probeCounter(0)}, 8);
+    instr(MOp::INC, {probeCounter(3)}, 8);
+    instr(MOp::MOV, {regValue(Reg::RDX), regValue(SCRATCH)});
+    emitTimestamp();
+    instr(MOp::MOV, {regValue(Reg::RAX), MOperand::mem(Reg::RBP, slotOffset(base))});
+    instr(MOp::MOV, {MOperand::global(INSTRUMENT_CHILDREN), regValue(Reg::RAX)});
+    instr(MOp::MOV, {regValue(Reg::RAX), MOperand::mem(Reg::RBP, slotOffset(base + 1))});
+    instr(MOp::MOV, {MOperand::immediate(0), MOperand::global(INSTRUMENT_CHILDREN)}, 8);
+    instr(MOp::MOV, {regValue(SCRATCH), regValue(Reg::RDX)});
+}
+
+// Soma a duracao da chamada aos exclusivos, descontando as chamadas que
+// ela fez, e aos inclusivos so quando nao ha outra ativacao da mesma
+// funcao na pilha (recursao nao conta duas vezes). A duracao inteira
+// entra na soma do chamador. keepResult preserva rax.
+void X86Emitter::emitProbeExit(bool keepResult) {
+    if (fn.probe < 0) return;
+    int base = alloc.slotCount + static_cast<int>(savedRegs.size());
+    std::string nested = fn.name + ".Linstr" + std::to_string(probeLabels++);
+    if (keepResult) instr(MOp::MOV, {regValue(Reg::RAX), regValue(SCRATCH)});
+    emitTimestamp();
+    instr(MOp::SUB, {MOperand::mem(Reg::RBP, slotOffset(base)), regValue(Reg::RAX)});
+    instr(MOp::DEC, {probeCounter(3)}, 8);
+    emitJcc(Cond::NE, nested);
+    instr(MOp::ADD, {regValue(Reg::RAX), probeCounter(1)});
+    out.push_back(MInstr::labelled(MOp::LABEL, nested));
+    instr(MOp::MOV, {regValue(Reg::RAX), regValue(Reg::RDX)});
+    instr(MOp::SUB, {MOperand::global(INSTRUMENT_CHILDREN), regValue(Reg::RDX)});
+    instr(MOp::ADD, {regValue(Reg::RDX), probeCounter(2)});
+    instr(MOp::ADD, {MOperand::mem(Reg::RBP, slotOffset(base + 1)), regValue(Reg::RAX)});
+    instr(MOp::MOV, {regValue(Reg::RAX), MOperand::global(INSTRUMENT_CHILDREN)});
+    if (keepResult) instr(MOp::MOV, {regValue(SCRATCH), regValue(Reg::RAX)});
+}
+
+void X86Emitter::emitEpilogue() {
+    for (size_t i = 0; i < savedRegs.size(); i++) {
+        int offset = slotOffset(alloc.slotCount + static_cast<int>(i));
+        instr(MOp::MOV, {MOperand::mem(Reg::RBP, offset), regValue(savedRegs[i])});
+    }
+    instr(MOp::LEAVE);
+    instr(MOp::RET);
+}
+
+void X86Emitter::emitInstr(const IRInstr& instr) {
+    switch (instr.op) {
+        case IROp::MOV:
+            move(value(instr.a), value(instr.dst));
+            break;
+        case IROp::ADD:
+        case IROp::SUB:
+        case IROp::MUL:
+            emitArithmetic(instr);
+            break;
+        case IROp::DIV:
+            emitDivision(instr);
+            break;
+        case IROp::CMP:
+            emitCompare(instr);
+            break;
+        case IROp::NOT:
+            if (instr.a.isImm()) {
+                move(value(Operand::immediate(instr.a.imm == 0)), value(instr.dst));
+                break;
+            }
+            emitTestZero(value(instr.a));
+            emitSetFlag(Cond::E, value(instr.dst));
+            break;
+        case IROp::LABEL:
+            out.push_back(MInstr::labelled(MOp::LABEL, instr.label));
+            break;
+        case IROp::JMP:
+            this->instr(MOp::JMP, {MOperand::label(instr.label)});
+            break;
+        case IROp::JZ:
+        case IROp::JNZ: {
+            Value cond = value(instr.a);
+            if (cond.isImm()) {
+                bool zero = instr.a.imm == 0;
+                if (zero == (instr.op == IROp::JZ)) this->instr(MOp::JMP, {MOperand::label(instr.label)});
+                break;
+            }
+            emitTestZero(cond);
+            emitJcc(instr.op == IROp::JZ ? Cond::E : Cond::NE, instr.label);
+            break;
+        }
+        case IROp::JCC:
+            emitCompareOperands(instr);
+            emitJcc(condition(instr.cond), instr.label);
+            break;
+        case IROp::CALL:
+            emitCall(instr);
+            break;
+        case IROp::PRINT:
+            move(value(instr.a), regValue(Reg::RAX));
+            this->instr(MOp::CALL, {MOperand::label("imprime_num")});
+            break;
+        case IROp::FLUSH:
+            this->instr(MOp::CALL, {MOperand::label("descarrega")});
+            break;
+        case IROp::RET:
+            move(value(instr.a), regValue(Reg::RAX));
+            emitProbeExit(true);
+            emitEpilogue();
+            break;
+        case IROp::EXIT:
+            move(value(instr.a), regValue(Reg::RDI));
+            emitProbeExit(false);
+            this->instr(MOp::CALL, {MOperand::label("sair")});
+            break;
+        case IROp::COUNT: {
+            MOperand counter = MOperand::global(PROFILE_COUNTERS);
+            counter.imm = Profile::HEADER_SIZE + 8 * instr.a.imm;
+            this->instr(MOp::INC, {counter}, 8);
+            break;
+        }
+        case IROp::ALLOCA:
+            emitAlloca(instr);
+            break;
+        case IROp::LOAD:
+            emitLoad(instr);
+            break;
+        case IROp::STORE:
+            emitStore(instr);
+            break;
+        case IROp::CHECK:
+            emitCompareOperands(instr);
+            emitJcc(Cond::AE, "erro_indice");
+            break;
+        case IROp::STACKSAVE:
+            move(regValue(Reg::RSP), value(instr.dst));
+            break;
+        case IROp::STACKRESTORE:
+            move(value(instr.a), regValue(Reg::RSP));
+            break;
+        case IROp::ADDRESS:
+            move(MOperand::address(instr.label), value(instr.dst));
+            break;
+        case IROp::ATOMICADD:
+            emitAtomicAdd(instr);
+            break;
+        case IROp::SWITCH:
+            emitSwitch(instr);
+            break;
+        case IROp::BITTEST:
+            emitBitTest(instr);
+            break;
+        case IROp::VLOAD:
+        case IROp::VSTORE:
+        case IROp::VADD:
+        case IROp::VSUB:
+        case IROp::VCMP:
+        case IROp::VSPLAT:
+        case IROp::VZERO:
+        case IROp::VSUM:
+            emitVector(instr);
+            break;
+    }
+}
+
+static int powerOfTwo(long long v) {
+    if (v <= 0 || (v & (v - 1)) != 0) return -1;
+    return __builtin_ctzll(static_cast<unsigned long long>(v));
+}
+
+// Tenta expressar a operacao como lea: soma de dois registradores, soma ou
+// subtracao de imediato e multiplicacao por 2, 3, 4, 5, 8 ou 9.
+bool X86Emitter::emitLea(const IRInstr& instr, const Value& dst, const Value& a, const Value& b) {
+    if (!dst.isReg() || !a.isReg()) return false;
+
+    MOperand address;
+    address.kind = MOperand::Kind::MEM;
+    if (instr.op == IROp::ADD && b.isReg() && a.reg != dst.reg && b.reg != dst.reg) {
+        address = MOperand::mem(a.reg);
+        address.hasIndex = true;
+        address.index = b.reg;
+    } else if (instr.op == IROp::ADD && b.isImm() && a.reg != dst.reg) {
+        address = MOperand::mem(a.reg, b.imm);
+    } else if (instr.op == IROp::SUB && b.isImm() && a.reg != dst.reg && b.imm != INT32_MIN) {
+        address = MOperand::mem(a.reg, -b.imm);
+    } else if (instr.op == IROp::MUL && b.isImm() && (b.imm == 3 || b.imm == 5 || b.imm == 9)) {
+        address = MOperand::mem(a.reg);
+        address.hasIndex = true;
+        address.index = a.reg;
+        address.scale = static_cast<int>(b.imm - 1);
+    } else if (instr.op == IROp::MUL && b.isImm() && (b.imm == 2 || b.imm == 4 || b.imm == 8) &&
+               a.reg != dst.reg) {
+        address.hasIndex = true;
+        address.index = a.reg;
+        address.scale = static_cast<int>(b.imm);
+    } else {
+        return false;
+    }
+
+    this->instr(MOp::LEA, {address, dst});
+    return true;
+}
+
+void X86Emitter::emitArithmetic(const IRInstr& instr) {
+    Value dst = value(instr.dst);
+    Value a = value(instr.a);
+    Value b = value(instr.b);
+
+    if (emitLea(instr, dst, a, b)) return;
+
+    MOp op;
+    switch (instr.op) {
+        case IROp::ADD: op = MOp::ADD; break;
+        case IROp::SUB: op = MOp::SUB; break;
+        default: op = MOp::IMUL; break;
+    }
+
+    if (instr.op == IROp::MUL && b.isImm() && powerOfTwo(b.imm) >= 0) {
+        int shift = powerOfTwo(b.imm);
+        if (shift == 0) {
+            move(a, dst);
+            return;
+        }
+        op = MOp::SHL;
+        b.imm = shift;
+    }
+
+    if (!dst.isReg()) {
+        Value tmp = regValue(SCRATCH);
+        move(a, tmp);
+        this->instr(op, {b, tmp});
+        move(tmp, dst);
+        return;
+    }
+
+    if (b.isReg() && b.reg == dst.reg && !(a.isReg() && a.reg == dst.reg)) {
+        if (instr.op == IROp::SUB) {
+            this->instr(MOp::NEG, {dst});
+            this->instr(MOp::ADD, {a, dst});
+        } else {
+            this->instr(op, {a, dst});
+        }
+        return;
+    }
+
+    move(a, dst);
+    this->instr(op, {b, dst});
+}
+
+void X86Emitter::emitDivision(const IRInstr& instr) {
+    Value dst = value(instr.dst);
+    Value a = value(instr.a);
+    Value b = value(instr.b);
+
+    if (b.isImm() || b.is(Reg::RAX) || b.is(Reg::RDX)) {
+        move(b, regValue(SCRATCH));
+        b = regValue(SCRATCH);
+    }
+    move(a, regValue(Reg::RAX));
+    this->instr(MOp::CQO);
+    this->instr(MOp::IDIV, {b}, b.isMem() ? 8 : 0);
+    move(regValue(Reg::RAX), dst);
+}
+
+void X86Emitter::emitCompareOperands(const IRInstr& instr) {
+    Value a = value(instr.a);
+    Value b = value(instr.b);
+
+    if (a.isImm() || (a.isMem() && b.isMem())) {
+        move(a, regValue(SCRATCH));
+        a = regValue(SCRATCH);
+    }
+    this->instr(MOp::CMP, {b, a}, b.isImm() && a.isMem() ? 8 : 0);
+}
+
+void X86Emitter::emitCompare(const IRInstr& instr) {
+    emitCompareOperands(instr);
+    emitSetFlag(condition(instr.cond), value(instr.dst));
+}
+
+void X86Emitter::emitTestZero(const Value& v) {
+    if (v.isReg()) {
+        instr(MOp::TEST, {v, v});
+    } else {
+        instr(MOp::CMP, {MOperand::immediate(0), v}, 8);
+    }
+}
+
+void X86Emitter::emitJcc(Cond cond, const std::string& label) {
+    MInstr jump(MOp::JCC, {MOperand::label(label)});
+    jump.cond = cond;
+    out.push_back(std::move(jump));
+}
+
+void X86Emitter::emitSetFlag(Cond cond, const Value& dst) {
+    Reg target = dst.isReg() ? dst.reg : SCRATCH;
+    MInstr set(MOp::SETCC, {MOperand::r(target, 1)});
+    set.cond = cond;
+    out.push_back(std::move(set));
+    instr(MOp::MOVZB, {MOperand::r(target, 1), MOperand::r(target, 4)});
+    if (!dst.isReg()) {
+        move(regValue(SCRATCH), dst);
+    }
+}
+
+// A pilha fica alinhada em 16 bytes em toda chamada: o quadro tem tamanho
+// multiplo de 16 e um numero impar de argumentos na pilha recebe 8 bytes de
+// preenchimento.
+void X86Emitter::emitCall(const IRInstr& instr) {
+    size_t total = instr.args.size();
+    size_t inRegisters = instr.convention == CallingConvention::SYSV ? std::min<size_t>(total, 6) : 0;
+    size_t onStack = total - inRegisters;
+    int padding = onStack % 2 ? 8 : 0;
+
+    if (padding) {
+        this->instr(MOp::SUB, {MOperand::immediate(padding), regValue(Reg::RSP)});
+    }
+    for (size_t i = total; i > inRegisters; i--) {
+        Value arg = value(instr.args[i - 1]);
+        if (arg.isImm() && !fitsInt32(arg.imm)) {
+            move(arg, regValue(SCRATCH));
+            arg = regValue(SCRATCH);
+        }
+        this->instr(MOp::PUSH, {arg}, arg.isMem() ? 8 : 0);
+    }
+
+    std::vector<std::pair<Value, Value>> moves;
+    for (size_t i = 0; i < inRegisters; i++) {
+        moves.emplace_back(value(instr.args[i]), regValue(argumentRegs[i]));
+    }
+    emitParallelMoves(moves);
+    if (instr.convention == CallingConvention::SYSV) {
+        this->instr(MOp::XOR, {MOperand::r(Reg::RAX, 4), MOperand::r(Reg::RAX, 4)});
+    }
+
+    this->instr(MOp::CALL, {MOperand::label(instr.label)});
+    int cleanup = static_cast<int>(onStack * 8) + padding;
+    if (cleanup > 0) {
+        this->instr(MOp::ADD, {MOperand::immediate(cleanup), regValue(Reg::RSP)});
+    }
+    move(regValue(Reg::RAX), value(instr.dst));
+}
+
+// Endereco de base[indice], com elementos de 8 bytes. O que nao cabe no
+// endereco passa por r11: o indice em memoria (ou grande demais para o
+// deslocamento), a base em memoria ou, com os dois em memoria, a soma.
+MOperand X86Emitter::element(const Operand& base, const Operand& index) {
+    Value b = value(base);
+    Value i = value(index);
+    bool constant = i.isImm() && i.imm > -(1LL << 28) && i.imm < (1LL << 28);
+    if (!constant && !i.isReg()) {
+        move(i, regValue(SCRATCH));
+        i = regValue(SCRATCH);
+    }
+
+    MOperand address = b;
+    if (b.isReg()) {
+        address = MOperand::mem(b.reg);
+    } else if (!base.isGlobal()) {
+        if (i.is(SCRATCH)) {
+            instr(MOp::SHL, {MOperand::immediate(3), i});
+            instr(MOp::ADD, {b, i});
+            return MOperand::mem(SCRATCH);
+        }
+        move(b, regValue(SCRATCH));
+        address = MOperand::mem(SCRATCH);
+    }
+    if (constant) {
+        address.imm += 8 * i.imm;
+    } else {
+        address.hasIndex = true;
+        address.index = i.reg;
+        address.scale = 8;
+    }
+    return address;
+}
+
+// Reserva a elementos zerados no topo da pilha, que continua alinhada em
+// 16 bytes; um tamanho calculado fora de 1..MAX_ARRAY_LENGTH vai para
+// erro_tamanho.
+void X86Emitter::emitAlloca(const IRInstr& instr) {
+    move(value(instr.a), regValue(Reg::RCX));
+    if (!instr.a.isImm()) {
+        this->instr(MOp::LEA, {MOperand::mem(Reg::RCX, -1), regValue(Reg::RAX)});
+        this->instr(MOp::CMP, {MOperand::immediate(MAX_ARRAY_LENGTH - 1), regValue(Reg::RAX)});
+        emitJcc(Cond::A, "erro_tamanho");
+    }
+    MOperand bytes;
+    bytes.kind = MOperand::Kind::MEM;
+    bytes.imm = 15;
+    bytes.hasIndex = true;
+    bytes.index = Reg::RCX;
+    bytes.scale = 8;
+    this->instr(MOp::LEA, {bytes, regValue(Reg::RAX)});
+    this->instr(MOp::AND, {MOperand::immediate(-16), regValue(Reg::RAX)});
+    this->instr(MOp::SUB, {regValue(Reg::RAX), regValue(Reg::RSP)});
+    this->instr(MOp::MOV, {regValue(Reg::RSP), regValue(Reg::RDI)});
+    this->instr(MOp::XOR, {MOperand::r(Reg::RAX, 4), MOperand::r(Reg::RAX, 4)});
+    this->instr(MOp::REP_STOSQ);
+    move(regValue(Reg::RSP), value(instr.dst));
+}
+
+void X86Emitter::emitLoad(const IRInstr& instr) {
+    MOperand address = element(instr.a, instr.b);
+    Value dst = value(instr.dst);
+    if (dst.isReg()) {
+        this->instr(MOp::MOV, {address, dst});
+        return;
+    }
+    this->instr(MOp::MOV, {address, regValue(SCRATCH)});
+    move(regValue(SCRATCH), dst);
+}
+
+// Valor em memoria com o endereco ocupando r11: push e pop levam o valor
+// sem outro registrador.
+void X86Emitter::emitStore(const IRInstr& instr) {
+    Value v = value(instr.args[0]);
+    MOperand address = element(instr.a, instr.b);
+    if (v.isReg()) {
+        this->instr(MOp::MOV, {v, address});
+    } else if (v.isImm()) {
+        this->instr(MOp::MOV, {v, address}, 8);
+    } else if ((address.hasBase && address.base == SCRATCH) || (address.hasIndex && address.index == SCRATCH)) {
+        this->instr(MOp::PUSH, {v}, 8);
+        this->instr(MOp::POP, {address}, 8);
+    } else {
+        this->instr(MOp::MOV, {v, regValue(SCRATCH)});
+        this->instr(MOp::MOV, {regValue(SCRATCH), address});
+    }
+}
+
+// lock add com o valor num registrador ou imediato. Em memoria, o valor
+// passa por r11, ou por rax (reservado pelo alocador) quando r11 ja faz
+// parte do endereco; o indice e sempre constante, entao nesse caso a base
+// esta em r11 e rax fica livre.
+void X86Emitter::emitAtomicAdd(const IRInstr& instr) {
+    MOperand address = element(instr.a, instr.b);
+    Value v = value(instr.args[0]);
+    if (v.isMem() || (v.isImm() && !fitsInt32(v.imm))) {
+        bool scratch = (address.hasBase && address.base == SCRATCH) || (address.hasIndex && address.index == SCRATCH);
+        Value temp = regValue(scratch ? Reg::RAX : SCRATCH);
+        move(v, temp);
+        v = temp;
+    }
+    this->instr(MOp::LOCK_ADD, {v, address}, 8);
+}
+
+// O valor menos o primeiro da tabela vai para r11; comparado sem sinal,
+// um so desvio cobre os dois lados de fora dela.
+void X86Emitter::emitSwitch(const IRInstr& instr) {
+    std::string table = fn.name + ".Ltabela" + std::to_string(tables.size());
+    move(value(instr.a), regValue(SCRATCH));
+    if (instr.b.imm != 0) this->instr(MOp::SUB, {MOperand::immediate(instr.b.imm), regValue(SCRATCH)});
+    long long last = static_cast<long long>(instr.targets.size()) - 1;
+    this->instr(MOp::CMP, {MOperand::immediate(last), regValue(SCRATCH)});
+    emitJcc(Cond::A, instr.label);
+    MOperand entry = MOperand::global(table);
+    entry.hasIndex = true;
+    entry.index = SCRATCH;
+    entry.scale = 8;
+    this->instr(MOp::JMP, {entry});
+    tables.emplace_back(table, instr.targets);
+}
+
+void X86Emitter::emitBitTest(const IRInstr& instr) {
+    Value index = value(instr.a);
+    if (!index.isReg()) {
+        move(index, regValue(SCRATCH));
+        index = regValue(SCRATCH);
+    }
+    this->instr(MOp::BT, {index, value(instr.b)});
+    emitJcc(Cond::B, instr.label);
+}
+
+void X86Emitter::emitTables() {
+    if (tables.empty()) return;
+    out.push_back(MInstr::labelled(MOp::SECTION, ".rodata"));
+    out.push_back(MInstr(MOp::ALIGN, {MOperand::immediate(8)}));
+    for (const auto& table : tables) {
+        out.push_back(MInstr::labelled(MOp::LABEL, table.first));
+        MInstr entries(MOp::QUAD);
+        for (const auto& target : table.second) entries.operands.push_back(MOperand::address(target));
+        out.push_back(std::move(entries));
+    }
+    out.push_back(MInstr::labelled(MOp::SECTION, ".text"));
+}
+
+// Operacoes do laco vetorizado. O vetorizador garante que o destino de
+// VSUB e VCMP so coincide com o segundo operando quando tambem coincide
+// com o primeiro.
+void X86Emitter::emitVector(const IRInstr& instr) {
+    auto xmm = [](const Operand& op) { return MOperand::xmm(static_cast<int>(op.imm)); };
+    MOperand scratch = MOperand::xmm(VECTOR_SCRATCH);
+    switch (instr.op) {
+        case IROp::VLOAD:
+            this->instr(MOp::MOVDQU, {element(instr.a, instr.b), xmm(instr.dst)});
+            break;
+        case IROp::VSTORE: {
+            MOperand address = element(instr.a, instr.b);
+            this->instr(MOp::MOVDQU, {xmm(instr.args[0]), address});
+            break;
+        }
+        case IROp::VADD:
+        case IROp::VSUB:
+        case IROp::VCMP: {
+            MOperand dst = xmm(instr.dst);
+            MOperand a = xmm(instr.a);
+            MOperand b = xmm(instr.b);
+            bool commutative = instr.op != IROp::VSUB;
+            if (commutative && dst == b) std::swap(a, b);
+            if (dst != a) this->instr(MOp::MOVDQA, {a, dst});
+            if (instr.op != IROp::VCMP) {
+                this->instr(instr.op == IROp::VADD ? MOp::PADDQ : MOp::PSUBQ, {b, dst});
+                break;
+            }
+            // iguais nas duas metades de 32 bits; depois 0 ou 1 em cada elemento
+            this->instr(MOp::PCMPEQD, {b, dst});
+            this->instr(MOp::PSHUFD, {MOperand::immediate(0xb1), dst, scratch});
+            this->instr(MOp::PAND, {scratch, dst});
+            if (instr.cond == ComparisonOperator::NOT_EQUAL) {
+                this->instr(MOp::PCMPEQD, {scratch, scratch});
+                this->instr(MOp::PXOR, {scratch, dst});
+            }
+            this->instr(MOp::PSRLQ, {MOperand::immediate(63), dst});
+            break;
+        }
+        case IROp::VSPLAT: {
+            MOperand dst = xmm(instr.dst);
+            if (instr.a.isImm() && instr.a.imm == 0) {
+                this->instr(MOp::PXOR, {dst, dst});
+                break;
+            }
+            Value v = value(instr.a);
+            if (!v.isReg()) {
+                move(v, regValue(SCRATCH));
+                v = regValue(SCRATCH);
+            }
+            this->instr(MOp::MOVQ, {v, dst});
+            this->instr(MOp::PUNPCKLQDQ, {dst, dst});
+            break;
+        }
+        case IROp::VZERO:
+            this->instr(MOp::PXOR, {xmm(instr.dst), xmm(instr.dst)});
+            break;
+        case IROp::VSUM: {
+            Value dst = value(instr.dst);
+            this->instr(MOp::PSHUFD, {MOperand::immediate(0x4e), xmm(instr.a), scratch});
+            this->instr(MOp::PADDQ, {xmm(instr.a), scratch});
+            this->instr(MOp::MOVQ, {scratch, dst.isReg() ? dst : regValue(SCRATCH)});
+            if (!dst.isReg()) move(regValue(SCRATCH), dst);
+            break;
+        }
+        default:
+            break;
+    }
+}
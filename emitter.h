@@ -0,0 +1,73 @@
+#pragma once
+#include "ir.h"
+#include "machine.h"
+#include "regalloc.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Simbolos de --instrument. A tabela (.data) guarda a quantidade de
+// funcoes, o endereco dos contadores e o endereco do nome de cada uma; os
+// contadores (.bss) tem um registro de INSTRUMENT_RECORD bytes por funcao:
+// entradas, ciclos inclusivos, ciclos exclusivos e chamadas em andamento.
+// O _start guarda o endereco da tabela em tabela_instrumentacao, que o
+// sair do runtime consulta.
+const char* const INSTRUMENT_TABLE = "__instrumentacao";
+const char* const INSTRUMENT_COUNTERS = "__instr_contadores";
+const char* const INSTRUMENT_CHILDREN = "__instr_filhos";
+const int INSTRUMENT_RECORD = 32;
+
+// Traduz uma IRFunction ja alocada para instrucoes de maquina. Vregs em
+// memoria viram operandos relativos a %rbp; r11 resolve os casos
+// memoria-memoria.
+class X86Emitter {
+public:
+    X86Emitter(const IRFunction& fn, const Allocation& alloc, std::vector<MInstr>& out);
+    void emit();
+
+private:
+    typedef MOperand Value;
+
+    const IRFunction& fn;
+    const Allocation& alloc;
+    std::vector<MInstr>& out;
+    std::vector<Reg> savedRegs;
+    int frameSize = 0;
+    int probeLabels = 0;
+    // Tabelas dos SWITCH, escritas no .rodata depois da funcao.
+    std::vector<std::pair<std::string, std::vector<std::string>>> tables;
+
+    Value value(const Operand& op) const;
+    Value regValue(Reg r) const;
+    int slotOffset(int slot) const;
+    int paramOffset(size_t index) const;
+
+    void instr(MOp op, std::vector<MOperand> operands = {}, int size = 0);
+    void move(const Value& src, const Value& dst);
+    void emitPrologue();
+    void emitEpilogue();
+    MOperand probeCounter(int field) const;
+    void emitTimestamp();
+    void emitProbeEntry();
+    void emitProbeExit(bool keepResult);
+    void emitInstr(const IRInstr& instr);
+    bool emitLea(const IRInstr& instr, const Value& dst, const Value& a, const Value& b);
+    void emitArithmetic(const IRInstr& instr);
+    void emitDivision(const IRInstr& instr);
+    void emitCompareOperands(const IRInstr& instr);
+    void emitCompare(const IRInstr& instr);
+    void emitTestZero(const Value& v);
+    void emitJcc(Cond cond, const std::string& label);
+    void emitSetFlag(Cond cond, const Value& dst);
+    void emitCall(const IRInstr& instr);
+    MOperand element(const Operand& base, const Operand& index);
+    void emitAlloca(const IRInstr& instr);
+    void emitLoad(const IRInstr& instr);
+    void emitStore(const IRInstr& instr);
+    void emitAtomicAdd(const IRInstr& instr);
+    void emitSwitch(const IRInstr& instr);
+    void emitBitTest(const IRInstr& instr);
+    void emitTables();
+    void emitVector(const IRInstr& instr);
+    void emitParallelMoves(std::vector<std::pair<Value, Value>> moves);
+};
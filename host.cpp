@@ -0,0 +1,29 @@
+#include "host.h"
+#include <unistd.h>
+
+static void writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(1, data, size);
+        if (written <= 0) return;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void StdoutHost::print(long long value) {
+    buffer += std::to_string(value);
+    buffer += '\n';
+    if (buffer.size() >= 65536) {
+        writeAll(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void StdoutHost::flush() {
+    writeAll(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+void StdoutHost::exit(long long) {
+    flush();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+// Destino das chamadas que o programa faz ao runtime quando ele roda dentro
+// do proprio compilador (--jit e --run). flush atende o builtin flush().
+class RuntimeHost {
+public:
+    virtual ~RuntimeHost() = default;
+    virtual void print(long long value) = 0;
+    virtual void flush() = 0;
+    virtual void exit(long long value) = 0;
+};
+
+// Escreve os numeros em stdout com um unico buffer, descarregado no sair.
+class StdoutHost : public RuntimeHost {
+public:
+    void print(long long value) override;
+    void flush() override;
+    void exit(long long value) override;
+
+private:
+    std::string buffer;
+};
@@ -0,0 +1,28 @@
+#include "ir.h"
+
+static void addUse(const Operand& op, std::vector<int>& uses) {
+    if (op.isVReg()) {
+        uses.push_back(op.vreg);
+    }
+}
+
+void collectUses(const IRInstr& instr, std::vector<int>& uses) {
+    addUse(instr.a, uses);
+    addUse(instr.b, uses);
+    for (const auto& arg : instr.args) {
+        addUse(arg, uses);
+    }
+}
+
+int definedVReg(const IRInstr& instr) {
+    return instr.dst.isVReg() ? instr.dst.vreg : -1;
+}
+
+bool isBranch(const IRInstr& instr) {
+    return instr.op == IROp::JMP || instr.op == IROp::JZ || instr.op == IROp::JNZ ||
+           instr.op == IROp::JCC || instr.op == IROp::SWITCH || instr.op == IROp::BITTEST;
+}
+
+bool isTerminator(const IRInstr& instr) {
+    return instr.op == IROp::JMP || instr.op == IROp::RET || instr.op == IROp::EXIT || instr.op == IROp::SWITCH;
+}
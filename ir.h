@@ -0,0 +1,133 @@
+#pragma once
+#include "ast.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Convencao de chamada: STACK e a original do compilador (argumentos na
+// pilha, lidos a partir de 16(%rbp)); SYSV passa os seis primeiros em
+// rdi, rsi, rdx, rcx, r8 e r9, como o System V AMD64.
+enum class CallingConvention { STACK, SYSV };
+
+// Representacao intermediaria de tres enderecos usada entre a arvore e o
+// assembly. Locais, parametros e temporarios sao registradores virtuais
+// (vregs); globais continuam sendo acessados pela memoria.
+enum class IROp {
+    MOV,    // dst = a
+    ADD,    // dst = a + b
+    SUB,    // dst = a - b
+    MUL,    // dst = a * b
+    DIV,    // dst = a / b
+    CMP,    // dst = (a cond b)
+    NOT,    // dst = (a == 0)
+    LABEL,
+    JMP,
+    JZ,     // se a == 0 desvia para label
+    JNZ,    // se a != 0 desvia para label
+    JCC,    // se (a cond b) desvia para label
+    CALL,   // dst = label(args...)
+    PRINT,  // imprime_num(a)
+    FLUSH,  // descarrega a saida pendente (builtin flush())
+    RET,    // retorna a
+    EXIT,   // sair(a); o valor chega ao driver no modo --jit
+    COUNT,  // contador a do perfil += 1 (--profile-generate)
+
+    // Vetores. O endereco base e um vreg (vetor local, na pilha) ou uma
+    // GLOBAL (vetor no .bss); os elementos tem 8 bytes.
+    ALLOCA,        // dst = a elementos zerados reservados na pilha
+    LOAD,          // dst = base a [indice b]
+    STORE,         // base a [indice b] = args[0]
+    CHECK,         // erro_indice se o indice a nao estiver em 0..b-1
+    STACKSAVE,     // dst = %rsp
+    STACKRESTORE,  // %rsp = a, desfaz os ALLOCA feitos desde o STACKSAVE
+
+    // parfor (parfor.cpp): o corpo vira uma funcao chamada pelo runtime.
+    ADDRESS,    // dst = endereco do rotulo label
+    ATOMICADD,  // base a [indice b] += args[0], de uma vez so entre threads
+
+    // match (switch.cpp). Os dois so saem no codigo de maquina; o --run
+    // recebe o match como comparacoes.
+    SWITCH,   // desvia para targets[a - b], ou para label se a estiver fora da tabela
+    BITTEST,  // se o bit a (0..63) do vreg b estiver ligado desvia para label
+
+    // Laco vetorizado (vectorizer.cpp): operandos IMM com o numero de um
+    // registrador xmm, dois elementos por registrador. Os xmm nao passam
+    // pelo alocador; o emissor usa o xmm15 como rascunho.
+    VLOAD,    // xmm dst = base a [indice b], dois elementos
+    VSTORE,   // base a [indice b] = xmm args[0]
+    VADD,     // xmm dst = xmm a + xmm b
+    VSUB,     // xmm dst = xmm a - xmm b
+    VCMP,     // xmm dst = (xmm a cond xmm b) em cada elemento; so == e !=
+    VSPLAT,   // xmm dst = a nos dois elementos
+    VZERO,    // xmm dst = 0
+    VSUM      // dst = soma dos dois elementos do xmm a
+};
+
+struct Operand {
+    enum class Kind { NONE, VREG, IMM, GLOBAL };
+
+    Kind kind = Kind::NONE;
+    int vreg = -1;
+    long long imm = 0;
+    std::string name;
+
+    static Operand reg(int v) {
+        Operand op;
+        op.kind = Kind::VREG;
+        op.vreg = v;
+        return op;
+    }
+
+    static Operand immediate(long long value) {
+        Operand op;
+        op.kind = Kind::IMM;
+        op.imm = value;
+        return op;
+    }
+
+    static Operand global(std::string symbol) {
+        Operand op;
+        op.kind = Kind::GLOBAL;
+        op.name = std::move(symbol);
+        return op;
+    }
+
+    bool isVReg() const { return kind == Kind::VREG; }
+    bool isImm() const { return kind == Kind::IMM; }
+    bool isGlobal() const { return kind == Kind::GLOBAL; }
+};
+
+struct IRInstr {
+    IROp op;
+    Operand dst;
+    Operand a;
+    Operand b;
+    ComparisonOperator cond = ComparisonOperator::EQUAL;
+    CallingConvention convention = CallingConvention::STACK;
+    std::string label;
+    std::vector<Operand> args;
+    std::vector<std::string> targets;  // SWITCH: um rotulo por valor a partir de b
+};
+
+struct IRFunction {
+    std::string name;
+    bool isEntry = false;
+    CallingConvention convention = CallingConvention::STACK;
+    std::vector<int> params;
+    std::vector<IRInstr> code;
+    int vregCount = 0;
+    int probe = -1;  // --instrument: registro da funcao na tabela, ou -1
+
+    int newVReg() { return vregCount++; }
+    void emit(IRInstr instr) { code.push_back(std::move(instr)); }
+
+    // Parametros que chegam em registradores; os demais ficam na pilha.
+    size_t registerParams() const {
+        return convention == CallingConvention::SYSV ? std::min<size_t>(params.size(), 6) : 0;
+    }
+};
+
+void collectUses(const IRInstr& instr, std::vector<int>& uses);
+int definedVReg(const IRInstr& instr);
+bool isBranch(const IRInstr& instr);
+bool isTerminator(const IRInstr& instr);
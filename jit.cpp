@@ -0,0 +1,244 @@
+#include "jit.h"
+#include <cstdint>
+#include <cstring>
+#include <dlfcn.h>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+void hostPrint(RuntimeHost* host, long long value) {
+    host->print(value);
+}
+
+void hostFlush(RuntimeHost* host, long long) {
+    host->flush();
+}
+
+void hostExit(RuntimeHost* host, long long value) {
+    host->exit(value);
+}
+
+MOperand pointer(const void* address) {
+    return MOperand::immediate(static_cast<long long>(reinterpret_cast<intptr_t>(address)));
+}
+
+MOperand function(void (*address)(RuntimeHost*, long long)) {
+    return MOperand::immediate(static_cast<long long>(reinterpret_cast<intptr_t>(address)));
+}
+
+const Reg preserved[] = { Reg::RBP, Reg::RBX, Reg::R12, Reg::R13, Reg::R14, Reg::R15 };
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+}
+
+JitProgram::JitProgram(const std::vector<MInstr>& code, RuntimeHost& host) : host(host) {
+    Assembler assembler;
+    ObjectCode object = assembler.assemble(runtimeStubs(code));
+    try {
+        load(object);
+    } catch (...) {
+        if (memory) munmap(memory, memorySize);
+        throw;
+    }
+}
+
+JitProgram::~JitProgram() {
+    if (memory) munmap(memory, memorySize);
+}
+
+long long JitProgram::run() {
+    failure = 0;
+    long long value = entry();
+    if (failure == 1) throw std::runtime_error("Erro em tempo de execucao: indice fora dos limites do vetor.");
+    if (failure == 2) throw std::runtime_error("Erro em tempo de execucao: tamanho de vetor invalido.");
+    return value;
+}
+
+// jit_enter salva os registradores preservados e o %rsp do chamador e
+// salta para _start; sair restaura esse %rsp e retorna de jit_enter com o
+// valor de main em %rax. Os stubs alinham a pilha antes de chamar o host.
+std::vector<MInstr> JitProgram::runtimeStubs(const std::vector<MInstr>& code) {
+    std::vector<MInstr> program;
+    std::set<std::string> defined;
+    std::set<std::string> called;
+    for (const auto& instr : code) {
+        if (instr.op == MOp::INCLUDE && instr.name == "runtime.s") continue;
+        if (instr.op == MOp::LABEL || instr.op == MOp::LCOMM) defined.insert(instr.name);
+        if ((instr.op == MOp::CALL || instr.op == MOp::JMP) &&
+            instr.operands[0].kind == MOperand::Kind::SYMBOL) {
+            called.insert(instr.operands[0].symbol);
+        }
+        program.push_back(instr);
+    }
+
+    auto emit = [&](MOp op, std::vector<MOperand> operands = {}) {
+        program.push_back(MInstr(op, std::move(operands)));
+    };
+    auto label = [&](const std::string& name) {
+        program.push_back(MInstr::labelled(MOp::LABEL, name));
+        defined.insert(name);
+    };
+    MOperand rsp = MOperand::r(Reg::RSP);
+    MOperand r11 = MOperand::r(SCRATCH);
+    MOperand savedRsp = MOperand::address("jit_saved_rsp");
+
+    program.push_back(MInstr::labelled(MOp::SECTION, ".text"));
+    label("jit_enter");
+    for (Reg r : preserved) emit(MOp::PUSH, {MOperand::r(r)});
+    emit(MOp::MOV, {savedRsp, r11});
+    emit(MOp::MOV, {rsp, MOperand::mem(SCRATCH)});
+    emit(MOp::AND, {MOperand::immediate(-16), rsp});
+    emit(MOp::JMP, {MOperand::label("_start")});
+
+    label("imprime_num");
+    emit(MOp::PUSH, {MOperand::r(Reg::RBP)});
+    emit(MOp::MOV, {rsp, MOperand::r(Reg::RBP)});
+    emit(MOp::AND, {MOperand::immediate(-16), rsp});
+    emit(MOp::MOV, {MOperand::r(Reg::RAX), MOperand::r(Reg::RSI)});
+    emit(MOp::MOV, {pointer(&host), MOperand::r(Reg::RDI)});
+    emit(MOp::MOV, {function(hostPrint), r11});
+    emit(MOp::CALL, {r11});
+    emit(MOp::LEAVE);
+    emit(MOp::RET);
+
+    label("descarrega");
+    emit(MOp::PUSH, {MOperand::r(Reg::RBP)});
+    emit(MOp::MOV, {rsp, MOperand::r(Reg::RBP)});
+    emit(MOp::AND, {MOperand::immediate(-16), rsp});
+    emit(MOp::MOV, {pointer(&host), MOperand::r(Reg::RDI)});
+    emit(MOp::MOV, {function(hostFlush), r11});
+    emit(MOp::CALL, {r11});
+    emit(MOp::XOR, {MOperand::r(Reg::RAX), MOperand::r(Reg::RAX)});
+    emit(MOp::LEAVE);
+    emit(MOp::RET);
+
+    auto leave = [&]() {
+        emit(MOp::MOV, {savedRsp, r11});
+        emit(MOp::MOV, {MOperand::mem(SCRATCH), rsp});
+        for (int i = static_cast<int>(sizeof(preserved) / sizeof(preserved[0])) - 1; i >= 0; i--) {
+            emit(MOp::POP, {MOperand::r(preserved[i])});
+        }
+        emit(MOp::RET);
+    };
+
+    label("sair");
+    emit(MOp::MOV, {MOperand::r(Reg::RDI), MOperand::r(Reg::RBX)});
+    emit(MOp::AND, {MOperand::immediate(-16), rsp});
+    emit(MOp::MOV, {MOperand::r(Reg::RDI), MOperand::r(Reg::RSI)});
+    emit(MOp::MOV, {pointer(&host), MOperand::r(Reg::RDI)});
+    emit(MOp::MOV, {function(hostExit), r11});
+    emit(MOp::CALL, {r11});
+    emit(MOp::MOV, {MOperand::r(Reg::RBX), MOperand::r(Reg::RAX)});
+    leave();
+
+    // o tipo do erro vai para failure; a saida ja impressa e entregue
+    label("erro_indice");
+    emit(MOp::MOV, {MOperand::immediate(1), MOperand::r(Reg::RAX)});
+    emit(MOp::JMP, {MOperand::label("jit_erro")});
+    label("erro_tamanho");
+    emit(MOp::MOV, {MOperand::immediate(2), MOperand::r(Reg::RAX)});
+    label("jit_erro");
+    emit(MOp::MOV, {pointer(&failure), r11});
+    emit(MOp::MOV, {MOperand::r(Reg::RAX), MOperand::mem(SCRATCH)});
+    emit(MOp::AND, {MOperand::immediate(-16), rsp});
+    emit(MOp::MOV, {pointer(&host), MOperand::r(Reg::RDI)});
+    emit(MOp::MOV, {function(hostFlush), r11});
+    emit(MOp::CALL, {r11});
+    leave();
+
+    // parfor roda numa thread so: o corpo recebe o intervalo inteiro
+    label("paralelo");
+    emit(MOp::MOV, {MOperand::r(Reg::RDI), r11});
+    emit(MOp::MOV, {MOperand::r(Reg::RSI), MOperand::r(Reg::RDI)});
+    emit(MOp::MOV, {MOperand::r(Reg::RDX), MOperand::r(Reg::RSI)});
+    emit(MOp::MOV, {MOperand::r(Reg::RCX), MOperand::r(Reg::RDX)});
+    emit(MOp::JMP, {r11});
+
+    for (const auto& name : called) {
+        if (defined.count(name)) continue;
+        void* address = dlsym(RTLD_DEFAULT, name.c_str());
+        if (!address) {
+            throw std::runtime_error("Erro: funcao externa '" + name + "' nao encontrada para --jit.");
+        }
+        label(name);
+        emit(MOp::MOV, {pointer(address), r11});
+        emit(MOp::JMP, {r11});
+    }
+
+    program.push_back(MInstr::labelled(MOp::SECTION, ".bss"));
+    MInstr saved = MInstr::labelled(MOp::LCOMM, "jit_saved_rsp");
+    saved.operands.push_back(MOperand::immediate(8));
+    program.push_back(saved);
+    return program;
+}
+
+// A .text fica sozinha nas primeiras paginas (depois protegidas como
+// leitura e execucao) e as demais secoes vem em seguida. MAP_32BIT mantem
+// tudo abaixo de 2 GiB, onde as relocacoes R_X86_64_32S alcancam.
+void JitProgram::load(const ObjectCode& object) {
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    std::vector<uint64_t> base(object.sections.size(), 0);
+    uint64_t textSize = 0;
+    uint64_t size = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t s = 0; s < object.sections.size(); s++) {
+            bool text = object.sections[s].name == ".text";
+            if (text != (pass == 0)) continue;
+            size = alignUp(size, object.sections[s].align);
+            base[s] = size;
+            size += object.sections[s].size;
+        }
+        if (pass == 0) size = textSize = alignUp(size, page);
+    }
+    memorySize = alignUp(std::max<uint64_t>(size, page), page);
+
+    void* mapped = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Erro: nao foi possivel reservar memoria para o JIT.");
+    }
+    memory = mapped;
+    uint8_t* start = static_cast<uint8_t*>(memory);
+
+    std::map<std::string, uint64_t> addresses;
+    for (const auto& symbol : object.symbols) {
+        if (symbol.section < 0) {
+            throw std::runtime_error("Erro: simbolo '" + symbol.name + "' indefinido no JIT.");
+        }
+        addresses[symbol.name] = reinterpret_cast<uint64_t>(start) + base[symbol.section] + symbol.value;
+    }
+
+    for (size_t s = 0; s < object.sections.size(); s++) {
+        const auto& section = object.sections[s];
+        if (!section.data.empty()) {
+            std::memcpy(start + base[s], section.data.data(), section.data.size());
+        }
+        for (const auto& reloc : section.relocations) {
+            uint8_t* place = start + base[s] + reloc.offset;
+            int64_t target = static_cast<int64_t>(addresses.at(reloc.symbol)) + reloc.addend;
+            if (reloc.type == R_X86_64_64) {
+                std::memcpy(place, &target, 8);
+                continue;
+            }
+            if (reloc.type == R_X86_64_PC32 || reloc.type == R_X86_64_PLT32) {
+                target -= static_cast<int64_t>(reinterpret_cast<uint64_t>(place));
+            }
+            if (target < INT32_MIN || target > INT32_MAX) {
+                throw std::runtime_error("Erro: relocacao fora de alcance para '" + reloc.symbol + "' no JIT.");
+            }
+            int32_t value = static_cast<int32_t>(target);
+            std::memcpy(place, &value, 4);
+        }
+    }
+
+    if (textSize > 0 && mprotect(memory, textSize, PROT_READ | PROT_EXEC) != 0) {
+        throw std::runtime_error("Erro: nao foi possivel tornar o codigo do JIT executavel.");
+    }
+    entry = reinterpret_cast<long long (*)()>(addresses.at("jit_enter"));
+}
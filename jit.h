@@ -0,0 +1,32 @@
+#pragma once
+#include "assembler.h"
+#include "host.h"
+#include "machine.h"
+#include <vector>
+
+// Monta o programa em memoria executavel e o roda no processo atual. O
+// runtime.s e trocado por stubs que chamam o RuntimeHost: imprime_num vira
+// RuntimeHost::print, descarrega vira RuntimeHost::flush e sair devolve o
+// controle (e o valor de retorno de main) para quem chamou run(). Os erros
+// de vetor (erro_indice, erro_tamanho) descarregam a saida e fazem run()
+// lancar runtime_error. Funcoes 'extern' sao resolvidas com dlsym.
+class JitProgram {
+public:
+    JitProgram(const std::vector<MInstr>& code, RuntimeHost& host);
+    ~JitProgram();
+
+    JitProgram(const JitProgram&) = delete;
+    JitProgram& operator=(const JitProgram&) = delete;
+
+    long long run();
+
+private:
+    RuntimeHost& host;
+    void* memory = nullptr;
+    size_t memorySize = 0;
+    long long (*entry)() = nullptr;
+    long long failure = 0;  // gravado pelos stubs de erro: 1 indice, 2 tamanho
+
+    std::vector<MInstr> runtimeStubs(const std::vector<MInstr>& code);
+    void load(const ObjectCode& object);
+};
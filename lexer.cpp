@@ -18,6 +18,8 @@ std::string token_type_to_string(TokenType type) {
         case TokenType::MAIN: return "Main";
         case TokenType::LBRACE: return "ChaveEsq";
         case TokenType::RBRACE: return "ChaveDir";
+        case TokenType::LBRACKET: return "ColcheteEsq";
+        case TokenType::RBRACKET: return "ColcheteDir";
         case TokenType::EQUAL: return "Igual";
         case TokenType::NOT_EQUAL: return "Diferente";
         case TokenType::LESS: return "Menor";
@@ -30,11 +32,16 @@ std::string token_type_to_string(TokenType type) {
         case TokenType::IF: return "Se";
         case TokenType::ELSE: return "Senao";
         case TokenType::WHILE: return "Enquanto";
+        case TokenType::PARFOR: return "ParaParalelo";
+        case TokenType::REDUCE: return "Reduz";
+        case TokenType::MATCH: return "Escolha";
         case TokenType::RETURN: return "Retorna";
         case TokenType::TRUE: return "Verdadeiro";
         case TokenType::FALSE: return "Falso";
         case TokenType::FUN: return "Fun";
+        case TokenType::EXTERN: return "Extern";
         case TokenType::COMMA: return "Virgula";
+        case TokenType::ARROW: return "Seta";
         case TokenType::END_OF_FILE: return "EOF";
         case TokenType::ILLEGAL: return "ErroLexico";
     }
@@ -51,6 +58,7 @@ Lexer::Lexer(std::string source)
 }
 
 void Lexer::advance() {
+    if (current_char == '\n') line++;
     position++;
     if (position < source.length()) {
         current_char = source[position];
@@ -66,7 +74,7 @@ void Lexer::skip_whitespace() {
 }
 
 Token Lexer::make_token(TokenType type, std::string lexeme) {
-    return Token{type, lexeme, position};
+    return Token{type, lexeme, position, line};
 }
 
 Token Lexer::number() {
@@ -75,7 +83,7 @@ Token Lexer::number() {
         advance();
     }
     std::string lexeme = source.substr(start_pos, position - start_pos);
-    return Token{TokenType::NUMBER, lexeme, start_pos};
+    return Token{TokenType::NUMBER, lexeme, start_pos, line};
 }
 
 Token Lexer::identifier() {
@@ -92,12 +100,20 @@ Token Lexer::identifier() {
         type = TokenType::MAIN;
     } else if (lexeme == "fun") {
         type = TokenType::FUN;
+    } else if (lexeme == "extern") {
+        type = TokenType::EXTERN;
     } else if (lexeme == "if") {
         type = TokenType::IF;
     } else if (lexeme == "else") {
         type = TokenType::ELSE;
     } else if (lexeme == "while") {
         type = TokenType::WHILE;
+    } else if (lexeme == "parfor") {
+        type = TokenType::PARFOR;
+    } else if (lexeme == "reduce") {
+        type = TokenType::REDUCE;
+    } else if (lexeme == "match") {
+        type = TokenType::MATCH;
     } else if (lexeme == "return") {
         type = TokenType::RETURN;
     } else if (lexeme == "true") {
@@ -106,7 +122,7 @@ Token Lexer::identifier() {
         type = TokenType::FALSE;
     }
     
-    return Token{type, lexeme, start_pos};
+    return Token{type, lexeme, start_pos, line};
 }
 
 std::vector<Token> Lexer::tokenize() {
@@ -143,12 +159,18 @@ std::vector<Token> Lexer::tokenize() {
             case ',': type = TokenType::COMMA; lexeme = ","; break;
             case '{': type = TokenType::LBRACE; lexeme = "{"; break;
             case '}': type = TokenType::RBRACE; lexeme = "}"; break;
+            case '[': type = TokenType::LBRACKET; lexeme = "["; break;
+            case ']': type = TokenType::RBRACKET; lexeme = "]"; break;
             
             case '=':
                 if (position + 1 < source.length() && source[position + 1] == '=') {
                     type = TokenType::EQUAL;
                     lexeme = "==";
                     advance();
+                } else if (position + 1 < source.length() && source[position + 1] == '>') {
+                    type = TokenType::ARROW;
+                    lexeme = "=>";
+                    advance();
                 } else {
                     type = TokenType::ASSIGN;
                     lexeme = "=";
@@ -211,7 +233,7 @@ std::vector<Token> Lexer::tokenize() {
                 break;
         }
 
-        tokens.push_back(Token{type, lexeme, start_pos});
+        tokens.push_back(Token{type, lexeme, start_pos, line});
         
         if (type == TokenType::ILLEGAL) {
             throw std::runtime_error("Erro lexico: caractere ilegal '" + lexeme + "' na posicao " + std::to_string(start_pos));
@@ -220,6 +242,6 @@ std::vector<Token> Lexer::tokenize() {
         advance();
     }
 
-    tokens.push_back(Token{TokenType::END_OF_FILE, "", position});
+    tokens.push_back(Token{TokenType::END_OF_FILE, "", position, line});
     return tokens;
 }
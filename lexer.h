@@ -11,6 +11,7 @@ public:
 private:
     std::string source;
     size_t position = 0;
+    size_t line = 1;
     char current_char = '\0';
 
     void advance();
@@ -0,0 +1,667 @@
+#include "machine.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <map>
+#include <stdexcept>
+
+bool MOperand::operator==(const MOperand& other) const {
+    if (kind != other.kind) return false;
+    switch (kind) {
+        case Kind::NONE:
+            return true;
+        case Kind::REG:
+            return reg == other.reg && size == other.size;
+        case Kind::IMM:
+            return imm == other.imm && symbol == other.symbol;
+        case Kind::MEM:
+            return imm == other.imm && symbol == other.symbol && hasBase == other.hasBase &&
+                   (!hasBase || base == other.base) && hasIndex == other.hasIndex &&
+                   (!hasIndex || (index == other.index && scale == other.scale));
+        case Kind::SYMBOL:
+            return symbol == other.symbol;
+    }
+    return false;
+}
+
+int MInstr::operandSize() const {
+    if (size) return size;
+    if (op == MOp::SETCC) return 1;
+    if (!operands.empty() && operands.back().isReg()) return operands.back().size;
+    for (const auto& operand : operands) {
+        if (operand.isReg()) return operand.size;
+    }
+    return 8;
+}
+
+static const char* condNames[] = {
+    "o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+
+const char* condName(Cond cond) {
+    return condNames[static_cast<int>(cond)];
+}
+
+static const char* mnemonic(MOp op) {
+    switch (op) {
+        case MOp::MOV: return "mov";
+        case MOp::MOVZB: return "movzb";
+        case MOp::LEA: return "lea";
+        case MOp::ADD: return "add";
+        case MOp::SUB: return "sub";
+        case MOp::IMUL: return "imul";
+        case MOp::MUL: return "mul";
+        case MOp::IDIV: return "idiv";
+        case MOp::DIV: return "div";
+        case MOp::NEG: return "neg";
+        case MOp::INC: return "inc";
+        case MOp::DEC: return "dec";
+        case MOp::AND: return "and";
+        case MOp::OR: return "or";
+        case MOp::XOR: return "xor";
+        case MOp::CMP: return "cmp";
+        case MOp::TEST: return "test";
+        case MOp::SHL: return "shl";
+        case MOp::SHR: return "shr";
+        case MOp::SAR: return "sar";
+        case MOp::BSR: return "bsr";
+        case MOp::BT: return "bt";
+        case MOp::CQO: return "cqo";
+        case MOp::PUSH: return "push";
+        case MOp::POP: return "pop";
+        case MOp::CALL: return "call";
+        case MOp::RET: return "ret";
+        case MOp::LEAVE: return "leave";
+        case MOp::JMP: return "jmp";
+        case MOp::SYSCALL: return "syscall";
+        case MOp::RDTSC: return "rdtsc";
+        case MOp::REP_STOSQ: return "rep stosq";
+        case MOp::XCHG: return "xchg";
+        case MOp::PAUSE: return "pause";
+        case MOp::LOCK_ADD: return "lock add";
+        case MOp::MOVDQU: return "movdqu";
+        case MOp::MOVDQA: return "movdqa";
+        case MOp::MOVQ: return "movq";
+        case MOp::PUNPCKLQDQ: return "punpcklqdq";
+        case MOp::PADDQ: return "paddq";
+        case MOp::PSUBQ: return "psubq";
+        case MOp::PCMPEQD: return "pcmpeqd";
+        case MOp::PSHUFD: return "pshufd";
+        case MOp::PAND: return "pand";
+        case MOp::PXOR: return "pxor";
+        case MOp::PSRLQ: return "psrlq";
+        default: return "";
+    }
+}
+
+static char sizeSuffix(int size) {
+    return size == 1 ? 'b' : size == 4 ? 'l' : 'q';
+}
+
+static const char* regText(Reg reg, int size) {
+    if (size == MOperand::XMM_SIZE) return xmmName(static_cast<int>(reg));
+    return size == 1 ? regName8(reg) : size == 4 ? regName32(reg) : regName(reg);
+}
+
+static void appendNumber(std::string& out, long long value) {
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
+
+static void appendSymbolOffset(std::string& out, const std::string& symbol, long long offset) {
+    if (symbol.empty()) {
+        appendNumber(out, offset);
+        return;
+    }
+    out += symbol;
+    if (offset > 0) out += '+';
+    if (offset != 0) appendNumber(out, offset);
+}
+
+static void appendOperand(std::string& text, const MOperand& op) {
+    switch (op.kind) {
+        case MOperand::Kind::REG:
+            text += regText(op.reg, op.size);
+            break;
+        case MOperand::Kind::IMM:
+            text += '$';
+            appendSymbolOffset(text, op.symbol, op.imm);
+            break;
+        case MOperand::Kind::SYMBOL:
+            text += op.symbol;
+            break;
+        case MOperand::Kind::MEM:
+            if (!op.symbol.empty() || op.imm != 0 || (!op.hasBase && !op.hasIndex)) {
+                appendSymbolOffset(text, op.symbol, op.imm);
+            }
+            if (op.hasBase || op.hasIndex) {
+                text += '(';
+                if (op.hasBase) text += regName(op.base);
+                if (op.hasIndex) {
+                    text += ", ";
+                    text += regName(op.index);
+                    if (op.scale != 1) {
+                        text += ", ";
+                        appendNumber(text, op.scale);
+                    }
+                }
+                text += ')';
+            }
+            break;
+        case MOperand::Kind::NONE:
+            break;
+    }
+}
+
+std::string formatOperand(const MOperand& op) {
+    std::string text;
+    appendOperand(text, op);
+    return text;
+}
+
+static void appendQuoted(std::string& quoted, const std::string& text) {
+    quoted += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if (c == '\n') {
+            quoted += "\\n";
+        } else if (c < 32 || c >= 127) {
+            const char* octal = "01234567";
+            quoted += '\\';
+            quoted += octal[(c >> 6) & 7];
+            quoted += octal[(c >> 3) & 7];
+            quoted += octal[c & 7];
+        } else {
+            quoted += static_cast<char>(c);
+        }
+    }
+    quoted += '"';
+}
+
+void AsmPrinter::list(const char* directive, const std::vector<MOperand>& values) {
+    out += directive;
+    out += ' ';
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i) out += ", ";
+        appendSymbolOffset(out, values[i].symbol, values[i].imm);
+    }
+    out += '\n';
+}
+
+void AsmPrinter::print(const std::vector<MInstr>& code) {
+    for (const auto& instr : code) {
+        print(instr);
+    }
+}
+
+void AsmPrinter::print(const MInstr& instr) {
+    switch (instr.op) {
+        case MOp::LABEL:
+            if (previous == MOp::RET || previous == MOp::GLOBL) out += '\n';
+            out += instr.name;
+            out += ":\n";
+            break;
+        case MOp::SECTION:
+            out += "\n.section ";
+            out += instr.name;
+            out += '\n';
+            break;
+        case MOp::GLOBL:
+            out += ".globl ";
+            out += instr.name;
+            out += '\n';
+            break;
+        case MOp::LCOMM:
+            out += ".lcomm ";
+            out += instr.name;
+            out += ", ";
+            appendNumber(out, instr.operands[0].imm);
+            out += '\n';
+            break;
+        case MOp::INCLUDE:
+            out += "\n.include ";
+            appendQuoted(out, instr.name);
+            out += '\n';
+            break;
+        case MOp::BYTE:
+            list(".byte", instr.operands);
+            break;
+        case MOp::QUAD:
+            list(".quad", instr.operands);
+            break;
+        case MOp::ASCII:
+            out += ".ascii ";
+            appendQuoted(out, instr.name);
+            out += '\n';
+            break;
+        case MOp::ZERO:
+            out += ".zero ";
+            appendNumber(out, instr.operands[0].imm);
+            out += '\n';
+            break;
+        case MOp::ALIGN:
+            out += ".balign ";
+            appendNumber(out, instr.operands[0].imm);
+            out += '\n';
+            break;
+        case MOp::JCC:
+            out += "  j";
+            out += condName(instr.cond);
+            out += ' ';
+            out += instr.operands[0].symbol;
+            out += '\n';
+            break;
+        case MOp::SETCC:
+            out += "  set";
+            out += condName(instr.cond);
+            out += ' ';
+            appendOperand(out, instr.operands[0]);
+            out += '\n';
+            break;
+        default: {
+            out += "  ";
+            out += mnemonic(instr.op);
+            if (instr.op == MOp::MOVZB) {
+                out += sizeSuffix(instr.operandSize());
+            } else if (instr.size) {
+                out += sizeSuffix(instr.size);
+            }
+            bool indirect = (instr.op == MOp::CALL || instr.op == MOp::JMP) &&
+                            instr.operands[0].kind != MOperand::Kind::SYMBOL;
+            for (size_t i = 0; i < instr.operands.size(); i++) {
+                out += i ? ", " : " ";
+                if (indirect) out += '*';
+                appendOperand(out, instr.operands[i]);
+            }
+            out += '\n';
+            break;
+        }
+    }
+    previous = instr.op;
+}
+
+void printAsm(const std::vector<MInstr>& code, std::ostream& out) {
+    std::string text;
+    AsmPrinter printer(text);
+    printer.print(code);
+    out << text;
+}
+
+namespace {
+
+// Leitor do subconjunto de AT&T que o proprio compilador gera e que o
+// runtime.s usa, para que o montador embutido aceite os dois.
+class AsmParser {
+public:
+    explicit AsmParser(const std::string& source) : source(source) {}
+
+    std::vector<MInstr> parse() {
+        size_t pos = 0;
+        while (pos <= source.size()) {
+            size_t end = source.find('\n', pos);
+            if (end == std::string::npos) end = source.size();
+            lineNumber++;
+            parseLine(source.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        return std::move(code);
+    }
+
+private:
+    const std::string& source;
+    std::vector<MInstr> code;
+    int lineNumber = 0;
+
+    [[noreturn]] void error(const std::string& message) const {
+        throw std::runtime_error("Erro de montagem na linha " + std::to_string(lineNumber) + ": " + message);
+    }
+
+    static std::string trim(const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) return "";
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    static bool isSymbolChar(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$';
+    }
+
+    static std::string stripComment(const std::string& line) {
+        bool inString = false;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] == '"' && (i == 0 || line[i - 1] != '\\')) inString = !inString;
+            if (!inString && line[i] == '#') return line.substr(0, i);
+        }
+        return line;
+    }
+
+    std::vector<std::string> splitOperands(const std::string& text) const {
+        std::vector<std::string> parts;
+        int depth = 0;
+        bool inString = false;
+        std::string current;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (c == '"' && (i == 0 || text[i - 1] != '\\')) inString = !inString;
+            if (!inString && c == '(') depth++;
+            if (!inString && c == ')') depth--;
+            if (!inString && depth == 0 && c == ',') {
+                parts.push_back(trim(current));
+                current.clear();
+            } else {
+                current += c;
+            }
+        }
+        if (!trim(current).empty() || !parts.empty()) parts.push_back(trim(current));
+        return parts;
+    }
+
+    long long number(const std::string& text) const {
+        if (text.empty()) error("numero esperado");
+        try {
+            size_t used = 0;
+            long long value;
+            try {
+                value = std::stoll(text, &used, 0);
+            } catch (const std::out_of_range&) {
+                // constantes sem sinal acima de INT64_MAX (ex.: 10^19 em .quad)
+                if (text[0] == '-') throw;
+                value = static_cast<long long>(std::stoull(text, &used, 0));
+            }
+            if (used != text.size()) error("numero invalido '" + text + "'");
+            return value;
+        } catch (const std::logic_error&) {
+            error("numero invalido '" + text + "'");
+        }
+    }
+
+    // simbolo, numero ou simbolo+numero
+    void expression(const std::string& text, std::string& symbol, long long& value) const {
+        symbol.clear();
+        value = 0;
+        if (text.empty()) return;
+        char first = text[0];
+        if (std::isdigit(static_cast<unsigned char>(first)) || first == '-' || first == '+') {
+            value = number(text);
+            return;
+        }
+        size_t end = 0;
+        while (end < text.size() && isSymbolChar(text[end])) end++;
+        symbol = text.substr(0, end);
+        if (end < text.size()) value = number(text.substr(end));
+    }
+
+    bool registerNamed(const std::string& name, Reg& reg, int& size) const {
+        for (int r = 0; r < VECTOR_REGS; r++) {
+            if (name == xmmName(r)) {
+                reg = static_cast<Reg>(r);
+                size = MOperand::XMM_SIZE;
+                return true;
+            }
+        }
+        for (int r = 0; r < NUM_REGS; r++) {
+            Reg candidate = static_cast<Reg>(r);
+            const char* names[] = { regName(candidate), regName32(candidate), regName8(candidate) };
+            const int sizes[] = { 8, 4, 1 };
+            for (int k = 0; k < 3; k++) {
+                if (name == names[k]) {
+                    reg = candidate;
+                    size = sizes[k];
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    Reg baseRegister(const std::string& name) const {
+        Reg reg;
+        int size;
+        if (!registerNamed(name, reg, size) || size != 8) error("registrador invalido '" + name + "'");
+        return reg;
+    }
+
+    MOperand operand(std::string text, bool branchTarget) const {
+        if (!text.empty() && text[0] == '*') text = trim(text.substr(1));
+        if (text.empty()) error("operando vazio");
+
+        MOperand op;
+        if (text[0] == '%') {
+            op.kind = MOperand::Kind::REG;
+            if (!registerNamed(text, op.reg, op.size)) error("registrador invalido '" + text + "'");
+            return op;
+        }
+        if (text[0] == '$') {
+            op.kind = MOperand::Kind::IMM;
+            expression(trim(text.substr(1)), op.symbol, op.imm);
+            return op;
+        }
+
+        size_t paren = text.find('(');
+        std::string displacement = trim(text.substr(0, paren));
+        op.kind = MOperand::Kind::MEM;
+        expression(displacement, op.symbol, op.imm);
+        if (paren == std::string::npos) {
+            if (branchTarget && !op.symbol.empty() && op.imm == 0) op.kind = MOperand::Kind::SYMBOL;
+            return op;
+        }
+
+        size_t close = text.find(')', paren);
+        if (close == std::string::npos) error("')' esperado");
+        std::vector<std::string> parts = splitOperands(text.substr(paren + 1, close - paren - 1));
+        if (parts.empty() || parts.size() > 3) error("endereco invalido '" + text + "'");
+        if (!parts[0].empty()) {
+            op.hasBase = true;
+            op.base = baseRegister(parts[0]);
+        }
+        if (parts.size() > 1) {
+            op.hasIndex = true;
+            op.index = baseRegister(parts[1]);
+            op.scale = parts.size() > 2 ? static_cast<int>(number(parts[2])) : 1;
+            if (op.scale != 1 && op.scale != 2 && op.scale != 4 && op.scale != 8) error("escala invalida");
+        }
+        return op;
+    }
+
+    static bool condition(const std::string& text, Cond& cond) {
+        static const std::map<std::string, Cond> aliases = {
+            {"z", Cond::E}, {"nz", Cond::NE}, {"c", Cond::B}, {"nc", Cond::AE},
+            {"nae", Cond::B}, {"nb", Cond::AE}, {"na", Cond::BE}, {"nbe", Cond::A},
+            {"nge", Cond::L}, {"nl", Cond::GE}, {"ng", Cond::LE}, {"nle", Cond::G},
+            {"pe", Cond::P}, {"po", Cond::NP}
+        };
+        for (int c = 0; c < 16; c++) {
+            if (text == condNames[c]) {
+                cond = static_cast<Cond>(c);
+                return true;
+            }
+        }
+        auto alias = aliases.find(text);
+        if (alias == aliases.end()) return false;
+        cond = alias->second;
+        return true;
+    }
+
+    MInstr instruction(const std::string& name) const {
+        static const std::map<std::string, MOp> mnemonics = {
+            {"mov", MOp::MOV}, {"movabs", MOp::MOV}, {"lea", MOp::LEA}, {"add", MOp::ADD},
+            {"sub", MOp::SUB}, {"imul", MOp::IMUL}, {"mul", MOp::MUL}, {"idiv", MOp::IDIV}, {"div", MOp::DIV},
+            {"neg", MOp::NEG},
+            {"inc", MOp::INC}, {"dec", MOp::DEC}, {"and", MOp::AND}, {"or", MOp::OR},
+            {"xor", MOp::XOR}, {"cmp", MOp::CMP}, {"test", MOp::TEST}, {"shl", MOp::SHL},
+            {"sal", MOp::SHL}, {"shr", MOp::SHR}, {"sar", MOp::SAR}, {"bsr", MOp::BSR}, {"bt", MOp::BT},
+            {"cqo", MOp::CQO}, {"cqto", MOp::CQO}, {"push", MOp::PUSH}, {"pop", MOp::POP}, {"call", MOp::CALL},
+            {"ret", MOp::RET}, {"leave", MOp::LEAVE}, {"jmp", MOp::JMP}, {"syscall", MOp::SYSCALL},
+            {"rdtsc", MOp::RDTSC}, {"xchg", MOp::XCHG}, {"pause", MOp::PAUSE}, {"movdqu", MOp::MOVDQU}, {"movdqa", MOp::MOVDQA},
+            {"punpcklqdq", MOp::PUNPCKLQDQ}, {"paddq", MOp::PADDQ}, {"psubq", MOp::PSUBQ},
+            {"pcmpeqd", MOp::PCMPEQD}, {"pshufd", MOp::PSHUFD}, {"pand", MOp::PAND}, {"pxor", MOp::PXOR},
+            {"psrlq", MOp::PSRLQ}
+        };
+
+        auto exact = mnemonics.find(name);
+        if (exact != mnemonics.end()) return MInstr(exact->second);
+
+        if (name == "movzbl" || name == "movzbq") {
+            MInstr instr(MOp::MOVZB);
+            instr.size = name.back() == 'l' ? 4 : 8;
+            return instr;
+        }
+
+        char suffix = name.empty() ? 0 : name.back();
+        auto base = mnemonics.find(name.substr(0, name.size() - 1));
+        if (base != mnemonics.end() && (suffix == 'b' || suffix == 'l' || suffix == 'q')) {
+            MInstr instr(base->second);
+            instr.size = suffix == 'b' ? 1 : suffix == 'l' ? 4 : 8;
+            return instr;
+        }
+
+        MInstr instr;
+        if (name.size() > 3 && name.compare(0, 3, "set") == 0 && condition(name.substr(3), instr.cond)) {
+            instr.op = MOp::SETCC;
+            return instr;
+        }
+        if (name.size() > 1 && name[0] == 'j' && condition(name.substr(1), instr.cond)) {
+            instr.op = MOp::JCC;
+            return instr;
+        }
+        error("instrucao desconhecida '" + name + "'");
+    }
+
+    std::string unquote(const std::string& text) const {
+        if (text.size() < 2 || text.front() != '"' || text.back() != '"') error("texto entre aspas esperado");
+        std::string result;
+        for (size_t i = 1; i + 1 < text.size(); i++) {
+            char c = text[i];
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            c = text[++i];
+            if (c == 'n') {
+                result += '\n';
+            } else if (c == 't') {
+                result += '\t';
+            } else if (c >= '0' && c <= '7') {
+                int value = 0;
+                for (int k = 0; k < 3 && i + 1 < text.size() && text[i] >= '0' && text[i] <= '7'; k++) {
+                    value = value * 8 + (text[i++] - '0');
+                }
+                i--;
+                result += static_cast<char>(value);
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+    void directive(const std::string& name, const std::string& rest) {
+        std::vector<std::string> args = splitOperands(rest);
+        auto argument = [&](size_t i) -> const std::string& {
+            if (i >= args.size() || args[i].empty()) error("argumento faltando em " + name);
+            return args[i];
+        };
+
+        if (name == ".text" || name == ".data" || name == ".bss") {
+            code.push_back(MInstr::labelled(MOp::SECTION, name));
+        } else if (name == ".section") {
+            code.push_back(MInstr::labelled(MOp::SECTION, argument(0)));
+        } else if (name == ".globl" || name == ".global") {
+            code.push_back(MInstr::labelled(MOp::GLOBL, argument(0)));
+        } else if (name == ".lcomm") {
+            MInstr instr = MInstr::labelled(MOp::LCOMM, argument(0));
+            instr.operands.push_back(MOperand::immediate(number(argument(1))));
+            code.push_back(instr);
+        } else if (name == ".include") {
+            code.push_back(MInstr::labelled(MOp::INCLUDE, unquote(argument(0))));
+        } else if (name == ".byte" || name == ".quad") {
+            MInstr instr(name == ".byte" ? MOp::BYTE : MOp::QUAD);
+            for (const auto& arg : args) {
+                MOperand value = MOperand::immediate(0);
+                expression(arg, value.symbol, value.imm);
+                instr.operands.push_back(value);
+            }
+            code.push_back(instr);
+        } else if (name == ".ascii" || name == ".asciz" || name == ".string") {
+            std::string text = unquote(argument(0));
+            if (name != ".ascii") text += '\0';
+            code.push_back(MInstr::labelled(MOp::ASCII, text));
+        } else if (name == ".zero" || name == ".skip") {
+            code.push_back(MInstr(MOp::ZERO, {MOperand::immediate(number(argument(0)))}));
+        } else if (name == ".balign" || name == ".align" || name == ".p2align") {
+            long long alignment = number(argument(0));
+            if (name == ".p2align") alignment = 1LL << alignment;
+            code.push_back(MInstr(MOp::ALIGN, {MOperand::immediate(alignment)}));
+        } else if (name != ".type" && name != ".size" && name != ".file" && name != ".ident") {
+            error("diretiva desconhecida '" + name + "'");
+        }
+    }
+
+    void parseLine(const std::string& raw) {
+        std::string line = trim(raw);
+        if (line.compare(0, 2, "//") == 0) return;
+        line = trim(stripComment(line));
+
+        size_t end = 0;
+        while (end < line.size() && isSymbolChar(line[end])) end++;
+        if (end > 0 && end < line.size() && line[end] == ':') {
+            code.push_back(MInstr::labelled(MOp::LABEL, line.substr(0, end)));
+            line = trim(line.substr(end + 1));
+            end = 0;
+            while (end < line.size() && isSymbolChar(line[end])) end++;
+        }
+        if (line.empty()) return;
+
+        std::string name = line.substr(0, end);
+        std::string rest = trim(line.substr(end));
+        if (name.empty()) error("linha invalida '" + line + "'");
+        if (name[0] == '.') {
+            directive(name, rest);
+            return;
+        }
+        if (name == "rep") {
+            if (rest != "stosq") error("instrucao desconhecida 'rep " + rest + "'");
+            code.push_back(MInstr(MOp::REP_STOSQ));
+            return;
+        }
+
+        // lock so e usado com add
+        bool locked = name == "lock";
+        if (locked) {
+            end = 0;
+            while (end < rest.size() && isSymbolChar(rest[end])) end++;
+            name = rest.substr(0, end);
+            rest = trim(rest.substr(end));
+            if (instruction(name).op != MOp::ADD) error("instrucao desconhecida 'lock " + name + "'");
+        }
+
+        MInstr instr = instruction(name);
+        if (locked) instr.op = MOp::LOCK_ADD;
+        bool branch = instr.op == MOp::JMP || instr.op == MOp::JCC || instr.op == MOp::CALL;
+        for (const auto& text : splitOperands(rest)) {
+            instr.operands.push_back(operand(text, branch));
+        }
+        // movq com um xmm e a copia entre registrador geral e xmm
+        if (instr.op == MOp::MOV && instr.size == 8 &&
+            std::any_of(instr.operands.begin(), instr.operands.end(),
+                        [](const MOperand& op) { return op.isXmm(); })) {
+            instr.op = MOp::MOVQ;
+            instr.size = 0;
+        }
+        if (instr.op == MOp::JCC && (instr.operands.size() != 1 ||
+                                     instr.operands[0].kind != MOperand::Kind::SYMBOL)) {
+            error("desvio condicional exige um rotulo");
+        }
+        code.push_back(instr);
+    }
+};
+
+}
+
+std::vector<MInstr> parseAsm(const std::string& source) {
+    return AsmParser(source).parse();
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "x86.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Instrucoes de maquina x86-64 ja com registradores fisicos. E a forma
+// produzida pelo X86Emitter e consumida tanto pela impressao em assembly
+// AT&T quanto pelo montador embutido.
+enum class MOp {
+    // pseudo-instrucoes e diretivas
+    LABEL, SECTION, GLOBL, LCOMM, INCLUDE, BYTE, QUAD, ASCII, ZERO, ALIGN,
+    // instrucoes
+    MOV, MOVZB, LEA, ADD, SUB, IMUL, MUL, IDIV, DIV, NEG, INC, DEC, AND, OR, XOR, CMP, TEST,
+    SHL, SHR, SAR, BSR, BT, CQO, PUSH, POP, CALL, RET, LEAVE, JMP, JCC, SETCC, SYSCALL, RDTSC,
+    REP_STOSQ, XCHG, PAUSE,
+    LOCK_ADD,  // add atomico (prefixo lock), destino na memoria
+    // SSE2, com registradores xmm (MOperand::xmm)
+    MOVDQU, MOVDQA, MOVQ, PUNPCKLQDQ, PADDQ, PSUBQ, PCMPEQD, PSHUFD, PAND, PXOR, PSRLQ
+};
+
+// Condicoes na ordem da codificacao (o campo tttn dos opcodes Jcc/SETcc).
+enum class Cond { O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G };
+
+struct MOperand {
+    enum class Kind { NONE, REG, IMM, MEM, SYMBOL };
+
+    // Tamanho que marca um registrador xmm; o numero dele fica em reg.
+    static const int XMM_SIZE = 16;
+
+    Kind kind = Kind::NONE;
+    Reg reg = Reg::RAX;
+    int size = 8;
+    long long imm = 0;
+    std::string symbol;
+    bool hasBase = false;
+    Reg base = Reg::RAX;
+    bool hasIndex = false;
+    Reg index = Reg::RAX;
+    int scale = 1;
+
+    static MOperand r(Reg reg, int size = 8) {
+        MOperand op;
+        op.kind = Kind::REG;
+        op.reg = reg;
+        op.size = size;
+        return op;
+    }
+
+    static MOperand xmm(int number) {
+        return r(static_cast<Reg>(number), XMM_SIZE);
+    }
+
+    static MOperand immediate(long long value) {
+        MOperand op;
+        op.kind = Kind::IMM;
+        op.imm = value;
+        return op;
+    }
+
+    static MOperand address(const std::string& symbol) {
+        MOperand op;
+        op.kind = Kind::IMM;
+        op.symbol = symbol;
+        return op;
+    }
+
+    static MOperand mem(Reg base, long long disp = 0) {
+        MOperand op;
+        op.kind = Kind::MEM;
+        op.hasBase = true;
+        op.base = base;
+        op.imm = disp;
+        return op;
+    }
+
+    static MOperand global(const std::string& symbol) {
+        MOperand op;
+        op.kind = Kind::MEM;
+        op.symbol = symbol;
+        return op;
+    }
+
+    static MOperand label(const std::string& name) {
+        MOperand op;
+        op.kind = Kind::SYMBOL;
+        op.symbol = name;
+        return op;
+    }
+
+    bool isReg() const { return kind == Kind::REG; }
+    bool isXmm() const { return kind == Kind::REG && size == XMM_SIZE; }
+    bool isImm() const { return kind == Kind::IMM; }
+    bool isMem() const { return kind == Kind::MEM; }
+    bool is(Reg r) const { return kind == Kind::REG && reg == r && size != XMM_SIZE; }
+    bool operator==(const MOperand& other) const;
+    bool operator!=(const MOperand& other) const { return !(*this == other); }
+};
+
+struct MInstr {
+    MOp op;
+    Cond cond = Cond::E;
+    int size = 0;                   // sufixo explicito (1, 4 ou 8); 0 = deduzido dos registradores
+    std::vector<MOperand> operands; // ordem AT&T: fonte primeiro
+    std::string name;               // rotulo, secao, simbolo, arquivo ou texto de .ascii
+
+    MInstr(MOp op = MOp::RET) : op(op) {}
+    MInstr(MOp op, std::vector<MOperand> operands) : op(op), operands(std::move(operands)) {}
+
+    static MInstr labelled(MOp op, std::string name) {
+        MInstr instr(op);
+        instr.name = std::move(name);
+        return instr;
+    }
+
+    int operandSize() const;
+};
+
+// Codigo de maquina de uma funcao. Diretivas fora de funcoes (secoes,
+// .lcomm, .include) ficam em blocos sem nome.
+struct MFunction {
+    std::string name;
+    std::vector<MInstr> code;
+};
+
+const char* condName(Cond cond);
+
+std::string formatOperand(const MOperand& op);
+
+// Serializa instrucoes em AT&T no fim de out. Pode receber varias listas
+// seguidas (uma por funcao): o espacamento entre elas e o mesmo de uma
+// lista unica.
+class AsmPrinter {
+public:
+    explicit AsmPrinter(std::string& out) : out(out) {}
+    void print(const std::vector<MInstr>& code);
+    void print(const MInstr& instr);
+
+private:
+    std::string& out;
+    MOp previous = MOp::LABEL;
+
+    void list(const char* directive, const std::vector<MOperand>& values);
+};
+
+void printAsm(const std::vector<MInstr>& code, std::ostream& out);
+std::vector<MInstr> parseAsm(const std::string& source);
@@ -8,16 +8,101 @@
 #include "lexer.h"
 #include "parser.h"
 #include "visitor.h"
+#include "astdump.h"
+#include "options.h"
+#include "compiler.h"
+#include "batch.h"
+#include "jit.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "server.h"
+#include "timereport.h"
+
+// O runtime.s e procurado no diretorio atual e ao lado do executavel.
+static std::string executableDir(const char* argv0) {
+    std::string path = argv0;
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Uso: " << argv[0] << " <arquivo.ci>" << std::endl;
+    CompilerOptions options;
+    std::vector<std::string> inputs;
+    bool batch = false;
+    bool invalid = false;
+    std::string serverSocket;
+    bool dumpAstEnabled = false;
+    AstFormat dumpFormat = AstFormat::TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parseOption(arg, options)) continue;
+
+        if (arg.rfind("--dump-ast=", 0) == 0) {
+            invalid = !parseAstFormat(arg.substr(11), dumpFormat);
+            if (invalid) break;
+            dumpAstEnabled = true;
+        } else if (arg == "--server") {
+            serverSocket = DEFAULT_SOCKET;
+        } else if (arg.rfind("--server=", 0) == 0 && arg.size() > 9) {
+            serverSocket = arg.substr(9);
+        } else if (arg.size() > 1 && arg[0] == '@') {
+            try {
+                std::vector<std::string> listed = readManifest(arg.substr(1));
+                inputs.insert(inputs.end(), listed.begin(), listed.end());
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            batch = true;
+        } else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        } else {
+            invalid = true;
+            break;
+        }
+    }
+
+    options.includeDirs = {".", executableDir(argv[0])};
+    if (!invalid && !serverSocket.empty() && inputs.empty() && !dumpAstEnabled) {
+        return runServer(serverSocket, options);
+    }
+    if (invalid || inputs.empty()) {
+        std::cerr << "Uso: " << argv[0] << " [-O0|-O1] [-jN] [--cache=dir] [--abi=stack|sysv] [--emit-obj|--jit|--run]"
+                  << " [--profile-generate[=arquivo]|--profile-use=arquivo] [--instrument]"
+                  << " [--time-report[=text|json]] [--dump-ast=text|json|bin] <arquivo.ci|arquivo.ast>" << std::endl;
+        std::cerr << "     " << argv[0] << " [-O0|-O1] [-jN] [--cache=dir] [--abi=stack|sysv] [--emit-obj]"
+                  << " <arquivo.ci>... | @lista" << std::endl;
+        std::cerr << "     " << argv[0] << " [opcoes] --server[=socket]" << std::endl;
+        return 1;
+    }
+    if (!options.cacheDir.empty() &&
+        (options.interpret || !options.profileGenerate.empty() || !options.profileUse.empty())) {
+        std::cerr << "Erro: --cache nao pode ser combinado com --run nem com os perfis" << std::endl;
+        return 1;
+    }
+    if (batch || inputs.size() > 1) {
+        if (options.jit || options.interpret || !options.profileGenerate.empty() || !options.profileUse.empty() ||
+            !options.timeReport.empty() || dumpAstEnabled) {
+            std::cerr << "Erro: --jit, --run, --time-report, --dump-ast e os perfis aceitam um unico arquivo"
+                      << std::endl;
+            return 1;
+        }
+        return compileBatch(inputs, options) == 0 ? 0 : 1;
+    }
+    if (options.instrument && (options.jit || options.interpret)) {
+        std::cerr << "Erro: --instrument nao pode ser combinado com --jit nem com --run" << std::endl;
+        return 1;
+    }
+    const char* input = inputs[0].c_str();
+    if (!options.profileGenerate.empty() && (options.interpret || !options.profileUse.empty())) {
+        std::cerr << "Erro: --profile-generate nao pode ser combinado com --run nem com --profile-use" << std::endl;
         return 1;
     }
 
-    std::ifstream file(argv[1]);
+    std::ifstream file(input, std::ios::binary);
     if (!file.is_open()) {
-        std::cerr << "Erro: Nao foi possivel abrir o arquivo " << argv[1] << std::endl;
+        std::cerr << "Erro: Nao foi possivel abrir o arquivo " << input << std::endl;
         return 1;
     }
 
@@ -25,42 +110,109 @@ int main(int argc, char* argv[]) {
     buffer << file.rdbuf();
     std::string source_code = buffer.str();
 
+    TimeReport report(options.timeReport);
     try {
-        Lexer lexer(source_code);
-        std::vector<Token> tokens = lexer.tokenize();
-
-        Parser parser(tokens);
-        std::unique_ptr<Program> ast_root = parser.parse();
-
-        std::cout << "Arvore Sintatica:" << std::endl;
-        PrintVisitor printVisitor;
-        ast_root->accept(printVisitor);
-        std::cout << std::endl;
-
-        std::ofstream output_file("program.s");
-        if (output_file.is_open()) {
-            output_file << std::endl;
-            
-            std::streambuf* orig = std::cout.rdbuf();
-            std::cout.rdbuf(output_file.rdbuf());
-            
-            CodeGenerationVisitor codeGenVisitor;
-            ast_root->accept(codeGenVisitor);
-            
-            std::cout << std::endl;
-            std::cout << "call sair" << std::endl;
-            std::cout << std::endl;
-            std::cout << ".include \"runtime.s\"" << std::endl;
-            
-            std::cout.rdbuf(orig);
-
-            output_file.close();
-            std::cout << "Codigo assembly gerado em: program.s" << std::endl;
+        // uma arvore gravada com --dump-ast=bin dispensa o lexico e o
+        // sintatico
+        std::vector<Token> tokens;
+        std::unique_ptr<Program> ast_root;
+        if (isBinaryAst(source_code)) {
+            report.begin("carga da arvore");
+            ast_root = loadAst(source_code);
+            report.end();
         } else {
-            std::cerr << "Erro: Nao foi possivel criar arquivo program.s" << std::endl;
+            report.begin("lexico");
+            Lexer lexer(source_code);
+            tokens = lexer.tokenize();
+            report.end();
+
+            report.begin("sintatico");
+            Parser parser(tokens);
+            ast_root = parser.parse();
+            report.end();
+        }
+
+        if (dumpAstEnabled) {
+            report.begin("impressao da arvore");
+            if (dumpFormat == AstFormat::BINARY) {
+                std::ofstream out("program.ast", std::ios::binary);
+                dumpAst(*ast_root, dumpFormat, out);
+                if (!out) throw std::runtime_error("Erro: Nao foi possivel criar arquivo program.ast");
+                std::cout << "Arvore gravada em: program.ast" << std::endl;
+            } else {
+                if (dumpFormat == AstFormat::TEXT) std::cout << "Arvore Sintatica:\n";
+                dumpAst(*ast_root, dumpFormat, std::cout);
+                if (dumpFormat == AstFormat::TEXT) std::cout << '\n';
+                std::cout.flush();
+            }
+            report.end();
+        }
+
+        report.begin("geracao de codigo");
+        CodeGenerationVisitor codeGenVisitor(options);
+        ast_root->accept(codeGenVisitor);
+        report.end();
+        report.steps(codeGenVisitor.codegenTimes());
+
+        if (!options.profileUse.empty()) {
+            const ProfileDecisions& decisions = codeGenVisitor.profileDecisions();
+            std::cout << "Perfil aplicado: " << decisions.inlinedCalls << " chamadas expandidas, "
+                      << decisions.swappedBranches << " ramos invertidos, " << decisions.coldBlocks
+                      << " blocos frios, " << decisions.unrolledLoops << " lacos desenrolados" << std::endl;
+        }
+
+        if (!options.cacheDir.empty()) {
+            const CacheStats& stats = codeGenVisitor.cacheStatistics();
+            std::cout << "Cache: " << stats.hits << " funcoes reaproveitadas, " << stats.misses
+                      << " geradas" << std::endl;
+        }
+
+        report.begin(options.interpret ? "bytecode e execucao" : options.jit ? "montagem e execucao" : "saida");
+        if (options.interpret) {
+            StdoutHost host;
+            BcProgram program = compileBytecode(codeGenVisitor.irFunctions(), codeGenVisitor.globalVariables());
+            Vm vm(program, host);
+            long long result = vm.run();
+            std::cout << "Programa interpretado, resultado: " << result << std::endl;
+        } else if (options.jit) {
+            StdoutHost host;
+            JitProgram program(codeGenVisitor.machineCode(), host);
+            long long result = program.run();
+            std::cout << "Programa executado em memoria, resultado: " << result << std::endl;
+        } else {
+            std::string path = options.emitObject ? "program.o" : "program.s";
+            FileSink sink(path);
+            emitProgram(codeGenVisitor, options, sink);
+            if (sink.failed()) {
+                std::cerr << "Erro: Nao foi possivel criar arquivo " << path << std::endl;
+                return 1;
+            } else if (options.emitObject) {
+                std::cout << "Objeto gerado em: " << path << std::endl;
+            } else {
+                std::cout << "Codigo assembly gerado em: " << path << std::endl;
+            }
+        }
+        report.end();
+
+        if (report.enabled()) {
+            size_t functions = ast_root->mainFunction ? 1 : 0;
+            for (const auto& decl : ast_root->globalDeclarations) {
+                if (dynamic_cast<const FunctionDeclaration*>(decl.get())) functions++;
+            }
+            report.count("tokens", tokens.size());
+            report.count("nos", static_cast<uint64_t>(treeSize(*ast_root)));
+            report.count("funcoes", functions);
+            report.count("instrucoes_ir", codeGenVisitor.codegenTimes().irInstructions);
+            if (!options.interpret) {
+                size_t instructions = 0;
+                for (const auto& fn : codeGenVisitor.machineFunctions()) instructions += fn.code.size();
+                report.count("instrucoes_maquina", instructions);
+            }
+            report.print(std::cerr);
         }
 
-    } catch (const std::runtime_error& e) {
+    } catch (const std::exception& e) {
+        // como em compile(): std::bad_alloc e afins viram diagnostico
         std::cerr << e.what() << std::endl;
         return 1;
     }
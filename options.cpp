@@ -0,0 +1,42 @@
+#include "options.h"
+#include <charconv>
+
+bool parseOption(const std::string& arg, CompilerOptions& options) {
+    if (arg == "-O0" || arg == "-O1") {
+        options.optimizationLevel = arg[2] - '0';
+    } else if (arg == "--abi=sysv") {
+        options.abi = CallingConvention::SYSV;
+    } else if (arg == "--abi=stack") {
+        options.abi = CallingConvention::STACK;
+    } else if (arg == "--emit-obj") {
+        options.emitObject = true;
+    } else if (arg == "--jit") {
+        options.jit = true;
+    } else if (arg == "--run") {
+        options.interpret = true;
+    } else if (arg == "--profile-generate") {
+        options.profileGenerate = "perfil.dat";
+    } else if (arg.rfind("--profile-generate=", 0) == 0 && arg.size() > 19) {
+        options.profileGenerate = arg.substr(19);
+    } else if (arg.rfind("--profile-use=", 0) == 0 && arg.size() > 14) {
+        options.profileUse = arg.substr(14);
+    } else if (arg == "--instrument") {
+        options.instrument = true;
+    } else if (arg.size() > 2 && arg.rfind("-j", 0) == 0) {
+        // so digitos, ate MAX_JOBS; o resto vira erro de uso
+        const char* end = arg.data() + arg.size();
+        int jobs = 0;
+        auto parsed = std::from_chars(arg.data() + 2, end, jobs);
+        if (arg[2] == '-' || parsed.ec != std::errc() || parsed.ptr != end || jobs > MAX_JOBS) return false;
+        options.jobs = jobs;
+    } else if (arg.rfind("--cache=", 0) == 0 && arg.size() > 8) {
+        options.cacheDir = arg.substr(8);
+    } else if (arg == "--time-report" || arg == "--time-report=text") {
+        options.timeReport = "text";
+    } else if (arg == "--time-report=json") {
+        options.timeReport = "json";
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "ir.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+struct MInstr;
+
+const int MAX_JOBS = 1024;
+
+struct CompilerOptions {
+    // 0: todo vreg vive na pilha (equivalente a antiga maquina de pilha)
+    // 1: alocacao de registradores por linear scan
+    int optimizationLevel = 1;
+
+    // Convencao usada entre funcoes do proprio programa. Funcoes declaradas
+    // com 'extern fun' sempre usam System V.
+    CallingConvention abi = CallingConvention::STACK;
+
+    // Gera program.o com o montador embutido em vez de program.s.
+    bool emitObject = false;
+
+    // Executa o programa em memoria, sem gerar arquivos.
+    bool jit = false;
+
+    // --run: o IR vai para o compilador de bytecode e e interpretado, sem
+    // passar pelo alocador de registradores nem pelo emissor x86.
+    bool interpret = false;
+
+    // --profile-generate[=arquivo]: conta entradas de blocos e chamadas;
+    // o programa grava os contadores nesse arquivo ao sair.
+    std::string profileGenerate;
+
+    // --profile-use=arquivo: com os contadores, expande chamadas quentes,
+    // poe o ramo mais executado no caminho direto, afasta blocos frios para
+    // o fim da funcao e desenrola lacos longos.
+    std::string profileUse;
+
+    // --instrument: cada funcao conta as entradas e soma os ciclos (rdtsc)
+    // inclusivos e exclusivos em .bss; o runtime imprime a tabela em stderr
+    // ao sair.
+    bool instrument = false;
+
+    // -jN: threads usadas para gerar as funcoes (0: uma por nucleo, no
+    // maximo MAX_JOBS). A saida e a mesma com qualquer quantidade.
+    int jobs = 0;
+
+    // --cache=dir: guarda o assembly de cada funcao em dir, pela chave do
+    // conteudo, e reaproveita nas proximas compilacoes.
+    std::string cacheDir;
+
+    // --time-report[=text|json]: tempo, alocacoes e memoria de cada fase,
+    // impressos em stderr no formato pedido; vazio desliga.
+    std::string timeReport;
+
+    // Diretorios onde o .include do runtime.s e procurado com --emit-obj.
+    std::vector<std::string> includeDirs = {"."};
+
+    // runtime.s ja interpretado, usado no lugar do arquivo (ver
+    // Assembler::preload); nulo para ler de includeDirs.
+    std::shared_ptr<const std::vector<MInstr>> runtime;
+};
+
+// Aplica uma opcao da linha de comando a options; devolve false se arg nao
+// for uma opcao de compilacao conhecida.
+bool parseOption(const std::string& arg, CompilerOptions& options);
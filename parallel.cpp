@@ -0,0 +1,127 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+int workerCount(int jobs) {
+    if (jobs > 0) return jobs;
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? static_cast<int>(cores) : 1;
+}
+
+void parallelFor(size_t count, int jobs, const std::function<void(size_t)>& body) {
+    size_t threads = std::min(count, static_cast<size_t>(workerCount(jobs)));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(count);
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                body(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++) pool.emplace_back(work);
+    work();
+    for (auto& thread : pool) thread.join();
+
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+namespace {
+
+// Indices ainda nao iniciados de uma thread: [begin, end).
+struct Range {
+    std::mutex lock;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// Proximo indice para a thread self: o inicio da propria faixa ou, se ela
+// acabou, a metade final da maior faixa das outras.
+bool take(std::vector<Range>& ranges, size_t self, size_t& index) {
+    {
+        std::lock_guard<std::mutex> guard(ranges[self].lock);
+        if (ranges[self].begin < ranges[self].end) {
+            index = ranges[self].begin++;
+            return true;
+        }
+    }
+    for (;;) {
+        size_t victim = self;
+        size_t most = 0;
+        for (size_t t = 0; t < ranges.size(); t++) {
+            if (t == self) continue;
+            std::lock_guard<std::mutex> guard(ranges[t].lock);
+            if (ranges[t].end - ranges[t].begin > most) {
+                most = ranges[t].end - ranges[t].begin;
+                victim = t;
+            }
+        }
+        if (victim == self) return false;
+
+        size_t first, last;
+        {
+            std::lock_guard<std::mutex> guard(ranges[victim].lock);
+            size_t left = ranges[victim].end - ranges[victim].begin;
+            if (left == 0) continue;
+            last = ranges[victim].end;
+            first = last - (left + 1) / 2;
+            ranges[victim].end = first;
+        }
+        std::lock_guard<std::mutex> guard(ranges[self].lock);
+        ranges[self].begin = first + 1;
+        ranges[self].end = last;
+        index = first;
+        return true;
+    }
+}
+
+}
+
+void stealingFor(size_t count, int jobs, const std::function<void(size_t, int)>& body) {
+    size_t threads = std::min(count, static_cast<size_t>(workerCount(jobs)));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) body(i, 0);
+        return;
+    }
+
+    std::vector<Range> ranges(threads);
+    for (size_t t = 0; t < threads; t++) {
+        ranges[t].begin = count * t / threads;
+        ranges[t].end = count * (t + 1) / threads;
+    }
+    std::vector<std::exception_ptr> errors(count);
+    auto work = [&](size_t self) {
+        size_t i;
+        while (take(ranges, self, i)) {
+            try {
+                body(i, static_cast<int>(self));
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++) pool.emplace_back(work, t);
+    work(0);
+    for (auto& thread : pool) thread.join();
+
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
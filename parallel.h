@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Quantidade de threads usada para jobs: 0 pede uma por nucleo.
+int workerCount(int jobs);
+
+// Executa body(0), ..., body(count - 1) em ate workerCount(jobs) threads,
+// que pegam o proximo indice livre ao terminar o anterior. Se alguma
+// chamada lancar excecao, as demais seguem ate o fim e a excecao de menor
+// indice e relancada, a mesma que uma execucao em ordem veria primeiro.
+void parallelFor(size_t count, int jobs, const std::function<void(size_t)>& body);
+
+// Para tarefas de custo muito desigual (arquivos inteiros): cada thread
+// comeca com uma faixa contigua de indices e, quando a sua acaba, rouba a
+// metade final da maior faixa restante. body recebe tambem o numero da
+// thread (0 a workerCount(jobs) - 1), para usar memoria propria dela.
+// Excecoes seguem a mesma regra de parallelFor.
+void stealingFor(size_t count, int jobs, const std::function<void(size_t index, int worker)>& body);
@@ -0,0 +1,265 @@
+#include "visitor.h"
+#include "ast.h"
+#include <set>
+#include <stdexcept>
+
+// parfor: o corpo vira a funcao nome.parforN(inicio, fim, ctx), System V,
+// que roda as iteracoes de inicio a fim - 1. O paralelo do runtime.s
+// divide o intervalo entre as threads e chama essa funcao com pedacos
+// dele. ctx e um bloco na pilha de quem executa o parfor: primeiro os
+// slots de fora lidos no corpo, depois uma palavra por variavel do reduce,
+// onde cada chamada soma (lock add) o que acumulou.
+
+namespace {
+
+// Procura no corpo de um parfor, e nas funcoes chamadas por ele, o que nao
+// pode rodar em varias threads: impressao, flush(), funcoes extern e
+// atribuicao a globais. Elementos de vetores globais podem ser gravados:
+// cada iteracao cuida dos seus indices.
+class HazardSearch {
+public:
+    HazardSearch(const std::map<std::string, const FunctionDeclaration*>& functions,
+                 const std::map<std::string, size_t>& externs)
+        : functions(functions), externs(externs) {}
+
+    // Descricao do primeiro problema, ou vazio.
+    std::string statement(const Statement& stmt, const std::string& where) {
+        std::string found;
+        if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+            for (const auto& s : block->statements) {
+                if (!(found = statement(*s, where)).empty()) break;
+            }
+        } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+            found = expression(*ifStmt->condition, where);
+            if (found.empty()) found = statement(*ifStmt->thenBranch, where);
+            if (found.empty() && ifStmt->elseBranch) found = statement(*ifStmt->elseBranch, where);
+        } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+            found = expression(*loop->condition, where);
+            if (found.empty()) found = statement(*loop->body, where);
+        } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+            found = expression(*match->subject, where);
+            for (const auto& arm : match->arms) {
+                if (!found.empty()) break;
+                found = statement(*arm.body, where);
+            }
+            if (found.empty() && match->otherwise) found = statement(*match->otherwise, where);
+        } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+            found = expression(*parfor->start, where);
+            if (found.empty()) found = expression(*parfor->end, where);
+            if (found.empty()) found = statement(*parfor->body, where);
+        } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+            const Exp& exp = *exprStmt->expression;
+            if (!dynamic_cast<const AssignmentExpression*>(&exp) && !dynamic_cast<const ArrayAssignment*>(&exp) &&
+                !isFlush(exp)) {
+                return "impressao " + where;
+            }
+            found = expression(exp, where);
+        } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+            if (var->initializer) found = expression(*var->initializer, where);
+        } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+            found = expression(*array->size, where);
+        } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+            found = expression(*ret->expression, where);
+        }
+        return found;
+    }
+
+private:
+    const std::map<std::string, const FunctionDeclaration*>& functions;
+    const std::map<std::string, size_t>& externs;
+    std::set<std::string> visited;
+
+    bool isFlush(const Exp& exp) const {
+        auto call = dynamic_cast<const FunctionCall*>(&exp);
+        return call && call->name == "flush" && !functions.count(call->name) && !externs.count(call->name);
+    }
+
+    std::string expression(const Exp& exp, const std::string& where) {
+        std::string found;
+        if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+            found = expression(*bin->opEsq, where);
+            if (found.empty()) found = expression(*bin->opDir, where);
+        } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+            found = expression(*cmp->left, where);
+            if (found.empty()) found = expression(*cmp->right, where);
+        } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+            found = expression(*logical->left, where);
+            if (found.empty()) found = expression(*logical->right, where);
+        } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+            found = expression(*unary->operand, where);
+        } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+            if (assign->binding.storage == StorageClass::GLOBAL) {
+                return "mudanca da global '" + assign->variable + "' " + where;
+            }
+            found = expression(*assign->value, where);
+        } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+            found = expression(*element->index, where);
+        } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+            found = expression(*store->index, where);
+            if (found.empty()) found = expression(*store->value, where);
+        } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+            if (isFlush(*call)) return "flush() " + where;
+            if (externs.count(call->name)) return "extern '" + call->name + "' " + where;
+            for (const auto& arg : call->arguments) {
+                if (!(found = expression(*arg, where)).empty()) return found;
+            }
+            auto callee = functions.find(call->name);
+            if (callee != functions.end() && visited.insert(call->name).second) {
+                found = statement(*callee->second->body, "em '" + call->name + "'");
+            }
+        }
+        return found;
+    }
+};
+
+// Os parfor de stmt, fora de expressoes.
+template <typename F>
+void forEachParallel(const Statement& stmt, F&& f) {
+    if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+        for (const auto& s : block->statements) forEachParallel(*s, f);
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        forEachParallel(*ifStmt->thenBranch, f);
+        if (ifStmt->elseBranch) forEachParallel(*ifStmt->elseBranch, f);
+    } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+        forEachParallel(*loop->body, f);
+    } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+        for (const auto& arm : match->arms) forEachParallel(*arm.body, f);
+        if (match->otherwise) forEachParallel(*match->otherwise, f);
+    } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+        f(*parfor);
+    }
+}
+
+}
+
+// Roda antes de gerar as funcoes (e de consultar o cache): o resultado
+// depende das funcoes chamadas, nao so da arvore de cada uma.
+void CodeGenerationVisitor::checkParallelBodies(const Program& node) const {
+    auto check = [&](const ParallelForStatement& parfor) {
+        if (options.instrument) {
+            throw std::runtime_error("Erro: parfor nao e suportado com --instrument.");
+        }
+        HazardSearch search(context->functionDeclarations, context->externFunctions);
+        std::string found = search.statement(*parfor.body, "no corpo");
+        if (!found.empty()) {
+            throw std::runtime_error("Erro semantico: o corpo de parfor nao pode imprimir, mudar globais, chamar "
+                                     "flush() nem funcoes extern (" + found + ").");
+        }
+    };
+    for (const auto& decl : node.globalDeclarations) {
+        if (auto fn = dynamic_cast<const FunctionDeclaration*>(decl.get())) forEachParallel(*fn->body, check);
+    }
+    if (auto main = dynamic_cast<const MainFunction*>(node.mainFunction.get())) {
+        forEachParallel(*main->body, check);
+    }
+}
+
+void CodeGenerationVisitor::visit(const ParallelForStatement& node) {
+    if (options.interpret) throw std::runtime_error("Erro: parfor nao e suportado com --run.");
+
+    std::string name = generateLabel("parfor");
+    Operand start = protect(lower(*node.start), *node.end);
+    Operand end = lower(*node.end);
+
+    // ctx: slots capturados e, zeradas pelo ALLOCA, as somas do reduce
+    size_t captured = node.captured.size();
+    size_t words = captured + node.reductionSlots.size();
+    Operand stack;
+    Operand ctx = Operand::immediate(0);
+    if (words > 0) {
+        stack = Operand::reg(function.newVReg());
+        emitInstr(IROp::STACKSAVE, stack);
+        ctx = Operand::reg(function.newVReg());
+        emitInstr(IROp::ALLOCA, ctx, Operand::immediate(static_cast<long long>(words)));
+        for (size_t k = 0; k < captured; k++) {
+            IRInstr store{IROp::STORE, Operand(), ctx, Operand::immediate(static_cast<long long>(k))};
+            store.args.push_back(Operand::reg(slotVReg(node.captured[k])));
+            function.emit(std::move(store));
+        }
+    }
+
+    IRInstr address{IROp::ADDRESS, Operand::reg(function.newVReg())};
+    address.label = name;
+    Operand body = address.dst;
+    function.emit(std::move(address));
+    IRInstr call{IROp::CALL, Operand::reg(function.newVReg())};
+    call.label = "paralelo";
+    call.convention = CallingConvention::SYSV;
+    call.args = {body, start, end, ctx};
+    function.emit(std::move(call));
+
+    for (size_t k = 0; k < node.reductionSlots.size(); k++) {
+        Operand partial = Operand::reg(function.newVReg());
+        emitInstr(IROp::LOAD, partial, ctx, Operand::immediate(static_cast<long long>(captured + k)));
+        Operand total = Operand::reg(slotVReg(node.reductionSlots[k]));
+        emitInstr(IROp::ADD, total, total, partial);
+    }
+    if (words > 0) emitInstr(IROp::STACKRESTORE, Operand(), stack);
+
+    outlineParallel(node, name);
+}
+
+// Gera a funcao do corpo no meio da funcao atual, guardando o estado dela.
+// Os lacos rapidos continuam valendo: os indices deles chegam pelo ctx com
+// o valor que tinham no parfor.
+void CodeGenerationVisitor::outlineParallel(const ParallelForStatement& node, const std::string& name) {
+    bool timing = !options.timeReport.empty();
+    times.steps[CodegenTimes::LOWERING] += loweringStart.elapsed();
+    IRFunction parent = std::move(function);
+    std::vector<int> parentSlots = std::move(slotVRegs);
+    std::vector<char> parentVariables = std::move(variableVRegs);
+    std::unordered_map<const Exp*, ExpInfo> parentInfo = std::move(expInfo);
+    std::vector<IRInstr> parentCold = std::move(coldCode);
+    std::vector<InlineFrame> parentInline = std::move(inlineStack);
+    int parentLabels = labelCounter;
+    inlineStack.clear();
+
+    beginFunction(name, false);
+    function.convention = CallingConvention::SYSV;
+    slotVRegs.assign(parentSlots.size(), -1);
+    int start = function.newVReg();
+    int end = function.newVReg();
+    Operand ctx = Operand::reg(function.newVReg());
+    function.params = {start, end, ctx.vreg};
+
+    for (size_t k = 0; k < node.captured.size(); k++) {
+        emitInstr(IROp::LOAD, Operand::reg(slotVReg(node.captured[k])), ctx,
+                  Operand::immediate(static_cast<long long>(k)));
+    }
+    for (int slot : node.reductionSlots) {
+        emitInstr(IROp::MOV, Operand::reg(slotVReg(slot)), Operand::immediate(0));
+    }
+    slotVRegs[node.binding.slot] = start;
+    markVariable(start);
+
+    std::string loopLabel = generateLabel("Linicio");
+    std::string endLabel = generateLabel("Lfim");
+    Operand index = Operand::reg(start);
+    emitJump(IROp::LABEL, loopLabel);
+    IRInstr test{IROp::JCC, Operand(), index, Operand::reg(end)};
+    test.cond = ComparisonOperator::GREATER_EQUAL;
+    test.label = endLabel;
+    function.emit(std::move(test));
+    node.body->accept(*this);
+    emitInstr(IROp::ADD, index, index, Operand::immediate(1));
+    emitJump(IROp::JMP, loopLabel);
+    emitJump(IROp::LABEL, endLabel);
+
+    size_t captured = node.captured.size();
+    for (size_t k = 0; k < node.reductionSlots.size(); k++) {
+        IRInstr add{IROp::ATOMICADD, Operand(), ctx, Operand::immediate(static_cast<long long>(captured + k))};
+        add.args.push_back(Operand::reg(slotVReg(node.reductionSlots[k])));
+        function.emit(std::move(add));
+    }
+    emitInstr(IROp::RET, Operand(), Operand::immediate(0));
+    emitFunction();
+
+    function = std::move(parent);
+    slotVRegs = std::move(parentSlots);
+    variableVRegs = std::move(parentVariables);
+    expInfo = std::move(parentInfo);
+    coldCode = std::move(parentCold);
+    inlineStack = std::move(parentInline);
+    labelCounter = parentLabels;
+    loweringStart = ThreadSample::now(timing);
+}
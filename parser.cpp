@@ -1,5 +1,7 @@
 #include "parser.h"
 #include "ast.h"
+#include <charconv>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -82,6 +84,9 @@ std::unique_ptr<Statement> Parser::declaration() {
     if (match(TokenType::FUN)) {
         return functionDeclaration();
     }
+    if (match(TokenType::EXTERN)) {
+        return externDeclaration();
+    }
     return statement();
 }
 
@@ -93,6 +98,13 @@ std::unique_ptr<Statement> Parser::varDeclaration() {
     Token nameToken = proximo_token();
     std::string name = nameToken.lexeme;
     
+    if (match(TokenType::LBRACKET)) {
+        auto size = expression();
+        verificaProxToken(TokenType::RBRACKET);
+        verificaProxToken(TokenType::SEMICOLON);
+        return std::make_unique<ArrayDeclaration>(name, std::move(size));
+    }
+    
     std::unique_ptr<Exp> initializer = nullptr;
     if (match(TokenType::ASSIGN)) {
         initializer = expression();
@@ -110,6 +122,26 @@ std::unique_ptr<Statement> Parser::functionDeclaration() {
     Token nameToken = proximo_token();
     std::string name = nameToken.lexeme;
     
+    std::vector<Parameter> parameters = parameterList();
+    auto body = blockStatement();
+    
+    return std::make_unique<FunctionDeclaration>(name, std::move(parameters), std::move(body));
+}
+
+std::unique_ptr<Statement> Parser::externDeclaration() {
+    verificaProxToken(TokenType::FUN);
+    if (!check(TokenType::IDENTIFIER)) {
+        throw std::runtime_error("Erro de sintaxe: esperava nome da funcao apos 'extern fun'.");
+    }
+    
+    Token nameToken = proximo_token();
+    std::vector<Parameter> parameters = parameterList();
+    verificaProxToken(TokenType::SEMICOLON);
+    
+    return std::make_unique<ExternDeclaration>(nameToken.lexeme, std::move(parameters));
+}
+
+std::vector<Parameter> Parser::parameterList() {
     verificaProxToken(TokenType::LPAREN);
     
     std::vector<Parameter> parameters;
@@ -124,9 +156,7 @@ std::unique_ptr<Statement> Parser::functionDeclaration() {
     }
     
     verificaProxToken(TokenType::RPAREN);
-    auto body = blockStatement();
-    
-    return std::make_unique<FunctionDeclaration>(name, std::move(parameters), std::move(body));
+    return parameters;
 }
 
 std::unique_ptr<Statement> Parser::mainFunction() {
@@ -161,6 +191,14 @@ std::unique_ptr<Statement> Parser::statement() {
         return whileStatement();
     }
     
+    if (match(TokenType::PARFOR)) {
+        return parallelForStatement();
+    }
+    
+    if (match(TokenType::MATCH)) {
+        return matchStatement();
+    }
+    
     if (match(TokenType::RETURN)) {
         return returnStatement();
     }
@@ -199,6 +237,100 @@ std::unique_ptr<Statement> Parser::whileStatement() {
     return std::make_unique<WhileStatement>(std::move(condition), std::move(body));
 }
 
+// parfor (i = inicio; i < fim) reduce (a, b) { ... }, com o reduce opcional.
+std::unique_ptr<Statement> Parser::parallelForStatement() {
+    verificaProxToken(TokenType::LPAREN);
+    if (!check(TokenType::IDENTIFIER)) {
+        throw std::runtime_error("Erro de sintaxe: esperava o indice do parfor.");
+    }
+    std::string index = proximo_token().lexeme;
+    verificaProxToken(TokenType::ASSIGN);
+    auto start = expression();
+    verificaProxToken(TokenType::SEMICOLON);
+    if (!check(TokenType::IDENTIFIER) || peek().lexeme != index) {
+        throw std::runtime_error("Erro de sintaxe: a condicao do parfor deve ser '" + index + " < fim'.");
+    }
+    proximo_token();
+    verificaProxToken(TokenType::LESS);
+    auto end = expression();
+    verificaProxToken(TokenType::RPAREN);
+
+    std::vector<std::string> reductions;
+    if (match(TokenType::REDUCE)) {
+        verificaProxToken(TokenType::LPAREN);
+        do {
+            if (!check(TokenType::IDENTIFIER)) {
+                throw std::runtime_error("Erro de sintaxe: esperava nome de variavel no reduce.");
+            }
+            reductions.push_back(proximo_token().lexeme);
+        } while (match(TokenType::COMMA));
+        verificaProxToken(TokenType::RPAREN);
+    }
+
+    auto body = blockStatement();
+    return std::make_unique<ParallelForStatement>(index, std::move(start), std::move(end), std::move(reductions),
+                                                  std::move(body));
+}
+
+// match (x) { 1 => { ... } 2, 3 => { ... } _ => { ... } }, com o _
+// opcional e sempre por ultimo.
+std::unique_ptr<Statement> Parser::matchStatement() {
+    verificaProxToken(TokenType::LPAREN);
+    auto subject = expression();
+    verificaProxToken(TokenType::RPAREN);
+    verificaProxToken(TokenType::LBRACE);
+
+    std::vector<MatchArm> arms;
+    std::unique_ptr<BlockStatement> otherwise;
+    while (!check(TokenType::RBRACE) && !isAtEnd()) {
+        if (otherwise) {
+            throw std::runtime_error("Erro de sintaxe: o braco '_' deve ser o ultimo do match.");
+        }
+        if (check(TokenType::IDENTIFIER) && peek().lexeme == "_") {
+            proximo_token();
+            verificaProxToken(TokenType::ARROW);
+            otherwise = blockStatement();
+            continue;
+        }
+        MatchArm arm;
+        do {
+            arm.values.push_back(matchValue());
+        } while (match(TokenType::COMMA));
+        verificaProxToken(TokenType::ARROW);
+        arm.body = blockStatement();
+        arms.push_back(std::move(arm));
+    }
+    verificaProxToken(TokenType::RBRACE);
+
+    if (arms.empty() && !otherwise) {
+        throw std::runtime_error("Erro de sintaxe: match sem bracos.");
+    }
+    return std::make_unique<MatchStatement>(std::move(subject), std::move(arms), std::move(otherwise));
+}
+
+// Valor de um braco: um numero, com '-' opcional.
+int Parser::matchValue() {
+    bool negative = match(TokenType::MINUS);
+    if (!match(TokenType::NUMBER)) {
+        throw std::runtime_error("Erro de sintaxe: esperava um numero ou '_' no braco do match.");
+    }
+    return intLiteral(previous(), negative);
+}
+
+// Valor de um literal, ja com o sinal; fora do intervalo de int e erro de
+// sintaxe com a linha, e nao uma excecao do std::stoi.
+int Parser::intLiteral(const Token& token, bool negative) {
+    const char* end = token.lexeme.data() + token.lexeme.size();
+    long long value = 0;
+    auto parsed = std::from_chars(token.lexeme.data(), end, value);
+    if (negative) value = -value;
+    if (parsed.ec != std::errc() || parsed.ptr != end || value < INT32_MIN || value > INT32_MAX) {
+        throw std::runtime_error("Erro de sintaxe: numero " + std::string(negative ? "-" : "") + token.lexeme +
+                                 " fora do intervalo de int na linha " + std::to_string(token.line) + ".");
+    }
+    return static_cast<int>(value);
+}
+
 std::unique_ptr<Statement> Parser::returnStatement() {
     auto expr = expression();
     verificaProxToken(TokenType::SEMICOLON);
@@ -213,9 +345,13 @@ std::unique_ptr<Exp> Parser::assignmentExpression() {
     std::unique_ptr<Exp> expr = orExpression();
     
     if (match(TokenType::ASSIGN)) {
+        if (auto element = dynamic_cast<ArrayAccess*>(expr.get())) {
+            std::unique_ptr<Exp> value = assignmentExpression();
+            return std::make_unique<ArrayAssignment>(element->name, std::move(element->index), std::move(value));
+        }
         Variable* var = dynamic_cast<Variable*>(expr.get());
         if (!var) {
-            throw std::runtime_error("Erro de sintaxe: lado esquerdo da atribuicao deve ser uma variavel.");
+            throw std::runtime_error("Erro de sintaxe: lado esquerdo da atribuicao deve ser uma variavel ou um elemento de vetor.");
         }
         std::string varName = var->name;
         expr.release();
@@ -343,8 +479,7 @@ std::unique_ptr<Exp> Parser::unary() {
 
 std::unique_ptr<Exp> Parser::primary() {
     if (match(TokenType::NUMBER)) {
-        Token token = previous();
-        int valor = std::stoi(token.lexeme);
+        int valor = intLiteral(previous(), false);
         return std::make_unique<Const>(valor);
     }
 
@@ -372,6 +507,12 @@ std::unique_ptr<Exp> Parser::primary() {
             return std::make_unique<FunctionCall>(token.lexeme, std::move(arguments));
         }
         
+        if (match(TokenType::LBRACKET)) {
+            std::unique_ptr<Exp> index = expression();
+            verificaProxToken(TokenType::RBRACKET);
+            return std::make_unique<ArrayAccess>(token.lexeme, std::move(index));
+        }
+        
         return std::make_unique<Variable>(token.lexeme);
     }
 
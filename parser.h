@@ -26,11 +26,17 @@ private:
     std::unique_ptr<Statement> declaration();
     std::unique_ptr<Statement> varDeclaration();
     std::unique_ptr<Statement> functionDeclaration();
+    std::unique_ptr<Statement> externDeclaration();
+    std::vector<Parameter> parameterList();
     std::unique_ptr<Statement> mainFunction();
     std::unique_ptr<BlockStatement> blockStatement();
     std::unique_ptr<Statement> statement();
     std::unique_ptr<Statement> ifStatement();
     std::unique_ptr<Statement> whileStatement();
+    std::unique_ptr<Statement> parallelForStatement();
+    std::unique_ptr<Statement> matchStatement();
+    int matchValue();
+    int intLiteral(const Token& token, bool negative);
     std::unique_ptr<Statement> returnStatement();
     std::unique_ptr<Exp> expression();
     std::unique_ptr<Exp> assignmentExpression();
@@ -0,0 +1,205 @@
+#include "profile.h"
+#include <fstream>
+#include <stdexcept>
+
+static uint64_t readQuad(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | bytes[i];
+    return value;
+}
+
+Profile::Profile(const Program& program) {
+    std::unordered_map<std::string, bool> externs;
+    for (const auto& decl : program.globalDeclarations) {
+        if (auto ext = dynamic_cast<const ExternDeclaration*>(decl.get())) externs[ext->name] = true;
+    }
+    for (const auto& decl : program.globalDeclarations) {
+        walk(*decl, externs);
+    }
+    if (program.mainFunction) {
+        walk(*program.mainFunction, externs);
+    }
+    mix(std::to_string(counterCount));
+}
+
+// FNV-1a sobre o tipo e os nomes de cada no visitado.
+void Profile::mix(const std::string& text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= 0xff;
+    hash *= 0x100000001b3ULL;
+}
+
+void Profile::probe(const void* node, int slots) {
+    first[node] = counterCount;
+    counterCount += slots;
+}
+
+void Profile::walk(const Statement& stmt, const std::unordered_map<std::string, bool>& externs) {
+    if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+        mix("bloco");
+        for (const auto& s : block->statements) walk(*s, externs);
+    } else if (auto main = dynamic_cast<const MainFunction*>(&stmt)) {
+        mix("main");
+        probe(main, 1);
+        walk(*main->body, externs);
+    } else if (auto fn = dynamic_cast<const FunctionDeclaration*>(&stmt)) {
+        mix("fun " + fn->name);
+        probe(fn, 1);
+        walk(*fn->body, externs);
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        mix("if");
+        probe(ifStmt, 2);
+        walk(*ifStmt->condition, externs);
+        walk(*ifStmt->thenBranch, externs);
+        if (ifStmt->elseBranch) walk(*ifStmt->elseBranch, externs);
+    } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+        mix("while");
+        probe(loop, 2);
+        walk(*loop->condition, externs);
+        walk(*loop->body, externs);
+    } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+        mix("match");
+        walk(*match->subject, externs);
+        for (const auto& arm : match->arms) {
+            for (int value : arm.values) mix("case " + std::to_string(value));
+            walk(*arm.body, externs);
+        }
+        if (match->otherwise) {
+            mix("case _");
+            walk(*match->otherwise, externs);
+        }
+    } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+        mix("parfor " + parfor->index);
+        for (const auto& name : parfor->reductions) mix("reduce " + name);
+        walk(*parfor->start, externs);
+        walk(*parfor->end, externs);
+        walk(*parfor->body, externs);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        walk(*exprStmt->expression, externs);
+    } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+        mix("let " + var->identifier);
+        if (var->initializer) walk(*var->initializer, externs);
+    } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+        mix("let " + array->identifier + "[]");
+        walk(*array->size, externs);
+    } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+        mix("return");
+        walk(*ret->expression, externs);
+    }
+}
+
+void Profile::walk(const Exp& exp, const std::unordered_map<std::string, bool>& externs) {
+    if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+        walk(*bin->opEsq, externs);
+        walk(*bin->opDir, externs);
+    } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+        walk(*cmp->left, externs);
+        walk(*cmp->right, externs);
+    } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+        walk(*logical->left, externs);
+        walk(*logical->right, externs);
+    } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+        walk(*unary->operand, externs);
+    } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+        walk(*assign->value, externs);
+    } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+        walk(*element->index, externs);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+        walk(*store->index, externs);
+        walk(*store->value, externs);
+    } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+        mix("call " + call->name);
+        if (!externs.count(call->name)) probe(call, 1);
+        for (const auto& arg : call->arguments) walk(*arg, externs);
+    }
+}
+
+void Profile::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Erro: Nao foi possivel abrir o perfil " + path);
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t expected = HEADER_SIZE + 8 * static_cast<size_t>(counterCount);
+    if (data.size() != expected || readQuad(data.data()) != MAGIC || readQuad(data.data() + 8) != hash ||
+        readQuad(data.data() + 16) != static_cast<uint64_t>(counterCount)) {
+        throw std::runtime_error("Erro: o perfil " + path + " nao corresponde a este programa.");
+    }
+    counts.resize(counterCount);
+    for (int i = 0; i < counterCount; i++) {
+        counts[i] = readQuad(data.data() + HEADER_SIZE + 8 * i);
+    }
+}
+
+int Profile::counter(const void* node, int slot) const {
+    auto it = first.find(node);
+    return it == first.end() ? -1 : it->second + slot;
+}
+
+uint64_t Profile::count(const void* node, int slot) const {
+    int index = counter(node, slot);
+    return index < 0 || !loaded() ? 0 : counts[index];
+}
+
+int treeSize(const Statement& stmt) {
+    int size = 1;
+    if (auto block = dynamic_cast<const BlockStatement*>(&stmt)) {
+        for (const auto& s : block->statements) size += treeSize(*s);
+    } else if (auto main = dynamic_cast<const MainFunction*>(&stmt)) {
+        size += treeSize(*main->body);
+    } else if (auto fn = dynamic_cast<const FunctionDeclaration*>(&stmt)) {
+        size += treeSize(*fn->body);
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        size += treeSize(*ifStmt->condition) + treeSize(*ifStmt->thenBranch);
+        if (ifStmt->elseBranch) size += treeSize(*ifStmt->elseBranch);
+    } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+        size += treeSize(*loop->condition) + treeSize(*loop->body);
+    } else if (auto match = dynamic_cast<const MatchStatement*>(&stmt)) {
+        size += treeSize(*match->subject);
+        for (const auto& arm : match->arms) size += treeSize(*arm.body);
+        if (match->otherwise) size += treeSize(*match->otherwise);
+    } else if (auto parfor = dynamic_cast<const ParallelForStatement*>(&stmt)) {
+        size += treeSize(*parfor->start) + treeSize(*parfor->end) + treeSize(*parfor->body);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
+        size += treeSize(*exprStmt->expression);
+    } else if (auto var = dynamic_cast<const VarDeclaration*>(&stmt)) {
+        if (var->initializer) size += treeSize(*var->initializer);
+    } else if (auto array = dynamic_cast<const ArrayDeclaration*>(&stmt)) {
+        size += treeSize(*array->size);
+    } else if (auto ret = dynamic_cast<const ReturnStatement*>(&stmt)) {
+        size += treeSize(*ret->expression);
+    }
+    return size;
+}
+
+int treeSize(const Program& program) {
+    int size = 1;
+    for (const auto& decl : program.globalDeclarations) size += treeSize(*decl);
+    if (program.mainFunction) size += treeSize(*program.mainFunction);
+    return size;
+}
+
+int treeSize(const Exp& exp) {
+    int size = 1;
+    if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+        size += treeSize(*bin->opEsq) + treeSize(*bin->opDir);
+    } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+        size += treeSize(*cmp->left) + treeSize(*cmp->right);
+    } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+        size += treeSize(*logical->left) + treeSize(*logical->right);
+    } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+        size += treeSize(*unary->operand);
+    } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+        size += treeSize(*assign->value);
+    } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+        size += treeSize(*element->index);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+        size += treeSize(*store->index) + treeSize(*store->value);
+    } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+        for (const auto& arg : call->arguments) size += treeSize(*arg);
+    }
+    return size;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Simbolos do programa instrumentado: o bloco com cabecalho e contadores
+// (.data) e a rotina que o grava no arquivo antes de sair.
+const char* const PROFILE_COUNTERS = "__perfil";
+const char* const PROFILE_WRITER = "__perfil_grava";
+
+// Contadores do perfil (--profile-generate / --profile-use). Uma passada
+// fixa pela arvore numera os pontos de medida; o programa instrumentado e a
+// compilacao seguinte refazem a mesma numeracao, e o arquivo guarda apenas
+// os contadores, precedidos de um cabecalho com a assinatura da arvore.
+//
+// Contadores por no:
+//   FunctionDeclaration, MainFunction: 0 entradas
+//   IfStatement: 0 ramo then, 1 ramo else (ou condicao falsa, sem else)
+//   WhileStatement: 0 entradas no laco, 1 iteracoes do corpo
+//   FunctionCall (nao extern): 0 chamadas
+class Profile {
+public:
+    // Cabecalho do arquivo: MAGIC, assinatura e quantidade de contadores,
+    // cada um em 8 bytes little-endian, seguidos dos contadores.
+    static const uint64_t MAGIC = 0x31304652455049ULL; // "IPERF01"
+    static const int HEADER_SIZE = 24;
+
+    Profile() = default;
+    explicit Profile(const Program& program);
+
+    // Le os contadores de path; falha se o arquivo nao vier deste programa.
+    void load(const std::string& path);
+
+    bool loaded() const { return !counts.empty(); }
+    int size() const { return counterCount; }
+    uint64_t signature() const { return hash; }
+
+    // Indice do contador slot do no, ou -1 se o no nao e medido.
+    int counter(const void* node, int slot = 0) const;
+    // Valor lido do arquivo; 0 sem perfil carregado.
+    uint64_t count(const void* node, int slot = 0) const;
+
+private:
+    std::unordered_map<const void*, int> first;
+    std::vector<uint64_t> counts;
+    int counterCount = 0;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    void mix(const std::string& text);
+    void probe(const void* node, int slots);
+    void walk(const Statement& stmt, const std::unordered_map<std::string, bool>& externs);
+    void walk(const Exp& exp, const std::unordered_map<std::string, bool>& externs);
+};
+
+// Decisoes tomadas com --profile-use, para o relatorio do driver.
+struct ProfileDecisions {
+    int inlinedCalls = 0;
+    int swappedBranches = 0;
+    int coldBlocks = 0;
+    int unrolledLoops = 0;
+
+    ProfileDecisions& operator+=(const ProfileDecisions& other) {
+        inlinedCalls += other.inlinedCalls;
+        swappedBranches += other.swappedBranches;
+        coldBlocks += other.coldBlocks;
+        unrolledLoops += other.unrolledLoops;
+        return *this;
+    }
+};
+
+// Quantidade de nos de uma subarvore; mede o custo de expandir uma funcao
+// ou replicar o corpo de um laco, e o tamanho do programa no relatorio de
+// --time-report.
+int treeSize(const Statement& stmt);
+int treeSize(const Exp& exp);
+int treeSize(const Program& program);
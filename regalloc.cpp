@@ -0,0 +1,267 @@
+#include "regalloc.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
+
+namespace {
+
+class BitSet {
+public:
+    explicit BitSet(int size = 0) : words((size + 63) / 64, 0) {}
+
+    void set(int i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(int i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+    bool test(int i) const { return (words[i / 64] >> (i % 64)) & 1; }
+
+    bool unite(const BitSet& other) {
+        bool changed = false;
+        for (size_t w = 0; w < words.size(); w++) {
+            uint64_t merged = words[w] | other.words[w];
+            if (merged != words[w]) {
+                words[w] = merged;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t w = 0; w < words.size(); w++) {
+            uint64_t bits = words[w];
+            while (bits) {
+                int bit = __builtin_ctzll(bits);
+                f(static_cast<int>(w * 64 + bit));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+struct BasicBlock {
+    int first;
+    int last;
+    std::vector<int> successors;
+    BitSet use;
+    BitSet def;
+    BitSet liveIn;
+    BitSet liveOut;
+};
+
+const Reg allocationOrder[] = {
+    Reg::RCX, Reg::RSI, Reg::RDI, Reg::R8, Reg::R9, Reg::R10, Reg::RDX, Reg::RAX,
+    Reg::RBX, Reg::R12, Reg::R13, Reg::R14, Reg::R15
+};
+
+}
+
+RegMask clobberedBy(const IRInstr& instr) {
+    switch (instr.op) {
+        case IROp::CALL:
+        case IROp::PRINT:
+        case IROp::FLUSH:
+        case IROp::EXIT:
+            return callerSavedMask();
+        case IROp::DIV:
+            return regBit(Reg::RAX) | regBit(Reg::RDX);
+        case IROp::ALLOCA:
+            return regBit(Reg::RAX) | regBit(Reg::RCX) | regBit(Reg::RDI);
+        case IROp::ATOMICADD:
+            return regBit(Reg::RAX);
+        default:
+            return 0;
+    }
+}
+
+LinearScanAllocator::LinearScanAllocator(const IRFunction& fn, bool spillAll)
+    : fn(fn), spillAll(spillAll) {}
+
+void LinearScanAllocator::buildIntervals() {
+    const auto& code = fn.code;
+    int n = static_cast<int>(code.size());
+    int numVRegs = fn.vregCount;
+
+    std::vector<BasicBlock> blocks;
+    std::map<std::string, int> labelBlock;
+    int start = 0;
+    for (int i = 0; i < n; i++) {
+        bool endsHere = i + 1 == n || isBranch(code[i]) || isTerminator(code[i]) ||
+                        code[i + 1].op == IROp::LABEL;
+        if (endsHere) {
+            blocks.push_back(BasicBlock{start, i, {}, BitSet(numVRegs), BitSet(numVRegs),
+                                        BitSet(numVRegs), BitSet(numVRegs)});
+            if (code[start].op == IROp::LABEL) {
+                labelBlock[code[start].label] = static_cast<int>(blocks.size()) - 1;
+            }
+            start = i + 1;
+        }
+    }
+
+    std::vector<int> uses;
+    for (size_t b = 0; b < blocks.size(); b++) {
+        auto& block = blocks[b];
+        const auto& last = code[block.last];
+        if (isBranch(last)) {
+            block.successors.push_back(labelBlock.at(last.label));
+        }
+        for (const auto& target : last.targets) {
+            int s = labelBlock.at(target);
+            if (std::find(block.successors.begin(), block.successors.end(), s) == block.successors.end()) {
+                block.successors.push_back(s);
+            }
+        }
+        if (!isTerminator(last) && b + 1 < blocks.size()) {
+            block.successors.push_back(static_cast<int>(b) + 1);
+        }
+
+        for (int i = block.first; i <= block.last; i++) {
+            uses.clear();
+            collectUses(code[i], uses);
+            for (int v : uses) {
+                if (!block.def.test(v)) block.use.set(v);
+            }
+            int d = definedVReg(code[i]);
+            if (d >= 0) block.def.set(d);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = static_cast<int>(blocks.size()) - 1; b >= 0; b--) {
+            auto& block = blocks[b];
+            for (int s : block.successors) {
+                block.liveOut.unite(blocks[s].liveIn);
+            }
+            BitSet in = block.use;
+            block.liveOut.forEach([&](int v) {
+                if (!block.def.test(v)) in.set(v);
+            });
+            changed |= block.liveIn.unite(in);
+        }
+    }
+
+    std::vector<int> from(numVRegs, INT_MAX);
+    std::vector<int> to(numVRegs, INT_MIN);
+    auto extend = [&](int v, int pos) {
+        from[v] = std::min(from[v], pos);
+        to[v] = std::max(to[v], pos);
+    };
+
+    for (int p : fn.params) {
+        extend(p, -1);
+    }
+    for (const auto& block : blocks) {
+        block.liveIn.forEach([&](int v) { extend(v, 2 * block.first); });
+        block.liveOut.forEach([&](int v) { extend(v, 2 * block.last + 1); });
+        for (int i = block.first; i <= block.last; i++) {
+            uses.clear();
+            collectUses(code[i], uses);
+            for (int v : uses) extend(v, 2 * i);
+            int d = definedVReg(code[i]);
+            if (d >= 0) extend(d, 2 * i + 1);
+        }
+    }
+
+    std::vector<std::pair<int, RegMask>> clobbers;
+    for (int i = 0; i < n; i++) {
+        RegMask mask = clobberedBy(code[i]);
+        if (mask) clobbers.emplace_back(i, mask);
+    }
+
+    intervals.clear();
+    for (int v = 0; v < numVRegs; v++) {
+        if (from[v] == INT_MAX) continue;
+        LiveInterval interval{v, from[v], to[v], 0};
+        auto it = std::lower_bound(clobbers.begin(), clobbers.end(),
+                                   std::make_pair((interval.start + 1) / 2, RegMask(0)));
+        for (; it != clobbers.end() && 2 * it->first + 1 <= interval.end; ++it) {
+            if (interval.start <= 2 * it->first) interval.forbidden |= it->second;
+        }
+        intervals.push_back(interval);
+    }
+
+    std::sort(intervals.begin(), intervals.end(), [](const LiveInterval& a, const LiveInterval& b) {
+        return a.start != b.start ? a.start < b.start : a.vreg < b.vreg;
+    });
+}
+
+void LinearScanAllocator::spill(Allocation& result, const LiveInterval& interval) {
+    int vreg = interval.vreg;
+    result.reg[vreg] = -1;
+    auto param = std::find(fn.params.begin(), fn.params.end(), vreg);
+    if (param != fn.params.end() && static_cast<size_t>(param - fn.params.begin()) >= fn.registerParams()) {
+        return;
+    }
+    int slot;
+    if (!slotEnds.empty() && slotEnds.top().first < interval.start) {
+        slot = slotEnds.top().second;
+        slotEnds.pop();
+    } else {
+        slot = result.slotCount++;
+    }
+    slotEnds.emplace(interval.end, slot);
+    result.slot[vreg] = slot;
+}
+
+Allocation LinearScanAllocator::run() {
+    buildIntervals();
+
+    Allocation result;
+    result.reg.assign(fn.vregCount, -1);
+    result.slot.assign(fn.vregCount, -1);
+    slotEnds = decltype(slotEnds)();
+
+    std::vector<const LiveInterval*> active;
+    RegMask freeRegs = allocatableMask();
+
+    for (const auto& current : intervals) {
+        if (spillAll) {
+            spill(result, current);
+            continue;
+        }
+
+        auto expired = std::remove_if(active.begin(), active.end(), [&](const LiveInterval* a) {
+            if (a->end >= current.start) return false;
+            freeRegs |= regBit(static_cast<Reg>(result.reg[a->vreg]));
+            return true;
+        });
+        active.erase(expired, active.end());
+
+        RegMask candidates = freeRegs & ~current.forbidden;
+        int chosen = -1;
+        for (Reg r : allocationOrder) {
+            if (candidates & regBit(r)) {
+                chosen = static_cast<int>(r);
+                break;
+            }
+        }
+
+        if (chosen < 0) {
+            const LiveInterval* victim = nullptr;
+            for (const LiveInterval* a : active) {
+                if (current.forbidden & regBit(static_cast<Reg>(result.reg[a->vreg]))) continue;
+                if (!victim || a->end > victim->end) victim = a;
+            }
+            if (!victim || victim->end <= current.end) {
+                spill(result, current);
+                continue;
+            }
+            chosen = result.reg[victim->vreg];
+            spill(result, *victim);
+            active.erase(std::find(active.begin(), active.end(), victim));
+        } else {
+            freeRegs &= ~regBit(static_cast<Reg>(chosen));
+        }
+
+        result.reg[current.vreg] = chosen;
+        result.usedRegs |= regBit(static_cast<Reg>(chosen));
+        active.push_back(&current);
+    }
+
+    return result;
+}
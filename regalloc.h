@@ -0,0 +1,49 @@
+#pragma once
+#include "ir.h"
+#include "x86.h"
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+struct LiveInterval {
+    int vreg;
+    int start;
+    int end;
+    RegMask forbidden = 0;
+};
+
+struct Allocation {
+    std::vector<int> reg;   // registrador fisico de cada vreg, ou -1 se vive na pilha
+    std::vector<int> slot;  // slot de spill de cada vreg, ou -1
+    int slotCount = 0;
+    RegMask usedRegs = 0;
+
+    bool inRegister(int vreg) const { return reg[vreg] >= 0; }
+};
+
+// Alocador linear scan (Poletto & Sarkar). Cada instrucao i usa seus
+// operandos na posicao 2i e define o destino em 2i+1, de modo que um
+// temporario que morre em i pode ceder o registrador ao resultado de i.
+// Registradores destruidos por chamadas ou por idiv nao sao atribuidos a
+// intervalos que atravessam essas instrucoes. Um vreg na pilha ocupa o slot
+// durante o intervalo inteiro, e vregs com intervalos disjuntos dividem o
+// mesmo slot, o que encurta o quadro (tambem em -O0).
+class LinearScanAllocator {
+public:
+    LinearScanAllocator(const IRFunction& fn, bool spillAll);
+    Allocation run();
+
+private:
+    const IRFunction& fn;
+    bool spillAll;
+    std::vector<LiveInterval> intervals;
+    // (fim do intervalo que ocupa o slot, slot), o que vaga antes no topo
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>>
+        slotEnds;
+
+    void buildIntervals();
+    void spill(Allocation& result, const LiveInterval& interval);
+};
+
+RegMask clobberedBy(const IRInstr& instr);
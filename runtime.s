@@ -4,61 +4,648 @@
   #
   # funcoes de apoio para o codigo compilado
   #
+  .text
 
+  # converte rax para decimal direto no fim de buffer_saida, seguido de \n.
+  # Conta os digitos antes para escrever cada par na posicao final, do fim
+  # para o comeco, e divide por 100 multiplicando pelo reciproco (sem idiv)
 imprime_num:
-  xor %r9, %r9            # rcx indice, r9 contagem
-  mov $20, %rcx
-  movb $10, buffer(%rcx)  # \n no final da string
-  dec %rcx
-  inc %r9
+  mov buffer_usado, %rdi
+  cmp $65515, %rdi        # 65536 - 21: cabe o maior texto ("-" + 19 digitos + \n)
+  jbe espaco_L0
+  push %rax
+  call descarrega
+  pop %rax
+  xor %rdi, %rdi
 
-  mov $10, %r8
-  or %rax, %rax
-  jz printzero_L0
-  jl mark_neg
-  mov $0, %r10            # r10 flag p/ negativo
-  jmp loop_L0
+espaco_L0:
+  lea buffer_saida(%rdi), %rdi
+  test %rax, %rax
+  jns conta_L0
+  movb $45, (%rdi)
+  inc %rdi
+  neg %rax                # sem sinal daqui em diante: INT64_MIN vira 2^63
 
-mark_neg:
-  mov $1, %r10
-  neg %rax
+  # digitos: bits * 1233 / 4096 aproxima log10 por baixo; a comparacao com
+  # a potencia de 10 corrige. Numeros de um digito nao passam por aqui
+conta_L0:
+  mov $1, %rcx
+  cmp $10, %rax
+  jb escreve_L0
+  bsr %rax, %rcx
+  inc %rcx
+  imul $1233, %rcx, %rcx
+  shr $12, %rcx
+  cmp potencias(,%rcx,8), %rax
+  jb escreve_L0
+  inc %rcx
 
-loop_L0:
-  cqo
-  idiv %r8  
-  addb $0x30, %dl
-  movb %dl, buffer(%rcx)
-  dec %rcx
-  inc %r9
-  or %rax, %rax
-  jnz loop_L0
-  test %r10, %r10
-  jz print_L0
-  movb $45, buffer(%rcx)
-  dec %rcx
-  jmp print_L0
+escreve_L0:
+  lea (%rdi, %rcx), %r8   # r8: fim dos digitos
+  movb $10, (%r8)
+  lea 1(%r8), %r9
+  sub $buffer_saida, %r9
+  mov %r9, buffer_usado
+  cmp $100, %rax
+  jb ultimos_L0
+  mov $0x28f5c28f5c28f5c3, %r11
 
-printzero_L0:
-  movb $0x30, buffer(%rcx)
-  dec %rcx
-  inc %r9
+pares_L0:
+  mov %rax, %r10
+  shr $2, %rax
+  mul %r11
+  shr $2, %rdx            # rdx = rax / 100
+  imul $100, %rdx, %rax
+  sub %rax, %r10          # r10 = rax % 100
+  movb digitos(,%r10,2), %al
+  movb %al, -2(%r8)
+  movb digitos+1(,%r10,2), %al
+  movb %al, -1(%r8)
+  sub $2, %r8
+  mov %rdx, %rax
+  cmp $100, %rax
+  jae pares_L0
+
+ultimos_L0:
+  cmp $10, %rax
+  jb um_L0
+  movb digitos(,%rax,2), %dl
+  movb %dl, -2(%r8)
+  movb digitos+1(,%rax,2), %dl
+  movb %dl, -1(%r8)
+  ret
+
+um_L0:
+  addb $48, %al
+  movb %al, -1(%r8)
+  ret
+
+  # escreve o que estiver em buffer_saida; tambem e o builtin flush()
+descarrega:
+  mov $1, %r8             # stdout
 
-print_L0:
+  # o mesmo, no descritor r8
+descarrega_fd:
+  mov $buffer_saida, %rsi # dados
+  mov buffer_usado, %rdx  # tamanho
+
+descarrega_L0:
+  test %rdx, %rdx
+  jz descarrega_fim
   mov $1, %rax            # sys_write
-  mov $1, %rdi            # stdout
-  mov $buffer, %rsi       # dados
-  inc %rcx
-  add %rcx, %rsi
-  mov %r9, %rdx           # tamanho
+  mov %r8, %rdi
   syscall
+  test %rax, %rax
+  jle descarrega_fim
+  add %rax, %rsi
+  sub %rax, %rdx
+  jmp descarrega_L0
+
+descarrega_fim:
+  movq $0, buffer_usado
+  xor %rax, %rax
   ret
 
 sair:
-  mov $60, %rax     # sys_exit
+  call descarrega
+  mov tabela_instrumentacao, %rdi
+  test %rdi, %rdi
+  jz sair_L0
+  call imprime_instrumentacao
+
+sair_L0:
+  mov $231, %rax    # sys_exit_group: termina tambem as threads do parfor
   xor %rdi, %rdi    # codigo de saida (0)
   syscall
 
+  # acesso a vetor fora dos limites e tamanho de vetor fora de
+  # 1..134217728: descarrega a saida, escreve a mensagem em stderr e
+  # termina com codigo 1
+erro_indice:
+  mov $mensagem_indice, %rsi
+  mov $61, %rdx
+  jmp erro_vetor
+
+erro_tamanho:
+  mov $mensagem_tamanho, %rsi
+  mov $54, %rdx
+
+erro_vetor:
+  push %rsi
+  push %rdx
+  call descarrega
+  pop %rdx
+  pop %rsi
+  mov $1, %rax      # sys_write
+  mov $2, %rdi      # stderr
+  syscall
+  mov $231, %rax    # sys_exit_group
+  mov $1, %rdi
+  syscall
+
+  # parfor: paralelo(corpo, inicio, fim, ctx) chama corpo(a, b, ctx) para
+  # pedacos [a, b) que cobrem [inicio, fim), em ate 64 threads (uma por
+  # CPU permitida), e so volta quando todos terminarem. As threads sao
+  # criadas na primeira chamada (clone, pilha de 64 MiB) e depois esperam
+  # num futex pela proxima. Cada thread comeca com uma faixa do intervalo
+  # e tira dela pedacos de grao iteracoes; sem nada na sua, toma a metade
+  # de cima da faixa com mais iteracoes. Cada faixa tem 64 bytes (inicio,
+  # fim e trava), para as threads nao dividirem linhas de cache. Um parfor
+  # chamado enquanto outro roda (dentro do corpo) executa direto, na
+  # thread que o chamou.
+paralelo:
+  cmp %rsi, %rdx
+  jle paralelo_vazio
+  mov $1, %rax
+  xchg %rax, paralelo_ocupado
+  test %rax, %rax
+  jz paralelo_L0
+  mov %rdi, %r11          # ja ocupado: tudo nesta thread
+  mov %rsi, %rdi
+  mov %rdx, %rsi
+  mov %rcx, %rdx
+  jmp *%r11
+
+paralelo_vazio:
+  ret
+
+paralelo_L0:
+  push %rbx
+  push %r12
+  push %r13
+  push %r14
+  push %r15
+  mov %rdi, %r12          # r12: corpo
+  mov %rsi, %r13          # r13: inicio
+  mov %rdx, %r14          # r14: fim
+  mov %rcx, %r15          # r15: ctx
+  cmpq $0, paralelo_threads
+  jne paralelo_L1
+  call paralelo_inicia
+
+paralelo_L1:
+  mov paralelo_threads, %rbx
+  cmp $1, %rbx
+  je paralelo_sozinho
+  mov %r14, %rax
+  sub %r13, %rax          # iteracoes
+  mov %rbx, %rcx
+  shl $4, %rcx
+  xor %rdx, %rdx
+  div %rcx                # grao: iteracoes / (16 * threads), ao menos 1
+  test %rax, %rax
+  jnz paralelo_L2
+  mov $1, %rax
+
+paralelo_L2:
+  mov %rax, paralelo_grao
+  mov %r14, %rax
+  sub %r13, %rax
+  xor %rdx, %rdx
+  div %rbx                # rax: iteracoes por faixa; a ultima leva o resto
+  mov paralelo_base, %rdi
+  mov %r13, %rsi
+  mov %rbx, %rcx
+
+paralelo_L3:
+  mov %rsi, (%rdi)
+  add %rax, %rsi
+  cmp $1, %rcx
+  jne paralelo_L4
+  mov %r14, %rsi
+
+paralelo_L4:
+  mov %rsi, 8(%rdi)
+  movq $0, 16(%rdi)
+  add $64, %rdi
+  dec %rcx
+  jnz paralelo_L3
+  mov %r12, paralelo_corpo
+  mov %r15, paralelo_ctx
+  lea -1(%rbx), %rax
+  mov %rax, paralelo_pendentes
+  lock addq $1, paralelo_geracao
+  mov $202, %rax          # sys_futex
+  mov $paralelo_geracao, %rdi
+  mov $129, %rsi          # FUTEX_WAKE_PRIVATE
+  mov $2147483647, %rdx   # todas
+  syscall
+  xor %rdi, %rdi          # esta thread fica com a faixa 0
+  call paralelo_trabalha
+
+paralelo_espera:
+  mov paralelo_pendentes, %rdx
+  test %rdx, %rdx
+  jz paralelo_fim
+  mov $202, %rax          # sys_futex
+  mov $paralelo_pendentes, %rdi
+  mov $128, %rsi          # FUTEX_WAIT_PRIVATE, enquanto valer rdx
+  xor %r10, %r10
+  syscall
+  jmp paralelo_espera
+
+paralelo_sozinho:
+  mov %r13, %rdi
+  mov %r14, %rsi
+  mov %r15, %rdx
+  call *%r12
+
+paralelo_fim:
+  movq $0, paralelo_ocupado
+  pop %r15
+  pop %r14
+  pop %r13
+  pop %r12
+  pop %rbx
+  ret
+
+  # conta as CPUs permitidas (sched_getaffinity), ate 64, e cria uma
+  # thread para cada uma alem desta; paralelo_threads termina com as que
+  # foram criadas, mais esta. Tambem alinha as faixas em 64 bytes
+paralelo_inicia:
+  mov $paralelo_faixas+63, %rax
+  and $-64, %rax
+  mov %rax, paralelo_base
+  mov $204, %rax          # sys_sched_getaffinity
+  xor %rdi, %rdi
+  mov $128, %rsi
+  mov $paralelo_mascara, %rdx
+  syscall
+  movq $1, paralelo_threads
+  test %rax, %rax
+  jle paralelo_inicia_fim
+  xor %rcx, %rcx          # rcx: CPUs
+  xor %rsi, %rsi
+
+paralelo_conta_L0:
+  mov paralelo_mascara(%rsi), %rdx
+
+paralelo_conta_L1:
+  test %rdx, %rdx
+  jz paralelo_conta_L2
+  lea -1(%rdx), %rdi
+  and %rdi, %rdx
+  inc %rcx
+  jmp paralelo_conta_L1
+
+paralelo_conta_L2:
+  add $8, %rsi
+  cmp %rax, %rsi
+  jb paralelo_conta_L0
+  cmp $64, %rcx
+  jbe paralelo_conta_L3
+  mov $64, %rcx
+
+paralelo_conta_L3:
+  mov %rcx, paralelo_nucleos
+
+paralelo_cria_L0:
+  mov paralelo_threads, %rbx
+  cmp paralelo_nucleos, %rbx
+  jae paralelo_inicia_fim
+  mov $9, %rax            # sys_mmap
+  xor %rdi, %rdi
+  mov $67108864, %rsi     # 64 MiB
+  mov $3, %rdx            # PROT_READ|PROT_WRITE
+  mov $0x24022, %r10      # MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_STACK
+  mov $-1, %r8
+  xor %r9, %r9
+  syscall
+  cmp $-4096, %rax
+  ja paralelo_inicia_fim
+  lea 67108856(%rax), %rsi  # topo da pilha, com o numero da thread
+  mov %rbx, (%rsi)
+  mov $56, %rax           # sys_clone
+  mov $0x50f00, %rdi      # VM|FS|FILES|SIGHAND|THREAD|SYSVSEM
+  xor %rdx, %rdx
+  xor %r10, %r10
+  xor %r8, %r8
+  syscall
+  test %rax, %rax
+  jz paralelo_trabalhador
+  js paralelo_inicia_fim
+  incq paralelo_threads
+  jmp paralelo_cria_L0
+
+paralelo_inicia_fim:
+  ret
+
+  # thread criada por paralelo_inicia: espera a geracao mudar, trabalha e
+  # avisa quando for a ultima a terminar
+paralelo_trabalhador:
+  pop %rbx                # rbx: numero da thread
+  xor %r12, %r12          # r12: ultima geracao atendida
+
+paralelo_trabalhador_L0:
+  mov paralelo_geracao, %rax
+  cmp %r12, %rax
+  jne paralelo_trabalhador_L1
+  mov $202, %rax          # sys_futex
+  mov $paralelo_geracao, %rdi
+  mov $128, %rsi          # FUTEX_WAIT_PRIVATE
+  mov %r12, %rdx
+  xor %r10, %r10
+  syscall
+  jmp paralelo_trabalhador_L0
+
+paralelo_trabalhador_L1:
+  mov %rax, %r12
+  mov %rbx, %rdi
+  call paralelo_trabalha
+  lock addq $-1, paralelo_pendentes
+  jnz paralelo_trabalhador_L0
+  mov $202, %rax          # sys_futex
+  mov $paralelo_pendentes, %rdi
+  mov $129, %rsi          # FUTEX_WAKE_PRIVATE
+  mov $1, %rdx
+  syscall
+  jmp paralelo_trabalhador_L0
+
+  # roda pedacos da faixa rdi e depois os roubados das outras
+paralelo_trabalha:
+  push %rbx
+  push %r12
+  push %r13
+  mov %rdi, %rbx
+  shl $6, %rbx
+  add paralelo_base, %rbx  # rbx: faixa propria
+
+paralelo_trabalha_L0:
+  mov %rbx, %rdi
+  call paralelo_trava
+  mov (%rbx), %r12        # r12: inicio do pedaco
+  mov 8(%rbx), %rsi
+  cmp %rsi, %r12
+  jge paralelo_rouba
+  mov %r12, %r13
+  add paralelo_grao, %r13
+  cmp %rsi, %r13
+  jle paralelo_trabalha_L1
+  mov %rsi, %r13          # r13: fim do pedaco
+
+paralelo_trabalha_L1:
+  mov %r13, (%rbx)
+  movq $0, 16(%rbx)
+  mov %r12, %rdi
+  mov %r13, %rsi
+  mov paralelo_ctx, %rdx
+  mov paralelo_corpo, %rax
+  call *%rax
+  jmp paralelo_trabalha_L0
+
+paralelo_rouba:
+  movq $0, 16(%rbx)
+  xor %rcx, %rcx          # rcx: faixa com mais iteracoes
+  xor %rdx, %rdx          # rdx: quantas
+  mov paralelo_base, %rdi
+  mov paralelo_threads, %r8
+  shl $6, %r8
+  add %rdi, %r8
+
+paralelo_rouba_L0:
+  mov 8(%rdi), %rax
+  sub (%rdi), %rax
+  cmp %rdx, %rax
+  jle paralelo_rouba_L1
+  mov %rax, %rdx
+  mov %rdi, %rcx
+
+paralelo_rouba_L1:
+  add $64, %rdi
+  cmp %r8, %rdi
+  jb paralelo_rouba_L0
+  test %rdx, %rdx
+  jle paralelo_trabalha_fim
+  mov %rcx, %rdi
+  mov %rcx, %r12
+  call paralelo_trava
+  mov (%r12), %rax
+  mov 8(%r12), %rsi
+  mov %rsi, %rdx
+  sub %rax, %rdx
+  jle paralelo_rouba_L2   # esvaziou enquanto procurava
+  shr $1, %rdx
+  add %rdx, %rax          # a vitima fica com [inicio, meio)
+  mov %rax, 8(%r12)
+  movq $0, 16(%r12)
+  mov %rbx, %rdi
+  call paralelo_trava
+  mov %rax, (%rbx)
+  mov %rsi, 8(%rbx)
+  movq $0, 16(%rbx)
+  jmp paralelo_trabalha_L0
+
+paralelo_rouba_L2:
+  movq $0, 16(%r12)
+  jmp paralelo_rouba
+
+paralelo_trabalha_fim:
+  pop %r13
+  pop %r12
+  pop %rbx
+  ret
+
+  # trava da faixa rdi (xchg); so muda r9
+paralelo_trava:
+  mov $1, %r9
+  xchg %r9, 16(%rdi)
+  test %r9, %r9
+  jz paralelo_trava_fim
+
+paralelo_trava_L0:
+  pause
+  cmpq $0, 16(%rdi)
+  jne paralelo_trava_L0
+  jmp paralelo_trava
+
+paralelo_trava_fim:
+  ret
+
+  # Perfil do --instrument em stderr, da funcao com mais ciclos exclusivos
+  # para a com menos; rdi aponta a tabela gerada pelo compilador (.quad
+  # funcoes, contadores e o endereco de cada nome). Cada registro dos
+  # contadores tem 32 bytes: entradas, ciclos inclusivos, ciclos exclusivos
+  # e chamadas em andamento, campo que aqui marca com -1 as linhas ja
+  # impressas. O texto e montado em buffer_saida, ja descarregado. Chamado
+  # so por sair, entao nao preserva registradores.
+imprime_instrumentacao:
+  mov %rdi, %rbx
+  mov (%rbx), %r13        # r13: funcoes
+  mov 8(%rbx), %r12       # r12: contadores
+  mov $1, %r14            # r14: total dos exclusivos (1 evita dividir por 0)
+  xor %rcx, %rcx
+
+total_L0:
+  cmp %r13, %rcx
+  jae total_fim
+  mov %rcx, %rax
+  shl $5, %rax
+  add 16(%r12, %rax), %r14
+  inc %rcx
+  jmp total_L0
+
+total_fim:
+  mov $cabecalho_instrumentacao, %rsi
+  mov $200, %rcx
+  call copia_texto
+
+linha_L0:
+  cmpq $65024, buffer_usado  # cabe mais uma linha com folga
+  jbe escolhe_L0
+  mov $2, %r8
+  call descarrega_fd
+
+escolhe_L0:
+  mov $-1, %r15           # r15: funcao da linha, ou -1
+  xor %rcx, %rcx
+
+escolhe_L1:
+  cmp %r13, %rcx
+  jae escolhe_fim
+  mov %rcx, %rax
+  shl $5, %rax
+  cmpq $-1, 24(%r12, %rax)
+  je escolhe_proxima
+  cmpq $0, (%r12, %rax)   # nunca chamada: fora da tabela
+  je escolhe_proxima
+  test %r15, %r15
+  js escolhe_esta
+  mov %r15, %rdx
+  shl $5, %rdx
+  mov 16(%r12, %rax), %r8
+  cmp 16(%r12, %rdx), %r8
+  jbe escolhe_proxima
+
+escolhe_esta:
+  mov %rcx, %r15
+
+escolhe_proxima:
+  inc %rcx
+  jmp escolhe_L1
+
+escolhe_fim:
+  test %r15, %r15
+  js imprime_instrumentacao_fim
+  mov %r15, %rbp
+  shl $5, %rbp
+  add %r12, %rbp          # rbp: registro da linha
+  movq $-1, 24(%rbp)
+  mov buffer_usado, %rax
+  mov %rax, inicio_linha
+  mov 16(%rbx, %r15, 8), %rsi
+  mov $200, %rcx
+  call copia_texto
+  mov $24, %rax
+  call coluna
+  mov (%rbp), %rax
+  call imprime_num
+  mov $40, %rax
+  call coluna
+  mov 8(%rbp), %rax
+  call imprime_num
+  mov $60, %rax
+  call coluna
+  mov 16(%rbp), %rax
+  call imprime_num
+  mov $80, %rax
+  call coluna
+  mov 16(%rbp), %rax
+  imul $100, %rax, %rax
+  cqo
+  idiv %r14
+  call imprime_num        # ultima coluna: termina a linha
+  jmp linha_L0
+
+imprime_instrumentacao_fim:
+  mov $2, %r8             # stderr
+  jmp descarrega_fd
+
+  # copia o texto em rsi, ate o byte 0 ou rcx bytes, para buffer_saida
+copia_texto:
+  mov buffer_usado, %rdi
+
+copia_L0:
+  test %rcx, %rcx
+  jz copia_fim
+  movzbq (%rsi), %rax
+  test %rax, %rax
+  jz copia_fim
+  movb %al, buffer_saida(%rdi)
+  inc %rsi
+  inc %rdi
+  dec %rcx
+  jmp copia_L0
+
+copia_fim:
+  mov %rdi, buffer_usado
+  ret
+
+  # troca o \n deixado por imprime_num (se houver) por espacos ate a
+  # coluna rax da linha, com ao menos um espaco
+coluna:
+  mov buffer_usado, %rdi
+  dec %rdi
+  cmpb $10, buffer_saida(%rdi)
+  je coluna_L0
+  inc %rdi
+
+coluna_L0:
+  add inicio_linha, %rax
+  cmp %rax, %rdi
+  jb coluna_L1
+  lea 1(%rdi), %rax
+
+coluna_L1:
+  movb $32, buffer_saida(%rdi)
+  inc %rdi
+  cmp %rax, %rdi
+  jb coluna_L1
+  mov %rdi, buffer_usado
+  ret
+
+
+  .section .rodata
+mensagem_indice:
+  .ascii "Erro em tempo de execucao: indice fora dos limites do vetor.\n"
+mensagem_tamanho:
+  .ascii "Erro em tempo de execucao: tamanho de vetor invalido.\n"
+
+cabecalho_instrumentacao:
+  .ascii "funcao                  entradas        ciclos inclusivos   ciclos exclusivos   %\n\0"
+
+  # pares "00" a "99"
+digitos:
+  .ascii "0001020304050607080910111213141516171819"
+  .ascii "2021222324252627282930313233343536373839"
+  .ascii "4041424344454647484950515253545556575859"
+  .ascii "6061626364656667686970717273747576777879"
+  .ascii "8081828384858687888990919293949596979899"
+
+  # 10^0 a 10^19
+potencias:
+  .quad 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000
+  .quad 100000000, 1000000000, 10000000000, 100000000000
+  .quad 1000000000000, 10000000000000, 100000000000000
+  .quad 1000000000000000, 10000000000000000, 100000000000000000
+  .quad 1000000000000000000, 10000000000000000000
+
 
   .section .bss
-  .lcomm buffer, 21
+  .lcomm buffer_usado, 8
+  .lcomm buffer_saida, 65536
+  .lcomm tabela_instrumentacao, 8
+  .lcomm inicio_linha, 8
+  .lcomm paralelo_ocupado, 8
+  .lcomm paralelo_threads, 8
+  .lcomm paralelo_nucleos, 8
+  .lcomm paralelo_geracao, 8
+  .lcomm paralelo_pendentes, 8
+  .lcomm paralelo_corpo, 8
+  .lcomm paralelo_ctx, 8
+  .lcomm paralelo_grao, 8
+  .lcomm paralelo_mascara, 128
+  .lcomm paralelo_base, 8           # paralelo_faixas alinhado em 64
+  .lcomm paralelo_faixas, 4160
+
 
+  .section .note.GNU-stack, "", @progbits
@@ -0,0 +1,201 @@
+#include "server.h"
+#include "compiler.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const size_t MAX_SOURCE = 64 << 20;
+const size_t ARENA_RESERVE = 1 << 20;
+
+// Memoria de cada thread, reservada na partida e reaproveitada de um
+// pedido para o outro: bytes recebidos e saida gerada.
+struct Arena {
+    std::string input;
+    std::string output;
+};
+
+// Leitura com buffer de um socket: linhas do cabecalho e depois o fonte.
+class Reader {
+public:
+    Reader(int fd, std::string& buffer) : fd(fd), buffer(buffer) { buffer.clear(); }
+
+    bool line(std::string& text) {
+        for (;;) {
+            size_t end = buffer.find('\n', pos);
+            if (end != std::string::npos) {
+                text.assign(buffer, pos, end - pos);
+                pos = end + 1;
+                return true;
+            }
+            if (buffer.size() - pos > 4096 || !fill()) return false;
+        }
+    }
+
+    bool bytes(size_t count, std::string& out) {
+        while (buffer.size() - pos < count) {
+            if (!fill()) return false;
+        }
+        out.assign(buffer, pos, count);
+        pos += count;
+        return true;
+    }
+
+private:
+    int fd;
+    std::string& buffer;
+    size_t pos = 0;
+
+    bool fill() {
+        char chunk[65536];
+        for (;;) {
+            ssize_t got = ::read(fd, chunk, sizeof chunk);
+            if (got > 0) {
+                buffer.append(chunk, static_cast<size_t>(got));
+                return true;
+            }
+            if (got < 0 && errno == EINTR) continue;
+            return false;
+        }
+    }
+};
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+void reply(int fd, char kind, const std::string& payload) {
+    std::string header = std::string(1, kind) + " " + std::to_string(payload.size()) + "\n";
+    if (sendAll(fd, header.data(), header.size())) sendAll(fd, payload.data(), payload.size());
+}
+
+size_t parseCount(const std::string& text, size_t limit) {
+    if (text.empty() || text.size() > 10 || text.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::runtime_error("Erro: pedido malformado.");
+    }
+    size_t value = std::stoul(text);
+    if (value > limit) throw std::runtime_error("Erro: pedido grande demais.");
+    return value;
+}
+
+void serve(int fd, const CompilerOptions& defaults, int threads, Arena& arena) {
+    Reader reader(fd, arena.input);
+    std::string line, source;
+    try {
+        if (!reader.line(line) || line != "CI1" || !reader.line(line)) {
+            throw std::runtime_error("Erro: pedido malformado.");
+        }
+        CompilerOptions options = defaults;
+        options.jobs = 1;
+        size_t count = parseCount(line, 64);
+        for (size_t i = 0; i < count; i++) {
+            if (!reader.line(line) || !parseOption(line, options)) {
+                throw std::runtime_error("Erro: opcao invalida no pedido: " + line);
+            }
+        }
+        if (options.jit || options.interpret || !options.profileGenerate.empty() || !options.profileUse.empty() ||
+            !options.timeReport.empty()) {
+            throw std::runtime_error("Erro: o servidor gera apenas assembly ou objeto.");
+        }
+        // O diretorio do cache e o do servidor: um pedido nao escolhe onde
+        // o processo grava. -jN fica entre 1 e as threads do servidor.
+        if (options.cacheDir != defaults.cacheDir) {
+            throw std::runtime_error("Erro: o servidor usa o proprio --cache; tire --cache do pedido.");
+        }
+        options.jobs = options.jobs == 0 ? threads : std::min(options.jobs, threads);
+        if (!reader.line(line) || !reader.bytes(parseCount(line, MAX_SOURCE), source)) {
+            throw std::runtime_error("Erro: pedido malformado.");
+        }
+
+        arena.output.clear();
+        MemorySink sink(arena.output);
+        CompileResult result = compile(source, options, sink);
+        if (!result.ok) throw std::runtime_error(result.error);
+        reply(fd, options.emitObject ? 'o' : 's', arena.output);
+    } catch (const std::exception& e) {
+        // qualquer falha responde so a este pedido; o servidor segue no ar
+        reply(fd, 'e', e.what());
+    }
+}
+
+std::shared_ptr<const std::vector<MInstr>> loadRuntime(const std::vector<std::string>& includeDirs) {
+    for (const auto& dir : includeDirs) {
+        std::ifstream in(dir + "/runtime.s");
+        if (!in.is_open()) continue;
+        std::stringstream text;
+        text << in.rdbuf();
+        return std::make_shared<const std::vector<MInstr>>(parseAsm(text.str()));
+    }
+    return nullptr;
+}
+
+}
+
+int runServer(const std::string& socketPath, const CompilerOptions& serverOptions) {
+    CompilerOptions defaults = serverOptions;
+    try {
+        defaults.runtime = loadRuntime(defaults.includeDirs);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof address.sun_path) {
+        std::cerr << "Erro: caminho do socket longo demais: " << socketPath << std::endl;
+        return 1;
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::unlink(socketPath.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof address) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Erro: nao foi possivel abrir o socket " << socketPath << std::endl;
+        return 1;
+    }
+
+    int threads = workerCount(defaults.jobs);
+    std::vector<Arena> arenas(static_cast<size_t>(threads));
+    for (auto& arena : arenas) {
+        arena.input.reserve(ARENA_RESERVE);
+        arena.output.reserve(ARENA_RESERVE);
+    }
+    std::cout << "Servidor ouvindo em " << socketPath << " (" << threads << " threads)" << std::endl;
+
+    auto work = [&](size_t worker) {
+        for (;;) {
+            int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;
+            }
+            serve(client, defaults, threads, arenas[worker]);
+            ::close(client);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(work, static_cast<size_t>(t));
+    work(0);
+    for (auto& thread : pool) thread.join();
+    std::cerr << "Erro: o servidor parou de aceitar conexoes" << std::endl;
+    return 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "options.h"
+#include <string>
+#include <vector>
+
+// Socket usado por --server e pelo client/cliente.cpp quando nenhum e dado.
+const char* const DEFAULT_SOCKET = "compilador.sock";
+
+// Servidor de compilacao (--server[=socket]): um processo que fica no ar
+// com o runtime.s ja interpretado e memoria reservada por thread, e atende
+// pedidos num socket Unix local. Cada conexao leva um pedido:
+//
+//   CI1\n
+//   <quantidade de opcoes>\n
+//   <opcao>\n ...                  (as mesmas da linha de comando)
+//   <tamanho do fonte>\n
+//   <fonte>
+//
+// e recebe "<tipo> <tamanho>\n" seguido de tantos bytes: tipo s para o
+// assembly, o para o objeto ELF (--emit-obj) ou e para a mensagem de erro.
+// As opcoes do servidor valem como padrao de cada pedido; -jN no servidor
+// e a quantidade de threads que atendem conexoes. Um pedido nao muda o
+// --cache do servidor, e o -jN dele fica limitado a essas threads.
+int runServer(const std::string& socketPath, const CompilerOptions& defaults);
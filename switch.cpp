@@ -0,0 +1,332 @@
+#include "visitor.h"
+#include "ast.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
+
+// match: o valor e avaliado uma vez e os casos, em ordem, viram faixas de
+// valores consecutivos com o mesmo braco. As faixas sao agrupadas no menor
+// numero de grupos, cada um resolvido por um teste:
+//
+//   - faixa sozinha: uma ou duas comparacoes;
+//   - tabela: SWITCH com um rotulo por valor no .rodata, quando o grupo
+//     tem ao menos TABLE_MIN_VALUES valores e ocupa TABLE_MIN_DENSITY% do
+//     intervalo;
+//   - bits: ate tres bracos num intervalo de 64 valores, um BITTEST por
+//     braco contra uma mascara, quando isso economiza comparacoes (os
+//     limites sao os do LLVM).
+//
+// Os grupos sao escolhidos por uma busca binaria no valor, ate sobrarem
+// SEQUENTIAL_LEAVES, testados em sequencia. Com --run so ha faixas: o
+// bytecode nao tem tabelas.
+//
+// Cadeias if (x == 1 || x == 2) { } else { if (x == 3) { } else { } } sobre
+// a mesma variavel e com constantes tambem viram match (com -O1 e sem
+// perfil, que conta cada if): as condicoes nao tem efeitos e x nao muda
+// entre elas, entao testa-las juntas da o mesmo resultado.
+
+struct CodeGenerationVisitor::MatchCluster {
+    enum class Kind { RANGE, TABLE, BITS };
+
+    Kind kind = Kind::RANGE;
+    long long low = 0;
+    long long high = 0;
+    std::string target;                                   // RANGE
+    std::vector<std::string> table;                       // TABLE: rotulo de cada valor, vazio nos buracos
+    std::vector<std::pair<uint64_t, std::string>> bits;   // BITS: mascara e braco
+    long long base = 0;                                   // BITS: valor do bit 0 das mascaras
+};
+
+namespace {
+
+const long long TABLE_MIN_VALUES = 4;
+const long long TABLE_MIN_DENSITY = 40;
+const size_t SEQUENTIAL_LEAVES = 3;
+const size_t CHAIN_MIN_VALUES = 3;
+
+// Valores low..high que escolhem o braco target.
+struct CaseRange {
+    long long low;
+    long long high;
+    int target;
+};
+
+// Compensa trocar as comparacoes por mascaras: uma faixa de um valor custa
+// uma comparacao e as demais, duas.
+bool fitsBits(long long span, size_t targets, int comparisons) {
+    if (span > 64) return false;
+    return (targets == 1 && comparisons >= 3) || (targets == 2 && comparisons >= 5) ||
+           (targets == 3 && comparisons >= 6);
+}
+
+// Menor numero de grupos que cobre as faixas; a escolha em cada ponto
+// fica com o grupo mais largo entre os de mesmo custo. Cluster e o
+// MatchCluster, privado do visitor.
+template <typename Cluster>
+std::vector<Cluster> partition(const std::vector<CaseRange>& ranges, const std::vector<std::string>& labels,
+                               bool tables) {
+    typedef typename Cluster::Kind Kind;
+    size_t n = ranges.size();
+    std::vector<size_t> best(n + 1, SIZE_MAX);
+    std::vector<size_t> from(n + 1, 0);
+    std::vector<Kind> kind(n + 1, Kind::RANGE);
+    best[0] = 0;
+    for (size_t i = 1; i <= n; i++) {
+        long long values = 0;
+        int comparisons = 0;
+        std::vector<int> targets;
+        for (size_t j = i; j-- > 0;) {
+            values += ranges[j].high - ranges[j].low + 1;
+            comparisons += ranges[j].low == ranges[j].high ? 1 : 2;
+            if (std::find(targets.begin(), targets.end(), ranges[j].target) == targets.end()) {
+                targets.push_back(ranges[j].target);
+            }
+            long long span = ranges[i - 1].high - ranges[j].low + 1;
+            Kind k;
+            if (j == i - 1) {
+                k = Kind::RANGE;
+            } else if (tables && fitsBits(span, targets.size(), comparisons)) {
+                k = Kind::BITS;
+            } else if (tables && values >= TABLE_MIN_VALUES && values * 100 >= span * TABLE_MIN_DENSITY) {
+                k = Kind::TABLE;
+            } else {
+                continue;
+            }
+            if (best[j] + 1 <= best[i]) {
+                best[i] = best[j] + 1;
+                from[i] = j;
+                kind[i] = k;
+            }
+        }
+    }
+
+    std::vector<Cluster> clusters;
+    for (size_t i = n; i > 0; i = from[i]) {
+        size_t first = from[i];
+        Cluster cluster;
+        cluster.kind = kind[i];
+        cluster.low = ranges[first].low;
+        cluster.high = ranges[i - 1].high;
+        if (cluster.kind == Kind::RANGE) {
+            cluster.target = labels[ranges[first].target];
+        } else if (cluster.kind == Kind::TABLE) {
+            cluster.table.assign(static_cast<size_t>(cluster.high - cluster.low + 1), "");
+            for (size_t r = first; r < i; r++) {
+                for (long long v = ranges[r].low; v <= ranges[r].high; v++) {
+                    cluster.table[static_cast<size_t>(v - cluster.low)] = labels[ranges[r].target];
+                }
+            }
+        } else {
+            // com tudo entre 0 e 63 o proprio valor e o indice do bit
+            cluster.base = cluster.low >= 0 && cluster.high < 64 ? 0 : cluster.low;
+            std::map<int, uint64_t> masks;
+            for (size_t r = first; r < i; r++) {
+                for (long long v = ranges[r].low; v <= ranges[r].high; v++) {
+                    masks[ranges[r].target] |= uint64_t(1) << (v - cluster.base);
+                }
+            }
+            for (const auto& mask : masks) cluster.bits.emplace_back(mask.second, labels[mask.first]);
+            // o braco com mais valores e testado primeiro
+            std::stable_sort(cluster.bits.begin(), cluster.bits.end(), [](const auto& a, const auto& b) {
+                return __builtin_popcountll(a.first) > __builtin_popcountll(b.first);
+            });
+        }
+        clusters.push_back(std::move(cluster));
+    }
+    std::reverse(clusters.begin(), clusters.end());
+    return clusters;
+}
+
+// x == c, c == x ou um || delas, sempre com a mesma variavel.
+bool equalityTest(const Exp& exp, const Variable*& subject, std::vector<int>& values) {
+    if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+        return logical->op == LogicalOperator::OR && equalityTest(*logical->left, subject, values) &&
+               equalityTest(*logical->right, subject, values);
+    }
+    auto cmp = dynamic_cast<const ComparisonExpression*>(&exp);
+    if (!cmp || cmp->op != ComparisonOperator::EQUAL) return false;
+    auto var = dynamic_cast<const Variable*>(cmp->left.get());
+    auto c = dynamic_cast<const Const*>(cmp->right.get());
+    if (!var || !c) {
+        var = dynamic_cast<const Variable*>(cmp->right.get());
+        c = dynamic_cast<const Const*>(cmp->left.get());
+    }
+    if (!var || !c) return false;
+    if (!subject) {
+        subject = var;
+    } else if (subject->binding.storage != var->binding.storage || subject->binding.slot != var->binding.slot) {
+        return false;
+    }
+    values.push_back(c->valor);
+    return true;
+}
+
+// O if que e o unico comando do bloco de um else.
+const IfStatement* onlyIf(const Statement& stmt) {
+    auto block = dynamic_cast<const BlockStatement*>(&stmt);
+    if (!block || block->statements.size() != 1) return nullptr;
+    return dynamic_cast<const IfStatement*>(block->statements[0].get());
+}
+
+}
+
+void CodeGenerationVisitor::visit(const MatchStatement& node) {
+    std::vector<MatchCase> arms;
+    for (const auto& arm : node.arms) arms.push_back(MatchCase{arm.values, arm.body.get()});
+    lowerMatch(*node.subject, arms, node.otherwise.get());
+}
+
+// Cadeia de if sobre a mesma variavel gerada como match; falso se node nao
+// comeca uma. O primeiro if que nao entra na cadeia fica com o else que o
+// contem, como o braco _.
+bool CodeGenerationVisitor::lowerEqualityChain(const IfStatement& node) {
+    if (options.optimizationLevel == 0 || !options.profileGenerate.empty() || context->profile.loaded()) {
+        return false;
+    }
+    const Variable* subject = nullptr;
+    std::vector<MatchCase> arms;
+    size_t values = 0;
+    const Statement* rest = nullptr;
+    for (const IfStatement* link = &node; link; link = rest ? onlyIf(*rest) : nullptr) {
+        MatchCase arm{{}, link->thenBranch.get()};
+        if (!equalityTest(*link->condition, subject, arm.values)) break;
+        values += arm.values.size();
+        arms.push_back(std::move(arm));
+        rest = link->elseBranch.get();
+    }
+    if (values < CHAIN_MIN_VALUES) return false;
+    lowerMatch(*subject, arms, rest);
+    return true;
+}
+
+void CodeGenerationVisitor::lowerMatch(const Exp& subject, const std::vector<MatchCase>& arms,
+                                       const Statement* otherwise) {
+    Operand value = lower(subject);
+    if (value.isGlobal()) {
+        Operand copy = Operand::reg(function.newVReg());
+        emitInstr(IROp::MOV, copy, value);
+        value = copy;
+    }
+
+    std::vector<std::string> labels;
+    for (size_t k = 0; k < arms.size(); k++) labels.push_back(generateLabel("Lcaso"));
+    std::string endLabel = generateLabel("Lfim");
+    std::string fallback = otherwise ? generateLabel("Loutro") : endLabel;
+
+    // um valor repetido fica com o primeiro braco (so numa cadeia de if)
+    std::map<long long, int> cases;
+    for (size_t k = 0; k < arms.size(); k++) {
+        for (int v : arms[k].values) cases.emplace(v, static_cast<int>(k));
+    }
+
+    if (value.isImm()) {
+        auto chosen = cases.find(value.imm);
+        emitJump(IROp::JMP, chosen != cases.end() ? labels[chosen->second] : fallback);
+    } else if (cases.empty()) {
+        emitJump(IROp::JMP, fallback);
+    } else {
+        std::vector<CaseRange> ranges;
+        for (const auto& c : cases) {
+            if (!ranges.empty() && ranges.back().high + 1 == c.first && ranges.back().target == c.second) {
+                ranges.back().high = c.first;
+            } else {
+                ranges.push_back(CaseRange{c.first, c.first, c.second});
+            }
+        }
+        std::vector<MatchCluster> clusters = partition<MatchCluster>(ranges, labels, !options.interpret);
+        emitClusters(value, clusters, 0, clusters.size() - 1, LLONG_MIN, LLONG_MAX, fallback);
+    }
+
+    for (size_t k = 0; k < arms.size(); k++) {
+        emitJump(IROp::LABEL, labels[k]);
+        arms[k].body->accept(*this);
+        bool last = k + 1 == arms.size() && !otherwise;
+        if (!last && !isTerminator(function.code.back())) emitJump(IROp::JMP, endLabel);
+    }
+    if (otherwise) {
+        emitJump(IROp::LABEL, fallback);
+        otherwise->accept(*this);
+    }
+    emitJump(IROp::LABEL, endLabel);
+}
+
+// Busca binaria nos grupos first..last; o valor esta entre low e high.
+void CodeGenerationVisitor::emitClusters(Operand value, const std::vector<MatchCluster>& clusters, size_t first,
+                                         size_t last, long long low, long long high, const std::string& fallback) {
+    if (last - first < SEQUENTIAL_LEAVES) {
+        for (size_t k = first; k <= last; k++) {
+            std::string miss = k == last ? fallback : generateLabel("Lproximo");
+            emitCluster(value, clusters[k], low, high, miss);
+            if (k < last) emitJump(IROp::LABEL, miss);
+        }
+        if (!isTerminator(function.code.back())) emitJump(IROp::JMP, fallback);
+        return;
+    }
+
+    size_t middle = (first + last + 1) / 2;
+    long long pivot = clusters[middle].low;
+    std::string rightLabel = generateLabel("Lmaior");
+    IRInstr test{IROp::JCC, Operand(), value, Operand::immediate(pivot)};
+    test.cond = ComparisonOperator::GREATER_EQUAL;
+    test.label = rightLabel;
+    function.emit(std::move(test));
+    emitClusters(value, clusters, first, middle - 1, low, pivot - 1, fallback);
+    emitJump(IROp::LABEL, rightLabel);
+    emitClusters(value, clusters, middle, last, pivot, high, fallback);
+}
+
+// Desvia para o braco do valor ou segue adiante (ou para miss) se o grupo
+// nao tiver o valor. Os testes que low e high ja garantem sao omitidos.
+void CodeGenerationVisitor::emitCluster(Operand value, const MatchCluster& cluster, long long low, long long high,
+                                        const std::string& miss) {
+    bool below = low < cluster.low;
+    bool above = high > cluster.high;
+    auto jump = [&](ComparisonOperator cond, long long bound, const std::string& label) {
+        IRInstr instr{IROp::JCC, Operand(), value, Operand::immediate(bound)};
+        instr.cond = cond;
+        instr.label = label;
+        function.emit(std::move(instr));
+    };
+
+    switch (cluster.kind) {
+        case MatchCluster::Kind::RANGE:
+            if (!below && !above) {
+                emitJump(IROp::JMP, cluster.target);
+            } else if (cluster.low == cluster.high) {
+                jump(ComparisonOperator::EQUAL, cluster.low, cluster.target);
+            } else if (!below) {
+                jump(ComparisonOperator::LESS_EQUAL, cluster.high, cluster.target);
+            } else if (!above) {
+                jump(ComparisonOperator::GREATER_EQUAL, cluster.low, cluster.target);
+            } else {
+                jump(ComparisonOperator::LESS, cluster.low, miss);
+                jump(ComparisonOperator::LESS_EQUAL, cluster.high, cluster.target);
+            }
+            break;
+        case MatchCluster::Kind::TABLE: {
+            IRInstr instr{IROp::SWITCH, Operand(), value, Operand::immediate(cluster.low)};
+            instr.label = miss;
+            for (const auto& target : cluster.table) instr.targets.push_back(target.empty() ? miss : target);
+            function.emit(std::move(instr));
+            break;
+        }
+        case MatchCluster::Kind::BITS: {
+            if (below) jump(ComparisonOperator::LESS, cluster.low, miss);
+            if (above) jump(ComparisonOperator::GREATER, cluster.high, miss);
+            Operand index = value;
+            if (cluster.base != 0) {
+                index = Operand::reg(function.newVReg());
+                emitInstr(IROp::SUB, index, value, Operand::immediate(cluster.base));
+            }
+            for (const auto& bits : cluster.bits) {
+                Operand mask = Operand::reg(function.newVReg());
+                emitInstr(IROp::MOV, mask, Operand::immediate(static_cast<long long>(bits.first)));
+                IRInstr test{IROp::BITTEST, Operand(), index, mask};
+                test.label = bits.second;
+                function.emit(std::move(test));
+            }
+            break;
+        }
+    }
+}
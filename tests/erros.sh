@@ -0,0 +1,23 @@
+#!/bin/bash
+# Programas que o compilador deve recusar: cada tests/erros/<nome>.ci tem
+# ao lado um <nome>.esperado com a mensagem de erro exata. Uso, a partir da
+# raiz, depois do make:
+#   tests/erros.sh
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+for source in "$ROOT"/tests/erros/*.ci; do
+    name=$(basename "$source" .ci)
+    if (cd "$WORK" && "$ROOT/compilador" "$source" >/dev/null 2>"$WORK/$name.err"); then
+        echo "$name: compilou, mas devia falhar"
+        failed=1
+    elif ! diff -u "${source%.ci}.esperado" "$WORK/$name.err" >/dev/null; then
+        echo "$name: mensagem diferente da esperada"
+        diff -u "${source%.ci}.esperado" "$WORK/$name.err"
+        failed=1
+    fi
+done
+[ $failed -eq 0 ] && echo "tests/erros: todos recusados como esperado"
+exit $failed
@@ -0,0 +1,262 @@
+#include "timereport.h"
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Contadores de alocacao em fatias por thread, cada uma na sua linha de
+// cache: as threads que geram funcoes nao disputam o mesmo contador. A
+// fatia e escolhida em rodizio na primeira alocacao da thread; com mais
+// threads vivas do que fatias, duas podem dividir uma (o total segue
+// exato, so a conta de cada thread mistura as duas).
+struct alignas(64) AllocationSlot {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+const int SLOTS = 64;
+AllocationSlot slots[SLOTS];
+std::atomic<int> nextSlot{0};
+std::atomic<int> counting{0};  // countAllocations(true) ainda abertos
+thread_local int threadSlot = -1;
+
+AllocationSlot& slot() {
+    if (threadSlot < 0) threadSlot = nextSlot.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    return slots[threadSlot];
+}
+
+void allocationTotals(uint64_t& count, uint64_t& bytes) {
+    count = bytes = 0;
+    for (const auto& s : slots) {
+        count += s.count.load(std::memory_order_relaxed);
+        bytes += s.bytes.load(std::memory_order_relaxed);
+    }
+}
+
+int64_t cpuTime(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+double milliseconds(int64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+const char* const HARDWARE_NAMES[3] = {"ciclos", "instrucoes", "falhas_cache"};
+
+// Contador de hardware do processo; inherit soma as threads criadas
+// depois (as de geracao de funcoes) quando elas terminam.
+int openCounter(uint64_t config) {
+    perf_event_attr attr = {};
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+}
+
+void countAllocations(bool enabled) {
+    counting.fetch_add(enabled ? 1 : -1, std::memory_order_relaxed);
+}
+
+void recordAllocation(std::size_t bytes) {
+    if (counting.load(std::memory_order_relaxed) <= 0) return;
+    AllocationSlot& s = slot();
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+ThreadSample ThreadSample::now(bool enabled) {
+    ThreadSample sample;
+    if (!enabled) return sample;
+    sample.enabled = true;
+    sample.wall = std::chrono::steady_clock::now();
+    sample.cpuNs = cpuTime(CLOCK_THREAD_CPUTIME_ID);
+    AllocationSlot& s = slot();
+    sample.allocations = s.count.load(std::memory_order_relaxed);
+    sample.allocatedBytes = s.bytes.load(std::memory_order_relaxed);
+    return sample;
+}
+
+PhaseStats ThreadSample::elapsed() const {
+    PhaseStats stats;
+    if (!enabled) return stats;
+    stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall).count();
+    stats.cpuMs = milliseconds(cpuTime(CLOCK_THREAD_CPUTIME_ID) - cpuNs);
+    AllocationSlot& s = slot();
+    stats.allocations = s.count.load(std::memory_order_relaxed) - allocations;
+    stats.allocatedBytes = s.bytes.load(std::memory_order_relaxed) - allocatedBytes;
+    return stats;
+}
+
+TimeReport::TimeReport(const std::string& format) : format(format) {
+    if (!enabled()) return;
+    countAllocations(true);
+    const uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    hardware = true;
+    for (int i = 0; i < 3; i++) {
+        counters[i] = openCounter(configs[i]);
+        if (counters[i] < 0) hardware = false;
+    }
+}
+
+TimeReport::~TimeReport() {
+    for (int fd : counters) {
+        if (fd >= 0) ::close(fd);
+    }
+    if (enabled()) countAllocations(false);
+}
+
+TimeReport::Sample TimeReport::sample() const {
+    Sample s;
+    s.wall = std::chrono::steady_clock::now();
+    s.cpuNs = cpuTime(CLOCK_PROCESS_CPUTIME_ID);
+    allocationTotals(s.allocations, s.allocatedBytes);
+    if (hardware) {
+        for (int i = 0; i < 3; i++) {
+            if (::read(counters[i], &s.hardware[i], sizeof s.hardware[i]) != sizeof s.hardware[i]) s.hardware[i] = 0;
+        }
+    }
+    return s;
+}
+
+TimeReport::Phase TimeReport::measure(const std::string& name, const Sample& from) const {
+    Sample to = sample();
+    Phase phase;
+    phase.name = name;
+    phase.stats.wallMs = std::chrono::duration<double, std::milli>(to.wall - from.wall).count();
+    phase.stats.cpuMs = milliseconds(to.cpuNs - from.cpuNs);
+    phase.stats.allocations = to.allocations - from.allocations;
+    phase.stats.allocatedBytes = to.allocatedBytes - from.allocatedBytes;
+    for (int i = 0; i < 3; i++) phase.hardware[i] = to.hardware[i] - from.hardware[i];
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    phase.peakRssKib = usage.ru_maxrss;
+    return phase;
+}
+
+void TimeReport::begin(const std::string& name) {
+    if (!enabled()) return;
+    current = name;
+    start = sample();
+    if (phases.empty()) first = start;
+}
+
+void TimeReport::end() {
+    if (!enabled()) return;
+    phases.push_back(measure(current, start));
+    overall = measure("total", first);
+}
+
+void TimeReport::steps(const CodegenTimes& times) {
+    if (!enabled()) return;
+    const char* const names[CodegenTimes::STEPS] = {"traducao para IR", "alocacao de registradores",
+                                                    "emissao x86"};
+    for (int i = 0; i < CodegenTimes::STEPS; i++) {
+        Phase phase;
+        phase.name = names[i];
+        phase.step = true;
+        phase.stats = times.steps[i];
+        phases.push_back(phase);
+    }
+}
+
+void TimeReport::count(const std::string& name, uint64_t value) {
+    if (enabled()) counts.emplace_back(name, value);
+}
+
+void TimeReport::print(std::ostream& out) const {
+    if (!enabled()) return;
+    if (format == "json") {
+        printJson(out);
+    } else {
+        printText(out);
+    }
+}
+
+// As etapas vem logo depois da fase que as contem, recuadas.
+void TimeReport::printText(std::ostream& out) const {
+    out << "Relatorio de tempo:\n"
+        << std::left << std::setw(30) << "fase" << std::right << std::setw(11) << "parede ms" << std::setw(11)
+        << "cpu ms" << std::setw(11) << "alocacoes" << std::setw(12) << "KiB aloc." << std::setw(14)
+        << "pico RSS KiB";
+    if (hardware) out << std::setw(14) << "ciclos" << std::setw(14) << "instrucoes" << std::setw(12) << "falhas cache";
+    out << '\n';
+
+    auto row = [&](const Phase& phase) {
+        std::string name = phase.step ? "  " + phase.name + " *" : phase.name;
+        out << std::left << std::setw(30) << name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(11) << phase.stats.wallMs << std::setw(11) << phase.stats.cpuMs << std::setw(11)
+            << phase.stats.allocations << std::setw(12) << std::setprecision(1)
+            << phase.stats.allocatedBytes / 1024.0;
+        if (phase.step) {
+            out << std::setw(14) << "-";
+            if (hardware) out << std::setw(14) << "-" << std::setw(14) << "-" << std::setw(12) << "-";
+        } else {
+            out << std::setw(14) << phase.peakRssKib;
+            if (hardware) {
+                out << std::setw(14) << phase.hardware[0] << std::setw(14) << phase.hardware[1] << std::setw(12)
+                    << phase.hardware[2];
+            }
+        }
+        out << '\n';
+    };
+    for (const auto& phase : phases) row(phase);
+    row(overall);
+
+    out << "* somado entre as threads que geram as funcoes\n";
+    if (!hardware) out << "Contadores de hardware indisponiveis (perf_event_open recusado)\n";
+    out << "Contagens:";
+    for (size_t i = 0; i < counts.size(); i++) {
+        std::string name = counts[i].first;
+        std::replace(name.begin(), name.end(), '_', ' ');
+        out << (i ? ", " : " ") << counts[i].second << ' ' << name;
+    }
+    out << std::endl;
+}
+
+void TimeReport::printJson(std::ostream& out) const {
+    auto phaseJson = [&](const Phase& phase) {
+        out << "{\"nome\": \"" << phase.name << "\", \"etapa\": " << (phase.step ? "true" : "false")
+            << std::fixed << std::setprecision(3) << ", \"parede_ms\": " << phase.stats.wallMs
+            << ", \"cpu_ms\": " << phase.stats.cpuMs << ", \"alocacoes\": " << phase.stats.allocations
+            << ", \"bytes_alocados\": " << phase.stats.allocatedBytes;
+        if (!phase.step) {
+            out << ", \"pico_rss_kib\": " << phase.peakRssKib;
+            for (int i = 0; i < 3; i++) {
+                out << ", \"" << HARDWARE_NAMES[i] << "\": ";
+                if (hardware) {
+                    out << phase.hardware[i];
+                } else {
+                    out << "null";
+                }
+            }
+        }
+        out << "}";
+    };
+
+    out << "{\"fases\": [";
+    for (size_t i = 0; i < phases.size(); i++) {
+        out << (i ? ",\n  " : "\n  ");
+        phaseJson(phases[i]);
+    }
+    out << "],\n \"total\": ";
+    phaseJson(overall);
+    out << ",\n \"contagens\": {";
+    for (size_t i = 0; i < counts.size(); i++) {
+        out << (i ? ", " : "") << '"' << counts[i].first << "\": " << counts[i].second;
+    }
+    out << "}}" << std::endl;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Tempo e memoria gastos numa fase da compilacao (--time-report).
+struct PhaseStats {
+    double wallMs = 0;
+    double cpuMs = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+
+    PhaseStats& operator+=(const PhaseStats& other) {
+        wallMs += other.wallMs;
+        cpuMs += other.cpuMs;
+        allocations += other.allocations;
+        allocatedBytes += other.allocatedBytes;
+        return *this;
+    }
+};
+
+// Liga a contagem de alocacoes (desligada por padrao). As chamadas se
+// acumulam: a contagem segue ligada ate cada true ter o seu false, entao
+// um relatorio que termina nao desliga o de outra compilacao.
+void countAllocations(bool enabled);
+
+// Soma uma alocacao de bytes na thread atual, se a contagem estiver
+// ligada. A biblioteca nao substitui o operator new; o do driver
+// (allocations.cpp) chama esta funcao, e quem embute o compilador pode
+// chamar do seu.
+void recordAllocation(std::size_t bytes);
+
+// Instante na thread atual: relogio, CPU da propria thread e alocacoes
+// feitas por ela. Criado desligado, elapsed() devolve zeros sem consultar
+// relogio nenhum, entao o codigo medido nao paga nada sem --time-report.
+class ThreadSample {
+public:
+    static ThreadSample now(bool enabled);
+    PhaseStats elapsed() const;
+
+private:
+    bool enabled = false;
+    std::chrono::steady_clock::time_point wall;
+    int64_t cpuNs = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+};
+
+// Etapas da geracao de cada funcao, medidas nas threads que geram as
+// funcoes e somadas entre elas.
+struct CodegenTimes {
+    enum Step { LOWERING, ALLOCATION, EMISSION, STEPS };
+
+    PhaseStats steps[STEPS];
+    uint64_t irInstructions = 0;
+
+    CodegenTimes& operator+=(const CodegenTimes& other) {
+        for (int i = 0; i < STEPS; i++) steps[i] += other.steps[i];
+        irInstructions += other.irInstructions;
+        return *this;
+    }
+};
+
+// Relatorio de --time-report[=text|json]. As fases de begin/end sao
+// sequenciais e medidas no processo inteiro (CPU de todas as threads,
+// todas as alocacoes, pico de RSS e, quando o kernel permite
+// perf_event_open, ciclos, instrucoes e falhas de cache). Desligado, todas
+// as chamadas sao vazias.
+class TimeReport {
+public:
+    explicit TimeReport(const std::string& format);
+    ~TimeReport();
+    TimeReport(const TimeReport&) = delete;
+    TimeReport& operator=(const TimeReport&) = delete;
+
+    bool enabled() const { return !format.empty(); }
+
+    void begin(const std::string& name);
+    void end();
+
+    // Etapas de geracao de codigo, mostradas dentro da fase atual.
+    void steps(const CodegenTimes& times);
+
+    void count(const std::string& name, uint64_t value);
+
+    // Texto alinhado ou um objeto JSON, conforme o formato pedido.
+    void print(std::ostream& out) const;
+
+private:
+    struct Sample {
+        std::chrono::steady_clock::time_point wall;
+        int64_t cpuNs = 0;
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t hardware[3] = {0, 0, 0};
+    };
+
+    struct Phase {
+        std::string name;
+        bool step = false;  // etapa somada entre threads: sem RSS nem contadores
+        PhaseStats stats;
+        long peakRssKib = 0;
+        uint64_t hardware[3] = {0, 0, 0};
+    };
+
+    std::string format;
+    int counters[3] = {-1, -1, -1};
+    bool hardware = false;
+    Sample first;    // inicio da primeira fase
+    Sample start;    // inicio da fase atual
+    std::string current;
+    Phase overall;
+    std::vector<Phase> phases;
+    std::vector<std::pair<std::string, uint64_t>> counts;
+
+    Sample sample() const;
+    Phase measure(const std::string& name, const Sample& from) const;
+    void printText(std::ostream& out) const;
+    void printJson(std::ostream& out) const;
+};
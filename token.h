@@ -17,6 +17,8 @@ enum class TokenType {
     MAIN,
     LBRACE,
     RBRACE,
+    LBRACKET,
+    RBRACKET,
     
     EQUAL,
     NOT,
@@ -32,12 +34,17 @@ enum class TokenType {
     IF,
     ELSE,
     WHILE,
+    PARFOR,
+    REDUCE,
+    MATCH,
     RETURN,
     TRUE,
     FALSE,
 
     FUN,
+    EXTERN,
     COMMA,
+    ARROW,
     
     END_OF_FILE,
     ILLEGAL
@@ -50,4 +57,5 @@ struct Token {
     TokenType type;
     std::string lexeme;
     size_t position;
+    size_t line = 1;  // linha do fonte, contada a partir de 1
 };
@@ -0,0 +1,259 @@
+#include "visitor.h"
+#include "ast.h"
+#include <map>
+#include <set>
+
+// Vetorizacao com SSE2 dos lacos na forma
+//
+//   while (i < n) { c[i] = E; ...; s = s + E; ...; i = i + 1; }
+//
+// em que todo acesso tem indice i e ja dispensa a checagem de limites
+// (versao rapida do laco, ver bounds.h). E usa elementos x[i], constantes e
+// escalares que nao mudam no laco, com +, -, ==, != e !; s e uma local que
+// so aparece na propria reducao. Dois elementos por iteracao, enquanto
+// i + 1 < n; o laco original vem em seguida e faz o que sobrar. Sem
+// multiplicacao: o SSE2 nao multiplica inteiros de 64 bits.
+struct CodeGenerationVisitor::VectorLoop {
+    int index = -1;
+    std::set<int> reductions;                    // slots das somas
+    std::map<std::string, int> invariants;       // valor -> xmm
+    std::vector<std::pair<const Exp*, int>> splats;
+    int firstTemp = 0;
+    std::vector<int> freeTemps;
+    std::vector<IRInstr> body;
+};
+
+namespace {
+
+int localSlot(const Exp& exp) {
+    auto var = dynamic_cast<const Variable*>(&exp);
+    return var && var->binding.storage != StorageClass::GLOBAL ? var->binding.slot : -1;
+}
+
+// Chave de um valor invariante; vazia se exp nao for um.
+std::string invariantKey(const Exp& exp) {
+    if (auto c = dynamic_cast<const Const*>(&exp)) return "k" + std::to_string(c->valor);
+    if (auto b = dynamic_cast<const BooleanLiteral*>(&exp)) return b->value ? "k1" : "k0";
+    if (auto var = dynamic_cast<const Variable*>(&exp)) {
+        if (var->binding.storage == StorageClass::GLOBAL) return "g" + var->name;
+        return "v" + std::to_string(var->binding.slot);
+    }
+    return "";
+}
+
+const Const ZERO(0);
+
+}
+
+// Confere se exp cabe no laco vetorizado e registra os invariantes dela.
+bool CodeGenerationVisitor::planVector(const Exp& exp, VectorLoop& loop) const {
+    if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+        return localSlot(*element->index) == loop.index &&
+               (element->bounds.proven || element->bounds.loop == fastLoops.back());
+    }
+    if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+        return (bin->op == Operador::SOMA || bin->op == Operador::SUB) && planVector(*bin->opEsq, loop) &&
+               planVector(*bin->opDir, loop);
+    }
+    if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+        return (cmp->op == ComparisonOperator::EQUAL || cmp->op == ComparisonOperator::NOT_EQUAL) &&
+               planVector(*cmp->left, loop) && planVector(*cmp->right, loop);
+    }
+    if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+        if (unary->isNot) planVector(ZERO, loop);
+        return planVector(*unary->operand, loop);
+    }
+
+    std::string key = invariantKey(exp);
+    if (key.empty()) return false;
+    int slot = localSlot(exp);
+    if (slot >= 0 && (slot == loop.index || loop.reductions.count(slot))) return false;
+    if (!loop.invariants.count(key)) {
+        int reg = static_cast<int>(loop.invariants.size());
+        loop.invariants[key] = reg;
+        loop.splats.emplace_back(&exp, reg);
+    }
+    return true;
+}
+
+// Gera exp em loop.body e devolve o xmm do resultado, ou -1 se faltarem
+// registradores. O resultado reaproveita o temporario de um operando;
+// invariantes nunca sao escritos.
+int CodeGenerationVisitor::lowerVector(const Exp& exp, VectorLoop& loop) {
+    auto temp = [&]() {
+        if (loop.freeTemps.empty()) return -1;
+        int reg = loop.freeTemps.back();
+        loop.freeTemps.pop_back();
+        return reg;
+    };
+    auto xmm = [](int reg) { return Operand::immediate(reg); };
+
+    if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+        int reg = temp();
+        if (reg >= 0) {
+            loop.body.push_back(IRInstr{IROp::VLOAD, xmm(reg), arrayBase(*element->array),
+                                        Operand::reg(slotVReg(loop.index))});
+        }
+        return reg;
+    }
+
+    const Exp* left = nullptr;
+    const Exp* right = nullptr;
+    IROp op = IROp::VADD;
+    ComparisonOperator cond = ComparisonOperator::EQUAL;
+    if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+        left = bin->opEsq.get();
+        right = bin->opDir.get();
+        op = bin->op == Operador::SOMA ? IROp::VADD : IROp::VSUB;
+    } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+        left = cmp->left.get();
+        right = cmp->right.get();
+        op = IROp::VCMP;
+        cond = cmp->op;
+    } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+        if (!unary->isNot) return lowerVector(*unary->operand, loop);
+        left = unary->operand.get();
+        right = &ZERO;
+        op = IROp::VCMP;
+    } else {
+        return loop.invariants.at(invariantKey(exp));
+    }
+
+    int a = lowerVector(*left, loop);
+    if (a < 0) return -1;
+    int b = lowerVector(*right, loop);
+    if (b < 0) return -1;
+    bool tempA = a >= loop.firstTemp;
+    bool tempB = b >= loop.firstTemp;
+    int dst = tempA ? a : tempB && op != IROp::VSUB ? b : temp();
+    if (dst < 0) return -1;
+    if (tempA && a != dst) loop.freeTemps.push_back(a);
+    if (tempB && b != dst) loop.freeTemps.push_back(b);
+
+    IRInstr instr{op, xmm(dst), xmm(a), xmm(b)};
+    instr.cond = cond;
+    loop.body.push_back(std::move(instr));
+    return dst;
+}
+
+void CodeGenerationVisitor::vectorizeLoop(const WhileStatement& node) {
+    auto cmp = dynamic_cast<const ComparisonExpression*>(node.condition.get());
+    auto block = dynamic_cast<const BlockStatement*>(node.body.get());
+    if (!cmp || cmp->op != ComparisonOperator::LESS || !block || block->statements.size() < 2) return;
+    VectorLoop loop;
+    loop.index = localSlot(*cmp->left);
+    const Exp& limit = *cmp->right;
+    if (loop.index < 0 || (!dynamic_cast<const Const*>(&limit) && !dynamic_cast<const Variable*>(&limit)) ||
+        localSlot(limit) == loop.index) {
+        return;
+    }
+
+    // ultimo comando: i = i + 1
+    auto last = dynamic_cast<const ExpressionStatement*>(block->statements.back().get());
+    auto step = last ? dynamic_cast<const AssignmentExpression*>(last->expression.get()) : nullptr;
+    auto sum = step ? dynamic_cast<const OpBin*>(step->value.get()) : nullptr;
+    auto one = sum ? dynamic_cast<const Const*>(sum->opDir.get()) : nullptr;
+    if (!step || step->binding.storage == StorageClass::GLOBAL || step->binding.slot != loop.index || !sum ||
+        sum->op != Operador::SOMA || localSlot(*sum->opEsq) != loop.index || !one || one->valor != 1) {
+        return;
+    }
+
+    // c[i] = E ou s = s + E, s = E + s, s = s - E
+    struct Statement {
+        const ArrayAssignment* store;
+        const AssignmentExpression* reduction;
+        const Exp* value;
+    };
+    std::vector<Statement> statements;
+    for (size_t i = 0; i + 1 < block->statements.size(); i++) {
+        auto exprStmt = dynamic_cast<const ExpressionStatement*>(block->statements[i].get());
+        if (!exprStmt) return;
+        if (auto store = dynamic_cast<const ArrayAssignment*>(exprStmt->expression.get())) {
+            if (localSlot(*store->index) != loop.index ||
+                !(store->bounds.proven || store->bounds.loop == fastLoops.back())) {
+                return;
+            }
+            statements.push_back(Statement{store, nullptr, store->value.get()});
+            continue;
+        }
+        auto assign = dynamic_cast<const AssignmentExpression*>(exprStmt->expression.get());
+        auto bin = assign ? dynamic_cast<const OpBin*>(assign->value.get()) : nullptr;
+        if (!bin || assign->binding.storage == StorageClass::GLOBAL) return;
+        int slot = assign->binding.slot;
+        if (slot == loop.index || slot == localSlot(limit) || !loop.reductions.insert(slot).second) return;
+        if (bin->op == Operador::SOMA && localSlot(*bin->opEsq) == slot) {
+            statements.push_back(Statement{nullptr, assign, bin->opDir.get()});
+        } else if (bin->op == Operador::SOMA && localSlot(*bin->opDir) == slot) {
+            statements.push_back(Statement{nullptr, assign, bin->opEsq.get()});
+        } else if (bin->op == Operador::SUB && localSlot(*bin->opEsq) == slot) {
+            statements.push_back(Statement{nullptr, assign, bin->opDir.get()});
+        } else {
+            return;
+        }
+    }
+    for (const auto& stmt : statements) {
+        if (!planVector(*stmt.value, loop)) return;
+    }
+
+    // xmm: invariantes, acumuladores e temporarios, sem o xmm15
+    int accumulators = static_cast<int>(loop.invariants.size());
+    loop.firstTemp = accumulators + static_cast<int>(loop.reductions.size());
+    for (int reg = VECTOR_SCRATCH - 1; reg >= loop.firstTemp; reg--) loop.freeTemps.push_back(reg);
+    int nextAccumulator = accumulators;
+    for (const auto& stmt : statements) {
+        int value = lowerVector(*stmt.value, loop);
+        if (value < 0) return;
+        if (stmt.store) {
+            IRInstr store{IROp::VSTORE, Operand(), arrayBase(*stmt.store->array), Operand::reg(slotVReg(loop.index))};
+            store.args.push_back(Operand::immediate(value));
+            loop.body.push_back(std::move(store));
+        } else {
+            int acc = nextAccumulator++;
+            loop.body.push_back(IRInstr{IROp::VADD, Operand::immediate(acc), Operand::immediate(acc),
+                                        Operand::immediate(value)});
+        }
+        if (value >= loop.firstTemp) loop.freeTemps.push_back(value);
+    }
+
+    // constantes fora de 32 bits vao para um vreg antes de comparar ou espalhar
+    auto invariant = [&](const Exp& exp) {
+        auto c = dynamic_cast<const Const*>(&exp);
+        return c ? immediate(c->valor) : lower(exp);
+    };
+    for (const auto& splat : loop.splats) {
+        emitInstr(IROp::VSPLAT, Operand::immediate(splat.second), invariant(*splat.first));
+    }
+    for (int acc = accumulators; acc < loop.firstTemp; acc++) {
+        emitInstr(IROp::VZERO, Operand::immediate(acc));
+    }
+
+    // i < n e i + 1 < n: com i < n a soma nao transborda
+    std::string loopLabel = generateLabel("Lvetor");
+    std::string endLabel = generateLabel("Lfimvetor");
+    Operand index = Operand::reg(slotVReg(loop.index));
+    emitJump(IROp::LABEL, loopLabel);
+    IRInstr below{IROp::JCC, Operand(), index, invariant(limit)};
+    below.cond = ComparisonOperator::GREATER_EQUAL;
+    below.label = endLabel;
+    function.emit(below);
+    Operand next = Operand::reg(function.newVReg());
+    emitInstr(IROp::ADD, next, index, Operand::immediate(1));
+    below.a = next;
+    function.emit(std::move(below));
+    emitCount(&node, 1);
+    emitCount(&node, 1);
+    for (auto& instr : loop.body) function.emit(std::move(instr));
+    emitInstr(IROp::ADD, index, index, Operand::immediate(2));
+    emitJump(IROp::JMP, loopLabel);
+    emitJump(IROp::LABEL, endLabel);
+
+    int acc = accumulators;
+    for (const auto& stmt : statements) {
+        if (!stmt.reduction) continue;
+        Operand total = Operand::reg(function.newVReg());
+        emitInstr(IROp::VSUM, total, Operand::immediate(acc++));
+        Operand s = Operand::reg(slotVReg(stmt.reduction->binding.slot));
+        auto bin = static_cast<const OpBin*>(stmt.reduction->value.get());
+        emitInstr(bin->op == Operador::SOMA ? IROp::ADD : IROp::SUB, s, s, total);
+    }
+}
@@ -1,668 +1,1013 @@
 #include "visitor.h"
 #include "ast.h"
-#include <iostream>
+#include "binder.h"
+#include "bounds.h"
+#include "emitter.h"
+#include "parallel.h"
+#include "regalloc.h"
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 
-void PrintVisitor::visit(const Program& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
-    }
-    std::cout << "Program" << std::endl;
-    
-    int declNum = 1;
-    for (const auto& decl : node.globalDeclarations) {
-        for (int i = 0; i < depth + 1; i++) {
-            std::cout << "  ";
-        }
-        std::cout << "|- Global Declaration " << declNum << ":" << std::endl;
-        
-        PrintVisitor declVisitor(depth + 2);
-        decl->accept(declVisitor);
-        declNum++;
-    }
-    
-    if (node.mainFunction) {
-        for (int i = 0; i < depth + 1; i++) {
-            std::cout << "  ";
-        }
-        std::cout << "|- Main Function:" << std::endl;
-        
-        PrintVisitor mainVisitor(depth + 2);
-        node.mainFunction->accept(mainVisitor);
+static ComparisonOperator negate(ComparisonOperator op) {
+    switch (op) {
+        case ComparisonOperator::EQUAL: return ComparisonOperator::NOT_EQUAL;
+        case ComparisonOperator::NOT_EQUAL: return ComparisonOperator::EQUAL;
+        case ComparisonOperator::LESS: return ComparisonOperator::GREATER_EQUAL;
+        case ComparisonOperator::GREATER: return ComparisonOperator::LESS_EQUAL;
+        case ComparisonOperator::LESS_EQUAL: return ComparisonOperator::GREATER;
+        case ComparisonOperator::GREATER_EQUAL: return ComparisonOperator::LESS;
     }
+    return op;
 }
 
-void PrintVisitor::visit(const BlockStatement& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
-    }
-    std::cout << "BlockStatement" << std::endl;
-    
-    int stmtNum = 1;
-    for (const auto& stmt : node.statements) {
-        for (int i = 0; i < depth + 1; i++) {
-            std::cout << "  ";
-        }
-        std::cout << "|- Statement " << stmtNum << ":" << std::endl;
-        
-        PrintVisitor stmtVisitor(depth + 2);
-        stmt->accept(stmtVisitor);
-        stmtNum++;
+static ComparisonOperator mirror(ComparisonOperator op) {
+    switch (op) {
+        case ComparisonOperator::LESS: return ComparisonOperator::GREATER;
+        case ComparisonOperator::GREATER: return ComparisonOperator::LESS;
+        case ComparisonOperator::LESS_EQUAL: return ComparisonOperator::GREATER_EQUAL;
+        case ComparisonOperator::GREATER_EQUAL: return ComparisonOperator::LESS_EQUAL;
+        default: return op;
     }
 }
 
-void PrintVisitor::visit(const MainFunction& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
+static bool compare(long long a, ComparisonOperator op, long long b) {
+    switch (op) {
+        case ComparisonOperator::EQUAL: return a == b;
+        case ComparisonOperator::NOT_EQUAL: return a != b;
+        case ComparisonOperator::LESS: return a < b;
+        case ComparisonOperator::GREATER: return a > b;
+        case ComparisonOperator::LESS_EQUAL: return a <= b;
+        case ComparisonOperator::GREATER_EQUAL: return a >= b;
     }
-    std::cout << "MainFunction()" << std::endl;
-    
-    PrintVisitor bodyVisitor(depth + 1);
-    node.body->accept(bodyVisitor);
+    return false;
 }
 
-void PrintVisitor::visit(const ExpressionStatement& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
-    }
-    std::cout << "ExpressionStatement" << std::endl;
-    
-    PrintVisitor exprVisitor(depth + 1);
-    node.expression->accept(exprVisitor);
+// Limiares do --profile-use.
+static const uint64_t HOT_CALL_COUNT = 1000;
+static const int INLINE_MAX_SIZE = 60;
+static const int INLINE_MAX_DEPTH = 3;
+static const int UNROLL_MAX_SIZE = 40;
+
+static bool isLeaf(const Exp& exp) {
+    return dynamic_cast<const Const*>(&exp) || dynamic_cast<const BooleanLiteral*>(&exp) ||
+           dynamic_cast<const Variable*>(&exp);
 }
 
-void PrintVisitor::visit(const VarDeclaration& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
-    }
-    std::cout << "VarDeclaration(\"" << node.identifier << "\")" << std::endl;
-    
-    if (node.initializer) {
-        for (int i = 0; i < depth + 1; i++) {
-            std::cout << "  ";
+void CodeGenerationVisitor::visit(const Program& node) {
+    bindNames(node);
+    markBoundsChecks(node);
+    auto shared = std::make_shared<ProgramContext>();
+    for (const auto& decl : node.globalDeclarations) {
+        if (auto varDecl = dynamic_cast<const VarDeclaration*>(decl.get())) {
+            shared->declaredVariables.push_back(varDecl->identifier);
+        } else if (auto array = dynamic_cast<const ArrayDeclaration*>(decl.get())) {
+            shared->globalArrays.push_back(array);
+        } else if (auto externDecl = dynamic_cast<const ExternDeclaration*>(decl.get())) {
+            shared->externFunctions[externDecl->name] = externDecl->parameters.size();
+        } else if (auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
+            shared->functionDeclarations[funcDecl->name] = funcDecl;
+            if (options.instrument) shared->probes.emplace(funcDecl->name, static_cast<int>(shared->probes.size()));
         }
-        std::cout << "|- Initializer:" << std::endl;
-        
-        PrintVisitor initVisitor(depth + 2);
-        node.initializer->accept(initVisitor);
     }
-}
 
-void PrintVisitor::visit(const Variable& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
+    if (!options.profileGenerate.empty() || !options.profileUse.empty()) {
+        shared->profile = Profile(node);
+        if (!options.profileUse.empty()) shared->profile.load(options.profileUse);
     }
-    std::cout << "Variable(\"" << node.name << "\")" << std::endl;
-}
+    if (!options.cacheDir.empty()) {
+        shared->cache.reset(new FunctionCache(options.cacheDir));
+    }
+    context = shared;
+    checkParallelBodies(node);
 
-void PrintVisitor::visit(const Const& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
+    if (!context->declaredVariables.empty() || !context->globalArrays.empty()) {
+        generateBSSSection();
+    }
+    generateTextSection(node);
+    if (!options.profileGenerate.empty()) {
+        generateProfileSection();
+    }
+    if (options.instrument) {
+        generateInstrumentSection(node);
     }
-    std::cout << "Const(" << node.valor << ")" << std::endl;
+    directives().push_back(MInstr::labelled(MOp::INCLUDE, "runtime.s"));
 }
 
-void PrintVisitor::visit(const BooleanLiteral& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
+std::vector<MInstr>& CodeGenerationVisitor::directives() {
+    if (machine.empty() || !machine.back().name.empty()) {
+        machine.push_back(MFunction());
     }
-    std::cout << "Boolean(" << (node.value ? "true" : "false") << ")" << std::endl;
+    return machine.back().code;
 }
 
-void PrintVisitor::visit(const OpBin& node) {
-    for (int i = 0; i < depth; i++) {
-        std::cout << "  ";
+std::vector<MInstr> CodeGenerationVisitor::machineCode() const {
+    std::vector<MInstr> code;
+    for (const auto& fn : machine) {
+        code.insert(code.end(), fn.code.begin(), fn.code.end());
     }
-    std::cout << "OpBin(" << operadorToString(node.op) << ")" << std::endl;
+    return code;
+}
+
+void CodeGenerationVisitor::generateBSSSection() {
+    std::vector<MInstr>& code = directives();
+    code.push_back(MInstr::labelled(MOp::SECTION, ".bss"));
+    for (const auto& varName : context->declaredVariables) {
+        MInstr lcomm = MInstr::labelled(MOp::LCOMM, varName);
+        lcomm.operands.push_back(MOperand::immediate(8));
+        code.push_back(lcomm);
+    }
+    for (const ArrayDeclaration* array : context->globalArrays) {
+        MInstr lcomm = MInstr::labelled(MOp::LCOMM, array->identifier);
+        lcomm.operands.push_back(MOperand::immediate(8 * array->length));
+        code.push_back(lcomm);
+    }
+}
+
+// Bloco de contadores no formato do arquivo de perfil e a rotina que o
+// grava com open/write/close antes do sair.
+void CodeGenerationVisitor::generateProfileSection() {
+    const Profile& profile = context->profile;
+    auto imm = [](long long v) { return MOperand::immediate(v); };
+    auto reg = [](Reg r) { return MOperand::r(r); };
+    std::vector<MInstr>& code = directives();
+
+    code.push_back(MInstr::labelled(MOp::SECTION, ".data"));
+    code.push_back(MInstr::labelled(MOp::LABEL, PROFILE_COUNTERS));
+    code.push_back(MInstr(MOp::QUAD, {imm(static_cast<long long>(Profile::MAGIC)),
+                                      imm(static_cast<long long>(profile.signature())), imm(profile.size())}));
+    if (profile.size() > 0) {
+        code.push_back(MInstr(MOp::ZERO, {imm(8LL * profile.size())}));
+    }
+    code.push_back(MInstr::labelled(MOp::LABEL, "__perfil_arquivo"));
+    code.push_back(MInstr::labelled(MOp::ASCII, options.profileGenerate));
+    code.push_back(MInstr(MOp::BYTE, {imm(0)}));
+
+    code.push_back(MInstr::labelled(MOp::SECTION, ".text"));
+    code.push_back(MInstr::labelled(MOp::LABEL, PROFILE_WRITER));
+    code.push_back(MInstr(MOp::MOV, {imm(2), reg(Reg::RAX)}));                       // sys_open
+    code.push_back(MInstr(MOp::MOV, {MOperand::address("__perfil_arquivo"), reg(Reg::RDI)}));
+    code.push_back(MInstr(MOp::MOV, {imm(01101), reg(Reg::RSI)}));                   // O_WRONLY|O_CREAT|O_TRUNC
+    code.push_back(MInstr(MOp::MOV, {imm(0644), reg(Reg::RDX)}));
+    code.push_back(MInstr(MOp::SYSCALL));
+    code.push_back(MInstr(MOp::TEST, {reg(Reg::RAX), reg(Reg::RAX)}));
+    MInstr failed(MOp::JCC, {MOperand::label("__perfil_fim")});
+    failed.cond = Cond::S;
+    code.push_back(failed);
+    code.push_back(MInstr(MOp::MOV, {reg(Reg::RAX), reg(Reg::RDI)}));
+    code.push_back(MInstr(MOp::MOV, {imm(1), reg(Reg::RAX)}));                       // sys_write
+    code.push_back(MInstr(MOp::MOV, {MOperand::address(PROFILE_COUNTERS), reg(Reg::RSI)}));
+    code.push_back(MInstr(MOp::MOV, {imm(Profile::HEADER_SIZE + 8LL * profile.size()), reg(Reg::RDX)}));
+    code.push_back(MInstr(MOp::SYSCALL));
+    code.push_back(MInstr(MOp::MOV, {imm(3), reg(Reg::RAX)}));                       // sys_close
+    code.push_back(MInstr(MOp::SYSCALL));
+    code.push_back(MInstr::labelled(MOp::LABEL, "__perfil_fim"));
+    code.push_back(MInstr(MOp::RET));
+}
+
+// Tabela lida pelo runtime ao sair (ver emitter.h) e os contadores que o
+// codigo das funcoes incrementa.
+void CodeGenerationVisitor::generateInstrumentSection(const Program& node) {
+    std::vector<std::string> names(context->probes.size() + 1);
+    for (const auto& probe : context->probes) {
+        names[probe.second] = probe.first;
+    }
+    names.back() = node.mainFunction ? "main" : "_start";
+    std::vector<MInstr>& code = directives();
+
+    code.push_back(MInstr::labelled(MOp::SECTION, ".data"));
+    code.push_back(MInstr::labelled(MOp::LABEL, INSTRUMENT_TABLE));
+    MInstr table(MOp::QUAD, {MOperand::immediate(static_cast<long long>(names.size())),
+                             MOperand::address(INSTRUMENT_COUNTERS)});
+    for (size_t i = 0; i < names.size(); i++) {
+        table.operands.push_back(MOperand::address("__instr_nome" + std::to_string(i)));
+    }
+    code.push_back(table);
+    for (size_t i = 0; i < names.size(); i++) {
+        code.push_back(MInstr::labelled(MOp::LABEL, "__instr_nome" + std::to_string(i)));
+        code.push_back(MInstr::labelled(MOp::ASCII, names[i]));
+        code.push_back(MInstr(MOp::BYTE, {MOperand::immediate(0)}));
+    }
+
+    code.push_back(MInstr::labelled(MOp::SECTION, ".bss"));
+    MInstr counters = MInstr::labelled(MOp::LCOMM, INSTRUMENT_COUNTERS);
+    counters.operands.push_back(MOperand::immediate(static_cast<long long>(INSTRUMENT_RECORD * names.size())));
+    code.push_back(counters);
+    MInstr children = MInstr::labelled(MOp::LCOMM, INSTRUMENT_CHILDREN);
+    children.operands.push_back(MOperand::immediate(8));
+    code.push_back(children);
+}
+
+void CodeGenerationVisitor::generateTextSection(const Program& node) {
+    directives().push_back(MInstr::labelled(MOp::SECTION, ".text"));
+    directives().push_back(MInstr::labelled(MOp::GLOBL, "_start"));
     
-    for (int i = 0; i < depth + 1; i++) {
-        std::cout << "  ";
+    // Cada funcao e gerada num visitor proprio, que so compartilha o
+    // contexto; o resultado e juntado na ordem das declaracoes.
+    std::vector<const FunctionDeclaration*> functions;
+    for (const auto& decl : node.globalDeclarations) {
+        if (auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
+            functions.push_back(funcDecl);
+        }
+    }
+    std::vector<std::unique_ptr<CodeGenerationVisitor>> workers(functions.size());
+    parallelFor(functions.size(), options.jobs, [&](size_t i) {
+        workers[i].reset(new CodeGenerationVisitor(options, context));
+        workers[i]->generateFunction(*functions[i]);
+    });
+
+    for (size_t i = 0; i < functions.size(); i++) {
+        if (options.abi == CallingConvention::SYSV) {
+            directives().push_back(MInstr::labelled(MOp::GLOBL, functions[i]->name));
+        }
+        CodeGenerationVisitor& worker = *workers[i];
+        for (auto& fn : worker.machine) machine.push_back(std::move(fn));
+        for (auto& fn : worker.irProgram) irProgram.push_back(std::move(fn));
+        decisions += worker.decisions;
+        cacheStats += worker.cacheStats;
+        times += worker.times;
+        workers[i].reset();
     }
-    std::cout << "|- Operando Esquerdo:" << std::endl;
     
-    PrintVisitor leftVisitor(depth + 2);
-    node.opEsq->accept(leftVisitor);
+    beginFunction("_start", true);
+    if (options.instrument) function.probe = static_cast<int>(context->probes.size());
     
-    for (int i = 0; i < depth + 1; i++) {
-        std::cout << "  ";
+    for (const auto& decl : node.globalDeclarations) {
+        if (dynamic_cast<const VarDeclaration*>(decl.get())) {
+            decl->accept(*this);
+        }
     }
-    std::cout << "|- Operando Direito:" << std::endl;
     
-    PrintVisitor rightVisitor(depth + 2);
-    node.opDir->accept(rightVisitor);
-}
+    if (node.mainFunction) {
+        node.mainFunction->accept(*this);
+    }
 
-void PrintVisitor::visit(const IfStatement& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "IfStatement" << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Condition:" << std::endl;
-    PrintVisitor condVisitor(depth + 1);
-    node.condition->accept(condVisitor);
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Then:" << std::endl;
-    PrintVisitor thenVisitor(depth + 1);
-    node.thenBranch->accept(thenVisitor);
-    
-    if (node.elseBranch) {
-        for (int i = 0; i < depth; i++) std::cout << "  ";
-        std::cout << "|- Else:" << std::endl;
-        PrintVisitor elseVisitor(depth + 1);
-        node.elseBranch->accept(elseVisitor);
+    if (function.code.empty() || function.code.back().op != IROp::EXIT) {
+        emitExit(Operand::immediate(0));
     }
+    emitFunction();
 }
 
-void PrintVisitor::visit(const WhileStatement& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "WhileStatement" << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Condition:" << std::endl;
-    PrintVisitor condVisitor(depth + 1);
-    node.condition->accept(condVisitor);
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Body:" << std::endl;
-    PrintVisitor bodyVisitor(depth + 1);
-    node.body->accept(bodyVisitor);
-}
+// Com --cache, reaproveita o assembly guardado para a mesma chave; senao
+// gera a funcao e guarda o resultado.
+void CodeGenerationVisitor::generateFunction(const FunctionDeclaration& node) {
+    const FunctionCache* cache = context->cache.get();
+    if (!cache) {
+        node.accept(*this);
+        return;
+    }
 
-void PrintVisitor::visit(const ComparisonExpression& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "Comparison(" << comparisonOperatorToString(node.op) << ")" << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Left:" << std::endl;
-    PrintVisitor leftVisitor(depth + 1);
-    node.left->accept(leftVisitor);
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Right:" << std::endl;
-    PrintVisitor rightVisitor(depth + 1);
-    node.right->accept(rightVisitor);
+    auto probe = context->probes.find(node.name);
+    std::string key = cache->key(node, options, context->externFunctions, context->functionDeclarations,
+                                 probe != context->probes.end() ? probe->second : -1);
+    std::string text;
+    if (cache->load(key, text)) {
+        try {
+            machine.push_back(MFunction{node.name, parseAsm(text)});
+            cacheStats.hits++;
+            return;
+        } catch (const std::runtime_error&) {
+            // entrada ilegivel: gera de novo e sobrescreve
+        }
+    }
+
+    // as funcoes dos parfor vem antes da propria funcao e vao junto
+    size_t first = machine.size();
+    node.accept(*this);
+    text.clear();
+    AsmPrinter printer(text);
+    for (size_t i = first; i < machine.size(); i++) printer.print(machine[i].code);
+    cache->store(key, text);
+    cacheStats.misses++;
+}
+
+void CodeGenerationVisitor::beginFunction(const std::string& name, bool isEntry) {
+    function = IRFunction();
+    function.name = name;
+    function.isEntry = isEntry;
+    slotVRegs.clear();
+    variableVRegs.clear();
+    expInfo.clear();
+    coldCode.clear();
+    labelCounter = 0;
+    loweringStart = ThreadSample::now(!options.timeReport.empty());
+}
+
+void CodeGenerationVisitor::emitFunction() {
+    for (auto& instr : coldCode) {
+        function.code.push_back(std::move(instr));
+    }
+    coldCode.clear();
+    bool timing = !options.timeReport.empty();
+    times.steps[CodegenTimes::LOWERING] += loweringStart.elapsed();
+    times.irInstructions += function.code.size();
+    if (options.interpret) {
+        irProgram.push_back(std::move(function));
+        return;
+    }
+
+    ThreadSample step = ThreadSample::now(timing);
+    LinearScanAllocator allocator(function, options.optimizationLevel == 0);
+    Allocation allocation = allocator.run();
+    times.steps[CodegenTimes::ALLOCATION] += step.elapsed();
+
+    step = ThreadSample::now(timing);
+    machine.push_back(MFunction{function.name, {}});
+    X86Emitter emitter(function, allocation, machine.back().code);
+    emitter.emit();
+    times.steps[CodegenTimes::EMISSION] += step.elapsed();
+}
+
+Operand CodeGenerationVisitor::lower(const Exp& exp) {
+    exp.accept(*this);
+    return result;
+}
+
+// Numeracao de Sethi-Ullman e efeitos colaterais de cada subarvore,
+// calculados uma unica vez por no.
+const CodeGenerationVisitor::ExpInfo& CodeGenerationVisitor::info(const Exp& exp) {
+    auto it = expInfo.find(&exp);
+    if (it != expInfo.end()) return it->second;
+
+    ExpInfo result{1, 0};
+    auto binary = [&](const Exp& left, const Exp& right) {
+        const ExpInfo& l = info(left);
+        int leftNeed = l.need;
+        int effects = l.effects;
+        const ExpInfo& r = info(right);
+        int rightNeed = isLeaf(right) ? 0 : r.need;
+        result.need = leftNeed == rightNeed ? leftNeed + 1 : std::max(leftNeed, rightNeed);
+        result.effects = effects | r.effects;
+    };
+
+    if (auto bin = dynamic_cast<const OpBin*>(&exp)) {
+        binary(*bin->opEsq, *bin->opDir);
+    } else if (auto cmp = dynamic_cast<const ComparisonExpression*>(&exp)) {
+        binary(*cmp->left, *cmp->right);
+    } else if (auto logical = dynamic_cast<const LogicalExpression*>(&exp)) {
+        binary(*logical->left, *logical->right);
+    } else if (auto unary = dynamic_cast<const UnaryExpression*>(&exp)) {
+        result = info(*unary->operand);
+    } else if (auto assign = dynamic_cast<const AssignmentExpression*>(&exp)) {
+        result = info(*assign->value);
+        result.effects |= WRITES_VARIABLE;
+    } else if (auto element = dynamic_cast<const ArrayAccess*>(&exp)) {
+        result = info(*element->index);
+    } else if (auto store = dynamic_cast<const ArrayAssignment*>(&exp)) {
+        binary(*store->index, *store->value);
+        result.effects |= WRITES_ARRAY;
+    } else if (auto call = dynamic_cast<const FunctionCall*>(&exp)) {
+        result.need = NUM_REGS;
+        result.effects = CALLS_FUNCTION;
+        for (const auto& arg : call->arguments) {
+            result.effects |= info(*arg).effects;
+        }
+    }
+
+    return expInfo[&exp] = result;
 }
 
-void PrintVisitor::visit(const LogicalExpression& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "Logical(" << logicalOperatorToString(node.op) << ")" << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Left:" << std::endl;
-    PrintVisitor leftVisitor(depth + 1);
-    node.left->accept(leftVisitor);
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Right:" << std::endl;
-    PrintVisitor rightVisitor(depth + 1);
-    node.right->accept(rightVisitor);
+// Operandos imediatos ou em memoria so sao lidos quando a instrucao que os
+// consome executa. Se a expressao avaliada depois puder alterar a variavel,
+// o valor e copiado para um temporario antes. Elementos de vetor ja chegam
+// lidos num temporario, entao escritas em vetor nao contam.
+Operand CodeGenerationVisitor::protect(Operand value, const Exp& later) {
+    int effects = info(later).effects;
+    bool clobbered = false;
+    if (value.isVReg() && isVariable(value.vreg)) {
+        clobbered = effects & WRITES_VARIABLE;
+    } else if (value.isGlobal()) {
+        clobbered = effects & (WRITES_VARIABLE | CALLS_FUNCTION);
+    }
+
+    if (clobbered) {
+        Operand copy = Operand::reg(function.newVReg());
+        emitInstr(IROp::MOV, copy, value);
+        return copy;
+    }
+    return value;
 }
 
-void PrintVisitor::visit(const UnaryExpression& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "Unary(" << (node.isNot ? "!" : "") << ")" << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Operand:" << std::endl;
-    PrintVisitor operandVisitor(depth + 1);
-    node.operand->accept(operandVisitor);
+// Um slot ganha vreg no primeiro uso: na entrada da funcao (ou da chamada
+// expandida) para os parametros, no let para as locais.
+int CodeGenerationVisitor::slotVReg(int slot) {
+    if (slotVRegs[slot] < 0) {
+        slotVRegs[slot] = function.newVReg();
+        markVariable(slotVRegs[slot]);
+    }
+    return slotVRegs[slot];
 }
 
-void PrintVisitor::visit(const AssignmentExpression& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "Assignment(=)" << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Variable: " << node.variable << std::endl;
-    
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "|- Value:" << std::endl;
-    PrintVisitor valueVisitor(depth + 1);
-    node.value->accept(valueVisitor);
+void CodeGenerationVisitor::markVariable(int vreg) {
+    if (vreg >= static_cast<int>(variableVRegs.size())) variableVRegs.resize(vreg + 1);
+    variableVRegs[vreg] = 1;
 }
 
-void PrintVisitor::visit(const ReturnStatement& node) {
-    for (int i = 0; i < depth; ++i) std::cout << "  ";
-    std::cout << "|- Return:" << std::endl;
-    
-    depth++;
-    node.expression->accept(*this);
-    depth--;
+bool CodeGenerationVisitor::isVariable(int vreg) const {
+    return vreg < static_cast<int>(variableVRegs.size()) && variableVRegs[vreg];
 }
 
-void PrintVisitor::visit(const FunctionDeclaration& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "FunctionDeclaration(\"" << node.name << "\")" << std::endl;
-    
-    for (int i = 0; i < depth + 1; i++) std::cout << "  ";
-    std::cout << "|- Parameters:" << std::endl;
-    
-    for (size_t j = 0; j < node.parameters.size(); j++) {
-        for (int i = 0; i < depth + 2; i++) std::cout << "  ";
-        std::cout << "|- Parameter " << (j + 1) << ": " << node.parameters[j].name << std::endl;
+// Avalia os dois operandos de um no binario. A ordem original (direita
+// primeiro ou esquerda primeiro) so e trocada quando nenhum dos lados tem
+// efeitos colaterais; nesse caso o lado que precisa de mais registradores
+// vai primeiro.
+std::pair<Operand, Operand> CodeGenerationVisitor::lowerOperands(const Exp& left, const Exp& right,
+                                                                 bool rightFirst) {
+    const ExpInfo& l = info(left);
+    const ExpInfo& r = info(right);
+    if (l.effects == 0 && r.effects == 0 && l.need != r.need) {
+        rightFirst = r.need > l.need;
     }
-    
-    for (int i = 0; i < depth + 1; i++) std::cout << "  ";
-    std::cout << "|- Body:" << std::endl;
-    PrintVisitor bodyVisitor(depth + 2);
-    node.body->accept(bodyVisitor);
+
+    if (rightFirst) {
+        Operand rightValue = protect(lower(right), left);
+        Operand leftValue = lower(left);
+        return {leftValue, rightValue};
+    }
+    Operand leftValue = protect(lower(left), right);
+    Operand rightValue = lower(right);
+    return {leftValue, rightValue};
 }
 
-void PrintVisitor::visit(const FunctionCall& node) {
-    for (int i = 0; i < depth; i++) std::cout << "  ";
-    std::cout << "FunctionCall(\"" << node.name << "\")" << std::endl;
-    
-    for (int i = 0; i < depth + 1; i++) std::cout << "  ";
-    std::cout << "|- Arguments:" << std::endl;
-    
-    for (size_t j = 0; j < node.arguments.size(); j++) {
-        for (int i = 0; i < depth + 2; i++) std::cout << "  ";
-        std::cout << "|- Argument " << (j + 1) << ":" << std::endl;
-        PrintVisitor argVisitor(depth + 3);
-        node.arguments[j]->accept(argVisitor);
+Operand CodeGenerationVisitor::immediate(long long value) {
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        return Operand::immediate(value);
     }
+    Operand temp = Operand::reg(function.newVReg());
+    emitInstr(IROp::MOV, temp, Operand::immediate(value));
+    return temp;
 }
 
-void CodeGenerationVisitor::visit(const Program& node) {
-    collectingVariables = true;
-    for (const auto& decl : node.globalDeclarations) {
-        if (auto varDecl = dynamic_cast<const VarDeclaration*>(decl.get())) {
-            declaredVariables.push_back(varDecl->identifier);
-        } else if (auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
-            funcDecl->accept(*this);
+// Desvia para label quando o valor logico de cond for igual a jumpIf,
+// sem materializar o resultado de comparacoes e operadores logicos.
+void CodeGenerationVisitor::lowerCondition(const Exp& cond, const std::string& label, bool jumpIf) {
+    if (auto cmp = dynamic_cast<const ComparisonExpression*>(&cond)) {
+        auto operands = lowerOperands(*cmp->left, *cmp->right, false);
+        ComparisonOperator op = jumpIf ? cmp->op : negate(cmp->op);
+        Operand a = operands.first;
+        Operand b = operands.second;
+        if (a.isImm() && b.isImm()) {
+            if (compare(a.imm, op, b.imm)) emitJump(IROp::JMP, label);
+            return;
+        }
+        if (a.isImm()) {
+            std::swap(a, b);
+            op = mirror(op);
         }
+        IRInstr instr{IROp::JCC, Operand(), a, b};
+        instr.cond = op;
+        instr.label = label;
+        function.emit(std::move(instr));
+        return;
     }
 
-    if (!declaredVariables.empty()) {
-        generateBSSSection();
-        std::cout << std::endl;
+    if (auto unary = dynamic_cast<const UnaryExpression*>(&cond)) {
+        if (unary->isNot) {
+            lowerCondition(*unary->operand, label, !jumpIf);
+            return;
+        }
     }
-    collectingVariables = false;
-    generateTextSection(node);
+
+    if (auto logical = dynamic_cast<const LogicalExpression*>(&cond)) {
+        bool isAnd = logical->op == LogicalOperator::AND;
+        if (isAnd != jumpIf) {
+            lowerCondition(*logical->left, label, jumpIf);
+            lowerCondition(*logical->right, label, jumpIf);
+        } else {
+            std::string skipLabel = generateLabel(isAnd ? "Lfalso" : "Lverdade");
+            lowerCondition(*logical->left, skipLabel, !jumpIf);
+            lowerCondition(*logical->right, label, jumpIf);
+            emitJump(IROp::LABEL, skipLabel);
+        }
+        return;
+    }
+
+    Operand value = lower(cond);
+    emitJump(jumpIf ? IROp::JNZ : IROp::JZ, label, value);
 }
 
-void CodeGenerationVisitor::generateBSSSection() {
-    std::cout << ".section .bss" << std::endl;
-    for (const auto& varName : declaredVariables) {
-        std::cout << ".lcomm " << varName << ", 8" << std::endl;
+void CodeGenerationVisitor::emitInstr(IROp op, Operand dst, Operand a, Operand b) {
+    IRInstr instr{op, std::move(dst), std::move(a), std::move(b)};
+    function.emit(std::move(instr));
+}
+
+void CodeGenerationVisitor::emitJump(IROp op, const std::string& label, Operand cond) {
+    IRInstr instr{op, Operand(), std::move(cond)};
+    instr.label = label;
+    function.emit(std::move(instr));
+}
+
+void CodeGenerationVisitor::emitExit(Operand value) {
+    if (!options.profileGenerate.empty()) {
+        IRInstr call{IROp::CALL, Operand::reg(function.newVReg())};
+        call.label = PROFILE_WRITER;
+        call.convention = CallingConvention::SYSV;
+        function.emit(std::move(call));
     }
+    emitInstr(IROp::EXIT, Operand(), value);
 }
 
-void CodeGenerationVisitor::generateTextSection(const Program& node) {
-    collectingVariables = false;
-    std::cout << ".section .text" << std::endl;
-    std::cout << ".globl _start" << std::endl;
-    std::cout << std::endl;
-    
-    for (const auto& decl : node.globalDeclarations) {
-        if (auto funcDecl = dynamic_cast<const FunctionDeclaration*>(decl.get())) {
-            funcDecl->accept(*this);
-            std::cout << std::endl;
-        }
+void CodeGenerationVisitor::emitCount(const void* node, int slot) {
+    if (options.profileGenerate.empty()) return;
+    int counter = context->profile.counter(node, slot);
+    if (counter >= 0) {
+        emitInstr(IROp::COUNT, Operand(), Operand::immediate(counter));
     }
-    
-    std::cout << "_start:" << std::endl;
-    
-    for (const auto& decl : node.globalDeclarations) {
-        if (auto varDecl = dynamic_cast<const VarDeclaration*>(decl.get())) {
-            decl->accept(*this);
-        }
+}
+
+// Gera stmt fora do fluxo principal: o codigo vai para o fim da funcao,
+// comeca em label e volta para resume.
+void CodeGenerationVisitor::emitCold(const Statement& stmt, const std::string& label, const std::string& resume) {
+    std::vector<IRInstr> hot;
+    std::swap(hot, function.code);
+    emitJump(IROp::LABEL, label);
+    stmt.accept(*this);
+    if (!isTerminator(function.code.back())) {
+        emitJump(IROp::JMP, resume);
     }
-    
-    if (node.mainFunction) {
-        node.mainFunction->accept(*this);
+    std::swap(hot, function.code);
+    for (auto& instr : hot) {
+        coldCode.push_back(std::move(instr));
     }
 }
 
+// Os vetores locais de um bloco saem da pilha no fim dele.
 void CodeGenerationVisitor::visit(const BlockStatement& node) {
+    Operand stack;
+    if (node.declaresArrays) {
+        stack = Operand::reg(function.newVReg());
+        emitInstr(IROp::STACKSAVE, stack);
+    }
     for (const auto& stmt : node.statements) {
         stmt->accept(*this);
     }
+    if (node.declaresArrays && !isTerminator(function.code.back())) {
+        emitInstr(IROp::STACKRESTORE, Operand(), stack);
+    }
 }
 
 void CodeGenerationVisitor::visit(const MainFunction& node) {
+    slotVRegs.assign(node.frameSlots, -1);
+    emitCount(&node);
     node.body->accept(*this);
 }
 
+// flush() e embutido enquanto o programa nao declarar uma funcao com
+// esse nome.
+bool CodeGenerationVisitor::isFlushCall(const Exp& exp) const {
+    auto call = dynamic_cast<const FunctionCall*>(&exp);
+    return call && call->name == "flush" && !context->functionDeclarations.count(call->name) &&
+           !context->externFunctions.count(call->name);
+}
+
 void CodeGenerationVisitor::visit(const ExpressionStatement& node) {
     isAssignmentExpression = false;
-    node.expression->accept(*this);
+    Operand value = lower(*node.expression);
 
-    if (!isAssignmentExpression) {
-        std::cout << "  call imprime_num" << std::endl;
+    if (!isAssignmentExpression && !isFlushCall(*node.expression)) {
+        emitInstr(IROp::PRINT, Operand(), value);
     }
 }
 
 void CodeGenerationVisitor::visit(const VarDeclaration& node) {
-    if (collectingVariables) return;
-    
-    if (insideFunction) {
-        if (node.initializer) {
-            node.initializer->accept(*this);
-        } else {
-            std::cout << "  mov $0, %rax" << std::endl;
-        }
-        
-        int offset = localOffsets[node.identifier];
-        std::cout << "  mov %rax, " << offset << "(%rbp)" << std::endl;
+    Operand value = node.initializer ? lower(*node.initializer) : Operand::immediate(0);
+
+    if (node.binding.storage == StorageClass::GLOBAL) {
+        emitInstr(IROp::MOV, Operand::global(node.identifier), value);
+        return;
+    }
+
+    // O slot ja tem vreg quando o let e gerado de novo, nas copias de um
+    // laco desenrolado: o nome vale o mesmo em todas elas.
+    int slot = node.binding.slot;
+    if (slotVRegs[slot] < 0 && value.isVReg() && !isVariable(value.vreg)) {
+        slotVRegs[slot] = value.vreg;
+        markVariable(value.vreg);
     } else {
-        if (node.initializer) {
-            node.initializer->accept(*this);
-            std::cout << "  mov %rax, " << node.identifier << std::endl;
-        } else {
-            std::cout << "  mov $0, %rax" << std::endl;
-            std::cout << "  mov %rax, " << node.identifier << std::endl;
-        }
+        emitInstr(IROp::MOV, Operand::reg(slotVReg(slot)), value);
+    }
+}
+
+// Vetor global: so o espaco no .bss. Local: a reserva na pilha e, quando o
+// tamanho nao e constante, o tamanho no slot seguinte, para as checagens.
+void CodeGenerationVisitor::visit(const ArrayDeclaration& node) {
+    if (node.binding.storage == StorageClass::GLOBAL) return;
+
+    Operand count = lower(*node.size);
+    int slot = node.binding.slot;
+    emitInstr(IROp::ALLOCA, Operand::reg(slotVReg(slot)), count);
+    if (node.length < 0) {
+        emitInstr(IROp::MOV, Operand::reg(slotVReg(slot + 1)), count);
     }
 }
 
 void CodeGenerationVisitor::visit(const Variable& node) {
-    if (insideFunction) {
-        if (parameterOffsets.find(node.name) != parameterOffsets.end()) {
-            int offset = parameterOffsets[node.name];
-            std::cout << "  mov " << offset << "(%rbp), %rax" << std::endl;
-            return;
-        }
-        
-        if (localOffsets.find(node.name) != localOffsets.end()) {
-            int offset = localOffsets[node.name];
-            std::cout << "  mov " << offset << "(%rbp), %rax" << std::endl;
-            return;
-        }
+    if (node.binding.storage == StorageClass::GLOBAL) {
+        result = Operand::global(node.name);
+    } else {
+        result = Operand::reg(slotVReg(node.binding.slot));
     }
-    
-    std::cout << "  mov " << node.name << ", %rax" << std::endl;
 }
 
 void CodeGenerationVisitor::visit(const Const& node) {
-    std::cout << "  mov $" << node.valor << ", %rax" << std::endl;
+    result = Operand::immediate(node.valor);
 }
 
 void CodeGenerationVisitor::visit(const BooleanLiteral& node) {
-    std::cout << "  mov $" << (node.value ? 1 : 0) << ", %rax" << std::endl;
+    result = Operand::immediate(node.value ? 1 : 0);
 }
 
 void CodeGenerationVisitor::visit(const OpBin& node) {
-    node.opDir->accept(*this);
-    std::cout << "  push %rax" << std::endl;
-    
-    node.opEsq->accept(*this);
-    std::cout << "  pop %rbx" << std::endl;
-    
+    auto operands = lowerOperands(*node.opEsq, *node.opDir, true);
+    Operand left = operands.first;
+    Operand right = operands.second;
+
+    IROp op;
     switch (node.op) {
-        case Operador::SOMA:
-            std::cout << "  add %rbx, %rax" << std::endl;
-            break;
-        case Operador::SUB:
-            std::cout << "  sub %rbx, %rax" << std::endl;
-            break;
-        case Operador::MULT:
-            std::cout << "  imul %rbx, %rax" << std::endl;
-            break;
-        case Operador::DIV:
-            std::cout << "  cqo" << std::endl;
-            std::cout << "  idiv %rbx" << std::endl;
-            break;
+        case Operador::SOMA: op = IROp::ADD; break;
+        case Operador::SUB: op = IROp::SUB; break;
+        case Operador::MULT: op = IROp::MUL; break;
+        case Operador::DIV: op = IROp::DIV; break;
         default:
             throw std::runtime_error("Operador desconhecido na geracao de codigo.");
     }
+
+    if (left.isImm() && right.isImm()) {
+        unsigned long long a = left.imm;
+        unsigned long long b = right.imm;
+        switch (op) {
+            case IROp::ADD: result = immediate(static_cast<long long>(a + b)); return;
+            case IROp::SUB: result = immediate(static_cast<long long>(a - b)); return;
+            case IROp::MUL: result = immediate(static_cast<long long>(a * b)); return;
+            default:
+                if (right.imm != 0 && !(right.imm == -1 && left.imm == INT64_MIN)) {
+                    result = immediate(left.imm / right.imm);
+                    return;
+                }
+                break;
+        }
+    }
+
+    if (left.isImm() && (op == IROp::ADD || op == IROp::MUL)) {
+        std::swap(left, right);
+    }
+
+    result = Operand::reg(function.newVReg());
+    emitInstr(op, result, left, right);
 }
 
 void CodeGenerationVisitor::visit(const IfStatement& node) {
-    if (collectingVariables) return;
-    
+    if (lowerEqualityChain(node)) return;
     std::string falseLabel = generateLabel("Lfalso");
     std::string endLabel = generateLabel("Lfim");
+    uint64_t thenCount = context->profile.count(&node, 0);
+    uint64_t elseCount = context->profile.count(&node, 1);
+
+    // Ramo que o perfil nunca viu executar vai para o fim da funcao.
+    bool thenCold = thenCount == 0 && elseCount > 0;
+    bool elseCold = elseCount == 0 && thenCount > 0 && node.elseBranch;
+    if (thenCold || elseCold) {
+        std::string coldLabel = generateLabel("Lfrio");
+        lowerCondition(*node.condition, coldLabel, thenCold);
+        const Statement* hot = thenCold ? node.elseBranch.get() : node.thenBranch.get();
+        if (hot) hot->accept(*this);
+        emitJump(IROp::LABEL, endLabel);
+        emitCold(thenCold ? *node.thenBranch : *node.elseBranch, coldLabel, endLabel);
+        decisions.coldBlocks++;
+        return;
+    }
+
+    // O else mais executado fica no caminho sem desvio.
+    if (node.elseBranch && elseCount > thenCount) {
+        std::string thenLabel = generateLabel("Lverdade");
+        lowerCondition(*node.condition, thenLabel, true);
+        node.elseBranch->accept(*this);
+        if (!isTerminator(function.code.back())) emitJump(IROp::JMP, endLabel);
+        emitJump(IROp::LABEL, thenLabel);
+        node.thenBranch->accept(*this);
+        emitJump(IROp::LABEL, endLabel);
+        decisions.swappedBranches++;
+        return;
+    }
     
-    node.condition->accept(*this);
-    
-    std::cout << "    cmp $0, %rax" << std::endl;
-    std::cout << "    jz " << falseLabel << std::endl;
+    lowerCondition(*node.condition, falseLabel, false);
     
+    emitCount(&node, 0);
     node.thenBranch->accept(*this);
     
-    if (node.elseBranch) {
-        std::cout << "    jmp " << endLabel << std::endl;
-        std::cout << falseLabel << ":" << std::endl;
-        node.elseBranch->accept(*this);
-        std::cout << endLabel << ":" << std::endl;
+    if (node.elseBranch || !options.profileGenerate.empty()) {
+        emitJump(IROp::JMP, endLabel);
+        emitJump(IROp::LABEL, falseLabel);
+        emitCount(&node, 1);
+        if (node.elseBranch) node.elseBranch->accept(*this);
+        emitJump(IROp::LABEL, endLabel);
     } else {
-        std::cout << falseLabel << ":" << std::endl;
+        emitJump(IROp::LABEL, falseLabel);
     }
 }
 
+// Com -O1, um laco com acessos sem checagem (markBoundsChecks) e gerado
+// na versao rapida; se ela depende de o indice nao ser negativo na entrada,
+// a versao com checagens fica para o caso contrario.
 void CodeGenerationVisitor::visit(const WhileStatement& node) {
-    if (collectingVariables) return;
-    
+    if (!node.boundsIndex || options.optimizationLevel == 0) {
+        emitLoop(node);
+        return;
+    }
+
+    std::string checkedLabel = generateLabel("Lchecado");
+    std::string doneLabel = generateLabel("Lfim");
+    if (node.entryTest) {
+        IRInstr test{IROp::JCC, Operand(), lower(*node.boundsIndex), Operand::immediate(0)};
+        test.cond = ComparisonOperator::LESS;
+        test.label = checkedLabel;
+        function.emit(std::move(test));
+    }
+    fastLoops.push_back(&node);
+    vectorizeLoop(node);
+    emitLoop(node);
+    fastLoops.pop_back();
+    if (node.entryTest) {
+        emitJump(IROp::JMP, doneLabel);
+        emitJump(IROp::LABEL, checkedLabel);
+        emitLoop(node);
+        emitJump(IROp::LABEL, doneLabel);
+    }
+}
+
+void CodeGenerationVisitor::emitLoop(const WhileStatement& node) {
     std::string loopLabel = generateLabel("Linicio");
     std::string endLabel = generateLabel("Lfim");
     
-    std::cout << loopLabel << ":" << std::endl;
-    
-    node.condition->accept(*this);
-    
-    std::cout << "    cmp $0, %rax" << std::endl;
-    std::cout << "    jz " << endLabel << std::endl;
-    
-    node.body->accept(*this);
-    
-    std::cout << "    jmp " << loopLabel << std::endl;
+    emitCount(&node, 0);
+    emitJump(IROp::LABEL, loopLabel);
+
+    // Copias extras do corpo, cada uma com o proprio teste: so o desvio de
+    // volta e economizado. Declaracoes nas copias caem nos vregs ja dados
+    // aos slots delas na primeira.
+    int factor = unrollFactor(node);
+    for (int copy = 0; copy < factor; copy++) {
+        lowerCondition(*node.condition, endLabel, false);
+        emitCount(&node, 1);
+        node.body->accept(*this);
+    }
+    if (factor > 1) decisions.unrolledLoops++;
     
-    std::cout << endLabel << ":" << std::endl;
+    emitJump(IROp::JMP, loopLabel);
+    emitJump(IROp::LABEL, endLabel);
 }
 
 void CodeGenerationVisitor::visit(const ComparisonExpression& node) {
-    if (collectingVariables) return;
-    
-    node.left->accept(*this);
-    std::cout << "    pushq %rax" << std::endl;
-    
-    node.right->accept(*this);
-    std::cout << "    popq %rbx" << std::endl;
-    
-    std::cout << "    cmp %rax, %rbx" << std::endl;
-    
-    switch (node.op) {
-        case ComparisonOperator::EQUAL:
-            std::cout << "    sete %al" << std::endl;
-            break;
-        case ComparisonOperator::NOT_EQUAL:
-            std::cout << "    setne %al" << std::endl;
-            break;
-        case ComparisonOperator::LESS:
-            std::cout << "    setl %al" << std::endl;
-            break;
-        case ComparisonOperator::GREATER:
-            std::cout << "    setg %al" << std::endl;
-            break;
-        case ComparisonOperator::LESS_EQUAL:
-            std::cout << "    setle %al" << std::endl;
-            break;
-        case ComparisonOperator::GREATER_EQUAL:
-            std::cout << "    setge %al" << std::endl;
-            break;
+    auto operands = lowerOperands(*node.left, *node.right, false);
+    Operand left = operands.first;
+    Operand right = operands.second;
+    ComparisonOperator op = node.op;
+
+    if (left.isImm() && right.isImm()) {
+        result = Operand::immediate(compare(left.imm, op, right.imm) ? 1 : 0);
+        return;
+    }
+    if (left.isImm()) {
+        std::swap(left, right);
+        op = mirror(op);
     }
     
-    std::cout << "    movzbl %al, %eax" << std::endl;
+    result = Operand::reg(function.newVReg());
+    IRInstr instr{IROp::CMP, result, left, right};
+    instr.cond = op;
+    function.emit(std::move(instr));
 }
 
 void CodeGenerationVisitor::visit(const LogicalExpression& node) {
-    if (collectingVariables) return;
-    
     std::string shortCircuitLabel = generateLabel("Lcircuit");
     std::string endLabel = generateLabel("Lend");
     
-    node.left->accept(*this);
-    
-    if (node.op == LogicalOperator::OR) {
-        std::cout << "    cmp $0, %rax" << std::endl;
-        std::cout << "    jnz " << shortCircuitLabel << std::endl;
-    } else {
-        std::cout << "    cmp $0, %rax" << std::endl;
-        std::cout << "    jz " << shortCircuitLabel << std::endl;
-    }
+    Operand value = Operand::reg(function.newVReg());
+    emitInstr(IROp::MOV, value, lower(*node.left));
+    emitJump(node.op == LogicalOperator::OR ? IROp::JNZ : IROp::JZ, shortCircuitLabel, value);
 
-    node.right->accept(*this);
-    std::cout << "    jmp " << endLabel << std::endl;
+    emitInstr(IROp::MOV, value, lower(*node.right));
+    emitJump(IROp::JMP, endLabel);
     
-    std::cout << shortCircuitLabel << ":" << std::endl;
-    
-    std::cout << endLabel << ":" << std::endl;
+    emitJump(IROp::LABEL, shortCircuitLabel);
+    emitJump(IROp::LABEL, endLabel);
+    result = value;
 }
 
 void CodeGenerationVisitor::visit(const UnaryExpression& node) {
-    if (collectingVariables) return;
-    
-    node.operand->accept(*this);
+    Operand operand = lower(*node.operand);
     
-    if (node.isNot) {
-        std::cout << "    cmp $0, %rax" << std::endl;
-        std::cout << "    sete %al" << std::endl;
-        std::cout << "    movzbl %al, %eax" << std::endl;
+    if (node.isNot && operand.isImm()) {
+        result = Operand::immediate(operand.imm == 0 ? 1 : 0);
+    } else if (node.isNot) {
+        result = Operand::reg(function.newVReg());
+        emitInstr(IROp::NOT, result, operand);
+    } else {
+        result = operand;
     }
 }
 
 void CodeGenerationVisitor::visit(const AssignmentExpression& node) {
-    if (collectingVariables) return;
-    
     isAssignmentExpression = true;
 
-    node.value->accept(*this);
+    Operand value = lower(*node.value);
     
-    if (insideFunction) {
-        if (parameterOffsets.find(node.variable) != parameterOffsets.end()) {
-            int offset = parameterOffsets[node.variable];
-            std::cout << "    mov %rax, " << offset << "(%rbp)" << std::endl;
-            return;
+    if (node.binding.storage != StorageClass::GLOBAL) {
+        result = Operand::reg(slotVReg(node.binding.slot));
+        IRInstr* last = function.code.empty() ? nullptr : &function.code.back();
+        if (value.isVReg() && !isVariable(value.vreg) && last &&
+            last->op != IROp::LABEL && last->dst.isVReg() && last->dst.vreg == value.vreg) {
+            last->dst = result;
+        } else {
+            emitInstr(IROp::MOV, result, value);
         }
+        return;
+    }
 
-        if (localOffsets.find(node.variable) != localOffsets.end()) {
-            int offset = localOffsets[node.variable];
-            std::cout << "    mov %rax, " << offset << "(%rbp)" << std::endl;
-            return;
-        }
+    emitInstr(IROp::MOV, Operand::global(node.variable), value);
+    result = value;
+}
+
+Operand CodeGenerationVisitor::arrayBase(const ArrayDeclaration& array) {
+    if (array.binding.storage == StorageClass::GLOBAL) return Operand::global(array.identifier);
+    return Operand::reg(slotVReg(array.binding.slot));
+}
+
+// Em -O0 todo acesso e checado; um indice constante dentro do vetor nunca.
+void CodeGenerationVisitor::emitBoundsCheck(const BoundsCheck& bounds, const ArrayDeclaration& array,
+                                            Operand index) {
+    if (options.optimizationLevel > 0 &&
+        (bounds.proven || std::find(fastLoops.begin(), fastLoops.end(), bounds.loop) != fastLoops.end())) {
+        return;
     }
+    Operand length = array.length > 0 ? Operand::immediate(array.length)
+                                       : Operand::reg(slotVReg(array.binding.slot + 1));
+    if (index.isImm() && length.isImm() && index.imm >= 0 && index.imm < length.imm) return;
+    emitInstr(IROp::CHECK, Operand(), index, length);
+}
+
+void CodeGenerationVisitor::visit(const ArrayAccess& node) {
+    Operand index = lower(*node.index);
+    emitBoundsCheck(node.bounds, *node.array, index);
+    result = Operand::reg(function.newVReg());
+    emitInstr(IROp::LOAD, result, arrayBase(*node.array), index);
+}
 
-    std::cout << "    mov %rax, " << node.variable << std::endl;
+void CodeGenerationVisitor::visit(const ArrayAssignment& node) {
+    isAssignmentExpression = true;
+
+    auto operands = lowerOperands(*node.index, *node.value, false);
+    Operand index = operands.first;
+    Operand value = operands.second.isImm() ? immediate(operands.second.imm) : operands.second;
+    emitBoundsCheck(node.bounds, *node.array, index);
+
+    IRInstr store{IROp::STORE, Operand(), arrayBase(*node.array), index};
+    store.args.push_back(value);
+    function.emit(std::move(store));
+    result = value;
 }
 
 void CodeGenerationVisitor::visit(const ReturnStatement& node) {
-    if (collectingVariables) return;
-    
-    node.expression->accept(*this);
-    
-    if (insideFunction) {
-        if (currentFunctionStackSize > 0) {
-            std::cout << "  add $" << currentFunctionStackSize << ", %rsp" << std::endl;
-        }
-        std::cout << "  pop %rbp" << std::endl;
-        std::cout << "  ret" << std::endl;
-        hasReturn = true;
+    Operand value = lower(*node.expression);
+    
+    if (!inlineStack.empty()) {
+        emitInstr(IROp::MOV, inlineStack.back().result, value);
+        emitJump(IROp::JMP, inlineStack.back().returnLabel);
+    } else if (function.isEntry) {
+        emitInstr(IROp::PRINT, Operand(), value);
+        emitExit(value);
     } else {
-        std::cout << "  call imprime_num" << std::endl;
-        std::cout << "call sair" << std::endl;
+        emitInstr(IROp::RET, Operand(), value);
     }
 }
 
 void CodeGenerationVisitor::visit(const FunctionDeclaration& node) {
-    if (collectingVariables) {
-        localVariables.clear();
-        parameterOffsets.clear();
-        localOffsets.clear();
-        currentFunctionStackSize = 0;
-
-        for (const auto& stmt : node.body->statements) {
-            if (auto varDecl = dynamic_cast<const VarDeclaration*>(stmt.get())) {
-                localVariables.push_back(varDecl->identifier);
-            }
-        }
-
-        int paramOffset = 16;
-        for (const auto& param : node.parameters) {
-            parameterOffsets[param.name] = paramOffset;
-            paramOffset += 8;
-        }
-        
-        int localOffset = -8;
-        for (const auto& localVar : localVariables) {
-            localOffsets[localVar] = localOffset;
-            localOffset -= 8;
-            currentFunctionStackSize += 8;
-        }
-        return;
-    }
+    beginFunction(node.name, false);
+    function.convention = options.abi;
+    if (options.instrument) function.probe = context->probes.at(node.name);
     
-    auto savedLocalVariables = localVariables;
-    auto savedParameterOffsets = parameterOffsets;
-    auto savedLocalOffsets = localOffsets;
-    auto savedFunctionStackSize = currentFunctionStackSize;
-
-    localVariables.clear();
-    parameterOffsets.clear();
-    localOffsets.clear();
-    currentFunctionStackSize = 0;
-
-    for (const auto& stmt : node.body->statements) {
-        if (auto varDecl = dynamic_cast<const VarDeclaration*>(stmt.get())) {
-            localVariables.push_back(varDecl->identifier);
-        }
+    slotVRegs.assign(node.frameSlots, -1);
+    for (size_t i = 0; i < node.parameters.size(); i++) {
+        int vreg = slotVReg(static_cast<int>(i));
+        function.params.push_back(vreg);
     }
     
-    int paramOffset = 16;
-    for (const auto& param : node.parameters) {
-        parameterOffsets[param.name] = paramOffset;
-        paramOffset += 8;
+    emitCount(&node);
+    node.body->accept(*this);
+
+    if (function.code.empty() || function.code.back().op != IROp::RET) {
+        emitInstr(IROp::RET, Operand(), Operand::immediate(0));
     }
-    
-    int localOffset = -8;
-    for (const auto& localVar : localVariables) {
-        localOffsets[localVar] = localOffset;
-        localOffset -= 8;
-        currentFunctionStackSize += 8;
+
+    emitFunction();
+}
+
+void CodeGenerationVisitor::visit(const ExternDeclaration&) {
+}
+
+int CodeGenerationVisitor::unrollFactor(const WhileStatement& node) const {
+    uint64_t entries = context->profile.count(&node, 0);
+    uint64_t iterations = context->profile.count(&node, 1);
+    if (entries == 0 || treeSize(*node.condition) + treeSize(*node.body) > UNROLL_MAX_SIZE) return 1;
+    uint64_t trips = iterations / entries;
+    return trips >= 16 ? 4 : trips >= 4 ? 2 : 1;
+}
+
+bool CodeGenerationVisitor::shouldInline(const FunctionCall& node) const {
+    const Profile& profile = context->profile;
+    if (!profile.loaded() || profile.count(&node) < HOT_CALL_COUNT) return false;
+    if (static_cast<int>(inlineStack.size()) >= INLINE_MAX_DEPTH) return false;
+    auto callee = context->functionDeclarations.find(node.name);
+    if (callee == context->functionDeclarations.end()) return false;
+    if (context->externFunctions.count(node.name)) return false;
+    const FunctionDeclaration& decl = *callee->second;
+    if (decl.parameters.size() != node.arguments.size() || treeSize(*decl.body) > INLINE_MAX_SIZE) return false;
+    if (decl.declaresArrays) return false;  // a pilha do chamador cresceria a cada chamada
+    for (const auto& frame : inlineStack) {
+        if (frame.name == node.name) return false;
+    }
+    return true;
+}
+
+// Expande o corpo da funcao no lugar da chamada. Os argumentos sao
+// avaliados na mesma ordem da chamada e copiados para vregs novos, ja que o
+// corpo pode alterar os parametros; as locais do chamador ficam ocultas.
+void CodeGenerationVisitor::inlineCall(const FunctionCall& node) {
+    const FunctionDeclaration& decl = *context->functionDeclarations.at(node.name);
+    std::vector<Operand> args(node.arguments.size());
+    for (int i = static_cast<int>(node.arguments.size()) - 1; i >= 0; i--) {
+        Operand arg = lower(*node.arguments[i]);
+        for (int j = 0; j < i; j++) {
+            arg = protect(arg, *node.arguments[j]);
+        }
+        args[i] = arg;
     }
 
-    std::cout << node.name << ":" << std::endl;
-    
-    std::cout << "  push %rbp" << std::endl;
-    std::cout << "  mov %rsp, %rbp" << std::endl;
-    if (currentFunctionStackSize > 0) {
-        std::cout << "  sub $" << currentFunctionStackSize << ", %rsp" << std::endl;
+    std::vector<int> callerSlots(decl.frameSlots, -1);
+    std::swap(callerSlots, slotVRegs);
+    for (size_t i = 0; i < args.size(); i++) {
+        emitInstr(IROp::MOV, Operand::reg(slotVReg(static_cast<int>(i))), args[i]);
     }
-    
-    insideFunction = true;
-    hasReturn = false;
 
-    node.body->accept(*this);
-    
-    insideFunction = false;
+    Operand value = Operand::reg(function.newVReg());
+    std::string returnLabel = generateLabel("Lretorno");
+    inlineStack.push_back(InlineFrame{node.name, returnLabel, value});
+    bool wasAssignment = isAssignmentExpression;
 
-    if (!hasReturn) {
-        std::cout << "  mov $0, %rax" << std::endl;
-        if (currentFunctionStackSize > 0) {
-            std::cout << "  add $" << currentFunctionStackSize << ", %rsp" << std::endl;
-        }
-        std::cout << "  pop %rbp" << std::endl;
-        std::cout << "  ret" << std::endl;
+    decl.body->accept(*this);
+
+    if (function.code.empty() || !isTerminator(function.code.back())) {
+        emitInstr(IROp::MOV, value, Operand::immediate(0));
+    } else if (function.code.back().op == IROp::JMP && function.code.back().label == returnLabel) {
+        function.code.pop_back();
     }
-    
-    localVariables = savedLocalVariables;
-    parameterOffsets = savedParameterOffsets;
-    localOffsets = savedLocalOffsets;
-    currentFunctionStackSize = savedFunctionStackSize;
+    emitJump(IROp::LABEL, returnLabel);
+
+    isAssignmentExpression = wasAssignment;
+    inlineStack.pop_back();
+    std::swap(callerSlots, slotVRegs);
+    decisions.inlinedCalls++;
+    result = value;
 }
 
 void CodeGenerationVisitor::visit(const FunctionCall& node) {
-    if (collectingVariables) return;
+    if (isFlushCall(node)) {
+        if (!node.arguments.empty()) {
+            throw std::runtime_error("Erro semantico: flush() nao recebe argumentos.");
+        }
+        emitInstr(IROp::FLUSH);
+        result = Operand::immediate(0);
+        return;
+    }
+    if (shouldInline(node)) {
+        inlineCall(node);
+        return;
+    }
 
-    for (int i = node.arguments.size() - 1; i >= 0; i--) {
-        node.arguments[i]->accept(*this);
-        std::cout << "  push %rax" << std::endl;
+    IRInstr call{IROp::CALL};
+    call.label = node.name;
+    call.convention = options.abi;
+
+    auto externFunc = context->externFunctions.find(node.name);
+    if (externFunc != context->externFunctions.end()) {
+        if (externFunc->second != node.arguments.size()) {
+            throw std::runtime_error("Erro semantico: funcao externa '" + node.name + "' espera " +
+                                     std::to_string(externFunc->second) + " argumentos.");
+        }
+        call.convention = CallingConvention::SYSV;
     }
-    
-    std::cout << "  call " << node.name << std::endl;
-    
-    if (!node.arguments.empty()) {
-        std::cout << "  add $" << (node.arguments.size() * 8) << ", %rsp" << std::endl;
+    call.args.resize(node.arguments.size());
+    emitCount(&node);
+
+    for (int i = static_cast<int>(node.arguments.size()) - 1; i >= 0; i--) {
+        Operand arg = lower(*node.arguments[i]);
+        for (int j = 0; j < i; j++) {
+            arg = protect(arg, *node.arguments[j]);
+        }
+        call.args[i] = arg;
     }
-}
\ No newline at end of file
+    
+    result = Operand::reg(function.newVReg());
+    call.dst = result;
+    function.emit(std::move(call));
+}
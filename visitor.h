@@ -3,6 +3,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+
+#include "cache.h"
+#include "ir.h"
+#include "machine.h"
+#include "options.h"
+#include "profile.h"
+#include "timereport.h"
 
 class Const;
 class BooleanLiteral;
@@ -12,10 +20,16 @@ class ComparisonExpression;
 class LogicalExpression;
 class UnaryExpression;
 class AssignmentExpression;
+class ArrayDeclaration;
+class ArrayAccess;
+class ArrayAssignment;
 class IfStatement;
 class WhileStatement;
+class ParallelForStatement;
+class MatchStatement;
 class ReturnStatement;
 class FunctionDeclaration;
+class ExternDeclaration;
 class FunctionCall;
 class Program;
 class BlockStatement;
@@ -34,10 +48,14 @@ public:
     virtual void visit(const MainFunction& node) = 0;
     virtual void visit(const ExpressionStatement& node) = 0;
     virtual void visit(const VarDeclaration& node) = 0;
+    virtual void visit(const ArrayDeclaration& node) = 0;
     virtual void visit(const IfStatement& node) = 0;
     virtual void visit(const WhileStatement& node) = 0;
+    virtual void visit(const ParallelForStatement& node) = 0;
+    virtual void visit(const MatchStatement& node) = 0;
     virtual void visit(const ReturnStatement& node) = 0;
     virtual void visit(const FunctionDeclaration& node) = 0;
+    virtual void visit(const ExternDeclaration& node) = 0;
     virtual void visit(const Const& node) = 0;
     virtual void visit(const BooleanLiteral& node) = 0;
     virtual void visit(const Variable& node) = 0;
@@ -46,66 +64,161 @@ public:
     virtual void visit(const LogicalExpression& node) = 0;
     virtual void visit(const UnaryExpression& node) = 0;
     virtual void visit(const AssignmentExpression& node) = 0;
+    virtual void visit(const ArrayAccess& node) = 0;
+    virtual void visit(const ArrayAssignment& node) = 0;
     virtual void visit(const FunctionCall& node) = 0;
 };
 
-class PrintVisitor : public Visitor {
+class CodeGenerationVisitor : public Visitor {
 private:
-    int depth;
+    enum Effects { WRITES_VARIABLE = 1, CALLS_FUNCTION = 2, WRITES_ARRAY = 4 };
 
-public:
-    PrintVisitor(int d = 0) : depth(d) {}
+    struct ExpInfo {
+        int need;
+        int effects;
+    };
 
-    void visit(const Program& node) override;
-    void visit(const BlockStatement& node) override;
-    void visit(const MainFunction& node) override;
-    void visit(const ExpressionStatement& node) override;
-    void visit(const VarDeclaration& node) override;
-    void visit(const IfStatement& node) override;
-    void visit(const WhileStatement& node) override;
-    void visit(const ReturnStatement& node) override;
-    void visit(const FunctionDeclaration& node) override;
-    void visit(const Const& node) override;
-    void visit(const BooleanLiteral& node) override;
-    void visit(const Variable& node) override;
-    void visit(const OpBin& node) override;
-    void visit(const ComparisonExpression& node) override;
-    void visit(const LogicalExpression& node) override;
-    void visit(const UnaryExpression& node) override;
-    void visit(const AssignmentExpression& node) override;
-    void visit(const FunctionCall& node) override;
-};
+    // Chamada expandida no lugar: return vira copia para result e desvio
+    // para returnLabel.
+    struct InlineFrame {
+        std::string name;
+        std::string returnLabel;
+        Operand result;
+    };
 
-class CodeGenerationVisitor : public Visitor {
-private:
-    std::vector<std::string> declaredVariables;
-    std::vector<std::string> localVariables;
-    std::map<std::string, int> parameterOffsets;
-    std::map<std::string, int> localOffsets;
-    int currentFunctionStackSize = 0;
-    bool collectingVariables = false;
+    // Laco sendo vetorizado (vectorizer.cpp).
+    struct VectorLoop;
+
+    // Braco de um match, ou de uma cadeia de if convertida, e um grupo de
+    // valores tratado por um so teste (switch.cpp).
+    struct MatchCase {
+        std::vector<int> values;
+        const Statement* body;
+    };
+    struct MatchCluster;
+
+    // Dados do programa inteiro, reunidos antes de gerar as funcoes e so
+    // lidos depois disso, inclusive pelas funcoes geradas em paralelo.
+    struct ProgramContext {
+        std::vector<std::string> declaredVariables;
+        std::vector<const ArrayDeclaration*> globalArrays;
+        std::map<std::string, size_t> externFunctions;
+        std::map<std::string, const FunctionDeclaration*> functionDeclarations;
+        Profile profile;
+        // --instrument: registro de cada funcao na tabela, na ordem das
+        // declaracoes; main (o _start) fica com o ultimo
+        std::map<std::string, int> probes;
+        std::unique_ptr<FunctionCache> cache;  // nulo sem --cache
+    };
+
+    CompilerOptions options;
+    std::shared_ptr<const ProgramContext> context;
+    std::vector<MFunction> machine;
+    std::vector<IRFunction> irProgram;
+    IRFunction function;
+    // vreg de cada slot do quadro (ast.h), -1 antes do primeiro uso; uma
+    // chamada expandida troca o vetor pelo do corpo dela.
+    std::vector<int> slotVRegs;
+    std::vector<char> variableVRegs;
+    std::unordered_map<const Exp*, ExpInfo> expInfo;
+    Operand result;
     bool isAssignmentExpression = false;
-    bool insideFunction = false;
-    bool hasReturn = false;
     int labelCounter = 0;
+    ProfileDecisions decisions;
+    CacheStats cacheStats;
+    CodegenTimes times;
+    ThreadSample loweringStart;
+    std::vector<InlineFrame> inlineStack;
+    std::vector<IRInstr> coldCode;
+    // Lacos cuja versao rapida esta sendo gerada: os acessos ligados a eles
+    // (BoundsCheck::loop) saem sem checagem.
+    std::vector<const WhileStatement*> fastLoops;
 
+    // Rotulos numerados por funcao e prefixados com o nome dela, para que
+    // cada funcao possa ser gerada sozinha.
     std::string generateLabel(const std::string& prefix) {
-        return prefix + std::to_string(labelCounter++);
+        return function.name + "." + prefix + std::to_string(labelCounter++);
     }
 
+    CodeGenerationVisitor(CompilerOptions options, std::shared_ptr<const ProgramContext> context)
+        : options(options), context(std::move(context)) {}
+
+    std::vector<MInstr>& directives();
     void generateBSSSection();
     void generateTextSection(const Program& node);
+    void generateFunction(const FunctionDeclaration& node);
+    void beginFunction(const std::string& name, bool isEntry);
+    void emitFunction();
+    Operand lower(const Exp& exp);
+    const ExpInfo& info(const Exp& exp);
+    Operand protect(Operand value, const Exp& later);
+    int slotVReg(int slot);
+    void markVariable(int vreg);
+    bool isVariable(int vreg) const;
+    std::pair<Operand, Operand> lowerOperands(const Exp& left, const Exp& right, bool rightFirst);
+    Operand immediate(long long value);
+    void lowerCondition(const Exp& cond, const std::string& label, bool jumpIf);
+    void emitInstr(IROp op, Operand dst = Operand(), Operand a = Operand(), Operand b = Operand());
+    void emitJump(IROp op, const std::string& label, Operand cond = Operand());
+    void emitExit(Operand value);
+    void emitCount(const void* node, int slot = 0);
+    void emitCold(const Statement& stmt, const std::string& label, const std::string& resume);
+    bool isFlushCall(const Exp& exp) const;
+    bool shouldInline(const FunctionCall& node) const;
+    void inlineCall(const FunctionCall& node);
+    int unrollFactor(const WhileStatement& node) const;
+    void emitLoop(const WhileStatement& node);
+    Operand arrayBase(const ArrayDeclaration& array);
+    void emitBoundsCheck(const BoundsCheck& bounds, const ArrayDeclaration& array, Operand index);
+    void vectorizeLoop(const WhileStatement& node);
+    bool planVector(const Exp& exp, VectorLoop& loop) const;
+    int lowerVector(const Exp& exp, VectorLoop& loop);
+    void checkParallelBodies(const Program& node) const;
+    void outlineParallel(const ParallelForStatement& node, const std::string& name);
+    bool lowerEqualityChain(const IfStatement& node);
+    void lowerMatch(const Exp& subject, const std::vector<MatchCase>& arms, const Statement* otherwise);
+    void emitClusters(Operand value, const std::vector<MatchCluster>& clusters, size_t first, size_t last,
+                      long long low, long long high, const std::string& fallback);
+    void emitCluster(Operand value, const MatchCluster& cluster, long long low, long long high,
+                     const std::string& miss);
+    void generateProfileSection();
+    void generateInstrumentSection(const Program& node);
 
 public:
+    explicit CodeGenerationVisitor(CompilerOptions options = CompilerOptions())
+        : options(options) {}
+
+    // Programa completo em instrucoes de maquina, uma lista por funcao,
+    // inclusive as diretivas de secao e o .include do runtime.
+    const std::vector<MFunction>& machineFunctions() const { return machine; }
+
+    // As mesmas instrucoes numa lista unica, para o montador e o JIT.
+    std::vector<MInstr> machineCode() const;
+
+    // Com options.interpret, o IR de cada funcao (_start por ultimo) e as
+    // globais declaradas, na ordem do programa.
+    const std::vector<IRFunction>& irFunctions() const { return irProgram; }
+    const std::vector<std::string>& globalVariables() const { return context->declaredVariables; }
+
+    const ProfileDecisions& profileDecisions() const { return decisions; }
+    const CacheStats& cacheStatistics() const { return cacheStats; }
+
+    // Com options.timeReport, as etapas da geracao somadas entre as funcoes.
+    const CodegenTimes& codegenTimes() const { return times; }
+
     void visit(const Program& node) override;
     void visit(const BlockStatement& node) override;
     void visit(const MainFunction& node) override;
     void visit(const ExpressionStatement& node) override;
     void visit(const VarDeclaration& node) override;
+    void visit(const ArrayDeclaration& node) override;
     void visit(const IfStatement& node) override;
     void visit(const WhileStatement& node) override;
+    void visit(const ParallelForStatement& node) override;
+    void visit(const MatchStatement& node) override;
     void visit(const ReturnStatement& node) override;
     void visit(const FunctionDeclaration& node) override;
+    void visit(const ExternDeclaration& node) override;
     void visit(const Const& node) override;
     void visit(const BooleanLiteral& node) override;
     void visit(const Variable& node) override;
@@ -114,5 +227,7 @@ public:
     void visit(const LogicalExpression& node) override;
     void visit(const UnaryExpression& node) override;
     void visit(const AssignmentExpression& node) override;
+    void visit(const ArrayAccess& node) override;
+    void visit(const ArrayAssignment& node) override;
     void visit(const FunctionCall& node) override;
 };
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "vm.h"
+#include <algorithm>
+#include <dlfcn.h>
+#include <stdexcept>
+
+namespace {
+
+// Aritmetica com transbordo em complemento de dois, como no codigo nativo.
+inline int64_t add(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+inline int64_t sub(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+
+inline int64_t mul(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+int64_t divide(int64_t a, int64_t b) {
+    if (b == 0 || (a == INT64_MIN && b == -1)) {
+        throw std::runtime_error("Erro em tempo de execucao: divisao invalida.");
+    }
+    return a / b;
+}
+
+inline int64_t argument(const BcArg& arg, const int64_t* r, const int64_t* g) {
+    switch (arg.kind) {
+        case BcArg::Kind::REG: return r[arg.value];
+        case BcArg::Kind::IMM: return arg.value;
+        case BcArg::Kind::GLOBAL: return g[arg.value];
+    }
+    return 0;
+}
+
+int64_t callExtern(void* function, const int64_t* a, int64_t count) {
+    typedef long long (*F0)();
+    typedef long long (*F1)(long long);
+    typedef long long (*F2)(long long, long long);
+    typedef long long (*F3)(long long, long long, long long);
+    typedef long long (*F4)(long long, long long, long long, long long);
+    typedef long long (*F5)(long long, long long, long long, long long, long long);
+    typedef long long (*F6)(long long, long long, long long, long long, long long, long long);
+    switch (count) {
+        case 0: return reinterpret_cast<F0>(function)();
+        case 1: return reinterpret_cast<F1>(function)(a[0]);
+        case 2: return reinterpret_cast<F2>(function)(a[0], a[1]);
+        case 3: return reinterpret_cast<F3>(function)(a[0], a[1], a[2]);
+        case 4: return reinterpret_cast<F4>(function)(a[0], a[1], a[2], a[3]);
+        case 5: return reinterpret_cast<F5>(function)(a[0], a[1], a[2], a[3], a[4]);
+        default: return reinterpret_cast<F6>(function)(a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+}
+
+}
+
+Vm::Vm(const BcProgram& program, RuntimeHost& host)
+    : program(program), host(host), globals(program.globals.size(), 0) {
+    if (program.entry < 0) {
+        throw std::runtime_error("Erro interno: programa sem ponto de entrada.");
+    }
+    for (const auto& name : program.externs) {
+        void* function = dlsym(RTLD_DEFAULT, name.c_str());
+        if (!function) {
+            throw std::runtime_error("Erro: funcao externa '" + name + "' nao encontrada para --run.");
+        }
+        externs.push_back(function);
+    }
+}
+
+long long Vm::run() {
+#define VM_LABEL(name) &&op_##name,
+    static const void* const labels[] = { BYTECODE_OPS(VM_LABEL) };
+#undef VM_LABEL
+
+    if (threaded.empty()) {
+        for (const auto& fn : program.functions) {
+            std::vector<Slot> slots;
+            slots.reserve(fn.code.size());
+            for (const auto& instr : fn.code) {
+                slots.push_back(Slot{labels[static_cast<int>(instr.op)], instr.a, instr.b, instr.c, instr.imm});
+            }
+            threaded.push_back(std::move(slots));
+        }
+    }
+
+    const BcFunction& entry = program.functions[program.entry];
+    std::fill(globals.begin(), globals.end(), 0);
+    stack.assign(std::max<size_t>(65536, 2 * static_cast<size_t>(entry.registerCount)), 0);
+    frames.clear();
+
+    size_t base = 0;
+    int32_t registerCount = entry.registerCount;
+    const Slot* code = threaded[program.entry].data();
+    const Slot* pc = code;
+    int64_t* r = stack.data();
+    int64_t* g = globals.data();
+    int64_t value;
+
+#define DISPATCH() goto *pc->handler
+#define NEXT() do { ++pc; DISPATCH(); } while (0)
+#define JUMP_IF(cond) do { if (cond) { pc = code + pc->a; DISPATCH(); } NEXT(); } while (0)
+
+    DISPATCH();
+
+op_MOV_RR: r[pc->a] = r[pc->b]; NEXT();
+op_MOV_RI: r[pc->a] = pc->imm; NEXT();
+op_LOADG: r[pc->a] = g[pc->b]; NEXT();
+op_STOREG: g[pc->b] = r[pc->a]; NEXT();
+op_STOREG_I: g[pc->b] = pc->imm; NEXT();
+
+op_ADD_RR: r[pc->a] = add(r[pc->b], r[pc->c]); NEXT();
+op_ADD_RI: r[pc->a] = add(r[pc->b], pc->imm); NEXT();
+op_SUB_RR: r[pc->a] = sub(r[pc->b], r[pc->c]); NEXT();
+op_SUB_RI: r[pc->a] = sub(r[pc->b], pc->imm); NEXT();
+op_SUB_IR: r[pc->a] = sub(pc->imm, r[pc->b]); NEXT();
+op_MUL_RR: r[pc->a] = mul(r[pc->b], r[pc->c]); NEXT();
+op_MUL_RI: r[pc->a] = mul(r[pc->b], pc->imm); NEXT();
+op_DIV_RR: r[pc->a] = divide(r[pc->b], r[pc->c]); NEXT();
+op_DIV_RI: r[pc->a] = divide(r[pc->b], pc->imm); NEXT();
+op_DIV_IR: r[pc->a] = divide(pc->imm, r[pc->b]); NEXT();
+
+op_EQ_RR: r[pc->a] = r[pc->b] == r[pc->c]; NEXT();
+op_EQ_RI: r[pc->a] = r[pc->b] == pc->imm; NEXT();
+op_NE_RR: r[pc->a] = r[pc->b] != r[pc->c]; NEXT();
+op_NE_RI: r[pc->a] = r[pc->b] != pc->imm; NEXT();
+op_LT_RR: r[pc->a] = r[pc->b] < r[pc->c]; NEXT();
+op_LT_RI: r[pc->a] = r[pc->b] < pc->imm; NEXT();
+op_GT_RR: r[pc->a] = r[pc->b] > r[pc->c]; NEXT();
+op_GT_RI: r[pc->a] = r[pc->b] > pc->imm; NEXT();
+op_LE_RR: r[pc->a] = r[pc->b] <= r[pc->c]; NEXT();
+op_LE_RI: r[pc->a] = r[pc->b] <= pc->imm; NEXT();
+op_GE_RR: r[pc->a] = r[pc->b] >= r[pc->c]; NEXT();
+op_GE_RI: r[pc->a] = r[pc->b] >= pc->imm; NEXT();
+op_NOT_R: r[pc->a] = r[pc->b] == 0; NEXT();
+
+op_JMP: pc = code + pc->a; DISPATCH();
+op_JZ: JUMP_IF(r[pc->b] == 0);
+op_JNZ: JUMP_IF(r[pc->b] != 0);
+op_JEQ_RR: JUMP_IF(r[pc->b] == r[pc->c]);
+op_JEQ_RI: JUMP_IF(r[pc->b] == pc->imm);
+op_JNE_RR: JUMP_IF(r[pc->b] != r[pc->c]);
+op_JNE_RI: JUMP_IF(r[pc->b] != pc->imm);
+op_JLT_RR: JUMP_IF(r[pc->b] < r[pc->c]);
+op_JLT_RI: JUMP_IF(r[pc->b] < pc->imm);
+op_JGT_RR: JUMP_IF(r[pc->b] > r[pc->c]);
+op_JGT_RI: JUMP_IF(r[pc->b] > pc->imm);
+op_JLE_RR: JUMP_IF(r[pc->b] <= r[pc->c]);
+op_JLE_RI: JUMP_IF(r[pc->b] <= pc->imm);
+op_JGE_RR: JUMP_IF(r[pc->b] >= r[pc->c]);
+op_JGE_RI: JUMP_IF(r[pc->b] >= pc->imm);
+
+op_CALL: {
+    const BcFunction& callee = program.functions[pc->b];
+    size_t calleeBase = base + static_cast<size_t>(registerCount);
+    size_t needed = calleeBase + static_cast<size_t>(callee.registerCount);
+    if (needed > stack.size()) {
+        stack.resize(2 * needed, 0);
+        r = stack.data() + base;
+    }
+    int64_t* next = stack.data() + calleeBase;
+    const BcArg* args = program.args.data() + pc->c;
+    for (size_t i = 0; i < callee.params.size(); i++) {
+        next[callee.params[i]] = static_cast<int64_t>(i) < pc->imm ? argument(args[i], r, g) : 0;
+    }
+    frames.push_back(Frame{code, pc + 1, base, registerCount, pc->a});
+    base = calleeBase;
+    registerCount = callee.registerCount;
+    code = threaded[pc->b].data();
+    pc = code;
+    r = next;
+    DISPATCH();
+}
+
+op_CALL_EXTERN: {
+    int64_t values[6] = {0, 0, 0, 0, 0, 0};
+    const BcArg* args = program.args.data() + pc->c;
+    for (int64_t i = 0; i < pc->imm; i++) values[i] = argument(args[i], r, g);
+    r[pc->a] = callExtern(externs[pc->b], values, pc->imm);
+    NEXT();
+}
+
+op_RET_R: value = r[pc->a]; goto doReturn;
+op_RET_I: value = pc->imm; goto doReturn;
+doReturn: {
+    Frame frame = frames.back();
+    frames.pop_back();
+    base = frame.base;
+    registerCount = frame.registerCount;
+    code = frame.code;
+    pc = frame.returnTo;
+    r = stack.data() + base;
+    r[frame.dst] = value;
+    DISPATCH();
+}
+
+op_PRINT_R: host.print(r[pc->a]); NEXT();
+op_PRINT_I: host.print(pc->imm); NEXT();
+op_FLUSH: host.flush(); NEXT();
+
+op_EXIT_R: value = r[pc->a]; goto doExit;
+op_EXIT_I: value = pc->imm; goto doExit;
+doExit:
+    host.exit(value);
+    return value;
+
+#undef DISPATCH
+#undef NEXT
+#undef JUMP_IF
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "bytecode.h"
+#include "host.h"
+#include <cstdint>
+#include <vector>
+
+// Interpretador do bytecode com despacho por goto computado: cada
+// instrucao guarda o endereco do seu tratador e o tratador salta direto
+// para o da proxima, sem voltar a um switch central.
+class Vm {
+public:
+    Vm(const BcProgram& program, RuntimeHost& host);
+    long long run();
+
+private:
+    struct Slot {
+        const void* handler;
+        int32_t a;
+        int32_t b;
+        int32_t c;
+        int64_t imm;
+    };
+
+    struct Frame {
+        const Slot* code;
+        const Slot* returnTo;
+        size_t base;
+        int32_t registerCount;
+        int32_t dst;
+    };
+
+    const BcProgram& program;
+    RuntimeHost& host;
+    std::vector<std::vector<Slot>> threaded;
+    std::vector<void*> externs;
+    std::vector<int64_t> globals;
+    std::vector<int64_t> stack;
+    std::vector<Frame> frames;
+};
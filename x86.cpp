@@ -0,0 +1,48 @@
+#include "x86.h"
+
+RegMask callerSavedMask() {
+    return regBit(Reg::RAX) | regBit(Reg::RCX) | regBit(Reg::RDX) | regBit(Reg::RSI) |
+           regBit(Reg::RDI) | regBit(Reg::R8) | regBit(Reg::R9) | regBit(Reg::R10) |
+           regBit(Reg::R11);
+}
+
+RegMask calleeSavedMask() {
+    return regBit(Reg::RBX) | regBit(Reg::R12) | regBit(Reg::R13) | regBit(Reg::R14) |
+           regBit(Reg::R15);
+}
+
+RegMask allocatableMask() {
+    return (callerSavedMask() | calleeSavedMask()) & ~regBit(SCRATCH);
+}
+
+const char* regName(Reg r) {
+    static const char* names[NUM_REGS] = {
+        "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+        "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+    };
+    return names[static_cast<int>(r)];
+}
+
+const char* regName32(Reg r) {
+    static const char* names[NUM_REGS] = {
+        "%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+        "%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"
+    };
+    return names[static_cast<int>(r)];
+}
+
+const char* regName8(Reg r) {
+    static const char* names[NUM_REGS] = {
+        "%al", "%cl", "%dl", "%bl", "%spl", "%bpl", "%sil", "%dil",
+        "%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b"
+    };
+    return names[static_cast<int>(r)];
+}
+
+const char* xmmName(int number) {
+    static const char* names[VECTOR_REGS] = {
+        "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7",
+        "%xmm8", "%xmm9", "%xmm10", "%xmm11", "%xmm12", "%xmm13", "%xmm14", "%xmm15"
+    };
+    return names[number];
+}
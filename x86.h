@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+
+// Registradores de proposito geral na ordem de codificacao do x86-64.
+enum class Reg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+const int NUM_REGS = 16;
+
+typedef uint32_t RegMask;
+
+inline RegMask regBit(Reg r) {
+    return 1u << static_cast<int>(r);
+}
+
+// rsp e rbp formam o quadro e r11 fica reservado como registrador de rascunho
+// do emissor; os outros 13 sao alocaveis.
+const Reg SCRATCH = Reg::R11;
+
+RegMask callerSavedMask();
+RegMask calleeSavedMask();
+RegMask allocatableMask();
+
+const char* regName(Reg r);
+const char* regName32(Reg r);
+const char* regName8(Reg r);
+
+// %xmm0 a %xmm15, usados so nos lacos vetorizados; o emissor guarda o
+// xmm15 como rascunho.
+const int VECTOR_REGS = 16;
+const int VECTOR_SCRATCH = 15;
+
+const char* xmmName(int number);